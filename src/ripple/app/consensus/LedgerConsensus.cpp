@@ -1478,27 +1478,26 @@ private:
 
         if (set)
         {
+            std::vector <SerializedTransaction::pointer> candidates;
+            std::vector <SerializedTransaction::pointer> unchecked;
+
             for (SHAMapItem::pointer item = set->peekFirstItem (); !!item;
                 item = set->peekNextItem (item->getTag ()))
             {
                 // If the checkLedger doesn't have the transaction
                 if (!checkLedger->hasTransaction (item->getTag ()))
                 {
-                    // Then try to apply the transaction to applyLedger
                     WriteLog (lsINFO, LedgerConsensus) <<
                         "Processing candidate transaction: " << item->getTag ();
                     try
                     {
                         SerializerIterator sit (item->peekSerializer ());
-                        SerializedTransaction::pointer txn
-                            = std::make_shared<SerializedTransaction>(sit);
-                        if (applyTransaction (engine, txn,
-                                              openLgr, true) == resultRetry)
-                        {
-                            // On failure, stash the failed transaction for
-                            // later retry.
-                            retriableTransactions.push_back (txn);
-                        }
+                        candidates.push_back (
+                            std::make_shared<SerializedTransaction>(sit));
+
+                        if ((getApp().getHashRouter ().getFlags (
+                                item->getTag ()) & SF_SIGGOOD) == 0)
+                            unchecked.push_back (candidates.back ());
                     }
                     catch (...)
                     {
@@ -1506,6 +1505,29 @@ private:
                     }
                 }
             }
+
+            // Verify the signatures we have not seen yet in parallel, so
+            // applying the transactions under the lock does not have to.
+            getApp().getSignatureCache ().checkBatch (unchecked);
+
+            for (auto const& txn : candidates)
+            {
+                // Then try to apply the transaction to applyLedger
+                try
+                {
+                    if (applyTransaction (engine, txn,
+                                          openLgr, true) == resultRetry)
+                    {
+                        // On failure, stash the failed transaction for
+                        // later retry.
+                        retriableTransactions.push_back (txn);
+                    }
+                }
+                catch (...)
+                {
+                    WriteLog (lsWARNING, LedgerConsensus) << "  Throws";
+                }
+            }
         }
 
         int changes;
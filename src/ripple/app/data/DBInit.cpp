@@ -67,6 +67,85 @@ const char* TxnDBInit[] =
 
 int TxnDBCount = std::extent<decltype(TxnDBInit)>::value;
 
+// Transaction database with binary keys, see [transaction_db_binary]
+const char* TxnBinaryDBInit[] =
+{
+    "PRAGMA synchronous=NORMAL;",
+    "PRAGMA journal_mode=WAL;",
+    "PRAGMA journal_size_limit=1582080;",
+
+#if (ULONG_MAX > UINT_MAX) && !defined (NO_SQLITE_MMAP)
+    "PRAGMA mmap_size=17179869184;",
+#endif
+
+    "BEGIN TRANSACTION;",
+
+    "CREATE TABLE Transactions (                \
+        TransID     BLOB PRIMARY KEY,           \
+        TransType   INTEGER,                    \
+        FromAcct    BLOB,                       \
+        FromSeq     INTEGER,                    \
+        LedgerSeq   INTEGER,                    \
+        Status      CHARACTER(1),               \
+        RawTxn      BLOB,                       \
+        TxnMeta     BLOB                        \
+    );",
+    "CREATE INDEX TxLgrIndex ON                 \
+        Transactions(LedgerSeq);",
+
+    "CREATE TABLE AccountTransactions (         \
+        TransID     BLOB,                       \
+        Account     BLOB,                       \
+        LedgerSeq   INTEGER,                    \
+        TxnSeq      INTEGER                     \
+    );",
+    "CREATE INDEX AcctTxIDIndex ON              \
+        AccountTransactions(TransID);",
+    "CREATE INDEX AcctTxIndex ON                \
+        AccountTransactions(Account, LedgerSeq, TxnSeq, TransID);",
+    "CREATE INDEX AcctLgrIndex ON               \
+        AccountTransactions(LedgerSeq, Account, TransID);",
+
+    "END TRANSACTION;"
+};
+
+int TxnBinaryDBCount = std::extent<decltype(TxnBinaryDBInit)>::value;
+
+std::string txnDBKey (uint256 const& transactionID)
+{
+    if (getConfig ().TXN_DB_BINARY)
+        return "X'" + to_string (transactionID) + "'";
+
+    return "'" + to_string (transactionID) + "'";
+}
+
+std::string txnDBKey (Account const& account)
+{
+    if (getConfig ().TXN_DB_BINARY)
+        return "X'" + strHex (account.begin (), account.size ()) + "'";
+
+    return "'" + to_string (account) + "'";
+}
+
+int bindTxnDBKey (SqliteStatement& statement, int position,
+    uint256 const& transactionID)
+{
+    if (getConfig ().TXN_DB_BINARY)
+        return statement.bind (position,
+            transactionID.begin (), transactionID.size ());
+
+    return statement.bind (position, to_string (transactionID));
+}
+
+int bindTxnDBKey (SqliteStatement& statement, int position,
+    Account const& account)
+{
+    if (getConfig ().TXN_DB_BINARY)
+        return statement.bind (position, account.begin (), account.size ());
+
+    return statement.bind (position, to_string (account));
+}
+
 // Ledger database holds ledgers and ledger confirmations
 const char* LedgerDBInit[] =
 {
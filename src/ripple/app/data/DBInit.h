@@ -29,15 +29,29 @@ namespace ripple {
 // VFALCO TODO Tidy these up into a class with functions and return types.
 extern const char* RpcDBInit[];
 extern const char* TxnDBInit[];
+extern const char* TxnBinaryDBInit[];
 extern const char* LedgerDBInit[];
 extern const char* WalletDBInit[];
 
 // VFALCO TODO Figure out what these counts are for
 extern int RpcDBCount;
 extern int TxnDBCount;
+extern int TxnBinaryDBCount;
 extern int LedgerDBCount;
 extern int WalletDBCount;
 
+/** Returns an SQL literal for a key in the transaction database.
+    Keys are hex text, or raw bytes with the binary schema.
+*/
+std::string txnDBKey (uint256 const& transactionID);
+std::string txnDBKey (Account const& account);
+
+/** Binds a key in the transaction database to a prepared statement. */
+int bindTxnDBKey (SqliteStatement& statement, int position,
+    uint256 const& transactionID);
+int bindTxnDBKey (SqliteStatement& statement, int position,
+    Account const& account);
+
 } // ripple
 
 #endif
@@ -0,0 +1,590 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/app/main/Tuning.h>
+#include <beast/unit_test/suite.h>
+#include <limits>
+
+namespace ripple {
+
+static bool rowBefore (AccountTxPager::RowPtr const& row,
+    AccountTxPager::Key const& key)
+{
+    return row->key < key;
+}
+
+static bool keyBefore (AccountTxPager::Key const& key,
+    AccountTxPager::RowPtr const& row)
+{
+    return key < row->key;
+}
+
+bool AccountTxPager::History::getPage (
+    std::uint32_t minLedger, std::uint32_t maxLedger, bool forward,
+    Key const* marker, std::size_t limit, Rows& page, bool& more,
+    Key& next) const
+{
+    more = false;
+
+    if (forward)
+    {
+        Key start (minLedger, 0);
+
+        if (marker && start < *marker)
+            start = *marker;
+
+        if (start.ledgerSeq < floor)
+            return false;
+
+        auto it = std::lower_bound (rows.begin (), rows.end (), start,
+            rowBefore);
+
+        for (; (it != rows.end ()) && ((*it)->key.ledgerSeq <= maxLedger); ++it)
+        {
+            if (page.size () == limit)
+            {
+                more = true;
+                next = (*it)->key;
+                break;
+            }
+
+            page.push_back (*it);
+        }
+
+        return true;
+    }
+
+    Key start (maxLedger, std::numeric_limits <std::uint32_t>::max ());
+
+    if (marker && *marker < start)
+        start = *marker;
+
+    auto it = std::upper_bound (rows.begin (), rows.end (), start, keyBefore);
+
+    while (it != rows.begin ())
+    {
+        --it;
+
+        if ((*it)->key.ledgerSeq < minLedger)
+            return true;
+
+        if (page.size () == limit)
+        {
+            more = true;
+            next = (*it)->key;
+            return true;
+        }
+
+        page.push_back (*it);
+    }
+
+    // The page ran into the floor, rows below it are not cached
+    if (minLedger < floor)
+    {
+        page.clear ();
+        return false;
+    }
+
+    return true;
+}
+
+void AccountTxPager::History::setLedger (std::uint32_t ledgerSeq,
+    Rows const& ledgerRows)
+{
+    if (ledgerSeq < floor)
+        return;
+
+    auto first = std::lower_bound (rows.begin (), rows.end (),
+        Key (ledgerSeq, 0), rowBefore);
+    auto last = std::upper_bound (first, rows.end (),
+        Key (ledgerSeq, std::numeric_limits <std::uint32_t>::max ()),
+            keyBefore);
+
+    first = rows.erase (first, last);
+    rows.insert (first, ledgerRows.begin (), ledgerRows.end ());
+}
+
+void AccountTxPager::History::trim (std::size_t maxRows)
+{
+    if (rows.size () <= maxRows)
+        return;
+
+    // Only whole ledgers can be dropped
+    floor = rows[rows.size () - maxRows - 1]->key.ledgerSeq + 1;
+
+    rows.erase (rows.begin (), std::lower_bound (rows.begin (), rows.end (),
+        Key (floor, 0), rowBefore));
+}
+
+//------------------------------------------------------------------------------
+
+AccountTxPager::AccountTxPager (DatabaseCon& txnDB, beast::Journal journal)
+    : m_txnDB (txnDB)
+    , m_journal (journal)
+    , m_epoch (0)
+{
+}
+
+AccountTxPager::~AccountTxPager ()
+{
+    // The statements must be finalized while the database is still open
+    auto sl (m_txnDB.lock ());
+    m_forward.reset ();
+    m_backward.reset ();
+}
+
+bool AccountTxPager::getPage (Account const& account,
+    std::uint32_t minLedger, std::uint32_t maxLedger, bool forward,
+    Key const* marker, std::size_t limit, Rows& page, Key& next)
+{
+    int const now = UptimeTimer::getInstance ().getElapsedSeconds ();
+    bool more = false;
+    bool load = false;
+    std::uint64_t epoch;
+
+    page.clear ();
+
+    {
+        ScopedLockType sl (m_lock);
+
+        auto it = m_cache.find (account);
+
+        if (it != m_cache.end ())
+        {
+            it->second.lastUse = now;
+
+            if (it->second.getPage (minLedger, maxLedger, forward, marker,
+                    limit, page, more, next))
+                return more;
+        }
+        else
+        {
+            load = ++m_requests[account] >= accountTxCacheHotRequests;
+        }
+
+        epoch = m_epoch;
+    }
+
+    History history;
+
+    if (load && loadHistory (account, history))
+    {
+        history.lastUse = now;
+
+        ScopedLockType sl (m_lock);
+
+        // Drop the history if a ledger was written while it loaded
+        if (epoch == m_epoch)
+        {
+            m_requests.erase (account);
+
+            if (m_cache.size () >= accountTxCacheAccounts)
+            {
+                auto oldest = m_cache.begin ();
+
+                for (auto it = m_cache.begin (); it != m_cache.end (); ++it)
+                {
+                    if (it->second.lastUse < oldest->second.lastUse)
+                        oldest = it;
+                }
+
+                m_cache.erase (oldest);
+            }
+
+            History& cached = m_cache[account];
+            cached = std::move (history);
+
+            if (cached.getPage (minLedger, maxLedger, forward, marker,
+                    limit, page, more, next))
+                return more;
+        }
+    }
+
+    return queryPage (account, minLedger, maxLedger, forward, marker,
+        limit, page, next);
+}
+
+void AccountTxPager::onLedgerWritten (AcceptedLedger const& ledger)
+{
+    std::uint32_t const ledgerSeq = ledger.getLedger ()->getLedgerSeq ();
+
+    ScopedLockType sl (m_lock);
+
+    ++m_epoch;
+
+    if (m_cache.empty ())
+        return;
+
+    hash_map <Account, Rows> affected;
+
+    for (auto const& vt : ledger.getMap ())
+    {
+        AcceptedLedgerTx const& tx = *vt.second;
+        RowPtr row;
+
+        for (auto const& address : tx.getAffected ())
+        {
+            Account const& account = address.getAccountID ();
+            auto it = m_cache.find (account);
+
+            if ((it == m_cache.end ()) || (ledgerSeq < it->second.floor))
+                continue;
+
+            if (!row)
+            {
+                auto newRow = std::make_shared <Row> ();
+                Serializer rawTxn;
+                tx.getTxn ()->add (rawTxn);
+                newRow->key = Key (ledgerSeq, tx.getTxnSeq ());
+                newRow->status = TXN_SQL_VALIDATED;
+                newRow->rawTxn = rawTxn.peekData ();
+                newRow->rawMeta = tx.getRawMeta ();
+                row = newRow;
+            }
+
+            Rows& rows = affected[account];
+
+            if (rows.empty () || (rows.back () != row))
+                rows.push_back (row);
+        }
+    }
+
+    // A rewritten ledger can also drop rows an account had in it
+    Rows const none;
+
+    for (auto& entry : m_cache)
+    {
+        auto const it = affected.find (entry.first);
+
+        entry.second.setLedger (ledgerSeq,
+            (it == affected.end ()) ? none : it->second);
+        entry.second.trim (accountTxCacheRows);
+    }
+}
+
+void AccountTxPager::sweep ()
+{
+    int const now = UptimeTimer::getInstance ().getElapsedSeconds ();
+
+    ScopedLockType sl (m_lock);
+
+    m_requests.clear ();
+
+    for (auto it = m_cache.begin (); it != m_cache.end ();)
+    {
+        if ((now - it->second.lastUse) > accountTxCacheExpirationSeconds)
+            it = m_cache.erase (it);
+        else
+            ++it;
+    }
+}
+
+bool AccountTxPager::queryPage (Account const& account,
+    std::uint32_t minLedger, std::uint32_t maxLedger, bool forward,
+    Key const* marker, std::size_t limit, Rows& page, Key& next)
+{
+    Key start = forward
+        ? Key (minLedger, 0)
+        : Key (maxLedger, std::numeric_limits <std::uint32_t>::max ());
+
+    if (marker && (forward ? (start < *marker) : (*marker < start)))
+        start = *marker;
+
+    bool more = false;
+
+    auto db = m_txnDB.getDB ();
+    auto sl (m_txnDB.lock ());
+
+    if (!m_forward)
+    {
+        // The (Account, LedgerSeq) prefix of AcctTxIndex bounds the scan,
+        // and its order matches the ORDER BY, so only the rows returned
+        // are visited.
+        SqliteDatabase* sqlite = db->getSqliteDB ();
+
+        m_forward = std::make_unique <SqliteStatement> (sqlite,
+            "SELECT AccountTransactions.LedgerSeq,AccountTransactions.TxnSeq,"
+            "Status,RawTxn,TxnMeta "
+            "FROM AccountTransactions INDEXED BY AcctTxIndex "
+            "INNER JOIN Transactions "
+            "ON Transactions.TransID = AccountTransactions.TransID "
+            "WHERE AccountTransactions.Account = ?1 "
+            "AND AccountTransactions.LedgerSeq >= ?2 "
+            "AND AccountTransactions.LedgerSeq <= ?4 "
+            "AND (AccountTransactions.LedgerSeq > ?2 "
+            "OR AccountTransactions.TxnSeq >= ?3) "
+            "ORDER BY AccountTransactions.LedgerSeq ASC, "
+            "AccountTransactions.TxnSeq ASC, AccountTransactions.TransID ASC "
+            "LIMIT ?5;");
+        m_backward = std::make_unique <SqliteStatement> (sqlite,
+            "SELECT AccountTransactions.LedgerSeq,AccountTransactions.TxnSeq,"
+            "Status,RawTxn,TxnMeta "
+            "FROM AccountTransactions INDEXED BY AcctTxIndex "
+            "INNER JOIN Transactions "
+            "ON Transactions.TransID = AccountTransactions.TransID "
+            "WHERE AccountTransactions.Account = ?1 "
+            "AND AccountTransactions.LedgerSeq <= ?2 "
+            "AND AccountTransactions.LedgerSeq >= ?4 "
+            "AND (AccountTransactions.LedgerSeq < ?2 "
+            "OR AccountTransactions.TxnSeq <= ?3) "
+            "ORDER BY AccountTransactions.LedgerSeq DESC, "
+            "AccountTransactions.TxnSeq DESC, AccountTransactions.TransID DESC "
+            "LIMIT ?5;");
+    }
+
+    SqliteStatement& statement = forward ? *m_forward : *m_backward;
+
+    bindTxnDBKey (statement, 1, account);
+    statement.bind (2, start.ledgerSeq);
+    statement.bind (3, start.txnSeq);
+    statement.bind (4, forward ? maxLedger : minLedger);
+    statement.bind (5, static_cast <std::uint32_t> (limit + 1));
+
+    for (;;)
+    {
+        int const result = statement.step ();
+
+        if (!statement.isRow (result))
+        {
+            if (!statement.isDone (result))
+                m_journal.warning << "Account transaction query failed: " <<
+                    statement.getError (result);
+            break;
+        }
+
+        Key const key (statement.getUInt32 (0), statement.getUInt32 (1));
+
+        if (page.size () == limit)
+        {
+            more = true;
+            next = key;
+            break;
+        }
+
+        auto row = std::make_shared <Row> ();
+        char const* status = statement.peekString (2);
+        row->key = key;
+        row->status = (status && *status) ? *status : TXN_SQL_UNKNOWN;
+        row->rawTxn = statement.getBlob (3);
+        row->rawMeta = statement.getBlob (4);
+        page.push_back (row);
+    }
+
+    statement.reset ();
+    return more;
+}
+
+bool AccountTxPager::loadHistory (Account const& account, History& history)
+{
+    Key next;
+    bool const more = queryPage (account, 0,
+        std::numeric_limits <std::uint32_t>::max (), false, nullptr,
+            accountTxCacheRows, history.rows, next);
+
+    std::reverse (history.rows.begin (), history.rows.end ());
+
+    if (more)
+    {
+        // The rest of the ledger holding the next row was not read
+        history.floor = next.ledgerSeq + 1;
+        history.rows.erase (history.rows.begin (),
+            std::lower_bound (history.rows.begin (), history.rows.end (),
+                Key (history.floor, 0), rowBefore));
+    }
+
+    if (history.rows.empty ())
+        return !more;
+
+    m_journal.debug << "Cached " << history.rows.size () <<
+        " transactions of " << to_string (account);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+class AccountTxPager_test : public beast::unit_test::suite
+{
+public:
+    typedef AccountTxPager::Key Key;
+    typedef AccountTxPager::Rows Rows;
+
+    // Every row of the account, the database a history is a window of
+    static Rows makeRows (std::uint32_t ledgers)
+    {
+        Rows rows;
+
+        for (std::uint32_t ledger = 1; ledger <= ledgers; ++ledger)
+        {
+            for (std::uint32_t seq = 0; seq < (ledger % 3); ++seq)
+            {
+                auto row = std::make_shared <AccountTxPager::Row> ();
+                row->key = Key (ledger, seq);
+                row->status = TXN_SQL_VALIDATED;
+                rows.push_back (row);
+            }
+        }
+
+        return rows;
+    }
+
+    // The page the database query would return
+    static bool expectedPage (Rows const& all, std::uint32_t minLedger,
+        std::uint32_t maxLedger, bool forward, Key const* marker,
+        std::size_t limit, Rows& page, Key& next)
+    {
+        Rows candidates;
+
+        for (auto const& row : all)
+        {
+            if ((row->key.ledgerSeq < minLedger) ||
+                (row->key.ledgerSeq > maxLedger))
+                continue;
+
+            if (marker && (forward ? (row->key < *marker) :
+                    (*marker < row->key)))
+                continue;
+
+            candidates.push_back (row);
+        }
+
+        if (!forward)
+            std::reverse (candidates.begin (), candidates.end ());
+
+        page.assign (candidates.begin (), candidates.begin () +
+            std::min (limit, candidates.size ()));
+
+        if (candidates.size () <= limit)
+            return false;
+
+        next = candidates[limit]->key;
+        return true;
+    }
+
+    void testPages ()
+    {
+        Rows const all = makeRows (60);
+
+        AccountTxPager::History history;
+        history.rows = all;
+        history.trim (25);
+
+        expect (history.floor > 1, "floor not raised");
+        expect (history.rows.size () <= 25, "history not trimmed");
+        expect (history.rows.front ()->key.ledgerSeq >= history.floor,
+            "rows below the floor kept");
+
+        int served = 0;
+        int missed = 0;
+
+        for (std::uint32_t minLedger = 1; minLedger <= 60; minLedger += 7)
+        {
+            for (std::uint32_t maxLedger = minLedger; maxLedger <= 64;
+                maxLedger += 5)
+            {
+                for (int forward = 0; forward < 2; ++forward)
+                {
+                    for (std::size_t limit = 1; limit < 30; limit += 4)
+                    {
+                        for (std::size_t m = 0; m <= all.size (); m += 3)
+                        {
+                            Key const* marker = (m == all.size ())
+                                ? nullptr : &all[m]->key;
+
+                            Rows page;
+                            Key next;
+                            bool more;
+
+                            if (!history.getPage (minLedger, maxLedger,
+                                forward != 0, marker, limit, page, more, next))
+                            {
+                                ++missed;
+                                continue;
+                            }
+
+                            ++served;
+
+                            Rows wantPage;
+                            Key wantNext;
+                            bool const wantMore = expectedPage (all,
+                                minLedger, maxLedger, forward != 0, marker,
+                                    limit, wantPage, wantNext);
+
+                            if (!expect (page == wantPage, "wrong page") ||
+                                !expect (more == wantMore, "wrong more"))
+                                return;
+
+                            if (more)
+                            {
+                                expect (!(next < wantNext) &&
+                                    !(wantNext < next), "wrong next");
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        expect (served > 0 && missed > 0, "test did not cover both paths");
+    }
+
+    void testSetLedger ()
+    {
+        AccountTxPager::History history;
+        history.rows = makeRows (10);
+        history.floor = 1;
+
+        auto row = std::make_shared <AccountTxPager::Row> ();
+        row->key = Key (5, 7);
+
+        history.setLedger (5, Rows (1, row));
+
+        Rows page;
+        Key next;
+        bool more;
+
+        expect (history.getPage (5, 5, true, nullptr, 10, page, more, next));
+        expect (page.size () == 1 && page[0] == row, "ledger not replaced");
+
+        auto newRow = std::make_shared <AccountTxPager::Row> ();
+        newRow->key = Key (11, 0);
+
+        history.setLedger (11, Rows (1, newRow));
+        history.setLedger (5, Rows ());
+
+        page.clear ();
+        expect (history.getPage (5, 5, true, nullptr, 10, page, more, next));
+        expect (page.empty (), "ledger not cleared");
+        expect (history.rows.back () == newRow, "new ledger not added");
+    }
+
+    void run ()
+    {
+        testPages ();
+        testSetLedger ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(AccountTxPager,ripple_app,ripple);
+
+} // ripple
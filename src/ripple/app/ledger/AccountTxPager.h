@@ -0,0 +1,159 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_ACCOUNTTXPAGER_H_INCLUDED
+#define RIPPLE_ACCOUNTTXPAGER_H_INCLUDED
+
+#include <beast/utility/Journal.h>
+#include <mutex>
+
+namespace ripple {
+
+/** Pages through the transactions that affected an account.
+
+    Rows are ordered by (LedgerSeq, TxnSeq). A page seeks directly to its
+    marker on the AcctTxIndex index instead of skipping the rows before
+    it, so a deep page costs the same as the first one.
+
+    The most recent rows of accounts that are requested often are kept in
+    memory. They are updated as ledgers are written, so clients polling a
+    busy account are served without touching the database.
+*/
+class AccountTxPager
+{
+public:
+    /** The position of a row in the history of an account. */
+    struct Key
+    {
+        std::uint32_t ledgerSeq;
+        std::uint32_t txnSeq;
+
+        Key ()
+            : ledgerSeq (0)
+            , txnSeq (0)
+        {
+        }
+
+        Key (std::uint32_t ledgerSeq_, std::uint32_t txnSeq_)
+            : ledgerSeq (ledgerSeq_)
+            , txnSeq (txnSeq_)
+        {
+        }
+
+        bool operator< (Key const& other) const
+        {
+            return (ledgerSeq < other.ledgerSeq) ||
+                ((ledgerSeq == other.ledgerSeq) && (txnSeq < other.txnSeq));
+        }
+    };
+
+    struct Row
+    {
+        Key key;
+        char status;
+        Blob rawTxn;
+        Blob rawMeta;
+    };
+
+    typedef std::shared_ptr <Row const> RowPtr;
+    typedef std::vector <RowPtr> Rows;
+
+    /** The cached history of one account.
+        Holds every row of the account in ledgers at or above the floor,
+        in ascending order.
+    */
+    struct History
+    {
+        Rows rows;
+        std::uint32_t floor;
+        int lastUse;
+
+        History ()
+            : floor (0)
+            , lastUse (0)
+        {
+        }
+
+        /** Serve a page from the cached rows.
+            @return false if the page needs rows below the floor.
+        */
+        bool getPage (std::uint32_t minLedger, std::uint32_t maxLedger,
+            bool forward, Key const* marker, std::size_t limit,
+            Rows& page, bool& more, Key& next) const;
+
+        /** Replace the rows of one ledger. */
+        void setLedger (std::uint32_t ledgerSeq, Rows const& ledgerRows);
+
+        /** Drop the oldest ledgers until at most maxRows rows are held. */
+        void trim (std::size_t maxRows);
+    };
+
+    AccountTxPager (DatabaseCon& txnDB, beast::Journal journal);
+    ~AccountTxPager ();
+
+    /** Fetch a page of the history of an account.
+
+        @param marker The first row of the page, or nullptr to start at the
+                      end of the ledger range the direction starts from.
+        @param next   Set to the first row after the page, if there is one.
+        @return true if there are more rows after the page.
+    */
+    bool getPage (Account const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger, bool forward,
+        Key const* marker, std::size_t limit, Rows& page, Key& next);
+
+    /** Update the cached accounts that a ledger affected.
+        Called once the rows of the ledger are committed.
+    */
+    void onLedgerWritten (AcceptedLedger const& ledger);
+
+    void sweep ();
+
+private:
+    bool queryPage (Account const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger, bool forward,
+        Key const* marker, std::size_t limit, Rows& page, Key& next);
+
+    bool loadHistory (Account const& account, History& history);
+
+    typedef std::mutex LockType;
+    typedef std::lock_guard <LockType> ScopedLockType;
+
+    DatabaseCon& m_txnDB;
+    beast::Journal m_journal;
+
+    // Built on first use, with the database locked
+    std::unique_ptr <SqliteStatement> m_forward;
+    std::unique_ptr <SqliteStatement> m_backward;
+
+    LockType m_lock;
+    hash_map <Account, History> m_cache;
+    hash_map <Account, int> m_requests;
+
+    // Changes whenever cached histories may have missed a ledger
+    std::uint64_t m_epoch;
+};
+
+} // ripple
+
+#endif
@@ -0,0 +1,754 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/core/Config.h>
+#include <beast/unit_test/suite.h>
+#include <beast/module/core/maths/Random.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace ripple {
+
+namespace detail {
+
+// Assigns dense ranks to balances visited in ascending order
+class BalanceRanker
+{
+public:
+    explicit BalanceRanker (std::vector <BalanceRanks::AccountRank>& ranks)
+        : mRanks (ranks)
+        , mRank (0)
+        , mSum (0)
+        , mLast (0)
+    {
+    }
+
+    void operator() (BalanceRanks::Balance const& balance)
+    {
+        if ((mRank == 0) || (balance.first > mLast))
+        {
+            ++mRank;
+            mLast = balance.first;
+        }
+
+        mRanks.emplace_back (balance.second, mRank);
+
+        // Wraps the same way the rank sum always has
+        mSum += mRank;
+    }
+
+    std::uint32_t sum () const
+    {
+        return mSum;
+    }
+
+private:
+    std::vector <BalanceRanks::AccountRank>& mRanks;
+    std::uint32_t mRank;
+    std::uint32_t mSum;
+    std::uint64_t mLast;
+};
+
+// Extract the account and balance from a state map item
+static bool getAccountBalance (SHAMapItem& item,
+    Account& account, std::uint64_t& balance)
+{
+    STObjectView const sle (item.peekData ());
+
+    if (sle.getType () != ltACCOUNT_ROOT)
+        return false;
+
+    account = sle.getFieldAccount160 (sfAccount);
+    balance = sle.getFieldAmount (sfBalance).getNValue ();
+    return true;
+}
+
+} // detail
+
+//------------------------------------------------------------------------------
+
+void BalanceRanks::clear ()
+{
+    mOrdered.clear ();
+    mBalances.clear ();
+}
+
+void BalanceRanks::setBalance (Account const& account, std::uint64_t balance)
+{
+    auto const result = mBalances.emplace (account, balance);
+
+    if (!result.second)
+    {
+        if (result.first->second == balance)
+            return;
+
+        mOrdered.erase (Balance (result.first->second, account));
+        result.first->second = balance;
+    }
+
+    mOrdered.emplace (balance, account);
+}
+
+void BalanceRanks::setBalances (std::vector <Balance>& balances)
+{
+    clear ();
+
+    std::sort (balances.begin (), balances.end ());
+
+    for (auto const& balance : balances)
+    {
+        mBalances.emplace (balance.second, balance.first);
+        mOrdered.emplace_hint (mOrdered.end (), balance);
+    }
+}
+
+void BalanceRanks::removeAccount (Account const& account)
+{
+    auto const iter = mBalances.find (account);
+
+    if (iter != mBalances.end ())
+    {
+        mOrdered.erase (Balance (iter->second, account));
+        mBalances.erase (iter);
+    }
+}
+
+std::uint32_t BalanceRanks::rank (Changes const& changes,
+    std::vector <AccountRank>& ranks) const
+{
+    // The changed balances, to be merged into the ordered walk
+    std::vector <Balance> changed;
+    changed.reserve (changes.size ());
+
+    for (auto const& change : changes)
+    {
+        if (change.second)
+            changed.emplace_back (*change.second, change.first);
+    }
+
+    std::sort (changed.begin (), changed.end ());
+
+    ranks.clear ();
+    ranks.reserve (mOrdered.size () + changed.size ());
+
+    detail::BalanceRanker ranker (ranks);
+    auto next = changed.cbegin ();
+
+    for (auto const& balance : mOrdered)
+    {
+        if (!changes.empty () && (changes.count (balance.second) != 0))
+            continue;
+
+        while ((next != changed.cend ()) && (*next < balance))
+            ranker (*next++);
+
+        ranker (balance);
+    }
+
+    while (next != changed.cend ())
+        ranker (*next++);
+
+    return ranker.sum ();
+}
+
+std::uint32_t BalanceRanks::rank (std::vector <Balance>& balances,
+    std::vector <AccountRank>& ranks)
+{
+    std::sort (balances.begin (), balances.end ());
+
+    ranks.clear ();
+    ranks.reserve (balances.size ());
+
+    detail::BalanceRanker ranker (ranks);
+
+    for (auto const& balance : balances)
+        ranker (balance);
+
+    return ranker.sum ();
+}
+
+//------------------------------------------------------------------------------
+
+BalanceRankIndex::BalanceRankIndex (beast::Journal journal)
+    : m_journal (journal)
+    , mUpdating (false)
+{
+}
+
+void BalanceRankIndex::setup (Ledger::ref ledger)
+{
+    std::vector <BalanceRanks::Balance> balances;
+
+    try
+    {
+        ledger->peekAccountStateMap ()->visitLeaves (
+            [&balances] (SHAMapItem::ref item)
+            {
+                Account account;
+                std::uint64_t balance;
+
+                if (detail::getAccountBalance (*item, account, balance))
+                    balances.emplace_back (balance, account);
+            });
+    }
+    catch (SHAMapMissingNode const& mn)
+    {
+        m_journal.warning << "Unable to index ledger " <<
+            ledger->getLedgerSeq () << ": " << mn;
+        invalidate ();
+        return;
+    }
+
+    BalanceRanks ranks;
+    ranks.setBalances (balances);
+
+    m_journal.debug << "Indexed " << ranks.size () <<
+        " accounts in ledger " << ledger->getLedgerSeq ();
+
+    std::lock_guard <std::mutex> sl (mLock);
+    std::swap (mRanks, ranks);
+    mLedger = ledger;
+}
+
+void BalanceRankIndex::update (AcceptedLedger::pointer const& accepted)
+{
+    {
+        std::lock_guard <std::mutex> sl (mLock);
+
+        // A ledger dropped here leaves a gap, and the index is then
+        // rebuilt from a later ledger
+        if (mPending.size () >= maxPending)
+            mPending.pop_front ();
+
+        mPending.push_back (accepted);
+
+        if (mUpdating)
+            return;
+
+        mUpdating = true;
+    }
+
+    // Applying a large ledger or rebuilding the index from the whole
+    // state map must not hold up publishing
+    if (getConfig ().RUN_STANDALONE)
+        processPending ();
+    else
+        getApp ().getJobQueue ().addJob (jtUPDATE_PF,
+            "BalanceRankIndex::update",
+            [this] (Job&) { processPending (); });
+}
+
+void BalanceRankIndex::processPending ()
+{
+    std::unique_lock <std::mutex> sl (mLock);
+
+    while (!mPending.empty ())
+    {
+        AcceptedLedger::pointer const accepted (mPending.front ());
+        mPending.pop_front ();
+
+        if (advance (*accepted))
+            continue;
+
+        Ledger::ref ledger = accepted->getLedger ();
+
+        if (mLedger && (ledger->getLedgerSeq () <= mLedger->getLedgerSeq ()))
+            continue;
+
+        // The index is empty or a ledger was skipped. Rebuild from the
+        // newest ledger, since the ones before it would be skipped too.
+        Ledger::pointer const newest (mPending.empty () ?
+            ledger : mPending.back ()->getLedger ());
+        mPending.clear ();
+
+        sl.unlock ();
+        setup (newest);
+        sl.lock ();
+    }
+
+    mUpdating = false;
+}
+
+bool BalanceRankIndex::advance (AcceptedLedger const& accepted)
+{
+    Ledger::ref ledger = accepted.getLedger ();
+
+    if (!mLedger || (ledger->getParentHash () != mLedger->getHash ()))
+        return false;
+
+    for (auto const& item : accepted.getMap ())
+    {
+        TransactionMetaSet::ref meta = item.second->getMeta ();
+
+        if (meta && !applyMeta (mRanks, *meta))
+        {
+            m_journal.warning << "Incomplete metadata for " <<
+                item.second->getTransactionID ();
+
+            // The ranks are now only partly updated
+            mLedger.reset ();
+            mRanks.clear ();
+            return false;
+        }
+    }
+
+    mLedger = ledger;
+    return true;
+}
+
+void BalanceRankIndex::invalidate ()
+{
+    std::lock_guard <std::mutex> sl (mLock);
+    mLedger.reset ();
+    mRanks.clear ();
+}
+
+bool BalanceRankIndex::getRanks (Ledger::ref ledger,
+    std::vector <AccountRank>& ranks, std::uint32_t& sum)
+{
+    std::lock_guard <std::mutex> sl (mLock);
+
+    if (!mLedger)
+        return false;
+
+    BalanceRanks::Changes changes;
+
+    try
+    {
+        if (!getChanges (*ledger->peekAccountStateMap (),
+            mLedger->peekAccountStateMap (), changes, maxChanges))
+        {
+            m_journal.info << "Ledger " << ledger->getLedgerSeq () <<
+                " is too far from indexed ledger " << mLedger->getLedgerSeq ();
+            return false;
+        }
+    }
+    catch (SHAMapMissingNode const& mn)
+    {
+        m_journal.warning << "Unable to compare with indexed ledger: " << mn;
+        return false;
+    }
+
+    sum = mRanks.rank (changes, ranks);
+    return true;
+}
+
+std::uint32_t BalanceRankIndex::rankLedger (Ledger::ref ledger,
+    std::vector <AccountRank>& ranks)
+{
+    std::vector <BalanceRanks::Balance> balances;
+
+    ledger->visitStateItems (
+        [&balances] (SLE::ref sle)
+        {
+            if (sle->getType () == ltACCOUNT_ROOT)
+            {
+                balances.emplace_back (
+                    sle->getFieldAmount (sfBalance).getNValue (),
+                    sle->getFieldAccount160 (sfAccount));
+            }
+        });
+
+    return BalanceRanks::rank (balances, ranks);
+}
+
+bool BalanceRankIndex::getChanges (SHAMap& map, SHAMap::ref base,
+    BalanceRanks::Changes& changes, int maxCount)
+{
+    SHAMap::Delta delta;
+
+    if (!map.compare (base, delta, maxCount))
+        return false;
+
+    for (auto const& item : delta)
+    {
+        Account account;
+        std::uint64_t balance;
+
+        if (item.second.first &&
+            detail::getAccountBalance (*item.second.first, account, balance))
+        {
+            changes[account] = balance;
+        }
+        else if (item.second.second &&
+            detail::getAccountBalance (*item.second.second, account, balance))
+        {
+            changes[account] = boost::none;
+        }
+    }
+
+    return true;
+}
+
+bool BalanceRankIndex::applyMeta (BalanceRanks& ranks, TransactionMetaSet& meta)
+{
+    for (auto const& node : meta.getNodes ())
+    {
+        if (node.getFieldU16 (sfLedgerEntryType) != ltACCOUNT_ROOT)
+            continue;
+
+        bool const created = (node.getFName () == sfCreatedNode);
+        int const index = node.getFieldIndex (
+            created ? sfNewFields : sfFinalFields);
+
+        STObject const* fields = (index == -1) ? nullptr :
+            dynamic_cast <STObject const*> (&node.peekAtIndex (index));
+
+        if (!fields || !fields->isFieldPresent (sfAccount))
+            return false;
+
+        Account const account = fields->getFieldAccount160 (sfAccount);
+
+        if (node.getFName () == sfDeletedNode)
+            ranks.removeAccount (account);
+        else if (fields->isFieldPresent (sfBalance))
+            ranks.setBalance (account,
+                fields->getFieldAmount (sfBalance).getNValue ());
+        else if (created)
+            ranks.setBalance (account, 0); // Default values are omitted
+        else
+            return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+class BalanceRankIndex_test : public beast::unit_test::suite
+{
+public:
+    typedef BalanceRanks::AccountRank AccountRank;
+
+    static Account makeAccount (int i)
+    {
+        Serializer s;
+        s.add32 (i);
+        uint256 const hash (s.getSHA512Half ());
+
+        Account account;
+        std::memcpy (account.begin (), hash.begin (), Account::bytes);
+        return account;
+    }
+
+    static SLE::pointer makeAccountRoot (Account const& account,
+        std::uint64_t balance)
+    {
+        SLE::pointer sle (std::make_shared <SLE> (
+            ltACCOUNT_ROOT, Ledger::getAccountRootIndex (account)));
+        sle->setFieldAccount (sfAccount, account);
+        sle->setFieldAmount (sfBalance, STAmount (balance));
+        sle->setFieldU32 (sfSequence, 1);
+        return sle;
+    }
+
+    static Ledger::pointer makeGenesisLedger ()
+    {
+        RippleAddress rootSeedMaster
+                = RippleAddress::createSeedGeneric ("masterpassphrase");
+        RippleAddress rootGeneratorMaster
+                = RippleAddress::createGeneratorPublic (rootSeedMaster);
+        RippleAddress rootAddress
+                = RippleAddress::createAccountPublic (rootGeneratorMaster, 0);
+        return std::make_shared <Ledger> (rootAddress, 100000);
+    }
+
+    // Plenty of accounts share a balance
+    static std::uint64_t randomBalance (beast::Random& r)
+    {
+        return 1000 * static_cast <std::uint64_t> (r.nextInt (1000000));
+    }
+
+    void testRanks ()
+    {
+        testcase ("ranks");
+
+        beast::Random r (42);
+        BalanceRanks ranks;
+        std::map <Account, std::uint64_t> balances;
+
+        for (int i = 0; i < 2000; ++i)
+        {
+            Account const account (makeAccount (i));
+            std::uint64_t const balance = r.nextInt (500);
+            ranks.setBalance (account, balance);
+            balances[account] = balance;
+        }
+
+        for (int i = 0; i < 2000; i += 11)
+        {
+            Account const account (makeAccount (i));
+            ranks.removeAccount (account);
+            balances.erase (account);
+        }
+
+        for (int i = 0; i < 2000; i += 13)
+        {
+            Account const account (makeAccount (i));
+            std::uint64_t const balance = r.nextInt (500);
+            ranks.setBalance (account, balance);
+            balances[account] = balance;
+        }
+
+        expect (ranks.size () == balances.size (), "wrong size");
+
+        // Patch some balances, remove some accounts and add others
+        BalanceRanks::Changes changes;
+
+        for (int i = 0; i < 2200; i += 7)
+        {
+            Account const account (makeAccount (i));
+
+            if (i % 3 == 0)
+            {
+                changes[account] = boost::none;
+                balances.erase (account);
+            }
+            else
+            {
+                std::uint64_t const balance = r.nextInt (600);
+                changes[account] = balance;
+                balances[account] = balance;
+            }
+        }
+
+        std::vector <BalanceRanks::Balance> reference;
+        std::set <std::uint64_t> distinct;
+
+        for (auto const& balance : balances)
+        {
+            reference.emplace_back (balance.second, balance.first);
+            distinct.insert (balance.second);
+        }
+
+        std::vector <AccountRank> expected;
+        std::uint32_t const expectedSum = BalanceRanks::rank (
+            reference, expected);
+
+        std::vector <AccountRank> actual;
+        std::uint32_t const actualSum = ranks.rank (changes, actual);
+
+        expect (actualSum == expectedSum, "wrong sum");
+        expect (actual == expected, "wrong ranks");
+
+        // Each rank counts the distinct balances up to the account's
+        std::uint32_t sum = 0;
+        bool dense = true;
+
+        for (auto const& rank : actual)
+        {
+            auto const iter = distinct.find (balances[rank.first]);
+            std::uint32_t const position = 1 +
+                std::distance (distinct.begin (), iter);
+
+            if (rank.second != position)
+                dense = false;
+
+            sum += position;
+        }
+
+        expect (dense, "ranks not dense");
+        expect (sum == actualSum, "sum mismatch");
+    }
+
+    void testLedger ()
+    {
+        testcase ("ledger");
+
+        beast::Random r (7);
+        Ledger::pointer base (makeGenesisLedger ());
+
+        for (int i = 0; i < 300; ++i)
+            base->writeBack (lepCREATE,
+                makeAccountRoot (makeAccount (i), randomBalance (r)));
+
+        Ledger::pointer ledger (std::make_shared <Ledger> (true, *base));
+
+        for (int i = 0; i < 320; i += 9)
+            ledger->writeBack (lepCREATE,
+                makeAccountRoot (makeAccount (i), randomBalance (r)));
+
+        ledger->peekAccountStateMap ()->delItem (
+            Ledger::getAccountRootIndex (makeAccount (4)));
+
+        BalanceRankIndex index ((beast::Journal ()));
+
+        std::vector <AccountRank> expected;
+        std::uint32_t const expectedSum = BalanceRankIndex::rankLedger (
+            ledger, expected);
+        expect (expected.size () == 302, "wrong account count");
+
+        std::vector <AccountRank> actual;
+        std::uint32_t actualSum = 0;
+        expect (!index.getRanks (ledger, actual, actualSum),
+            "empty index used");
+
+        index.setup (base);
+        expect (index.getRanks (ledger, actual, actualSum), "index unused");
+        expect (actualSum == expectedSum, "wrong sum");
+        expect (actual == expected, "wrong ranks");
+
+        index.invalidate ();
+        expect (!index.getRanks (ledger, actual, actualSum),
+            "invalid index used");
+    }
+
+    static void addMeta (TransactionMetaSet& meta, Account const& account,
+        SField::ref type, SField::ref fields, std::uint64_t const* balance)
+    {
+        uint256 const index (Ledger::getAccountRootIndex (account));
+        meta.setAffectedNode (index, type, ltACCOUNT_ROOT);
+
+        STObject object (fields);
+        object.setFieldAccount (sfAccount, account);
+
+        if (balance)
+            object.setFieldAmount (sfBalance, STAmount (*balance));
+
+        meta.getAffectedNode (index).addObject (object);
+    }
+
+    void testMeta ()
+    {
+        testcase ("metadata");
+
+        Account const a (makeAccount (1));
+        Account const b (makeAccount (2));
+        Account const c (makeAccount (3));
+        std::uint64_t const balance = 300;
+
+        BalanceRanks ranks;
+        ranks.setBalance (a, 100);
+        ranks.setBalance (b, 200);
+
+        TransactionMetaSet meta (uint256 (), 1, 0);
+        addMeta (meta, a, sfModifiedNode, sfFinalFields, &balance);
+        addMeta (meta, b, sfDeletedNode, sfFinalFields, &balance);
+        addMeta (meta, c, sfCreatedNode, sfNewFields, nullptr);
+        expect (BalanceRankIndex::applyMeta (ranks, meta), "meta rejected");
+
+        std::vector <AccountRank> actual;
+        expect (ranks.rank (BalanceRanks::Changes (), actual) == 3,
+            "wrong sum");
+        expect (actual.size () == 2 &&
+            actual[0] == AccountRank (c, 1) &&
+            actual[1] == AccountRank (a, 2), "wrong ranks");
+
+        TransactionMetaSet incomplete (uint256 (), 1, 0);
+        addMeta (incomplete, a, sfModifiedNode, sfFinalFields, nullptr);
+        expect (!BalanceRankIndex::applyMeta (ranks, incomplete),
+            "incomplete meta accepted");
+    }
+
+    void run ()
+    {
+        testRanks ();
+        testLedger ();
+        testMeta ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(BalanceRankIndex,ripple_app,ripple);
+
+//------------------------------------------------------------------------------
+
+/** Compare ranking a large ledger by scanning it against using the index.
+
+    The index is built from a ledger full of synthetic account roots. The
+    next ledger changes some of them, and is then ranked both ways.
+*/
+class BalanceRankIndex_timing_test : public BalanceRankIndex_test
+{
+public:
+    enum
+    {
+        accountCount = 2000000,
+        changeCount = 10000
+    };
+
+    template <class Function>
+    static double elapsed (Function f)
+    {
+        auto const start = std::chrono::steady_clock::now ();
+        f ();
+        return std::chrono::duration_cast <std::chrono::duration <double>> (
+            std::chrono::steady_clock::now () - start).count ();
+    }
+
+    void run ()
+    {
+        beast::Random r;
+        Ledger::pointer base (makeGenesisLedger ());
+
+        for (int i = 0; i < accountCount; ++i)
+            base->writeBack (lepCREATE,
+                makeAccountRoot (makeAccount (i), randomBalance (r)));
+
+        Ledger::pointer ledger (std::make_shared <Ledger> (true, *base));
+
+        for (int i = 0; i < changeCount; ++i)
+            ledger->writeBack (lepCREATE, makeAccountRoot (
+                makeAccount (r.nextInt (accountCount + changeCount)),
+                    randomBalance (r)));
+
+        testcase ("scan");
+
+        std::vector <AccountRank> scanned;
+        std::uint32_t scannedSum = 0;
+        double const scan = elapsed ([&]
+        {
+            scannedSum = BalanceRankIndex::rankLedger (ledger, scanned);
+        });
+
+        log << scanned.size () << " accounts ranked in " << scan << "s";
+
+        testcase ("index");
+
+        BalanceRankIndex index ((beast::Journal ()));
+        double const setup = elapsed ([&]
+        {
+            index.setup (base);
+        });
+
+        std::vector <AccountRank> ranks;
+        std::uint32_t sum = 0;
+        bool used = false;
+        double const patched = elapsed ([&]
+        {
+            used = index.getRanks (ledger, ranks, sum);
+        });
+
+        expect (used, "index unused");
+        expect (sum == scannedSum, "wrong sum");
+        expect (ranks == scanned, "wrong ranks");
+
+        log << accountCount << " accounts indexed in " << setup << "s, " <<
+            ranks.size () << " ranked after " << changeCount <<
+            " changes in " << patched << "s";
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(BalanceRankIndex_timing,ripple_app,ripple);
+
+} // ripple
@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_BALANCERANKINDEX_H_INCLUDED
+#define RIPPLE_BALANCERANKINDEX_H_INCLUDED
+
+#include <boost/optional.hpp>
+#include <deque>
+#include <mutex>
+#include <set>
+
+namespace ripple {
+
+/** Accounts ordered by balance.
+
+    The dividend pays every account in proportion to the dense rank of its
+    balance: the lowest balance has rank 1 and each higher distinct balance
+    has the next rank. This keeps the accounts sorted so the ranks can be
+    produced in one ordered walk instead of a scan and a sort.
+*/
+class BalanceRanks
+{
+public:
+    typedef std::pair <Account, std::uint32_t> AccountRank;
+    typedef std::pair <std::uint64_t, Account> Balance;
+
+    /** Balances that differ from the set, by account.
+        An empty value means the account no longer exists.
+    */
+    typedef hash_map <Account, boost::optional <std::uint64_t>> Changes;
+
+    void clear ();
+
+    void setBalance (Account const& account, std::uint64_t balance);
+
+    /** Replace the contents of the set.
+        The balances are sorted in place.
+    */
+    void setBalances (std::vector <Balance>& balances);
+
+    void removeAccount (Account const& account);
+
+    std::size_t size () const
+    {
+        return mBalances.size ();
+    }
+
+    /** Rank every account in ascending balance order.
+        @param changes Balances that replace the ones in the set.
+        @return The sum of all ranks, modulo 2^32.
+    */
+    std::uint32_t rank (Changes const& changes,
+        std::vector <AccountRank>& ranks) const;
+
+    /** Rank accounts that are not in any set.
+        The balances are sorted in place.
+    */
+    static std::uint32_t rank (std::vector <Balance>& balances,
+        std::vector <AccountRank>& ranks);
+
+private:
+    std::set <Balance> mOrdered;
+    hash_map <Account, std::uint64_t> mBalances;
+};
+
+//------------------------------------------------------------------------------
+
+/** Keeps the balance ranks of a recent ledger up to date.
+
+    The index follows validated ledgers, applying the account root changes
+    recorded in each transaction's metadata. The ranks for a ledger being
+    built are the index's ranks patched with the difference between the two
+    state maps, which is small when the index is current.
+*/
+class BalanceRankIndex
+{
+public:
+    typedef BalanceRanks::AccountRank AccountRank;
+
+    explicit BalanceRankIndex (beast::Journal journal);
+
+    /** Rebuild the index from every account root in the ledger. */
+    void setup (Ledger::ref ledger);
+
+    /** Advance the index to a newly validated ledger.
+        The ledger is applied in a job, not by the caller. If it does not
+        follow the indexed ledger the index is rebuilt from it, and the
+        ledgers validated meanwhile are applied once that finishes.
+    */
+    void update (AcceptedLedger::pointer const& accepted);
+
+    void invalidate ();
+
+    /** Rank every account root in a ledger using the index.
+        @return `false` if the index could not be used.
+    */
+    bool getRanks (Ledger::ref ledger, std::vector <AccountRank>& ranks,
+        std::uint32_t& sum);
+
+    /** Rank every account root in a ledger by visiting its state map. */
+    static std::uint32_t rankLedger (Ledger::ref ledger,
+        std::vector <AccountRank>& ranks);
+
+    /** Find the account roots that differ between two state maps.
+        @return `false` if there are more than maxCount differences.
+    */
+    static bool getChanges (SHAMap& map, SHAMap::ref base,
+        BalanceRanks::Changes& changes, int maxCount);
+
+    /** Apply the account root changes in a transaction's metadata.
+        @return `false` if an account root change was incomplete.
+    */
+    static bool applyMeta (BalanceRanks& ranks, TransactionMetaSet& meta);
+
+private:
+    // Apply the pending ledgers, rebuilding the index when needed
+    void processPending ();
+
+    // Apply a ledger that follows the indexed one
+    bool advance (AcceptedLedger const& accepted);
+
+    enum
+    {
+        // The most state map differences patched onto the index
+        maxChanges = 65536,
+
+        // The most ledgers held while the index is rebuilt
+        maxPending = 256
+    };
+
+    std::mutex mLock;
+    beast::Journal m_journal;
+
+    // The ledger the ranks are for
+    Ledger::pointer mLedger;
+    BalanceRanks mRanks;
+
+    // Validated ledgers not applied yet, and whether a job is applying them
+    std::deque <AcceptedLedger::pointer> mPending;
+    bool mUpdating;
+};
+
+} // ripple
+
+#endif
@@ -566,7 +566,7 @@ void InboundLedger::trigger (Peer::ptr const& peer)
             // Release the lock while we process the large state map
             sl.unlock();
             mLedger->peekAccountStateMap ()->getMissingNodes (
-                nodeIDs, nodeHashes, 256, &filter);
+                nodeIDs, nodeHashes, 256, &filter, getConfig ().SYNC_THREADS);
             sl.lock();
 
             // Make sure nothing happened while we released the lock
@@ -267,19 +267,13 @@ Ledger::Ledger (std::uint32_t ledgerSeq, std::uint32_t closeTime)
 
 Ledger::~Ledger ()
 {
+    // SHAMap::size walks the whole tree, too much to pay on every
+    // destroy just for a log label
     if (mTransactionMap)
-    {
-        logTimedDestroy <Ledger> (mTransactionMap,
-            "mTransactionMap with " +
-            std::to_string(mTransactionMap->size ()) + " items");
-    }
+        logTimedDestroy <Ledger> (mTransactionMap, "mTransactionMap");
 
     if (mAccountStateMap)
-    {
-        logTimedDestroy <Ledger> (mAccountStateMap,
-            "mAccountStateMap with " +
-            std::to_string (mAccountStateMap->size ()) + " items");
-    }
+        logTimedDestroy <Ledger> (mAccountStateMap, "mAccountStateMap");
 }
 
 bool Ledger::enforceFreeze () const
@@ -652,7 +646,7 @@ uint256 Ledger::getHash ()
     return mHash;
 }
 
-bool Ledger::saveValidatedLedger (bool current)
+bool Ledger::saveValidatedLedger (bool current, bool synchronous)
 {
     // TODO(tom): Fix this hard-coded SQL!
     WriteLog (lsTRACE, Ledger)
@@ -660,22 +654,6 @@ bool Ledger::saveValidatedLedger (bool current)
         << (current ? "" : "fromAcquire ") << getLedgerSeq ();
     static boost::format deleteLedger (
         "DELETE FROM Ledgers WHERE LedgerSeq = %u;");
-    static boost::format deleteTrans1 (
-        "DELETE FROM Transactions WHERE LedgerSeq = %u;");
-    static boost::format deleteTrans2 (
-        "DELETE FROM AccountTransactions WHERE LedgerSeq = %u;");
-    static boost::format deleteAcctTrans (
-        "DELETE FROM AccountTransactions WHERE TransID = '%s';");
-    static boost::format transExists (
-        "SELECT Status FROM Transactions WHERE TransID = '%s';");
-    static boost::format updateTx (
-        "UPDATE Transactions SET LedgerSeq = %u, Status = '%c', TxnMeta = %s "
-        "WHERE TransID = '%s';");
-    static boost::format addLedger (
-        "INSERT OR REPLACE INTO Ledgers "
-        "(LedgerHash,LedgerSeq,PrevHash,TotalCoins,TotalCoinsVBC,ClosingTime,PrevClosingTime,"
-        "CloseTimeRes,CloseFlags,DividendTime,AccountSetHash,TransSetHash) VALUES "
-        "('%s','%u','%s','%s','%s','%u','%u','%d','%u','%u','%s','%s');");
 
     if (!getAccountHash ().isNonZero ())
     {
@@ -727,79 +705,22 @@ bool Ledger::saveValidatedLedger (bool current)
             boost::str (deleteLedger % mLedgerSeq));
     }
 
-    {
-        auto db = getApp().getTxnDB ().getDB ();
-        auto dbLock (getApp().getTxnDB ().lock ());
-        db->executeSQL ("BEGIN TRANSACTION;");
-
-        db->executeSQL (boost::str (deleteTrans1 % getLedgerSeq ()));
-        db->executeSQL (boost::str (deleteTrans2 % getLedgerSeq ()));
-
-        std::string const ledgerSeq (std::to_string (getLedgerSeq ()));
-
-        for (auto const& vt : aLedger->getMap ())
-        {
-            uint256 transactionID = vt.second->getTransactionID ();
-
-            getApp().getMasterTransaction ().inLedger (
-                transactionID, getLedgerSeq ());
-
-            std::string const txnId (to_string (transactionID));
-            std::string const txnSeq (std::to_string (vt.second->getTxnSeq ()));
+    for (auto const& vt : aLedger->getMap ())
+        getApp().getMasterTransaction ().inLedger (
+            vt.second->getTransactionID (), getLedgerSeq ());
 
-            db->executeSQL (boost::str (deleteAcctTrans % transactionID));
-
-            auto const& accts = vt.second->getAffected ();
-
-            if (!accts.empty ())
-            {
-                std::string sql ("INSERT INTO AccountTransactions "
-                                 "(TransID, Account, LedgerSeq, TxnSeq) VALUES ");
-
-                // Try to make an educated guess on how much space we'll need
-                // for our arguments. In argument order we have:
-                // 64 + 34 + 10 + 10 = 118 + 10 extra = 128 bytes
-                sql.reserve (sql.length () + (accts.size () * 128));
+    // The writer finishes the save once the transactions are committed
+    getApp().getTxnDBWriter ().write (aLedger, synchronous);
+    return true;
+}
 
-                bool first = true;
-                for (auto const& it : accts)
-                {
-                    if (!first)
-                        sql += ", ('";
-                    else
-                    {
-                        sql += "('";
-                        first = false;
-                    }
-
-                    sql += txnId;
-                    sql += "','";
-                    sql += it.humanAccountID ();
-                    sql += "',";
-                    sql += ledgerSeq;
-                    sql += ",";
-                    sql += txnSeq;
-                    sql += ")";
-                }
-                sql += ";";
-                if (ShouldLog (lsTRACE, Ledger))
-                {
-                    WriteLog (lsTRACE, Ledger) << "ActTx: " << sql;
-                }
-                db->executeSQL (sql);
-            }
-            else
-                WriteLog (lsWARNING, Ledger)
-                    << "Transaction in ledger " << mLedgerSeq
-                    << " affects no accounts";
-
-            db->executeSQL (
-                SerializedTransaction::getMetaSQLInsertReplaceHeader () +
-                vt.second->getTxn ()->getMetaSQL (
-                    getLedgerSeq (), vt.second->getEscMeta ()) + ";");
-        }
-        db->executeSQL ("COMMIT TRANSACTION;");
-    }
+void Ledger::finishSaveValidated ()
+{
+    static boost::format addLedger (
+        "INSERT OR REPLACE INTO Ledgers "
+        "(LedgerHash,LedgerSeq,PrevHash,TotalCoins,TotalCoinsVBC,ClosingTime,PrevClosingTime,"
+        "CloseTimeRes,CloseFlags,DividendTime,AccountSetHash,TransSetHash) VALUES "
+        "('%s','%u','%s','%s','%s','%u','%u','%d','%u','%u','%s','%s');");
 
     {
         auto sl (getApp().getLedgerDB ().lock ());
@@ -813,13 +734,14 @@ bool Ledger::saveValidatedLedger (bool current)
                 to_string (mAccountHash) % to_string (mTransHash)));
     }
 
+    getApp().getLedgerHashIndex ().insert (mLedgerSeq, getHash (), mParentHash);
+
     {
         // Clients can now trust the database for information about this ledger
         // sequence.
         StaticScopedLockType sl (sPendingSaveLock);
         sPendingSaves.erase(getLedgerSeq());
     }
-    return true;
 }
 
 #ifndef NO_SQLITE3_PREPARE
@@ -1032,6 +954,11 @@ void Ledger::getSQL2 (Ledger::ref ret)
 
 uint256 Ledger::getHashByIndex (std::uint32_t ledgerIndex)
 {
+    LedgerHashIndex& index (getApp().getLedgerHashIndex ());
+
+    if (index.isOpen ())
+        return index.getHash (ledgerIndex);
+
     uint256 ret;
 
     std::string sql =
@@ -1058,6 +985,17 @@ uint256 Ledger::getHashByIndex (std::uint32_t ledgerIndex)
 bool Ledger::getHashesByIndex (
     std::uint32_t ledgerIndex, uint256& ledgerHash, uint256& parentHash)
 {
+    LedgerHashIndex& index (getApp().getLedgerHashIndex ());
+
+    if (index.isOpen ())
+    {
+        if (index.get (ledgerIndex, ledgerHash, parentHash))
+            return true;
+
+        WriteLog (lsTRACE, Ledger) << "Don't have ledger " << ledgerIndex;
+        return false;
+    }
+
 #ifndef NO_SQLITE3_PREPARE
 
     auto& con = getApp().getLedgerDB ();
@@ -1125,6 +1063,21 @@ Ledger::getHashesByIndex (std::uint32_t minSeq, std::uint32_t maxSeq)
 {
     std::map< std::uint32_t, std::pair<uint256, uint256> > ret;
 
+    LedgerHashIndex& index (getApp().getLedgerHashIndex ());
+
+    if (index.isOpen ())
+    {
+        for (std::uint64_t seq = minSeq; seq <= maxSeq; ++seq)
+        {
+            uint256 ledgerHash, parentHash;
+
+            if (index.get (seq, ledgerHash, parentHash))
+                ret[seq] = std::make_pair (ledgerHash, parentHash);
+        }
+
+        return ret;
+    }
+
     std::string sql =
         "SELECT LedgerSeq,LedgerHash,PrevHash FROM Ledgers WHERE LedgerSeq >= ";
     sql.append (beast::lexicalCastThrow <std::string> (minSeq));
@@ -1512,15 +1465,18 @@ static void visitHelper (
 }
 
 void Ledger::visitStateItems (std::function<void (SLE::ref)> function) const
+{
+    visitStateLeaves (std::bind(&visitHelper, std::ref(function),
+                                std::placeholders::_1));
+}
+
+void Ledger::visitStateLeaves (
+    std::function<void (SHAMapItem::ref)> function) const
 {
     try
     {
         if (mAccountStateMap)
-        {
-            mAccountStateMap->visitLeaves(
-                std::bind(&visitHelper, std::ref(function),
-                          std::placeholders::_1));
-        }
+            mAccountStateMap->visitLeaves(function);
     }
     catch (SHAMapMissingNode&)
     {
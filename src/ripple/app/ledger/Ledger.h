@@ -305,6 +305,10 @@ public:
     bool hasAccount (const RippleAddress & acctID) const;
     AccountState::pointer getAccountState (const RippleAddress & acctID) const;
     LedgerStateParms writeBack (LedgerStateParms parms, SLE::ref);
+
+    // An amount of native currency to add to an account root, by index
+    typedef std::pair <uint256, std::uint64_t> Credit;
+
     SLE::pointer getAccountRoot (Account const& accountID) const;
     SLE::pointer getAccountRoot (const RippleAddress & naAccountID) const;
     void updateSkipList ();
@@ -319,6 +323,9 @@ public:
         std::function <bool (SLE::ref)>) const;
     void visitStateItems (std::function<void (SLE::ref)>) const;
 
+    /** Visit the serialized state items, see STObjectView. */
+    void visitStateLeaves (std::function<void (SHAMapItem::ref)>) const;
+
     // database functions (low-level)
     static Ledger::pointer loadByIndex (std::uint32_t ledgerIndex);
     static Ledger::pointer loadByHash (uint256 const& ledgerHash);
@@ -329,6 +336,11 @@ public:
                   getHashesByIndex (std::uint32_t minSeq, std::uint32_t maxSeq);
     bool pendSaveValidated (bool isSynchronous, bool isCurrent);
 
+    /** Save the header of a ledger whose transactions have been written.
+        Clients can then trust the database for this ledger sequence.
+    */
+    void finishSaveValidated ();
+
     // next/prev function
     SLE::pointer getSLE (uint256 const& uHash) const; // SLE is mutable
     SLE::pointer getSLEi (uint256 const& uHash) const; // SLE is immutable
@@ -525,9 +537,9 @@ protected:
 
     void saveValidatedLedgerAsync(Job&, bool current)
     {
-        saveValidatedLedger(current);
+        saveValidatedLedger(current, false);
     }
-    bool saveValidatedLedger (bool current);
+    bool saveValidatedLedger (bool current, bool synchronous = true);
 
 private:
     void initializeFees ();
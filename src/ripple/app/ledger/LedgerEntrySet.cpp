@@ -24,6 +24,9 @@
 #include <ripple/app/book/Quality.h>
 #include <ripple/basics/Log.h>
 #include <ripple/basics/StringUtilities.h>
+#include <ripple/core/WorkerPool.h>
+#include <beast/unit_test/suite.h>
+#include <beast/module/core/maths/Random.h>
 
 namespace ripple {
 
@@ -34,10 +37,116 @@ namespace ripple {
 //
 #define DIR_NODE_MAX        32
 
+LedgerEntrySetTable::value_type& LedgerEntrySetTable::insert (
+    uint256 const& key, LedgerEntrySetEntry const& entry)
+{
+    // Keep the table at most half full so probes stay short
+    if ((mValues.size () + 1) * 2 > mSlots.size ())
+        rehash (std::max <std::size_t> (16, mSlots.size () * 2));
+
+    std::size_t const slot = findSlot (key);
+    assert (mSlots[slot] == 0);
+
+    if (mKeysSorted)
+        mKeys.insert (std::lower_bound (mKeys.begin (), mKeys.end (), key), key);
+
+    mValues.emplace_back (key, entry);
+    mSlots[slot] = static_cast <std::uint32_t> (mValues.size ());
+    return mValues.back ();
+}
+
+void LedgerEntrySetTable::erase (uint256 const& key)
+{
+    std::size_t hole = findSlot (key);
+    assert (mSlots[hole] != 0);
+    std::size_t const position = mSlots[hole] - 1;
+
+    // Shift back the entries that probed past the removed one
+    for (std::size_t i = (hole + 1) & mMask; mSlots[i] != 0; i = (i + 1) & mMask)
+    {
+        std::size_t const home = hash (mValues[mSlots[i] - 1].first) & mMask;
+
+        if (((i - home) & mMask) >= ((i - hole) & mMask))
+        {
+            mSlots[hole] = mSlots[i];
+            hole = i;
+        }
+    }
+
+    mSlots[hole] = 0;
+
+    // Fill the gap in the vector with the last entry
+    std::size_t const last = mValues.size () - 1;
+
+    if (position != last)
+    {
+        mSlots[findSlot (mValues[last].first)] =
+            static_cast <std::uint32_t> (position + 1);
+        mValues[position] = mValues[last];
+    }
+
+    mValues.pop_back ();
+
+    if (mKeysSorted)
+        mKeys.erase (std::lower_bound (mKeys.begin (), mKeys.end (), key));
+}
+
+void LedgerEntrySetTable::sort ()
+{
+    std::sort (mValues.begin (), mValues.end (),
+        [] (value_type const& lhs, value_type const& rhs)
+        {
+            return lhs.first < rhs.first;
+        });
+
+    rehash (mSlots.size ());
+}
+
+std::vector <uint256> const& LedgerEntrySetTable::sortedKeys () const
+{
+    if (!mKeysSorted)
+    {
+        mKeys.clear ();
+        mKeys.reserve (mValues.size ());
+
+        for (auto const& value : mValues)
+            mKeys.push_back (value.first);
+
+        std::sort (mKeys.begin (), mKeys.end ());
+        mKeysSorted = true;
+    }
+
+    return mKeys;
+}
+
+void LedgerEntrySetTable::rehash (std::size_t capacity)
+{
+    mSlots.assign (capacity, 0);
+    mMask = capacity - 1;
+
+    for (std::size_t i = 0; i < mValues.size (); ++i)
+        mSlots[findSlot (mValues[i].first)] = static_cast <std::uint32_t> (i + 1);
+}
+
+//------------------------------------------------------------------------------
+
+LedgerEntrySetTable& LedgerEntrySet::modifyEntries ()
+{
+    if (!mEntries.unique ())
+        mEntries = std::make_shared <LedgerEntrySetTable> (*mEntries);
+
+    return *mEntries;
+}
+
 void LedgerEntrySet::init (Ledger::ref ledger, uint256 const& transactionID,
                            std::uint32_t ledgerID, TransactionEngineParams params)
 {
-    mEntries.clear ();
+    if (mEntries.unique ())
+        mEntries->clear ();
+    else
+        mEntries = std::make_shared <LedgerEntrySetTable> ();
+    mCredits.clear ();
+    mCreditedItems.clear ();
     mLedger = ledger;
     mSet.init (transactionID, ledgerID);
     mParams = params;
@@ -46,31 +155,76 @@ void LedgerEntrySet::init (Ledger::ref ledger, uint256 const& transactionID,
 
 void LedgerEntrySet::clear ()
 {
-    mEntries.clear ();
+    if (mEntries.unique ())
+        mEntries->clear ();
+    else
+        mEntries = std::make_shared <LedgerEntrySetTable> ();
+    mCredits.clear ();
+    mCreditedItems.clear ();
     mSet.clear ();
 }
 
 LedgerEntrySet LedgerEntrySet::duplicate () const
 {
-    return LedgerEntrySet (mLedger, mEntries, mSet, mSeq + 1);
+    return LedgerEntrySet (mLedger, mEntries, mCredits, mSet, mSeq + 1);
 }
 
 void LedgerEntrySet::swapWith (LedgerEntrySet& e)
 {
     std::swap (mLedger, e.mLedger);
-    mEntries.swap (e.mEntries);
+    std::swap (mEntries, e.mEntries);
+    mCredits.swap (e.mCredits);
+    mCreditedItems.swap (e.mCreditedItems);
     mSet.swap (e.mSet);
     std::swap (mParams, e.mParams);
     std::swap (mSeq, e.mSeq);
 }
 
+std::size_t LedgerEntrySet::creditBalances (std::vector <Ledger::Credit> credits)
+{
+    assert (mCredits.empty ());
+    std::sort (credits.begin (), credits.end ());
+
+    SHAMap::ref stateMap (mLedger->peekAccountStateMap ());
+    std::size_t credited = 0;
+    auto out = credits.begin ();
+
+    for (auto const& credit : credits)
+    {
+        if (hasEntry (credit.first) != taaNONE)
+        {
+            SLE::pointer sle (entryCache (ltACCOUNT_ROOT, credit.first));
+
+            if (sle)
+            {
+                entryModify (sle);
+                std::uint64_t const balance =
+                    sle->getFieldAmount (sfBalance).getNValue ();
+                sle->setFieldAmount (sfBalance, balance + credit.second);
+                ++credited;
+            }
+        }
+        else if (stateMap->hasItem (credit.first))
+        {
+            assert ((out == credits.begin ()) || ((out - 1)->first != credit.first));
+            *out++ = credit;
+        }
+    }
+
+    credits.erase (out, credits.end ());
+    credited += credits.size ();
+    mCredits.swap (credits);
+
+    return credited;
+}
+
 // Find an entry in the set.  If it has the wrong sequence number, copy it and update the sequence number.
 // This is basically: copy-on-read.
 SLE::pointer LedgerEntrySet::getEntry (uint256 const& index, LedgerEntryAction& action)
 {
-    auto it = mEntries.find (index);
+    auto it = peekEntries ().find (index);
 
-    if (it == mEntries.end ())
+    if (it == nullptr)
     {
         action = taaNONE;
         return SLE::pointer ();
@@ -79,8 +233,10 @@ SLE::pointer LedgerEntrySet::getEntry (uint256 const& index, LedgerEntryAction&
     if (it->second.mSeq != mSeq)
     {
         assert (it->second.mSeq < mSeq);
-        it->second.mEntry = std::make_shared<SerializedLedgerEntry> (*it->second.mEntry);
-        it->second.mSeq = mSeq;
+        auto entry = modifyEntries ().find (index);
+        entry->second.mEntry = std::make_shared<SerializedLedgerEntry> (*entry->second.mEntry);
+        entry->second.mSeq = mSeq;
+        it = entry;
     }
 
     action = it->second.mAction;
@@ -122,9 +278,9 @@ SLE::pointer LedgerEntrySet::entryCache (LedgerEntryType letType, uint256 const&
 
 LedgerEntryAction LedgerEntrySet::hasEntry (uint256 const& index) const
 {
-    std::map<uint256, LedgerEntrySetEntry>::const_iterator it = mEntries.find (index);
+    auto it = peekEntries ().find (index);
 
-    if (it == mEntries.end ())
+    if (it == nullptr)
         return taaNONE;
 
     return it->second.mAction;
@@ -134,11 +290,12 @@ void LedgerEntrySet::entryCache (SLE::ref sle)
 {
     assert (mLedger);
     assert (sle->isMutable () || mImmutable); // Don't put an immutable SLE in a mutable LES
-    auto it = mEntries.find (sle->getIndex ());
+    auto& entries = modifyEntries ();
+    auto it = entries.find (sle->getIndex ());
 
-    if (it == mEntries.end ())
+    if (it == nullptr)
     {
-        mEntries.insert (std::make_pair (sle->getIndex (), LedgerEntrySetEntry (sle, taaCACHED, mSeq)));
+        entries.insert (sle->getIndex (), LedgerEntrySetEntry (sle, taaCACHED, mSeq));
         return;
     }
 
@@ -159,11 +316,12 @@ void LedgerEntrySet::entryCreate (SLE::ref sle)
 {
     assert (mLedger && !mImmutable);
     assert (sle->isMutable ());
-    auto it = mEntries.find (sle->getIndex ());
+    auto& entries = modifyEntries ();
+    auto it = entries.find (sle->getIndex ());
 
-    if (it == mEntries.end ())
+    if (it == nullptr)
     {
-        mEntries.insert (std::make_pair (sle->getIndex (), LedgerEntrySetEntry (sle, taaCREATE, mSeq)));
+        entries.insert (sle->getIndex (), LedgerEntrySetEntry (sle, taaCREATE, mSeq));
         return;
     }
 
@@ -197,11 +355,12 @@ void LedgerEntrySet::entryModify (SLE::ref sle)
 {
     assert (sle->isMutable () && !mImmutable);
     assert (mLedger);
-    auto it = mEntries.find (sle->getIndex ());
+    auto& entries = modifyEntries ();
+    auto it = entries.find (sle->getIndex ());
 
-    if (it == mEntries.end ())
+    if (it == nullptr)
     {
-        mEntries.insert (std::make_pair (sle->getIndex (), LedgerEntrySetEntry (sle, taaMODIFY, mSeq)));
+        entries.insert (sle->getIndex (), LedgerEntrySetEntry (sle, taaMODIFY, mSeq));
         return;
     }
 
@@ -233,12 +392,13 @@ void LedgerEntrySet::entryDelete (SLE::ref sle)
 {
     assert (sle->isMutable () && !mImmutable);
     assert (mLedger);
-    auto it = mEntries.find (sle->getIndex ());
+    auto& entries = modifyEntries ();
+    auto it = entries.find (sle->getIndex ());
 
-    if (it == mEntries.end ())
+    if (it == nullptr)
     {
         assert (false); // deleting an entry not cached?
-        mEntries.insert (std::make_pair (sle->getIndex (), LedgerEntrySetEntry (sle, taaDELETE, mSeq)));
+        entries.insert (sle->getIndex (), LedgerEntrySetEntry (sle, taaDELETE, mSeq));
         return;
     }
 
@@ -255,7 +415,7 @@ void LedgerEntrySet::entryDelete (SLE::ref sle)
         break;
 
     case taaCREATE:
-        mEntries.erase (it);
+        entries.erase (sle->getIndex ());
         break;
 
     case taaDELETE:
@@ -272,7 +432,7 @@ Json::Value LedgerEntrySet::getJson (int) const
 
     Json::Value nodes (Json::arrayValue);
 
-    for (auto it = mEntries.begin (), end = mEntries.end (); it != end; ++it)
+    for (auto it = begin (), e = end (); it != e; ++it)
     {
         Json::Value entry (Json::objectValue);
         entry["node"] = to_string (it->first);
@@ -346,9 +506,10 @@ Json::Value LedgerEntrySet::getJson (int) const
 SLE::pointer LedgerEntrySet::getForMod (uint256 const& node, Ledger::ref ledger,
                                         NodeToLedgerEntry& newMods)
 {
-    auto it = mEntries.find (node);
+    auto it = peekEntries ().find (node)
+        ? modifyEntries ().find (node) : nullptr;
 
-    if (it != mEntries.end ())
+    if (it != nullptr)
     {
         if (it->second.mAction == taaDELETE)
         {
@@ -448,6 +609,94 @@ bool LedgerEntrySet::threadOwners (SLE::ref node, Ledger::ref ledger,
         return false;
 }
 
+// Add the previous and final fields of a modified node to its metadata
+static void addModifiedFields (STObject& node, SLE const& origNode,
+    SLE& curNode)
+{
+    STObject prevs (sfPreviousFields);
+    for (auto const& obj : origNode)
+    {
+        // search the original node for values saved on modify
+        if (obj.getFName ().shouldMeta (SField::sMD_ChangeOrig) && !curNode.hasMatchingEntry (obj))
+            prevs.addObject (obj);
+    }
+
+    if (!prevs.empty ())
+        node.addObject (prevs);
+
+    STObject finals (sfFinalFields);
+    for (auto const& obj : curNode)
+    {
+        // search the final node for values saved always
+        if (obj.getFName ().shouldMeta (SField::sMD_Always | SField::sMD_ChangeNew))
+            finals.addObject (obj);
+    }
+
+    if (!finals.empty ())
+        node.addObject (finals);
+}
+
+void LedgerEntrySet::calcCreditMeta ()
+{
+    SHAMap::ref stateMap (mLedger->peekAccountStateMap ());
+    uint256 const txID (mSet.getTxID ());
+    std::uint32_t const lgrSeq (mSet.getLgrSeq ());
+
+    std::vector <STObject> nodes (mCredits.size (), STObject (sfModifiedNode));
+    mCreditedItems.assign (mCredits.size (), SHAMapItem::pointer ());
+
+    // Each account root is threaded and listed exactly as it would be
+    // had it been modified through the set
+    std::size_t const chunk = 256;
+    WorkerPool::forEach ((mCredits.size () + chunk - 1) / chunk,
+        [&] (std::size_t c)
+    {
+        std::size_t const last = std::min (mCredits.size (), (c + 1) * chunk);
+
+        for (std::size_t i = c * chunk; i < last; ++i)
+        {
+            uint256 const& index (mCredits[i].first);
+            SHAMapItem::pointer item (stateMap->peekItem (index));
+
+            // Credits were checked against this ledger when they were made
+            assert (item);
+            if (!item)
+                continue;
+
+            SLE const origNode (item->peekSerializer (), index);
+            SLE curNode (origNode);
+            curNode.setFieldAmount (sfBalance,
+                origNode.getFieldAmount (sfBalance).getNValue () +
+                    mCredits[i].second);
+
+            STObject& node (nodes[i]);
+            node.setFieldH256 (sfLedgerIndex, index);
+            node.setFieldU16 (sfLedgerEntryType, ltACCOUNT_ROOT);
+
+            uint256 prevTxID;
+            std::uint32_t prevLgrID;
+
+            if (curNode.thread (txID, lgrSeq, prevTxID, prevLgrID) &&
+                    prevTxID.isNonZero ())
+                TransactionMetaSet::thread (node, prevTxID, prevLgrID);
+
+            addModifiedFields (node, origNode, curNode);
+
+            mCreditedItems[i] = std::make_shared <SHAMapItem> (index);
+            curNode.add (mCreditedItems[i]->peekSerializer ());
+        }
+    });
+
+    for (std::size_t i = 0; i < nodes.size (); ++i)
+    {
+        if (mCreditedItems[i])
+            mSet.addAffectedNode (nodes[i]);
+    }
+
+    mCreditedItems.erase (std::remove (mCreditedItems.begin (),
+        mCreditedItems.end (), SHAMapItem::pointer ()), mCreditedItems.end ());
+}
+
 void LedgerEntrySet::calcRawMeta (Serializer& s, TER result, std::uint32_t index)
 {
     // calculate the raw meta data and return it. This must be called before the set is committed
@@ -455,7 +704,13 @@ void LedgerEntrySet::calcRawMeta (Serializer& s, TER result, std::uint32_t index
     // Entries modified only as a result of building the transaction metadata
     NodeToLedgerEntry newMod;
 
-    for (auto& it : mEntries)
+    // Threading a node can turn a cached entry later in key order into a
+    // modified one, so the entries must be visited in key order for the
+    // metadata to come out the same everywhere.
+    auto& entries = modifyEntries ();
+    entries.sort ();
+
+    for (auto& it : entries)
     {
         SField::ptr type = &sfGeneric;
 
@@ -535,27 +790,7 @@ void LedgerEntrySet::calcRawMeta (Serializer& s, TER result, std::uint32_t index
             if (curNode->isThreadedType ()) // thread transaction to node it modified
                 threadTx (curNode, mLedger, newMod);
 
-            STObject prevs (sfPreviousFields);
-            for (auto const& obj : *origNode)
-            {
-                // search the original node for values saved on modify
-                if (obj.getFName ().shouldMeta (SField::sMD_ChangeOrig) && !curNode->hasMatchingEntry (obj))
-                    prevs.addObject (obj);
-            }
-
-            if (!prevs.empty ())
-                mSet.getAffectedNode (it.first).addObject (prevs);
-
-            STObject finals (sfFinalFields);
-            for (auto const& obj : *curNode)
-            {
-                // search the final node for values saved always
-                if (obj.getFName ().shouldMeta (SField::sMD_Always | SField::sMD_ChangeNew))
-                    finals.addObject (obj);
-            }
-
-            if (!finals.empty ())
-                mSet.getAffectedNode (it.first).addObject (finals);
+            addModifiedFields (mSet.getAffectedNode (it.first), *origNode, *curNode);
         }
         else if (type == &sfCreatedNode) // if created, thread to owner(s)
         {
@@ -583,6 +818,23 @@ void LedgerEntrySet::calcRawMeta (Serializer& s, TER result, std::uint32_t index
     for (auto& it : newMod)
         entryModify (it.second);
 
+    if (!mCredits.empty ())
+    {
+        // Entries in the set are never also credited in bulk
+        assert (std::none_of (newMod.begin (), newMod.end (),
+            [this] (NodeToLedgerEntry::value_type const& mod)
+            {
+                return std::binary_search (mCredits.begin (), mCredits.end (),
+                    Ledger::Credit (mod.first, 0), [] (
+                        Ledger::Credit const& a, Ledger::Credit const& b)
+                    {
+                        return a.first < b.first;
+                    });
+            }));
+
+        calcCreditMeta ();
+    }
+
     mSet.addRaw (s, result, index);
     WriteLog (lsTRACE, LedgerEntrySet) << "Metadata:" << mSet.getJson (0);
 }
@@ -996,24 +1248,35 @@ uint256 LedgerEntrySet::getNextLedgerIndex (uint256 const& uHash)
 {
     // find next node in ledger that isn't deleted by LES
     uint256 ledgerNext = uHash;
-    std::map<uint256, LedgerEntrySetEntry>::const_iterator it;
+    LedgerEntrySetTable const& entries = peekEntries ();
+    LedgerEntrySetTable::value_type const* it;
 
     do
     {
         ledgerNext = mLedger->getNextLedgerIndex (ledgerNext);
-        it  = mEntries.find (ledgerNext);
+        it  = entries.find (ledgerNext);
     }
-    while ((it != mEntries.end ()) && (it->second.mAction == taaDELETE));
+    while ((it != nullptr) && (it->second.mAction == taaDELETE));
+
+    // find the first node in LES after uHash that isn't deleted
+    std::vector <uint256> const& keys = entries.sortedKeys ();
+    uint256 const* next = nullptr;
 
-    // find next node in LES that isn't deleted
-    for (it = mEntries.upper_bound (uHash); it != mEntries.end (); ++it)
+    for (auto key = std::upper_bound (keys.begin (), keys.end (), uHash);
+        key != keys.end (); ++key)
     {
-        // node found in LES, node found in ledger, return earliest
-        if (it->second.mAction != taaDELETE)
-            return (ledgerNext.isNonZero () && (ledgerNext < it->first)) ?
-                    ledgerNext : it->first;
+        if (entries.find (*key)->second.mAction != taaDELETE)
+        {
+            next = &*key;
+            break;
+        }
     }
 
+    // node found in LES, node found in ledger, return earliest
+    if (next != nullptr)
+        return (ledgerNext.isNonZero () && (ledgerNext < *next)) ?
+                ledgerNext : *next;
+
     // nothing next in LES, return next ledger node
     return ledgerNext;
 }
@@ -1736,4 +1999,129 @@ rippleTransferRate (LedgerEntrySet& ledger, Account const& uSenderID,
            : rippleTransferRate (ledger, issuer);
 }
 
+//------------------------------------------------------------------------------
+
+class LedgerEntrySet_test : public beast::unit_test::suite
+{
+public:
+    static uint256 makeIndex (beast::Random& r)
+    {
+        uint256 index;
+        r.fillBitsRandomly (index.begin (), uint256::bytes);
+        return index;
+    }
+
+    void testTable ()
+    {
+        testcase ("table");
+
+        beast::Random r (17);
+        uint256 const book (makeIndex (r));
+        LedgerEntrySetTable table;
+        std::map <uint256, int> expected;
+
+        for (int i = 0; i < 20000; ++i)
+        {
+            // From here on insert and erase keep the sorted keys up to date
+            if (i == 10000)
+                table.sortedKeys ();
+
+            // Quality indexes of one book differ only in their last 8 bytes
+            uint256 const index = ((i % 3) == 0)
+                ? Ledger::getQualityIndex (book, r.nextInt64 ())
+                : makeIndex (r);
+
+            if (r.nextInt (4) == 0 && !expected.empty ())
+            {
+                // Remove an existing entry
+                auto it = expected.lower_bound (index);
+                if (it == expected.end ())
+                    it = expected.begin ();
+                table.erase (it->first);
+                expected.erase (it);
+            }
+            else if (expected.find (index) == expected.end ())
+            {
+                table.insert (index,
+                    LedgerEntrySetEntry (SLE::pointer (), taaCACHED, i));
+                expected[index] = i;
+            }
+        }
+
+        expect (table.size () == expected.size (), "Table size mismatch");
+
+        bool found = true;
+        for (auto const& item : expected)
+        {
+            auto const entry = table.find (item.first);
+            found = found && entry && (entry->second.mSeq == item.second);
+        }
+        expect (found, "Table lost an entry");
+        expect (! table.find (makeIndex (r)), "Table found a stranger");
+
+        auto const& keys = table.sortedKeys ();
+        expect (keys.size () == expected.size () &&
+            std::equal (keys.begin (), keys.end (), expected.begin (),
+                [] (uint256 const& lhs, std::pair <uint256 const, int> const& rhs)
+                {
+                    return lhs == rhs.first;
+                }), "Sorted keys out of order");
+
+        table.sort ();
+        expect (std::equal (table.begin (), table.end (), expected.begin (),
+            [] (LedgerEntrySetTable::value_type const& lhs,
+                std::pair <uint256 const, int> const& rhs)
+            {
+                return lhs.first == rhs.first && lhs.second.mSeq == rhs.second;
+            }), "Sorted table out of order");
+    }
+
+    void testDuplicate ()
+    {
+        testcase ("duplicate");
+
+        RippleAddress rootSeedMaster
+                = RippleAddress::createSeedGeneric ("masterpassphrase");
+        RippleAddress rootGeneratorMaster
+                = RippleAddress::createGeneratorPublic (rootSeedMaster);
+        RippleAddress rootAddress
+                = RippleAddress::createAccountPublic (rootGeneratorMaster, 0);
+        Ledger::pointer base (std::make_shared <Ledger> (rootAddress, 100000));
+        Ledger::pointer ledger (std::make_shared <Ledger> (true, *base));
+
+        uint256 const rootIndex (
+            Ledger::getAccountRootIndex (rootAddress.getAccountID ()));
+
+        LedgerEntrySet parent (ledger, tapNONE);
+        SLE::pointer sle = parent.entryCache (ltACCOUNT_ROOT, rootIndex);
+        expect (!!sle, "Root account missing");
+
+        LedgerEntrySet child (parent.duplicate ());
+        SLE::pointer copy = child.entryCache (ltACCOUNT_ROOT, rootIndex);
+        expect (copy != sle, "Duplicate should copy entries it reads");
+        copy->setFieldU32 (sfSequence, 99);
+        child.entryModify (copy);
+
+        uint256 const created (Ledger::getQualityIndex (rootIndex, ~0ull));
+        child.entryCreate (ltDIR_NODE, created);
+
+        expect (parent.hasEntry (rootIndex) == taaCACHED,
+            "Parent saw the child's modify");
+        expect (parent.hasEntry (created) == taaNONE,
+            "Parent saw the child's create");
+        expect (child.hasEntry (rootIndex) == taaMODIFY, "Child lost modify");
+        expect (sle->getFieldU32 (sfSequence) == 1, "Parent entry changed");
+        expect (child.getNextLedgerIndex (rootIndex) == created,
+            "Created entry should be next");
+    }
+
+    void run ()
+    {
+        testTable ();
+        testDuplicate ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(LedgerEntrySet,ripple_app,ripple);
+
 } // ripple
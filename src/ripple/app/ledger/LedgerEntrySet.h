@@ -77,6 +77,151 @@ public:
         , mSeq (s)
     {
     }
+
+    LedgerEntrySetEntry (LedgerEntrySetEntry const&) = default;
+    LedgerEntrySetEntry (LedgerEntrySetEntry&&) = default;
+
+    // The table moves entries between slots. Assigning an entry replaces
+    // its contents; the object count is left alone.
+    LedgerEntrySetEntry& operator= (LedgerEntrySetEntry const& other)
+    {
+        mEntry = other.mEntry;
+        mAction = other.mAction;
+        mSeq = other.mSeq;
+        return *this;
+    }
+
+    LedgerEntrySetEntry& operator= (LedgerEntrySetEntry&& other)
+    {
+        mEntry = std::move (other.mEntry);
+        mAction = other.mAction;
+        mSeq = other.mSeq;
+        return *this;
+    }
+};
+
+/** The entries of a LedgerEntrySet, keyed by ledger index.
+
+    Entries are kept in one flat vector and found through an open-addressed
+    table of positions using linear probing, so a lookup touches no tree
+    nodes and copying the whole set is two vector copies. Iteration follows
+    the vector, which is not in key order; call sort () first when the
+    order matters.
+*/
+class LedgerEntrySetTable
+{
+public:
+    typedef std::pair <uint256, LedgerEntrySetEntry> value_type;
+    typedef std::vector <value_type>::iterator iterator;
+    typedef std::vector <value_type>::const_iterator const_iterator;
+
+    LedgerEntrySetTable () : mMask (0), mKeysSorted (false)
+    {
+    }
+
+    bool empty () const
+    {
+        return mValues.empty ();
+    }
+
+    std::size_t size () const
+    {
+        return mValues.size ();
+    }
+
+    iterator begin ()
+    {
+        return mValues.begin ();
+    }
+
+    iterator end ()
+    {
+        return mValues.end ();
+    }
+    const_iterator begin () const
+    {
+        return mValues.begin ();
+    }
+    const_iterator end () const
+    {
+        return mValues.end ();
+    }
+
+    void clear ()
+    {
+        mValues.clear ();
+        std::fill (mSlots.begin (), mSlots.end (), 0);
+        mKeys.clear ();
+        mKeysSorted = false;
+    }
+
+    /** Returns the entry for the key, or nullptr.
+        The pointer is invalidated by insert, erase and sort.
+    */
+    value_type* find (uint256 const& key)
+    {
+        if (mSlots.empty ())
+            return nullptr;
+
+        std::uint32_t const slot = mSlots[findSlot (key)];
+        return slot ? &mValues[slot - 1] : nullptr;
+    }
+
+    value_type const* find (uint256 const& key) const
+    {
+        return const_cast <LedgerEntrySetTable*> (this)->find (key);
+    }
+
+    /** Add an entry for a key which is not in the table. */
+    value_type& insert (uint256 const& key, LedgerEntrySetEntry const& entry);
+
+    /** Remove the entry for a key which is in the table.
+        The last entry is moved into its place.
+    */
+    void erase (uint256 const& key);
+
+    /** Put the entries in key order. */
+    void sort ();
+
+    /** Returns the keys in order.
+        The keys are sorted on the first call and then kept in order by
+        insert and erase.
+    */
+    std::vector <uint256> const& sortedKeys () const;
+
+private:
+    static std::size_t hash (uint256 const& key)
+    {
+        // Indexes are hashes already, but the quality indexes of one book
+        // share their first 24 bytes, so mix in the last 8.
+        std::uint64_t front;
+        std::uint64_t back;
+        std::memcpy (&front, key.begin (), sizeof (front));
+        std::memcpy (&back, key.end () - sizeof (back), sizeof (back));
+        return static_cast <std::size_t> (front ^ back);
+    }
+
+    // Returns the slot holding the key, or the empty slot that ends its probe
+    std::size_t findSlot (uint256 const& key) const
+    {
+        std::size_t i = hash (key) & mMask;
+
+        while (mSlots[i] != 0 && mValues[mSlots[i] - 1].first != key)
+            i = (i + 1) & mMask;
+
+        return i;
+    }
+
+    void rehash (std::size_t capacity);
+
+    // Each slot holds a position in mValues plus one, or zero when empty
+    std::vector <std::uint32_t> mSlots;
+    std::vector <value_type> mValues;
+    std::size_t mMask;
+
+    // The keys in order, once sortedKeys has been called
+    mutable std::vector <uint256> mKeys;
+    mutable bool mKeysSorted;
 };
 
 /** An LES is a LedgerEntrySet.
@@ -95,11 +240,15 @@ public:
 
     LedgerEntrySet (
         Ledger::ref ledger, TransactionEngineParams tep, bool immutable = false)
-        : mLedger (ledger), mParams (tep), mSeq (0), mImmutable (immutable)
+        : mLedger (ledger)
+        , mEntries (std::make_shared <LedgerEntrySetTable> ())
+        , mParams (tep), mSeq (0), mImmutable (immutable)
     {
     }
 
-    LedgerEntrySet () : mParams (tapNONE), mSeq (0), mImmutable (false)
+    LedgerEntrySet ()
+        : mEntries (std::make_shared <LedgerEntrySetTable> ())
+        , mParams (tapNONE), mSeq (0), mImmutable (false)
     {
     }
 
@@ -157,6 +306,22 @@ public:
     void entryDelete (SLE::ref);    // This entry will be deleted
     void entryModify (SLE::ref);    // This entry will be modified
 
+    /** Add native currency to many account roots.
+        Credits to accounts that are not in the ledger are skipped, and
+        credits to entries already in the set are made to those entries.
+        The other accounts are not cached in the set. calcRawMeta threads
+        and lists each of them just as if it had been modified, and builds
+        the new account roots to write back in one pass.
+        @return The number of accounts credited.
+    */
+    std::size_t creditBalances (std::vector <Ledger::Credit> credits);
+
+    // The credited account roots, built by calcRawMeta and sorted by index
+    std::vector <SHAMapItem::pointer> const& getCreditedItems () const
+    {
+        return mCreditedItems;
+    }
+
     // higher-level ledger functions
     SLE::pointer entryCreate (LedgerEntryType letType, uint256 const& uIndex);
     SLE::pointer entryCache (LedgerEntryType letType, uint256 const& uIndex);
@@ -249,36 +414,27 @@ public:
     void calcRawMeta (Serializer&, TER result, std::uint32_t index);
 
     // iterator functions
-    typedef std::map<uint256, LedgerEntrySetEntry>::iterator iterator;
-    typedef std::map<uint256, LedgerEntrySetEntry>::const_iterator const_iterator;
+    typedef LedgerEntrySetTable::const_iterator const_iterator;
 
     bool empty () const
     {
-        return mEntries.empty ();
+        return mEntries->empty ();
     }
     const_iterator cbegin () const
     {
-        return mEntries.cbegin ();
+        return mEntries->begin ();
     }
     const_iterator cend () const
     {
-        return mEntries.cend ();
+        return mEntries->end ();
     }
     const_iterator begin () const
     {
-        return mEntries.cbegin ();
+        return mEntries->begin ();
     }
     const_iterator end () const
     {
-        return mEntries.cend ();
-    }
-    iterator begin ()
-    {
-        return mEntries.begin ();
-    }
-    iterator end ()
-    {
-        return mEntries.end ();
+        return mEntries->end ();
     }
 
     void setDeliveredAmount (STAmount const& amt)
@@ -288,7 +444,10 @@ public:
 
 private:
     Ledger::pointer mLedger;
-    std::map<uint256, LedgerEntrySetEntry>  mEntries; // cannot be unordered!
+    // Shared with duplicates until either side changes it
+    std::shared_ptr <LedgerEntrySetTable> mEntries;
+    std::vector<Ledger::Credit> mCredits; // sorted by index
+    std::vector<SHAMapItem::pointer> mCreditedItems;
 
     typedef hash_map<uint256, SLE::pointer> NodeToLedgerEntry;
 
@@ -298,12 +457,21 @@ private:
     bool mImmutable;
 
     LedgerEntrySet (
-        Ledger::ref ledger, const std::map<uint256, LedgerEntrySetEntry>& e,
-        const TransactionMetaSet & s, int m) :
-        mLedger (ledger), mEntries (e), mSet (s), mParams (tapNONE), mSeq (m),
-        mImmutable (false)
+        Ledger::ref ledger, std::shared_ptr <LedgerEntrySetTable> const& e,
+        std::vector<Ledger::Credit> const& c, const TransactionMetaSet & s,
+        int m) :
+        mLedger (ledger), mEntries (e), mCredits (c), mSet (s),
+        mParams (tapNONE), mSeq (m), mImmutable (false)
     {}
 
+    LedgerEntrySetTable const& peekEntries () const
+    {
+        return *mEntries;
+    }
+
+    // The entries, copied first if a duplicate still shares them
+    LedgerEntrySetTable& modifyEntries ();
+
     SLE::pointer getForMod (
         uint256 const& node, Ledger::ref ledger,
         NodeToLedgerEntry& newMods);
@@ -318,6 +486,8 @@ private:
     bool threadOwners (
         SLE::ref node, Ledger::ref ledger, NodeToLedgerEntry& newMods);
 
+    void calcCreditMeta ();
+
     TER rippleSend (
         Account const& uSenderID, Account const& uReceiverID,
         const STAmount & saAmount, STAmount & saActual);
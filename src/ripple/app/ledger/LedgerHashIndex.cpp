@@ -0,0 +1,451 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/app/ledger/LedgerHashIndex.h>
+#include <beast/unit_test/suite.h>
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace ripple {
+
+namespace bip = boost::interprocess;
+
+// The header holds the magic, the version and record size as 32 bit
+// values, and the number of records in use as a 64 bit value.
+static char const ledgerHashIndexMagic [8] =
+    { 'R', 'L', 'H', 'I', 'N', 'D', 'E', 'X' };
+static std::uint32_t const ledgerHashIndexVersion = 1;
+
+static int const ledgerHashIndexVersionOffset = 8;
+static int const ledgerHashIndexRecordSizeOffset = 12;
+static int const ledgerHashIndexCountOffset = 16;
+
+LedgerHashIndex::LedgerHashIndex (beast::Journal journal)
+    : m_journal (journal)
+    , m_records (0)
+    , m_count (0)
+{
+}
+
+LedgerHashIndex::~LedgerHashIndex ()
+{
+    ScopedWriteLockType sl (m_lock);
+
+    if (m_region)
+        m_region->flush ();
+
+    close ();
+}
+
+bool LedgerHashIndex::open (boost::filesystem::path const& path)
+{
+    ScopedWriteLockType sl (m_lock);
+
+    close ();
+    m_path = path;
+
+    try
+    {
+        if (! boost::filesystem::exists (m_path) && ! create ())
+            return false;
+
+        if (map ())
+        {
+            m_journal.info << "Opened " << m_path.string () << " with " <<
+                m_count << " ledgers";
+            return true;
+        }
+
+        m_journal.warning << "Recreating invalid " << m_path.string ();
+        unmap ();
+
+        if (create () && map ())
+            return true;
+    }
+    catch (std::exception const& e)
+    {
+        m_journal.warning << "Unable to open " << m_path.string () <<
+            ": " << e.what ();
+    }
+
+    close ();
+    return false;
+}
+
+bool LedgerHashIndex::isOpen ()
+{
+    ScopedReadLockType sl (m_lock);
+
+    return m_region != nullptr;
+}
+
+void LedgerHashIndex::verify (DatabaseCon& ledgerDB)
+{
+    if (! isOpen ())
+        return;
+
+    std::uint64_t tableCount (0);
+    bool agree (true);
+
+    {
+        auto sl (ledgerDB.lock ());
+        auto db (ledgerDB.getDB ()->getSqliteDB ());
+
+        SqliteStatement countSt (db,
+            "SELECT COUNT(DISTINCT LedgerSeq) FROM Ledgers;");
+
+        if (countSt.isRow (countSt.step ()))
+            tableCount = countSt.getInt64 (0);
+
+        SqliteStatement recentSt (db,
+            "SELECT LedgerSeq,LedgerHash,PrevHash FROM Ledgers "
+            "ORDER BY LedgerSeq DESC LIMIT " + std::to_string (verifyRecent) +
+            ";");
+
+        while (agree && recentSt.isRow (recentSt.step ()))
+        {
+            LedgerHash hash, parentHash;
+            hash.SetHexExact (recentSt.peekString (1));
+            parentHash.SetHexExact (recentSt.peekString (2));
+
+            LedgerHash indexHash, indexParentHash;
+            agree = get (recentSt.getUInt32 (0), indexHash, indexParentHash) &&
+                (indexHash == hash) && (indexParentHash == parentHash);
+        }
+    }
+
+    if (agree && (size () == tableCount))
+        return;
+
+    m_journal.warning << "Rebuilding " << m_path.string () << " from " <<
+        tableCount << " ledgers";
+
+    {
+        ScopedWriteLockType sl (m_lock);
+
+        try
+        {
+            unmap ();
+            boost::filesystem::remove (m_path);
+
+            if (! create () || ! map ())
+            {
+                close ();
+                return;
+            }
+        }
+        catch (std::exception const& e)
+        {
+            m_journal.warning << "Unable to rebuild " << m_path.string () <<
+                ": " << e.what ();
+            close ();
+            return;
+        }
+    }
+
+    auto sl (ledgerDB.lock ());
+
+    SqliteStatement st (ledgerDB.getDB ()->getSqliteDB (),
+        "SELECT LedgerSeq,LedgerHash,PrevHash FROM Ledgers "
+        "ORDER BY LedgerSeq;");
+
+    while (st.isRow (st.step ()))
+    {
+        LedgerHash hash, parentHash;
+        hash.SetHexExact (st.peekString (1));
+        parentHash.SetHexExact (st.peekString (2));
+        insert (st.getUInt32 (0), hash, parentHash);
+    }
+
+    m_journal.info << "Rebuilt " << m_path.string () << " with " <<
+        size () << " ledgers";
+}
+
+bool LedgerHashIndex::get (
+    LedgerIndex seq, LedgerHash& hash, LedgerHash& parentHash)
+{
+    ScopedReadLockType sl (m_lock);
+
+    unsigned char const* record (find (seq));
+
+    if (record == nullptr)
+        return false;
+
+    hash = LedgerHash::fromVoid (record);
+    parentHash = LedgerHash::fromVoid (record + LedgerHash::bytes);
+    return true;
+}
+
+LedgerHash LedgerHashIndex::getHash (LedgerIndex seq)
+{
+    ScopedReadLockType sl (m_lock);
+
+    unsigned char const* record (find (seq));
+
+    if (record == nullptr)
+        return LedgerHash ();
+
+    return LedgerHash::fromVoid (record);
+}
+
+void LedgerHashIndex::insert (LedgerIndex seq,
+    LedgerHash const& hash, LedgerHash const& parentHash)
+{
+    ScopedWriteLockType sl (m_lock);
+
+    if (! m_region)
+        return;
+
+    try
+    {
+        if (reserve (seq))
+            write (seq, hash, parentHash);
+    }
+    catch (std::exception const& e)
+    {
+        // Lookups fall back to the database and the index is rebuilt
+        // at the next startup, since its count won't match the table.
+        m_journal.warning << "Closing " << m_path.string () <<
+            ": " << e.what ();
+        close ();
+    }
+}
+
+std::uint64_t LedgerHashIndex::size ()
+{
+    ScopedReadLockType sl (m_lock);
+
+    return m_count;
+}
+
+bool LedgerHashIndex::create ()
+{
+    unsigned char header [headerSize] = { 0 };
+
+    std::uint32_t const version (ledgerHashIndexVersion);
+    std::uint32_t const size (recordSize);
+
+    std::memcpy (header, ledgerHashIndexMagic, sizeof (ledgerHashIndexMagic));
+    std::memcpy (header + ledgerHashIndexVersionOffset,
+        &version, sizeof (version));
+    std::memcpy (header + ledgerHashIndexRecordSizeOffset,
+        &size, sizeof (size));
+
+    std::ofstream file (m_path.string ().c_str (),
+        std::ios::binary | std::ios::trunc);
+    file.write (reinterpret_cast <char const*> (header), headerSize);
+
+    return file.good ();
+}
+
+bool LedgerHashIndex::map ()
+{
+    std::uint64_t const fileSize (boost::filesystem::file_size (m_path));
+
+    if (fileSize < headerSize)
+        return false;
+
+    m_file = std::make_unique <bip::file_mapping> (
+        m_path.string ().c_str (), bip::read_write);
+    m_region = std::make_unique <bip::mapped_region> (
+        *m_file, bip::read_write);
+
+    unsigned char const* base (
+        static_cast <unsigned char const*> (m_region->get_address ()));
+
+    std::uint32_t version, size;
+    std::memcpy (&version, base + ledgerHashIndexVersionOffset,
+        sizeof (version));
+    std::memcpy (&size, base + ledgerHashIndexRecordSizeOffset,
+        sizeof (size));
+    std::memcpy (&m_count, base + ledgerHashIndexCountOffset,
+        sizeof (m_count));
+
+    m_records = (fileSize - headerSize) / recordSize;
+
+    return (std::memcmp (base, ledgerHashIndexMagic,
+            sizeof (ledgerHashIndexMagic)) == 0) &&
+        (version == ledgerHashIndexVersion) &&
+        (size == recordSize) &&
+        (m_count <= m_records);
+}
+
+void LedgerHashIndex::unmap ()
+{
+    m_region.reset ();
+    m_file.reset ();
+}
+
+void LedgerHashIndex::close ()
+{
+    unmap ();
+    m_records = 0;
+    m_count = 0;
+}
+
+bool LedgerHashIndex::reserve (LedgerIndex seq)
+{
+    if (seq < m_records)
+        return true;
+
+    // The mapping can't outlive a resize of its file on every platform
+    std::uint64_t const records (
+        (std::uint64_t (seq) / growRecords + 1) * growRecords);
+
+    unmap ();
+    boost::filesystem::resize_file (m_path, headerSize + records * recordSize);
+
+    if (map ())
+        return true;
+
+    close ();
+    return false;
+}
+
+void LedgerHashIndex::setCount (std::uint64_t count)
+{
+    unsigned char* base (static_cast <unsigned char*> (
+        m_region->get_address ()));
+
+    m_count = count;
+    std::memcpy (base + ledgerHashIndexCountOffset, &m_count, sizeof (m_count));
+}
+
+void LedgerHashIndex::write (LedgerIndex seq,
+    LedgerHash const& hash, LedgerHash const& parentHash)
+{
+    assert (hash.isNonZero ());
+
+    unsigned char* record (static_cast <unsigned char*> (
+        m_region->get_address ()) + headerSize +
+        std::uint64_t (seq) * recordSize);
+
+    bool const empty (std::all_of (record, record + LedgerHash::bytes,
+        [](unsigned char c) { return c == 0; }));
+
+    std::memcpy (record, hash.begin (), LedgerHash::bytes);
+    std::memcpy (record + LedgerHash::bytes, parentHash.begin (),
+        LedgerHash::bytes);
+
+    if (empty)
+        setCount (m_count + 1);
+}
+
+unsigned char const* LedgerHashIndex::find (LedgerIndex seq) const
+{
+    if (! m_region || seq >= m_records)
+        return nullptr;
+
+    unsigned char const* record (static_cast <unsigned char const*> (
+        m_region->get_address ()) + headerSize +
+        std::uint64_t (seq) * recordSize);
+
+    // Slots for ledgers we never saved are zero
+    if (std::all_of (record, record + LedgerHash::bytes,
+        [](unsigned char c) { return c == 0; }))
+    {
+        return nullptr;
+    }
+
+    return record;
+}
+
+//------------------------------------------------------------------------------
+
+class LedgerHashIndex_test : public beast::unit_test::suite
+{
+public:
+    void testIndex (boost::filesystem::path const& path)
+    {
+        testcase ("lookups");
+
+        LedgerHash const a (1), b (2), c (3);
+
+        {
+            LedgerHashIndex index ((beast::Journal ()));
+            expect (index.open (path), "open failed");
+            expect (index.size () == 0, "new index not empty");
+
+            LedgerHash hash, parentHash;
+            expect (! index.get (5, hash, parentHash), "found missing ledger");
+
+            index.insert (5, b, a);
+            index.insert (100000, c, b);
+
+            expect (index.get (5, hash, parentHash) &&
+                hash == b && parentHash == a, "wrong ledger 5");
+            expect (index.getHash (100000) == c, "wrong ledger 100000");
+            expect (index.getHash (99999).isZero (), "found missing ledger");
+            expect (index.size () == 2, "wrong size");
+
+            // Replacing a ledger doesn't change the count
+            index.insert (5, c, a);
+            expect (index.getHash (5) == c, "ledger not replaced");
+            expect (index.size () == 2, "wrong size after replace");
+        }
+
+        testcase ("reopen");
+
+        {
+            LedgerHashIndex index ((beast::Journal ()));
+            expect (index.open (path), "reopen failed");
+            expect (index.size () == 2, "wrong size after reopen");
+            expect (index.getHash (100000) == c, "ledger lost on reopen");
+        }
+
+        testcase ("invalid file");
+
+        {
+            std::fstream file (path.string ().c_str (),
+                std::ios::binary | std::ios::in | std::ios::out);
+            file.write ("garbage!", 8);
+        }
+
+        {
+            LedgerHashIndex index ((beast::Journal ()));
+            expect (index.open (path), "invalid file not recreated");
+            expect (index.size () == 0, "invalid file not emptied");
+            expect (index.getHash (5).isZero (), "invalid file not emptied");
+        }
+    }
+
+    void run ()
+    {
+        boost::filesystem::path const path (
+            boost::filesystem::temp_directory_path () /
+            boost::filesystem::unique_path ());
+
+        testIndex (path);
+
+        boost::system::error_code ec;
+        boost::filesystem::remove (path, ec);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(LedgerHashIndex,ripple_app,ripple);
+
+} // ripple
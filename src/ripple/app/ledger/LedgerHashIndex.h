@@ -0,0 +1,136 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_LEDGERHASHINDEX_H_INCLUDED
+#define RIPPLE_LEDGERHASHINDEX_H_INCLUDED
+
+#include <beast/utility/Journal.h>
+#include <boost/filesystem/path.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <memory>
+
+namespace boost {
+namespace interprocess {
+class file_mapping;
+class mapped_region;
+}
+}
+
+namespace ripple {
+
+/** Maps the sequence of each saved ledger to its hash and parent hash.
+
+    The index mirrors the Ledgers table in a memory mapped file with one
+    fixed size record per sequence, so a lookup is a single read at a
+    computed offset instead of a SQL query. Records are written once a
+    ledger is saved to the table and the file grows as higher sequences
+    arrive; slots for ledgers we never saved stay zero and, on systems
+    with sparse files, take no space.
+
+    At startup the index is checked against the table and rebuilt from it
+    if they disagree. If the file can't be used the index stays closed and
+    callers fall back to the database.
+*/
+class LedgerHashIndex
+{
+public:
+    explicit LedgerHashIndex (beast::Journal journal);
+    ~LedgerHashIndex ();
+
+    /** Open the index file, creating it if needed.
+        @return false if the file could not be used.
+    */
+    bool open (boost::filesystem::path const& path);
+
+    /** Returns true if the index is open and answering lookups. */
+    bool isOpen ();
+
+    /** Make the index agree with the Ledgers table.
+        The index is rebuilt from the table if it holds a different number
+        of ledgers or any of the most recent ones disagree.
+    */
+    void verify (DatabaseCon& ledgerDB);
+
+    /** Look up a ledger by sequence.
+        @return false if no ledger with that sequence is indexed.
+    */
+    bool get (LedgerIndex seq, LedgerHash& hash, LedgerHash& parentHash);
+
+    /** Returns the hash of a ledger, or zero if it is not indexed. */
+    LedgerHash getHash (LedgerIndex seq);
+
+    /** Record a ledger which was saved to the Ledgers table. */
+    void insert (LedgerIndex seq,
+        LedgerHash const& hash, LedgerHash const& parentHash);
+
+    /** Returns the number of ledgers indexed. */
+    std::uint64_t size ();
+
+private:
+    enum
+    {
+        headerSize = 64,
+
+        // A ledger hash followed by its parent hash
+        recordSize = 64,
+
+        // The file grows by this many records at a time
+        growRecords = 65536,
+
+        // The number of recent ledgers compared with the table at startup
+        verifyRecent = 256
+    };
+
+    typedef boost::shared_mutex LockType;
+    typedef boost::shared_lock <LockType> ScopedReadLockType;
+    typedef boost::unique_lock <LockType> ScopedWriteLockType;
+
+    // These require the exclusive lock
+    bool create ();
+    bool map ();
+    void unmap ();
+    void close ();
+    bool reserve (LedgerIndex seq);
+    void setCount (std::uint64_t count);
+    void write (LedgerIndex seq,
+        LedgerHash const& hash, LedgerHash const& parentHash);
+
+    // Requires either lock
+    unsigned char const* find (LedgerIndex seq) const;
+
+    LockType m_lock;
+    beast::Journal m_journal;
+    boost::filesystem::path m_path;
+    std::unique_ptr <boost::interprocess::file_mapping> m_file;
+    std::unique_ptr <boost::interprocess::mapped_region> m_region;
+
+    // The number of records the mapped file has room for
+    std::uint64_t m_records;
+
+    // The number of records holding a ledger
+    std::uint64_t m_count;
+};
+
+} // ripple
+
+#endif
@@ -33,8 +33,6 @@ namespace ripple {
 #define CACHED_LEDGER_AGE 120
 #endif
 
-// FIXME: Need to clean up ledgers by index at some point
-
 LedgerHistory::LedgerHistory (
     beast::insight::Collector::ptr const& collector)
     : collector_ (collector)
@@ -68,7 +66,7 @@ uint256 LedgerHistory::getLedgerHash (std::uint32_t index)
     if (it != mLedgersByIndex.end ())
         return it->second;
 
-    return uint256 ();
+    return getApp().getLedgerHashIndex ().getHash (index);
 }
 
 Ledger::pointer LedgerHistory::getLedgerBySeq (std::uint32_t index)
@@ -85,6 +83,12 @@ Ledger::pointer LedgerHistory::getLedgerBySeq (std::uint32_t index)
         }
     }
 
+    LedgerHashIndex& hashIndex (getApp().getLedgerHashIndex ());
+    uint256 const hash (hashIndex.getHash (index));
+
+    if (hash.isNonZero ())
+        return getLedgerByHash (hash);
+
     Ledger::pointer ret (Ledger::loadByIndex (index));
 
     if (!ret)
@@ -98,7 +102,10 @@ Ledger::pointer LedgerHistory::getLedgerBySeq (std::uint32_t index)
 
         assert (ret->isImmutable ());
         m_ledgers_by_hash.canonicalize (ret->getHash (), ret);
-        mLedgersByIndex[ret->getLedgerSeq ()] = ret->getHash ();
+
+        if (! hashIndex.isOpen ())
+            mLedgersByIndex[ret->getLedgerSeq ()] = ret->getHash ();
+
         return (ret->getLedgerSeq () == index) ? ret : Ledger::pointer ();
     }
 }
@@ -286,9 +293,44 @@ bool LedgerHistory::fixIndex (LedgerIndex ledgerIndex, LedgerHash const& ledgerH
         it->second = ledgerHash;
         return false;
     }
+
+    if (it == mLedgersByIndex.end ())
+    {
+        // Saved ledgers are tracked by the LedgerHashIndex instead
+        uint256 const indexHash (
+            getApp().getLedgerHashIndex ().getHash (ledgerIndex));
+
+        if (indexHash.isNonZero () && (indexHash != ledgerHash))
+        {
+            mLedgersByIndex[ledgerIndex] = ledgerHash;
+            return false;
+        }
+    }
+
     return true;
 }
 
+void LedgerHistory::sweep ()
+{
+    m_ledgers_by_hash.sweep ();
+    m_consensus_validated.sweep ();
+
+    LedgerHashIndex& hashIndex (getApp().getLedgerHashIndex ());
+
+    if (! hashIndex.isOpen ())
+        return;
+
+    LedgersByHash::ScopedLockType sl (m_ledgers_by_hash.peekMutex ());
+
+    for (auto it = mLedgersByIndex.begin (); it != mLedgersByIndex.end ();)
+    {
+        if (hashIndex.getHash (it->first) == it->second)
+            it = mLedgersByIndex.erase (it);
+        else
+            ++it;
+    }
+}
+
 void LedgerHistory::tune (int size, int age)
 {
     m_ledgers_by_hash.setTargetSize (size);
@@ -75,11 +75,7 @@ public:
 
     /** Remove stale cache entries
     */
-    void sweep ()
-    {
-        m_ledgers_by_hash.sweep ();
-        m_consensus_validated.sweep ();
-    }
+    void sweep ();
 
     /** Report that we have locally built a particular ledger
     */
@@ -121,8 +117,10 @@ private:
     ConsensusValidated m_consensus_validated;
 
 
-    // Maps ledger indexes to the corresponding hash.
-    std::map <LedgerIndex, LedgerHash> mLedgersByIndex; // validated ledgers
+    // Maps ledger indexes to the corresponding hash for validated ledgers
+    // the LedgerHashIndex doesn't hold yet. Entries are dropped once the
+    // ledger is saved and the index agrees with them.
+    std::map <LedgerIndex, LedgerHash> mLedgersByIndex;
 };
 
 } // ripple
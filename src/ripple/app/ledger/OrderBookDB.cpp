@@ -21,18 +21,25 @@
 */
 //==============================================================================
 
+#include <beast/unit_test/suite.h>
+
 namespace ripple {
 
 OrderBookDB::OrderBookDB (Stoppable& parent)
     : Stoppable ("OrderBookDB", parent)
+    , mLedgerSeq (0)
     , mSeq (0)
+    , mCheckSeq (0)
 {
 }
 
 void OrderBookDB::invalidate ()
 {
     ScopedLockType sl (mLock);
+    mLedgerSeq = 0;
+    mPending.clear ();
     mSeq = 0;
+    mCheckSeq = 0;
 }
 
 void OrderBookDB::setup (Ledger::ref ledger)
@@ -41,12 +48,13 @@ void OrderBookDB::setup (Ledger::ref ledger)
         ScopedLockType sl (mLock);
         auto seq = ledger->getLedgerSeq ();
 
-        // Do a full update every 256 ledgers
+        // The books follow each published ledger, so a full update is
+        // only a periodic consistency check against the tracked books
         if (mSeq != 0)
         {
             if (seq == mSeq)
                 return;
-            if ((seq > mSeq) && ((seq - mSeq) < 256))
+            if ((seq > mSeq) && ((seq - mSeq) < 16384))
                 return;
             if ((seq < mSeq) && ((mSeq - seq) < 16))
                 return;
@@ -56,34 +64,61 @@ void OrderBookDB::setup (Ledger::ref ledger)
             << "Advancing from " << mSeq << " to " << seq;
 
         mSeq = seq;
+
+        // The tracked books are kept until the update replaces them, so
+        // they can be compared if they reflect the same ledger
+        mCheckSeq = (mLedgerSeq == seq) ? seq : 0;
+
+        // Hold published ledgers until the full update finishes
+        mLedgerSeq = 0;
+        mPending.clear ();
     }
 
     if (getConfig().RUN_STANDALONE)
         update(ledger);
     else
         getApp().getJobQueue().addJob(jtUPDATE_PF, "OrderBookDB::update",
-            std::bind(&OrderBookDB::update, this, ledger));
+            [this, ledger] (Job&) { update (ledger); });
 }
 
-static void updateHelper (SLE::ref entry,
-    hash_set< uint256 >& seen,
+template <class Object>
+static bool getBookRoot (Object const& entry, Book& book)
+{
+    // A book directory has one root for each quality
+    if (!entry.isFieldPresent (sfExchangeRate))
+        return false;
+
+    // Default fields are left out of new node metadata and XRP is zero
+    auto const getH160 = [&entry] (SField::ref field)
+    {
+        return entry.isFieldPresent (field) ?
+            entry.getFieldH160 (field) : uint160 ();
+    };
+
+    book.in.currency.copyFrom (getH160 (sfTakerPaysCurrency));
+    book.in.account.copyFrom (getH160 (sfTakerPaysIssuer));
+    book.out.account.copyFrom (getH160 (sfTakerGetsIssuer));
+    book.out.currency.copyFrom (getH160 (sfTakerGetsCurrency));
+    return true;
+}
+
+static void updateHelper (SHAMapItem::ref item,
+    hash_map< uint256, int >& bookDirs,
     OrderBookDB::IssueToOrderBook& destMap,
     OrderBookDB::IssueToOrderBook& sourceMap,
     hash_set< Issue >& XRPBooks,
     int& books)
 {
-    if (entry->getType () == ltDIR_NODE &&
-        entry->isFieldPresent (sfExchangeRate) &&
-        entry->getFieldH256 (sfRootIndex) == entry->getIndex())
-    {
-        Book book;
-        book.in.currency.copyFrom (entry->getFieldH160 (sfTakerPaysCurrency));
-        book.in.account.copyFrom (entry->getFieldH160 (sfTakerPaysIssuer));
-        book.out.account.copyFrom (entry->getFieldH160 (sfTakerGetsIssuer));
-        book.out.currency.copyFrom (entry->getFieldH160 (sfTakerGetsCurrency));
+    // Read the few fields needed without deserializing every entry
+    STObjectView const entry (item->peekData ());
+    Book book;
 
+    if (entry.getType () == ltDIR_NODE &&
+        entry.getFieldH256 (sfRootIndex) == item->getTag () &&
+        getBookRoot (entry, book))
+    {
         uint256 index = Ledger::getBookBase (book);
-        if (seen.insert (index).second)
+        if (bookDirs[index]++ == 0)
         {
             auto orderBook = std::make_shared<OrderBook> (index, book);
             sourceMap[book.in].push_back (orderBook);
@@ -99,7 +134,7 @@ static void updateHelper (SLE::ref entry,
 
 void OrderBookDB::update (Ledger::pointer ledger)
 {
-    hash_set< uint256 > seen;
+    hash_map< uint256, int > bookDirs;
     OrderBookDB::IssueToOrderBook destMap;
     OrderBookDB::IssueToOrderBook sourceMap;
     hash_set< Issue > XRPBooks;
@@ -112,8 +147,8 @@ void OrderBookDB::update (Ledger::pointer ledger)
 
     try
     {
-        ledger->visitStateItems(std::bind(&updateHelper, std::placeholders::_1,
-                                          std::ref(seen), std::ref(destMap),
+        ledger->visitStateLeaves(std::bind(&updateHelper,
+            std::placeholders::_1, std::ref(bookDirs), std::ref(destMap),
             std::ref(sourceMap), std::ref(XRPBooks), std::ref(books)));
     }
     catch (const SHAMapMissingNode&)
@@ -121,7 +156,9 @@ void OrderBookDB::update (Ledger::pointer ledger)
         WriteLog (lsINFO, OrderBookDB)
             << "OrderBookDB::update encountered a missing node";
         ScopedLockType sl (mLock);
+        mPending.clear ();
         mSeq = 0;
+        mCheckSeq = 0;
         return;
     }
 
@@ -130,13 +167,277 @@ void OrderBookDB::update (Ledger::pointer ledger)
     {
         ScopedLockType sl (mLock);
 
+        if (mCheckSeq != 0 && mCheckSeq == ledger->getLedgerSeq ())
+            checkBooks (bookDirs);
+        mCheckSeq = 0;
+
         mXRPBooks.swap(XRPBooks);
         mSourceMap.swap(sourceMap);
         mDestMap.swap(destMap);
+        mBookDirs.swap(bookDirs);
+
+        mLedgerSeq = ledger->getLedgerSeq ();
+        mLedgerHash = ledger->getHash ();
+
+        // Catch up with the ledgers published during the update
+        for (auto const& accepted : mPending)
+        {
+            Ledger::ref next = accepted->getLedger ();
+
+            if (next->getLedgerSeq () <= mLedgerSeq)
+                continue;
+
+            if (next->getParentHash () != mLedgerHash)
+            {
+                WriteLog (lsDEBUG, OrderBookDB)
+                    << "OrderBookDB::update missed ledger "
+                    << next->getLedgerSeq () - 1;
+                mLedgerSeq = 0;
+                mSeq = 0;
+                break;
+            }
+
+            applyChanges (*accepted);
+        }
+
+        mPending.clear ();
     }
     getApp().getLedgerMaster().newOrderBookDB();
 }
 
+void OrderBookDB::checkBooks (BookDirCounts const& rebuilt)
+{
+    int missing = 0;
+    int extra = 0;
+
+    for (auto const& dir : rebuilt)
+    {
+        auto const it = mBookDirs.find (dir.first);
+        int const tracked = (it == mBookDirs.end ()) ? 0 : it->second;
+
+        if (tracked != dir.second)
+        {
+            ++missing;
+            WriteLog (lsDEBUG, OrderBookDB) << "Book " << dir.first <<
+                " has " << dir.second << " root directories, tracked " <<
+                tracked;
+        }
+    }
+
+    for (auto const& dir : mBookDirs)
+    {
+        if (rebuilt.find (dir.first) == rebuilt.end ())
+        {
+            ++extra;
+            WriteLog (lsDEBUG, OrderBookDB) << "Book " << dir.first <<
+                " is gone, tracked " << dir.second << " root directories";
+        }
+    }
+
+    if (missing != 0 || extra != 0)
+    {
+        WriteLog (lsWARNING, OrderBookDB)
+            << "Tracked books differ from ledger " << mCheckSeq << ": "
+            << missing << " missing or miscounted, " << extra << " extra";
+    }
+}
+
+void OrderBookDB::update (AcceptedLedger::pointer const& accepted)
+{
+    Ledger::ref ledger = accepted->getLedger ();
+    bool changed = false;
+
+    {
+        ScopedLockType sl (mLock);
+
+        if (mLedgerSeq != 0)
+        {
+            if (ledger->getParentHash () == mLedgerHash)
+                changed = applyChanges (*accepted);
+            else if (ledger->getLedgerSeq () > mLedgerSeq)
+            {
+                // A ledger was skipped
+                mLedgerSeq = 0;
+                mSeq = 0;
+            }
+        }
+        else if (mSeq != 0)
+        {
+            // A full update is running
+            mPending.push_back (accepted);
+
+            // If it falls too far behind it will miss a ledger and the
+            // next one published starts over
+            if (mPending.size () > 256)
+                mPending.pop_front ();
+        }
+    }
+
+    if (changed)
+        getApp().getLedgerMaster().newOrderBookDB();
+
+    // The books are empty or a ledger was skipped
+    setup (ledger);
+}
+
+bool OrderBookDB::applyChanges (AcceptedLedger const& accepted)
+{
+    BookChanges changes;
+
+    for (auto const& item : accepted.getMap ())
+    {
+        TransactionMetaSet::ref meta = item.second->getMeta ();
+
+        if (meta)
+            getBookChanges (*meta, changes);
+    }
+
+    bool const changed = applyBookChanges (changes);
+
+    Ledger::ref ledger = accepted.getLedger ();
+    mLedgerSeq = ledger->getLedgerSeq ();
+    mLedgerHash = ledger->getHash ();
+
+    if (changed)
+    {
+        WriteLog (lsDEBUG, OrderBookDB)
+            << "OrderBookDB books changed in ledger " << mLedgerSeq;
+    }
+
+    return changed;
+}
+
+bool OrderBookDB::applyBookChanges (BookChanges const& changes)
+{
+    ScopedLockType sl (mLock);
+    bool changed = false;
+
+    for (auto const& change : changes)
+    {
+        Book const& book = change.first;
+        uint256 const index = Ledger::getBookBase (book);
+        int& count = mBookDirs[index];
+
+        if (change.second > 0)
+        {
+            if (count++ == 0)
+            {
+                rawAddBook (index, book);
+                changed = true;
+            }
+        }
+        else if (count == 0 || --count == 0)
+        {
+            mBookDirs.erase (index);
+            rawRemoveBook (index, book);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+void OrderBookDB::getBookChanges (TransactionMetaSet& meta,
+    BookChanges& changes)
+{
+    for (auto const& node : meta.getNodes ())
+    {
+        if (node.getFieldU16 (sfLedgerEntryType) != ltDIR_NODE)
+            continue;
+
+        // Modifying a directory never changes the books
+        bool const created = (node.getFName () == sfCreatedNode);
+        if (!created && node.getFName () != sfDeletedNode)
+            continue;
+
+        int const index = node.getFieldIndex (
+            created ? sfNewFields : sfFinalFields);
+
+        STObject const* fields = (index == -1) ? nullptr :
+            dynamic_cast <STObject const*> (&node.peekAtIndex (index));
+
+        Book book;
+
+        if (fields && fields->isFieldPresent (sfRootIndex) &&
+            fields->getFieldH256 (sfRootIndex) ==
+                node.getFieldH256 (sfLedgerIndex) &&
+            getBookRoot (*fields, book))
+        {
+            changes.emplace_back (book, created ? 1 : -1);
+        }
+    }
+}
+
+void OrderBookDB::rawAddBook (uint256 const& index, Book const& book)
+{
+    auto& books = mSourceMap[book.in];
+
+    // addOrderBook may already have added it
+    for (auto const& ob : books)
+    {
+        if (ob->getBookBase () == index)
+            return;
+    }
+
+    auto orderBook = std::make_shared<OrderBook> (index, book);
+
+    books.push_back (orderBook);
+    mDestMap[book.out].push_back (orderBook);
+    if (isXRP (book.out))
+        mXRPBooks.insert (book.in);
+    else if (isVBC (book.out))
+        mVBCBooks.insert (book.in);
+}
+
+static void eraseBook (OrderBookDB::IssueToOrderBook& map, Issue const& issue,
+    uint256 const& index)
+{
+    auto it = map.find (issue);
+    if (it == map.end ())
+        return;
+
+    auto& books = it->second;
+    books.erase (std::remove_if (books.begin (), books.end (),
+        [&index] (OrderBook::ref ob)
+        {
+            return ob->getBookBase () == index;
+        }), books.end ());
+
+    if (books.empty ())
+        map.erase (it);
+}
+
+void OrderBookDB::rawRemoveBook (uint256 const& index, Book const& book)
+{
+    eraseBook (mSourceMap, book.in, index);
+    eraseBook (mDestMap, book.out, index);
+
+    bool const toXRP = isXRP (book.out);
+    bool const toVBC = isVBC (book.out);
+
+    if (!toXRP && !toVBC)
+        return;
+
+    // Another book from the same issue may still reach the native currency
+    auto it = mSourceMap.find (book.in);
+    if (it != mSourceMap.end ())
+    {
+        for (auto const& ob : it->second)
+        {
+            if ((toXRP && isXRP (ob->getCurrencyOut ())) ||
+                (toVBC && isVBC (ob->getCurrencyOut ())))
+            {
+                return;
+            }
+        }
+    }
+
+    if (toXRP)
+        mXRPBooks.erase (book.in);
+    else
+        mVBCBooks.erase (book.in);
+}
+
 void OrderBookDB::addOrderBook(Book const& book)
 {
     bool toXRP = isXRP (book.out);
@@ -246,6 +547,10 @@ void OrderBookDB::processTxn (
 
     if (alTx.getResult () == tesSUCCESS)
     {
+        // Serialized on first use and shared by every book the
+        // transaction touches.
+        InfoSub::Payload::pointer payload;
+
         // Check if this is an offer or an offer cancel or a payment that
         // consumes an offer.
         // Check to see what the meta looks like.
@@ -279,7 +584,12 @@ void OrderBookDB::processTxn (
                                  data->getFieldAmount (sfTakerPays).issue()});
 
                             if (listeners)
-                                listeners->publish (jvObj);
+                            {
+                                if (!payload)
+                                    payload = InfoSub::Payload::make (jvObj);
+
+                                listeners->publish (payload);
+                            }
                         }
                     }
                 }
@@ -293,4 +603,142 @@ void OrderBookDB::processTxn (
     }
 }
 
+//------------------------------------------------------------------------------
+
+class OrderBookDB_test : public beast::unit_test::suite
+{
+public:
+    static void addDirectory (TransactionMetaSet& meta, SField::ref type,
+        Book const& book, std::uint64_t rate, bool root)
+    {
+        uint256 const index (Ledger::getQualityIndex (
+            Ledger::getBookBase (book), rate));
+        meta.setAffectedNode (index, type, ltDIR_NODE);
+
+        STObject object (type == sfCreatedNode ? sfNewFields : sfFinalFields);
+        object.setFieldH256 (sfRootIndex, root ? index : uint256 (1));
+        object.setFieldU64 (sfExchangeRate, rate);
+
+        // New node metadata leaves out XRP
+        if (type != sfCreatedNode || !isXRP (book.in))
+        {
+            object.setFieldH160 (sfTakerPaysCurrency, book.in.currency);
+            object.setFieldH160 (sfTakerPaysIssuer, book.in.account);
+        }
+
+        if (type != sfCreatedNode || !isXRP (book.out))
+        {
+            object.setFieldH160 (sfTakerGetsCurrency, book.out.currency);
+            object.setFieldH160 (sfTakerGetsIssuer, book.out.account);
+        }
+
+        meta.getAffectedNode (index).addObject (object);
+    }
+
+    void testBookChanges ()
+    {
+        testcase ("book changes");
+
+        Account const issuer (1);
+        Issue const usd (to_currency ("USD"), issuer);
+        Issue const eur (to_currency ("EUR"), issuer);
+
+        Book const xrpToUsd (xrpIssue (), usd);
+        Book const usdToEur (usd, eur);
+        Book const eurToXrp (eur, xrpIssue ());
+
+        TransactionMetaSet meta (uint256 (), 1, 0);
+        addDirectory (meta, sfCreatedNode, xrpToUsd, 100, true);
+        addDirectory (meta, sfDeletedNode, eurToXrp, 200, true);
+        addDirectory (meta, sfCreatedNode, usdToEur, 300, false);
+        addDirectory (meta, sfModifiedNode, usdToEur, 400, true);
+
+        // An owner directory
+        uint256 const owner (Ledger::getOwnerDirIndex (issuer));
+        meta.setAffectedNode (owner, sfCreatedNode, ltDIR_NODE);
+        STObject fields (sfNewFields);
+        fields.setFieldH256 (sfRootIndex, owner);
+        fields.setFieldAccount (sfOwner, issuer);
+        meta.getAffectedNode (owner).addObject (fields);
+
+        OrderBookDB::BookChanges changes;
+        OrderBookDB::getBookChanges (meta, changes);
+
+        expect (changes.size () == 2, "wrong number of changes");
+        expect (std::count (changes.begin (), changes.end (),
+            std::make_pair (xrpToUsd, 1)) == 1, "created book missing");
+        expect (std::count (changes.begin (), changes.end (),
+            std::make_pair (eurToXrp, -1)) == 1, "deleted book missing");
+    }
+
+    // Applies the book roots created and deleted by one transaction
+    static bool apply (OrderBookDB& db,
+        std::vector <std::pair <Book, std::uint64_t>> const& created,
+        std::vector <std::pair <Book, std::uint64_t>> const& deleted)
+    {
+        TransactionMetaSet meta (uint256 (), 1, 0);
+
+        for (auto const& dir : created)
+            addDirectory (meta, sfCreatedNode, dir.first, dir.second, true);
+
+        for (auto const& dir : deleted)
+            addDirectory (meta, sfDeletedNode, dir.first, dir.second, true);
+
+        OrderBookDB::BookChanges changes;
+        OrderBookDB::getBookChanges (meta, changes);
+        return db.applyBookChanges (changes);
+    }
+
+    void testApply ()
+    {
+        testcase ("apply");
+
+        Account const issuer (1);
+        Issue const usd (to_currency ("USD"), issuer);
+        Issue const eur (to_currency ("EUR"), issuer);
+
+        Book const usdToXrp (usd, xrpIssue ());
+        Book const usdToVbc (usd, vbcIssue ());
+        Book const usdToEur (usd, eur);
+
+        beast::RootStoppable root ("root");
+        OrderBookDB db (root);
+
+        // Two qualities of one book, and a book to each native currency
+        expect (apply (db, { { usdToXrp, 100 }, { usdToXrp, 200 },
+            { usdToVbc, 100 }, { usdToEur, 100 } }, {}), "books not added");
+        expect (db.getBookSize (usd) == 3, "wrong number of books");
+        expect (db.isBookToXRP (usd), "book to XRP missing");
+        expect (db.isBookToVBC (usd), "book to VBC missing");
+
+        // A quality of a book that already exists
+        expect (! apply (db, { { usdToEur, 200 } }, {}),
+            "existing book added again");
+        expect (db.getBookSize (usd) == 3, "book added twice");
+
+        // The book stays while one of its qualities is left
+        expect (! apply (db, {}, { { usdToXrp, 100 } }),
+            "book removed with a quality left");
+        expect (db.isBookToXRP (usd), "book to XRP removed early");
+
+        expect (apply (db, {}, { { usdToXrp, 200 }, { usdToVbc, 100 } }),
+            "books not removed");
+        expect (db.getBookSize (usd) == 1, "removed books remain");
+        expect (! db.isBookToXRP (usd), "book to XRP remains");
+        expect (! db.isBookToVBC (usd), "book to VBC remains");
+
+        // A book created and deleted by the same transaction
+        apply (db, { { usdToVbc, 300 } }, { { usdToVbc, 300 } });
+        expect (! db.isBookToVBC (usd), "deleted book remains");
+    }
+
+    void run ()
+    {
+        testBookChanges ();
+        testApply ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(OrderBookDB,ripple_app,ripple);
+
 } // ripple
@@ -25,9 +25,18 @@
 #define RIPPLE_ORDERBOOKDB_H_INCLUDED
 
 #include <ripple/app/ledger/BookListeners.h>
+#include <deque>
 
 namespace ripple {
 
+/** The order books in a recent ledger.
+
+    A full update visits every entry in the state map, so it only runs when
+    the books are first needed, after a gap in the published ledgers, and
+    periodically as a consistency check. In between, the books follow each
+    published ledger by applying the book directories its transactions
+    created and deleted.
+*/
 class OrderBookDB
     : public beast::Stoppable
     , public beast::LeakChecked <OrderBookDB>
@@ -37,6 +46,10 @@ public:
 
     void setup (Ledger::ref ledger);
     void update (Ledger::pointer ledger);
+
+    /** Advance the books to a newly published ledger. */
+    void update (AcceptedLedger::pointer const& accepted);
+
     void invalidate ();
 
     void addOrderBook(Book const&);
@@ -62,8 +75,37 @@ public:
 
     typedef hash_map <Issue, OrderBook::List> IssueToOrderBook;
 
+    /** Book directory roots created (+1) or deleted (-1) by a transaction.
+        Each quality in a book has its own root directory.
+    */
+    typedef std::vector <std::pair <Book, int>> BookChanges;
+
+    static void getBookChanges (TransactionMetaSet& meta,
+        BookChanges& changes);
+
+    /** Add and remove books for the root directories in `changes`.
+        A book is removed once its last root directory is deleted.
+        @return `true` if a book was added or removed.
+    */
+    bool applyBookChanges (BookChanges const& changes);
+
 private:
-    void rawAddBook(Book const&);
+    // Ledgers published while a full update runs, replayed after it
+    typedef std::deque <AcceptedLedger::pointer> PendingLedgers;
+
+    // Root directories of each book by book base
+    typedef hash_map <uint256, int> BookDirCounts;
+
+    void rawAddBook (uint256 const& index, Book const&);
+    void rawRemoveBook (uint256 const& index, Book const&);
+
+    // Apply one ledger's changes, returns `true` if a book was added or
+    // removed. The lock must be held.
+    bool applyChanges (AcceptedLedger const& accepted);
+
+    // Log the books that differ between the tracked and the rebuilt root
+    // directory counts. The lock must be held.
+    void checkBooks (BookDirCounts const& rebuilt);
 
     // by ci/ii
     IssueToOrderBook mSourceMap;
@@ -86,7 +128,20 @@ private:
 
     BookToListenersMap mListeners;
 
+    BookDirCounts mBookDirs;
+
+    // Ledger the books reflect, zero if they are not being tracked
+    std::uint32_t mLedgerSeq;
+    uint256 mLedgerHash;
+
+    PendingLedgers mPending;
+
+    // Ledger of the last full update
     std::uint32_t mSeq;
+
+    // Ledger the tracked books reflected when the full update started,
+    // zero if there is nothing to check the update against
+    std::uint32_t mCheckSeq;
 };
 
 } // ripple
@@ -0,0 +1,275 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+namespace ripple {
+
+// Most ledgers queued for one database transaction
+static std::size_t const maxBatchLedgers = 64;
+
+TxnDBWriter::TxnDBWriter (DatabaseCon& txnDB, AccountTxPager& pager,
+    bool binary, beast::Journal journal)
+    : m_txnDB (txnDB)
+    , m_pager (pager)
+    , m_binary (binary)
+    , m_journal (journal)
+    , m_writing (false)
+    , m_batches (0)
+{
+}
+
+TxnDBWriter::~TxnDBWriter ()
+{
+    // The statements must be finalized while the database is still open
+    auto sl (m_txnDB.lock ());
+    m_deleteTxns.reset ();
+    m_deleteAcctTxns.reset ();
+    m_deleteAcctTxn.reset ();
+    m_insertAcctTxn.reset ();
+    m_insertTxn.reset ();
+}
+
+void TxnDBWriter::write (AcceptedLedger::pointer const& ledger,
+    bool synchronous)
+{
+    if (synchronous)
+    {
+        writeBatch (std::vector <AcceptedLedger::pointer> (1, ledger));
+        return;
+    }
+
+    ScopedLockType sl (m_lock);
+    m_queue.push_back (ledger);
+    condWrite ();
+}
+
+void TxnDBWriter::flush ()
+{
+    std::unique_lock <LockType> sl (m_lock);
+
+    // Write the queue here rather than waiting for the job, which never
+    // runs if the job queue has already stopped
+    for (;;)
+    {
+        if (!m_queue.empty ())
+            writeNext (sl);
+        else if (m_batches != 0)
+            m_written.wait (sl);
+        else
+            break;
+    }
+}
+
+void TxnDBWriter::condWrite ()
+{
+    if (m_writing)
+        return;
+
+    m_writing = true;
+    getApp().getJobQueue ().addJob (jtWRITE, "TxnDBWriter::doWrite",
+        std::bind (&TxnDBWriter::doWrite, this, std::placeholders::_1));
+}
+
+void TxnDBWriter::doWrite (Job&)
+{
+    LoadEvent::autoptr event (
+        getApp().getJobQueue ().getLoadEventAP (jtDISK, "TxnDBWrite"));
+
+    std::unique_lock <LockType> sl (m_lock);
+    assert (m_writing);
+
+    try
+    {
+        while (!m_queue.empty ())
+            writeNext (sl);
+    }
+    catch (...)
+    {
+        // Let the next write queue a job for what is left
+        m_writing = false;
+        throw;
+    }
+
+    m_writing = false;
+}
+
+void TxnDBWriter::writeNext (std::unique_lock <LockType>& sl)
+{
+    std::vector <AcceptedLedger::pointer> batch;
+
+    if (m_queue.size () <= maxBatchLedgers)
+    {
+        batch.swap (m_queue);
+    }
+    else
+    {
+        batch.assign (m_queue.begin (),
+            m_queue.begin () + maxBatchLedgers);
+        m_queue.erase (m_queue.begin (),
+            m_queue.begin () + maxBatchLedgers);
+    }
+
+    ++m_batches;
+    sl.unlock ();
+
+    try
+    {
+        writeBatch (batch);
+    }
+    catch (...)
+    {
+        // Don't leave flush waiting on a batch that will never finish
+        sl.lock ();
+
+        if (--m_batches == 0)
+            m_written.notify_all ();
+
+        throw;
+    }
+
+    sl.lock ();
+
+    if (--m_batches == 0)
+        m_written.notify_all ();
+}
+
+void TxnDBWriter::writeBatch (
+    std::vector <AcceptedLedger::pointer> const& ledgers)
+{
+    {
+        auto db = m_txnDB.getDB ();
+        auto dbLock (m_txnDB.lock ());
+        SqliteDatabase* sqlite = db->getSqliteDB ();
+
+        if (!m_insertTxn)
+        {
+            m_deleteTxns = std::make_unique <SqliteStatement> (sqlite,
+                "DELETE FROM Transactions WHERE LedgerSeq = ?;");
+            m_deleteAcctTxns = std::make_unique <SqliteStatement> (sqlite,
+                "DELETE FROM AccountTransactions WHERE LedgerSeq = ?;");
+            m_deleteAcctTxn = std::make_unique <SqliteStatement> (sqlite,
+                "DELETE FROM AccountTransactions WHERE TransID = ?;");
+            m_insertAcctTxn = std::make_unique <SqliteStatement> (sqlite,
+                "INSERT INTO AccountTransactions "
+                "(TransID, Account, LedgerSeq, TxnSeq) VALUES (?, ?, ?, ?);");
+            m_insertTxn = std::make_unique <SqliteStatement> (sqlite,
+                "INSERT OR REPLACE INTO Transactions "
+                "(TransID, TransType, FromAcct, FromSeq, LedgerSeq, Status, "
+                "RawTxn, TxnMeta) VALUES (?, ?, ?, ?, ?, ?, ?, ?);");
+        }
+
+        db->executeSQL ("BEGIN TRANSACTION;");
+
+        try
+        {
+            for (auto const& ledger : ledgers)
+                writeLedger (*ledger);
+        }
+        catch (...)
+        {
+            // The connection is shared, so the transaction must not stay open
+            db->executeSQL ("ROLLBACK TRANSACTION;");
+            throw;
+        }
+
+        db->executeSQL ("COMMIT TRANSACTION;");
+    }
+
+    if (ledgers.size () > 1)
+        m_journal.debug << "Wrote " << ledgers.size () <<
+            " ledgers in one transaction";
+
+    for (auto const& ledger : ledgers)
+    {
+        m_pager.onLedgerWritten (*ledger);
+        ledger->getLedger ()->finishSaveValidated ();
+    }
+}
+
+void TxnDBWriter::writeLedger (AcceptedLedger const& ledger)
+{
+    std::uint32_t const ledgerSeq = ledger.getLedger ()->getLedgerSeq ();
+    std::string const status (1, TXN_SQL_VALIDATED);
+
+    m_deleteTxns->bind (1, ledgerSeq);
+    execute (*m_deleteTxns);
+
+    m_deleteAcctTxns->bind (1, ledgerSeq);
+    execute (*m_deleteAcctTxns);
+
+    for (auto const& vt : ledger.getMap ())
+    {
+        AcceptedLedgerTx const& tx = *vt.second;
+        SerializedTransaction const& txn = *tx.getTxn ();
+        uint256 const transactionID = tx.getTransactionID ();
+
+        bindTxnDBKey (*m_deleteAcctTxn, 1, transactionID);
+        execute (*m_deleteAcctTxn);
+
+        auto const& accts = tx.getAffected ();
+
+        if (accts.empty ())
+            m_journal.warning << "Transaction in ledger " << ledgerSeq <<
+                " affects no accounts";
+
+        for (auto const& account : accts)
+        {
+            bindTxnDBKey (*m_insertAcctTxn, 1, transactionID);
+            bindTxnDBKey (*m_insertAcctTxn, 2, account.getAccountID ());
+            m_insertAcctTxn->bind (3, ledgerSeq);
+            m_insertAcctTxn->bind (4, tx.getTxnSeq ());
+            execute (*m_insertAcctTxn);
+        }
+
+        Serializer rawTxn;
+        txn.add (rawTxn);
+
+        bindTxnDBKey (*m_insertTxn, 1, transactionID);
+
+        if (m_binary)
+            m_insertTxn->bind (2,
+                static_cast <std::uint32_t> (txn.getTxnType ()));
+        else
+            m_insertTxn->bind (2, txn.getTransactionType ());
+
+        bindTxnDBKey (*m_insertTxn, 3, txn.getSourceAccount ().getAccountID ());
+        m_insertTxn->bind (4, txn.getSequence ());
+        m_insertTxn->bind (5, ledgerSeq);
+        m_insertTxn->bindStatic (6, status);
+        m_insertTxn->bindStatic (7, rawTxn.peekData ());
+        m_insertTxn->bindStatic (8, tx.getRawMeta ());
+        execute (*m_insertTxn);
+    }
+}
+
+void TxnDBWriter::execute (SqliteStatement& statement)
+{
+    int const result = statement.step ();
+
+    if (!statement.isDone (result))
+        m_journal.warning << "Transaction database write failed: " <<
+            statement.getError (result);
+
+    statement.reset ();
+}
+
+} // ripple
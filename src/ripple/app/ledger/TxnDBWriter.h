@@ -0,0 +1,99 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_TXNDBWRITER_H_INCLUDED
+#define RIPPLE_TXNDBWRITER_H_INCLUDED
+
+#include <beast/utility/Journal.h>
+#include <condition_variable>
+#include <mutex>
+
+namespace ripple {
+
+/** Writes the transactions of validated ledgers to the transaction database.
+
+    Rows are written with prepared statements that are built once and
+    reused. Ledgers saved asynchronously are queued, and a single job
+    writes everything queued in one database transaction, so a server
+    catching up on history commits many ledgers at a time.
+
+    Once a ledger's transactions are committed its header is saved and the
+    ledger is no longer pending.
+*/
+class TxnDBWriter
+{
+public:
+    TxnDBWriter (DatabaseCon& txnDB, AccountTxPager& pager, bool binary,
+        beast::Journal journal);
+    ~TxnDBWriter ();
+
+    /** Write the transactions of a ledger.
+        If synchronous, returns after they are committed.
+    */
+    void write (AcceptedLedger::pointer const& ledger, bool synchronous);
+
+    /** Write the queued ledgers on the calling thread.
+        Returns once every ledger queued so far is committed, including
+        any a job is part way through writing.
+    */
+    void flush ();
+
+private:
+    typedef std::mutex LockType;
+    typedef std::lock_guard <LockType> ScopedLockType;
+
+    void condWrite ();
+    void doWrite (Job&);
+
+    // Called with the lock held. Releases it while writing the next batch.
+    void writeNext (std::unique_lock <LockType>& sl);
+
+    void writeBatch (std::vector <AcceptedLedger::pointer> const& ledgers);
+    void writeLedger (AcceptedLedger const& ledger);
+
+    void execute (SqliteStatement& statement);
+
+    DatabaseCon& m_txnDB;
+    AccountTxPager& m_pager;
+    bool const m_binary;
+    beast::Journal m_journal;
+
+    // Built on first use, with the database locked
+    std::unique_ptr <SqliteStatement> m_deleteTxns;
+    std::unique_ptr <SqliteStatement> m_deleteAcctTxns;
+    std::unique_ptr <SqliteStatement> m_deleteAcctTxn;
+    std::unique_ptr <SqliteStatement> m_insertAcctTxn;
+    std::unique_ptr <SqliteStatement> m_insertTxn;
+
+    LockType m_lock;
+    std::vector <AcceptedLedger::pointer> m_queue;
+    bool m_writing;
+
+    // Batches being written with the lock released
+    int m_batches;
+    std::condition_variable m_written;
+};
+
+} // ripple
+
+#endif
@@ -163,6 +163,7 @@ public:
     std::unique_ptr <CollectorManager> m_collectorManager;
     std::unique_ptr <Resource::Manager> m_resourceManager;
     std::unique_ptr <FullBelowCache> m_fullBelowCache;
+    std::unique_ptr <SignatureCache> m_signatureCache;
 
     // These are Stoppable-related
     NodeStoreScheduler m_nodeStoreScheduler;
@@ -172,6 +173,7 @@ public:
     std::unique_ptr <RPC::Manager> m_rpcManager;
     // VFALCO TODO Make OrderBookDB abstract
     OrderBookDB m_orderBookDB;
+    BalanceRankIndex m_balanceRankIndex;
     std::unique_ptr <PathRequests> m_pathRequests;
     std::unique_ptr <LedgerMaster> m_ledgerMaster;
     std::unique_ptr <InboundLedgers> m_inboundLedgers;
@@ -194,7 +196,10 @@ public:
 
     std::unique_ptr <DatabaseCon> mRpcDB;
     std::unique_ptr <DatabaseCon> mTxnDB;
+    std::unique_ptr <AccountTxPager> m_accountTxPager;
+    std::unique_ptr <TxnDBWriter> m_txnDBWriter;
     std::unique_ptr <DatabaseCon> mLedgerDB;
+    std::unique_ptr <LedgerHashIndex> m_ledgerHashIndex;
     std::unique_ptr <DatabaseCon> mWalletDB;
 
     std::unique_ptr <beast::asio::SSLContext> m_peerSSLContext;
@@ -269,6 +274,10 @@ public:
             "full_below", get_seconds_clock (), m_collectorManager->collector (),
                 fullBelowTargetSize, fullBelowExpirationSeconds))
 
+        , m_signatureCache (std::make_unique <SignatureCache> (
+            get_seconds_clock (), m_collectorManager->collector (),
+                signatureCacheTargetSize, signatureCacheExpirationSeconds))
+
         , m_nodeStoreScheduler (*this)
 
         // The JobQueue has to come pretty early since
@@ -293,6 +302,8 @@ public:
 
         , m_orderBookDB (*m_jobQueue)
 
+        , m_balanceRankIndex (m_logs.journal("BalanceRankIndex"))
+
         , m_pathRequests (new PathRequests (
             m_logs.journal("PathRequest"), m_collectorManager->collector ()))
 
@@ -310,7 +321,7 @@ public:
         , m_networkOPs (make_NetworkOPs (get_seconds_clock (),
             getConfig ().RUN_STANDALONE, getConfig ().NETWORK_QUORUM,
             *m_jobQueue, *m_ledgerMaster, *m_jobQueue,
-            m_logs.journal("NetworkOPs")))
+            m_collectorManager->collector (), m_logs.journal("NetworkOPs")))
 
         // VFALCO NOTE LocalCredentials starts the deprecated UNL service
         , m_deprecatedUNL (make_UniqueNodeList (*m_jobQueue))
@@ -409,6 +420,11 @@ public:
         return *m_siteFiles;
     }
 
+    SignatureCache& getSignatureCache ()
+    {
+        return *m_signatureCache;
+    }
+
     LocalCredentials& getLocalCredentials ()
     {
         return m_localCredentials ;
@@ -486,6 +502,11 @@ public:
         return m_orderBookDB;
     }
 
+    BalanceRankIndex& getBalanceRankIndex ()
+    {
+        return m_balanceRankIndex;
+    }
+
     PathRequests& getPathRequests ()
     {
         return *m_pathRequests;
@@ -556,11 +577,26 @@ public:
         assert (mTxnDB.get() != nullptr);
         return *mTxnDB;
     }
+    AccountTxPager& getAccountTxPager ()
+    {
+        assert (m_accountTxPager.get() != nullptr);
+        return *m_accountTxPager;
+    }
+    TxnDBWriter& getTxnDBWriter ()
+    {
+        assert (m_txnDBWriter.get() != nullptr);
+        return *m_txnDBWriter;
+    }
     DatabaseCon& getLedgerDB ()
     {
         assert (mLedgerDB.get() != nullptr);
         return *mLedgerDB;
     }
+    LedgerHashIndex& getLedgerHashIndex ()
+    {
+        assert (m_ledgerHashIndex.get() != nullptr);
+        return *m_ledgerHashIndex;
+    }
     DatabaseCon& getWalletDB ()
     {
         assert (mWalletDB.get() != nullptr);
@@ -581,8 +617,31 @@ public:
         assert (mWalletDB.get () == nullptr);
 
         mRpcDB = std::make_unique <DatabaseCon> ("rpc.db", RpcDBInit, RpcDBCount);
-        mTxnDB = std::make_unique <DatabaseCon> ("transaction.db", TxnDBInit, TxnDBCount);
+        if (getConfig ().TXN_DB_BINARY)
+            mTxnDB = std::make_unique <DatabaseCon> ("transaction_binary.db", TxnBinaryDBInit, TxnBinaryDBCount);
+        else
+            mTxnDB = std::make_unique <DatabaseCon> ("transaction.db", TxnDBInit, TxnDBCount);
+        m_accountTxPager = std::make_unique <AccountTxPager> (*mTxnDB,
+            m_logs.journal("AccountTxPager"));
+        m_txnDBWriter = std::make_unique <TxnDBWriter> (*mTxnDB,
+            *m_accountTxPager, getConfig ().TXN_DB_BINARY,
+                m_logs.journal("TxnDBWriter"));
         mLedgerDB = std::make_unique <DatabaseCon> ("ledger.db", LedgerDBInit, LedgerDBCount);
+        m_ledgerHashIndex = std::make_unique <LedgerHashIndex> (
+            m_logs.journal("LedgerHashIndex"));
+
+        // The index mirrors the ledger database, so it only lives on disk
+        // when the database does (see DatabaseCon).
+        auto const startUp = getConfig ().START_UP;
+        if (! getConfig ().RUN_STANDALONE ||
+            startUp == Config::LOAD ||
+            startUp == Config::LOAD_FILE ||
+            startUp == Config::REPLAY)
+        {
+            if (m_ledgerHashIndex->open (
+                    getConfig ().DATA_DIR / "ledger_hash.idx"))
+                m_ledgerHashIndex->verify (*mLedgerDB);
+        }
         mWalletDB = std::make_unique <DatabaseCon> ("wallet.db", WalletDBInit, WalletDBCount);
 
         return
@@ -607,6 +666,8 @@ public:
     {
         // VFALCO NOTE: 0 means use heuristics to determine the thread count.
         m_jobQueue->setThreadCount (0, getConfig ().RUN_STANDALONE);
+        m_jobQueue->setSlowJobThreshold (
+            std::chrono::milliseconds (getConfig ().JOB_TRACE));
 
     #if ! BEAST_WIN32
     #ifdef SIGINT
@@ -932,6 +993,7 @@ public:
         mShutdown = true;
 
         mValidations->flush ();
+        m_txnDBWriter->flush ();
         mShutdown = false;
 
         stopped ();
@@ -1059,6 +1121,8 @@ public:
         //
 
         m_fullBelowCache->sweep ();
+        m_signatureCache->sweep ();
+        m_accountTxPager->sweep ();
 
         logTimedCall (m_journal.warning, "TransactionMaster::sweep", __FILE__, __LINE__, std::bind (
             &TransactionMaster::sweep, &m_txMaster));
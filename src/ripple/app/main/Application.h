@@ -35,6 +35,8 @@ namespace NodeStore { class Database; }
 namespace RPC { class Manager; }
 
 // VFALCO TODO Fix forward declares required for header dependency loops
+class AccountTxPager;
+class BalanceRankIndex;
 class CollectorManager;
 class AmendmentTable;
 class IHashRouter;
@@ -50,8 +52,11 @@ class NetworkOPs;
 class OrderBookDB;
 class ProofOfWorkFactory;
 class SerializedLedgerEntry;
+class SignatureCache;
 class TransactionMaster;
 class TxQueue;
+class TxnDBWriter;
+class LedgerHashIndex;
 class LocalCredentials;
 class PathRequests;
 
@@ -96,6 +101,7 @@ public:
     virtual JobQueue&               getJobQueue () = 0;
     virtual RPC::Manager&           getRPCManager () = 0;
     virtual SiteFiles::Manager&     getSiteFiles () = 0;
+    virtual SignatureCache&         getSignatureCache () = 0;
     virtual NodeCache&              getTempNodeCache () = 0;
     virtual TreeNodeCache&          getTreeNodeCache () = 0;
     virtual SLECache&               getSLECache () = 0;
@@ -113,6 +119,7 @@ public:
     virtual LedgerMaster&           getLedgerMaster () = 0;
     virtual NetworkOPs&             getOPs () = 0;
     virtual OrderBookDB&            getOrderBookDB () = 0;
+    virtual BalanceRankIndex&       getBalanceRankIndex () = 0;
     virtual TransactionMaster&      getMasterTransaction () = 0;
     virtual TxQueue&                getTxQueue () = 0;
     virtual LocalCredentials&       getLocalCredentials () = 0;
@@ -121,7 +128,10 @@ public:
 
     virtual DatabaseCon& getRpcDB () = 0;
     virtual DatabaseCon& getTxnDB () = 0;
+    virtual TxnDBWriter& getTxnDBWriter () = 0;
+    virtual AccountTxPager& getAccountTxPager () = 0;
     virtual DatabaseCon& getLedgerDB () = 0;
+    virtual LedgerHashIndex& getLedgerHashIndex () = 0;
 
     virtual std::chrono::milliseconds getIOLatency () = 0;
 
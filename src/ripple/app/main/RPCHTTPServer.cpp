@@ -26,6 +26,7 @@
 #include <ripple/app/main/RPCHTTPServer.h>
 #include <ripple/rpc/RPCHandler.h>
 #include <ripple/rpc/RPCServerHandler.h>
+#include <boost/utility/string_ref.hpp>
 
 namespace ripple {
 
@@ -172,9 +173,13 @@ public:
     // Dispatched on the job queue
     void processSession (Job& job, HTTP::Session& session)
     {
-        auto const s (to_string(session.message().body));
-        session.write (processRequest (to_string(session.message().body),
-            session.remoteAddress().at_port(0)));
+        // Parse straight out of the body's buffer instead of a copy of it
+        auto const body (session.message().body.data());
+
+        processRequest (session, boost::string_ref (
+            boost::asio::buffer_cast <char const*> (body),
+                boost::asio::buffer_size (body)),
+                    session.remoteAddress().at_port(0));
 
         if (session.message().keep_alive())
         {
@@ -194,20 +199,26 @@ public:
     }
 
     // Stolen directly from RPCServerHandler
-    std::string
-    processRequest (std::string const& request,
+    //
+    // The reply is streamed to the session as it is written. The session
+    // holds this job back while too much of it is queued, so a large
+    // result is never buffered whole.
+    //
+    void
+    processRequest (HTTP::Session& session, boost::string_ref request,
         beast::IP::Endpoint const& remoteIPAddress)
     {
         Json::Value jvRequest;
         {
-            Json::Reader reader;
+            Json::InSituReader reader;
 
             if ((request.size () > 1000000) ||
-                ! reader.parse (request, jvRequest) ||
+                ! reader.parse (request.data (),
+                    request.data () + request.size (), jvRequest) ||
                 jvRequest.isNull () ||
                 ! jvRequest.isObject ())
             {
-                return createResponse (400, "Unable to parse request");
+                return session.write (createResponse (400, "Unable to parse request"));
             }
         }
 
@@ -221,7 +232,7 @@ public:
             usage = m_resourceManager.newInboundEndpoint(remoteIPAddress);
 
         if (usage.disconnect ())
-            return createResponse (503, "Server is overloaded");
+            return session.write (createResponse (503, "Server is overloaded"));
 
         // Parse id now so errors from here on will have the id
         //
@@ -232,14 +243,14 @@ public:
         Json::Value const method = jvRequest ["method"];
 
         if (method.isNull ())
-            return createResponse (400, "Null method");
+            return session.write (createResponse (400, "Null method"));
 
         if (! method.isString ())
-            return createResponse (400, "method is not string");
+            return session.write (createResponse (400, "method is not string"));
 
         std::string strMethod = method.asString ();
         if (strMethod.empty())
-            return createResponse (400, "method is empty");
+            return session.write (createResponse (400, "method is empty"));
 
         // Parse params
         Json::Value params = jvRequest ["params"];
@@ -248,7 +259,7 @@ public:
             params = Json::Value (Json::arrayValue);
 
         else if (!params.isArray ())
-            return HTTPReply (400, "params unparseable");
+            return session.write (HTTPReply (400, "params unparseable"));
 
         // VFALCO TODO Shouldn't we handle this earlier?
         //
@@ -257,11 +268,10 @@ public:
             // VFALCO TODO Needs implementing
             // FIXME Needs implementing
             // XXX This needs rate limiting to prevent brute forcing password.
-            return HTTPReply (403, "Forbidden");
+            return session.write (HTTPReply (403, "Forbidden"));
         }
 
 
-        std::string response;
         RPCHandler rpcHandler (m_networkOPs);
         Resource::Charge loadType = Resource::feeReferenceRPC;
 
@@ -273,9 +283,11 @@ public:
 
         usage.charge (loadType);
 
-        response = JSONRPCReply (result, Json::Value (), id);
-
-        return createResponse (200, response);
+        HTTPReply (200, result,
+            [&session] (char const* data, std::size_t bytes)
+            {
+                session.write (data, bytes);
+            });
     }
 
     //
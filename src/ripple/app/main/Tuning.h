@@ -32,6 +32,18 @@ enum
 
     ,fullBelowExpirationSeconds = 600
 
+    ,signatureCacheTargetSize = 65536
+
+    ,signatureCacheExpirationSeconds = 600
+
+    ,accountTxCacheAccounts = 128
+
+    ,accountTxCacheRows = 512
+
+    ,accountTxCacheHotRequests = 3
+
+    ,accountTxCacheExpirationSeconds = 300
+
     ,defaultCacheTargetSize = 0
 
     ,defaultCacheExpirationSeconds = 120
@@ -21,14 +21,71 @@
 */
 //==============================================================================
 
-#include <boost/foreach.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <thread>
 
 namespace ripple {
 
-// VFALCO TODO Inline the function definitions
+/** Routing table sharded by hash with time wheel expiry.
+
+    The table is split into shards, each with its own lock, so relayed
+    transactions, proposals and validations for unrelated hashes do not
+    contend. Lookups of existing entries only take a shared lock and the
+    flags are atomic, so the common "have we seen this" checks run in
+    parallel. Entries are created and expired under the exclusive lock.
+
+    Each shard expires entries with a time wheel holding one slot per second
+    of the hold time. Advancing the wheel to the current second clears the
+    slots that have come around again, so expiry costs the same whatever the
+    size of the table.
+*/
 class HashRouter : public IHashRouter
 {
+public:
+    /** Returns the current time in seconds. */
+    typedef std::function <int ()> clock_type;
+
 private:
+    /** The set of peers an entry was received from.
+
+        Most hashes are heard from a handful of peers, so the short IDs are
+        kept in a sorted vector rather than a node based set.
+    */
+    class PeerSet
+    {
+    public:
+        void insert (PeerShortID peer)
+        {
+            auto const iter (std::lower_bound (
+                mPeers.begin (), mPeers.end (), peer));
+            if (iter == mPeers.end () || *iter != peer)
+                mPeers.insert (iter, peer);
+        }
+
+        bool contains (PeerShortID peer) const
+        {
+            return std::binary_search (mPeers.begin (), mPeers.end (), peer);
+        }
+
+        /** Exchange the contents with a std::set. */
+        void swap (std::set <PeerShortID>& other)
+        {
+            std::set <PeerShortID> mine (mPeers.begin (), mPeers.end ());
+            mPeers.assign (other.begin (), other.end ());
+            other.swap (mine);
+        }
+
+    private:
+        std::vector <PeerShortID> mPeers;
+    };
+
     /** An entry in the routing table.
     */
     class Entry : public CountedObject <Entry>
@@ -41,11 +98,6 @@ private:
         {
         }
 
-        std::set <PeerShortID> const& peekPeers () const
-        {
-            return mPeers;
-        }
-
         void addPeer (PeerShortID peer)
         {
             if (peer != 0)
@@ -54,27 +106,28 @@ private:
 
         bool hasPeer (PeerShortID peer) const
         {
-            return mPeers.count (peer) > 0;
+            return mPeers.contains (peer);
         }
 
         int getFlags (void) const
         {
-            return mFlags;
+            return mFlags.load ();
         }
 
         bool hasFlag (int mask) const
         {
-            return (mFlags & mask) != 0;
+            return (mFlags.load () & mask) != 0;
         }
 
-        void setFlag (int flagsToSet)
+        /** Set flags, returning the flags that were set before. */
+        int setFlag (int flagsToSet)
         {
-            mFlags |= flagsToSet;
+            return mFlags.fetch_or (flagsToSet);
         }
 
         void clearFlag (int flagsToClear)
         {
-            mFlags &= ~flagsToClear;
+            mFlags.fetch_and (~flagsToClear);
         }
 
         void swapSet (std::set <PeerShortID>& other)
@@ -83,14 +136,46 @@ private:
         }
 
     private:
-        int mFlags;
-        std::set <PeerShortID> mPeers;
+        // Atomic so flags can be read and set under the shared lock
+        std::atomic <int> mFlags;
+        PeerSet mPeers;
+    };
+
+    typedef boost::shared_mutex LockType;
+    typedef boost::shared_lock <LockType> ScopedReadLockType;
+    typedef boost::unique_lock <LockType> ScopedWriteLockType;
+
+    /** A portion of the table with its own lock and time wheel. */
+    struct Shard
+    {
+        LockType lock;
+
+        // Stores all suppressed hashes
+        hash_map <uint256, Entry> map;
+
+        // Hashes created in each second, indexed by second modulo the size
+        std::vector <std::vector <uint256>> wheel;
+
+        // The last second the wheel was advanced to
+        int wheelTime;
+    };
+
+    enum
+    {
+        shardCount = 16
     };
 
 public:
-    explicit HashRouter (int holdTime)
-        : mHoldTime (holdTime)
+    HashRouter (int holdTime, clock_type clock)
+        : mHoldTime (std::max (holdTime, 1))
+        , mClock (clock)
     {
+        int const now (mClock ());
+        for (auto& shard : mShards)
+        {
+            shard.wheel.resize (mHoldTime);
+            shard.wheelTime = now;
+        }
     }
 
     bool addSuppression (uint256 const& index);
@@ -103,87 +188,122 @@ public:
 
     bool swapSet (uint256 const& index, std::set<PeerShortID>& peers, int flag);
 
+    /** Returns the number of hashes being tracked. */
+    std::size_t size ();
+
 private:
-    Entry getEntry (uint256 const& );
+    Shard& getShard (uint256 const& index)
+    {
+        // Indexes are hashes, so their leading byte is evenly distributed
+        return mShards [*index.begin () % shardCount];
+    }
+
+    // Returns nullptr if the entry does not exist, shared lock required
+    static Entry* findEntry (Shard& shard, uint256 const& index);
 
-    Entry& findCreateEntry (uint256 const& , bool& created);
+    // Exclusive lock required
+    Entry& findCreateEntry (Shard& shard, uint256 const& index, bool& created);
 
-    typedef RippleMutex LockType;
-    typedef std::lock_guard <LockType> ScopedLockType;
-    LockType mLock;
+    // Exclusive lock required
+    void advanceWheel (Shard& shard, int now);
 
-    // Stores all suppressed hashes and their expiration time
-    hash_map <uint256, Entry> mSuppressionMap;
+    std::array <Shard, shardCount> mShards;
 
-    // Stores all expiration times and the hashes indexed for them
-    std::map< int, std::list<uint256> > mSuppressionTimes;
+    int const mHoldTime;
 
-    int mHoldTime;
+    clock_type mClock;
 };
 
 //------------------------------------------------------------------------------
 
-HashRouter::Entry& HashRouter::findCreateEntry (uint256 const& index, bool& created)
+HashRouter::Entry* HashRouter::findEntry (Shard& shard, uint256 const& index)
 {
-    hash_map<uint256, Entry>::iterator fit = mSuppressionMap.find (index);
+    auto const fit (shard.map.find (index));
 
-    if (fit != mSuppressionMap.end ())
+    if (fit == shard.map.end ())
+        return nullptr;
+
+    return &fit->second;
+}
+
+HashRouter::Entry& HashRouter::findCreateEntry (
+    Shard& shard, uint256 const& index, bool& created)
+{
+    if (Entry* entry = findEntry (shard, index))
     {
         created = false;
-        return fit->second;
+        return *entry;
     }
 
     created = true;
 
-    int now = UptimeTimer::getInstance ().getElapsedSeconds ();
-    int expireTime = now - mHoldTime;
+    int const now (mClock ());
+    advanceWheel (shard, now);
+    shard.wheel [now % mHoldTime].push_back (index);
+
+    return shard.map.emplace (std::piecewise_construct,
+        std::forward_as_tuple (index), std::forward_as_tuple ()).first->second;
+}
+
+void HashRouter::advanceWheel (Shard& shard, int now)
+{
+    if (now <= shard.wheelTime)
+        return;
 
-    // See if any supressions need to be expired
-    std::map< int, std::list<uint256> >::iterator it = mSuppressionTimes.begin ();
+    // Each second we pass reuses the slot holding the hashes created one
+    // hold time earlier, so those have expired. After a full turn every
+    // slot has expired and there is no need to go around again.
+    int const steps (std::min (now - shard.wheelTime, mHoldTime));
 
-    if ((it != mSuppressionTimes.end ()) && (it->first <= expireTime))
+    for (int i = 1; i <= steps; ++i)
     {
-        BOOST_FOREACH (uint256 const& lit, it->second)
-        mSuppressionMap.erase (lit);
-        mSuppressionTimes.erase (it);
+        std::vector <uint256>& slot (
+            shard.wheel [(shard.wheelTime + i) % mHoldTime]);
+
+        for (auto const& index : slot)
+            shard.map.erase (index);
+
+        slot.clear ();
     }
 
-    mSuppressionTimes[now].push_back (index);
-    return mSuppressionMap.emplace (index, Entry ()).first->second;
+    shard.wheelTime = now;
 }
 
 bool HashRouter::addSuppression (uint256 const& index)
 {
-    ScopedLockType sl (mLock);
+    Shard& shard (getShard (index));
 
-    bool created;
-    findCreateEntry (index, created);
-    return created;
-}
+    {
+        ScopedReadLockType sl (shard.lock);
 
-HashRouter::Entry HashRouter::getEntry (uint256 const& index)
-{
-    ScopedLockType sl (mLock);
+        if (findEntry (shard, index))
+            return false;
+    }
+
+    ScopedWriteLockType sl (shard.lock);
 
     bool created;
-    return findCreateEntry (index, created);
+    findCreateEntry (shard, index, created);
+    return created;
 }
 
 bool HashRouter::addSuppressionPeer (uint256 const& index, PeerShortID peer)
 {
-    ScopedLockType sl (mLock);
+    Shard& shard (getShard (index));
+    ScopedWriteLockType sl (shard.lock);
 
     bool created;
-    findCreateEntry (index, created).addPeer (peer);
+    findCreateEntry (shard, index, created).addPeer (peer);
     return created;
 }
 
 bool HashRouter::addSuppressionPeer (uint256 const& index, PeerShortID peer, int& flags)
 {
-    ScopedLockType sl (mLock);
+    Shard& shard (getShard (index));
+    ScopedWriteLockType sl (shard.lock);
 
     bool created;
-    Entry& s = findCreateEntry (index, created);
+    Entry& s = findCreateEntry (shard, index, created);
     s.addPeer (peer);
     flags = s.getFlags ();
     return created;
@@ -191,18 +311,40 @@ bool HashRouter::addSuppressionPeer (uint256 const& index, PeerShortID peer, int
 
 int HashRouter::getFlags (uint256 const& index)
 {
-    ScopedLockType sl (mLock);
+    Shard& shard (getShard (index));
+
+    {
+        ScopedReadLockType sl (shard.lock);
+
+        if (Entry* entry = findEntry (shard, index))
+            return entry->getFlags ();
+    }
+
+    // Asking about a hash starts tracking it
+    ScopedWriteLockType sl (shard.lock);
 
     bool created;
-    return findCreateEntry (index, created).getFlags ();
+    return findCreateEntry (shard, index, created).getFlags ();
 }
 
 bool HashRouter::addSuppressionFlags (uint256 const& index, int flag)
 {
-    ScopedLockType sl (mLock);
+    Shard& shard (getShard (index));
+
+    {
+        ScopedReadLockType sl (shard.lock);
+
+        if (Entry* entry = findEntry (shard, index))
+        {
+            entry->setFlag (flag);
+            return false;
+        }
+    }
+
+    ScopedWriteLockType sl (shard.lock);
 
     bool created;
-    findCreateEntry (index, created).setFlag (flag);
+    findCreateEntry (shard, index, created).setFlag (flag);
     return created;
 }
 
@@ -215,24 +357,29 @@ bool HashRouter::setFlag (uint256 const& index, int flag)
     // return: true = changed, false = unchanged
     assert (flag != 0);
 
-    ScopedLockType sl (mLock);
+    Shard& shard (getShard (index));
 
-    bool created;
-    Entry& s = findCreateEntry (index, created);
+    {
+        ScopedReadLockType sl (shard.lock);
 
-    if ((s.getFlags () & flag) == flag)
-        return false;
+        if (Entry* entry = findEntry (shard, index))
+            return (entry->setFlag (flag) & flag) != flag;
+    }
 
-    s.setFlag (flag);
-    return true;
+    ScopedWriteLockType sl (shard.lock);
+
+    bool created;
+    Entry& s = findCreateEntry (shard, index, created);
+    return (s.setFlag (flag) & flag) != flag;
 }
 
 bool HashRouter::swapSet (uint256 const& index, std::set<PeerShortID>& peers, int flag)
 {
-    ScopedLockType sl (mLock);
+    Shard& shard (getShard (index));
+    ScopedWriteLockType sl (shard.lock);
 
     bool created;
-    Entry& s = findCreateEntry (index, created);
+    Entry& s = findCreateEntry (shard, index, created);
 
     if ((s.getFlags () & flag) == flag)
         return false;
@@ -243,9 +390,235 @@ bool HashRouter::swapSet (uint256 const& index, std::set<PeerShortID>& peers, in
     return true;
 }
 
+std::size_t HashRouter::size ()
+{
+    std::size_t result (0);
+
+    for (auto& shard : mShards)
+    {
+        ScopedReadLockType sl (shard.lock);
+        result += shard.map.size ();
+    }
+
+    return result;
+}
+
 IHashRouter* IHashRouter::New (int holdTime)
 {
-    return new HashRouter (holdTime);
+    return new HashRouter (holdTime, []
+    {
+        return UptimeTimer::getInstance ().getElapsedSeconds ();
+    });
 }
 
+//------------------------------------------------------------------------------
+
+class HashRouter_test : public beast::unit_test::suite
+{
+public:
+    static uint256 makeIndex (std::uint64_t id)
+    {
+        // Spread the id over every byte, the way a real hash would be
+        uint256 index;
+        std::uint64_t x (id);
+        for (auto p = index.begin (); p != index.end (); p += sizeof (x))
+        {
+            x += 0x9e3779b97f4a7c15ULL;
+            std::uint64_t z (x);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z ^= z >> 31;
+            std::memcpy (p, &z, sizeof (z));
+        }
+        return index;
+    }
+
+    void testFlags ()
+    {
+        testcase ("flags");
+
+        HashRouter router (300, [] { return 0; });
+        uint256 const a (makeIndex (1));
+
+        expect (router.addSuppression (a), "first suppression created");
+        expect (! router.addSuppression (a), "second suppression created");
+        expect (router.getFlags (a) == 0, "new entry has flags");
+
+        expect (router.setFlag (a, SF_RELAYED), "flag not changed");
+        expect (! router.setFlag (a, SF_RELAYED), "flag changed twice");
+        expect (router.setFlag (a, SF_RELAYED | SF_SAVED), "flags not changed");
+        expect (router.getFlags (a) == (SF_RELAYED | SF_SAVED), "wrong flags");
+
+        uint256 const b (makeIndex (2));
+        expect (router.addSuppressionFlags (b, SF_BAD), "flags entry not created");
+        int flags (0);
+        expect (! router.addSuppressionPeer (b, 7, flags), "peer entry created");
+        expect (flags == SF_BAD, "wrong flags with peer");
+    }
+
+    void testPeers ()
+    {
+        testcase ("peers");
+
+        HashRouter router (300, [] { return 0; });
+        uint256 const a (makeIndex (1));
+
+        router.addSuppressionPeer (a, 5);
+        router.addSuppressionPeer (a, 3);
+        router.addSuppressionPeer (a, 5);
+        router.addSuppressionPeer (a, 0);
+
+        std::set <PeerShortID> peers;
+        peers.insert (9);
+        expect (router.swapSet (a, peers, SF_RELAYED), "swap refused");
+        expect (peers.size () == 2 && peers.count (3) && peers.count (5),
+            "wrong peers");
+
+        expect (! router.swapSet (a, peers, SF_RELAYED), "swapped twice");
+
+        // Swapping under a new flag hands back the set given by the first
+        expect (router.swapSet (a, peers, SF_SAVED), "swap refused");
+        expect (peers.size () == 1 && peers.count (9), "wrong swapped peers");
+    }
+
+    void testExpiration ()
+    {
+        testcase ("expiration");
+
+        int now (0);
+        HashRouter router (2, [&now] { return now; });
+
+        // Each shard has its own wheel, so keep the hashes in one shard
+        uint256 a (makeIndex (1));
+        uint256 b (makeIndex (2));
+        uint256 c (makeIndex (3));
+        uint256 d (makeIndex (4));
+        *a.begin () = *b.begin () = *c.begin () = *d.begin () = 0;
+
+        router.addSuppression (a);
+        now = 1;
+        router.addSuppression (b);
+        expect (! router.addSuppression (a), "expired early");
+
+        // Creating an entry advances the wheel
+        now = 2;
+        router.addSuppression (c);
+        expect (router.size () == 2, "wrong size after one expiry");
+        expect (! router.addSuppression (b), "expired early");
+        expect (router.addSuppression (a), "not expired");
+
+        // A gap longer than the hold time expires everything
+        now = 10;
+        router.addSuppression (d);
+        expect (router.size () == 1, "wrong size after a long gap");
+    }
+
+    void run ()
+    {
+        testFlags ();
+        testPeers ();
+        testExpiration ();
+    }
+
+private:
+    typedef IHashRouter::PeerShortID PeerShortID;
+};
+
+BEAST_DEFINE_TESTSUITE(HashRouter,ripple_app,ripple);
+
+//------------------------------------------------------------------------------
+
+/** Measures HashRouter throughput under simulated overlay traffic.
+
+    Messages arrive at 50,000 per second from 100 peers, each hash being
+    heard from several peers. Simulated time advances with the number of
+    messages processed, so entries expire through the time wheel as they
+    would on a busy server. The time taken is compared with the simulated
+    time to show how much headroom the router has.
+*/
+class HashRouter_timing_test : public beast::unit_test::suite
+{
+public:
+    typedef IHashRouter::PeerShortID PeerShortID;
+
+    static int const messagesPerSecond = 50000;
+    static int const peerCount = 100;
+    static int const peersPerHash = 8;
+    static int const holdSeconds = 30;
+    static int const simulatedSeconds = 120;
+
+    static std::uint64_t const messageCount =
+        std::uint64_t (messagesPerSecond) * simulatedSeconds;
+
+    static void worker (HashRouter& router, std::atomic <std::uint64_t>& next)
+    {
+        for (;;)
+        {
+            std::uint64_t const n (next++);
+            if (n >= messageCount)
+                break;
+
+            uint256 const index (
+                HashRouter_test::makeIndex (n / peersPerHash));
+            PeerShortID const peer ((n % peerCount) + 1);
+
+            int flags;
+            if (router.addSuppressionPeer (index, peer, flags))
+                router.setFlag (index, SF_SIGGOOD);
+            else if (flags & SF_BAD)
+                continue;
+
+            // The last peer to relay the hash triggers our own relay
+            if ((n % peersPerHash) == (peersPerHash - 1) &&
+                (router.getFlags (index) & SF_SIGGOOD))
+            {
+                std::set <PeerShortID> peers;
+                router.swapSet (index, peers, SF_RELAYED);
+            }
+        }
+    }
+
+    double time (HashRouter& router, std::atomic <std::uint64_t>& next,
+        int threads)
+    {
+        auto const start = std::chrono::steady_clock::now ();
+        std::vector <std::thread> workers;
+        for (int i = 0; i < threads; ++i)
+            workers.emplace_back (&worker, std::ref (router), std::ref (next));
+        for (auto& t : workers)
+            t.join ();
+        auto const elapsed = std::chrono::steady_clock::now () - start;
+
+        return std::chrono::duration_cast <std::chrono::duration <double>> (
+            elapsed).count ();
+    }
+
+    void run ()
+    {
+        for (int threads : { 1, 2, 4, 8 })
+        {
+            std::stringstream ss;
+            ss << threads << " threads";
+            testcase (ss.str ());
+
+            std::atomic <std::uint64_t> next (0);
+            HashRouter router (holdSeconds, [&next]
+            {
+                return static_cast <int> (next.load () / messagesPerSecond);
+            });
+
+            double const t = time (router, next, threads);
+            std::uint64_t const count (messageCount);
+
+            log << count << " messages in " << t << "s, " <<
+                (count / t) << " per second (" <<
+                (simulatedSeconds / t) << "x real time), " <<
+                router.size () << " hashes tracked";
+            pass ();
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(HashRouter_timing,ripple_app,ripple);
+
 } // ripple
@@ -32,6 +32,7 @@
 #include <beast/module/core/system/SystemStats.h>
 #include <beast/cxx14/memory.h> // <memory>
 #include <boost/foreach.hpp>
+#include <chrono>
 #include <tuple>
 
 namespace ripple {
@@ -55,6 +56,7 @@ public:
     NetworkOPsImp (
             clock_type& clock, bool standalone, std::size_t network_quorum,
             JobQueue& job_queue, LedgerMaster& ledgerMaster, Stoppable& parent,
+            beast::insight::Collector::ptr const& collector,
             beast::Journal journal)
         : NetworkOPs (parent)
         , m_clock (clock)
@@ -83,6 +85,7 @@ public:
         , m_job_queue (job_queue)
         , m_standalone (standalone)
         , m_network_quorum (network_quorum)
+        , m_publishStats (collector)
     {
 		m_dividendVote = make_DividendVote(0, SYSTEM_CURRENCY_START, SYSTEM_CURRENCY_START, deprecatedLogs().journal("DividendVote"));
     }
@@ -468,6 +471,7 @@ public:
 
     InfoSub::pointer findRpcSub (std::string const& strUrl);
     InfoSub::pointer addRpcSub (std::string const& strUrl, InfoSub::ref);
+    Json::Value getRpcSubJson ();
 
     //--------------------------------------------------------------------------
     //
@@ -495,6 +499,12 @@ private:
         Ledger::ref lpCurrent);
     bool haveConsensusObject ();
 
+    // Parse the marker, fetch a page and set the marker of the next page
+    bool getTxsAccountPage (
+        RippleAddress const& account, std::int32_t minLedger,
+        std::int32_t maxLedger, bool forward, Json::Value& token,
+        std::uint32_t limit, AccountTxPager::Rows& rows);
+
     Json::Value pubBootstrapAccountInfo (
         Ledger::ref lpAccepted, RippleAddress const& naAccountID);
 
@@ -579,6 +589,32 @@ private:
 
     // The number of nodes that we need to consider ourselves connected
     std::size_t const m_network_quorum;
+
+    // Time taken to hand one event to every subscriber of a stream
+    struct PublishStats
+    {
+        explicit PublishStats (beast::insight::Collector::ptr const& collector)
+            : ledger (collector->make_event ("publish_ledger"))
+            , server (collector->make_event ("publish_server"))
+            , transactions (collector->make_event ("publish_transactions"))
+            , proposed (collector->make_event ("publish_proposed"))
+            , accounts (collector->make_event ("publish_accounts"))
+        {
+        }
+
+        beast::insight::Event ledger;
+        beast::insight::Event server;
+        beast::insight::Event transactions;
+        beast::insight::Event proposed;
+        beast::insight::Event accounts;
+    };
+
+    PublishStats m_publishStats;
+
+    // Sends to every live subscriber in the map and drops the dead ones.
+    // Must be called with mLock held.
+    static void publish (SubMapType& subscribers,
+        InfoSub::Payload::pointer const& payload);
 };
 
 //------------------------------------------------------------------------------
@@ -857,7 +893,8 @@ void NetworkOPsImp::submitTransaction (
     {
         try
         {
-            if (!passesLocalChecks (*trans) || !trans->checkSign ())
+            if (!passesLocalChecks (*trans) ||
+                !getApp().getSignatureCache ().checkSign (*trans))
             {
                 m_journal.warning << "Submitted transaction has bad signature";
                 getApp().getHashRouter ().setFlag (suppress, SF_BAD);
@@ -1820,26 +1857,35 @@ void NetworkOPsImp::pubServer ()
         jvObj [jss::load_factor]   =
                 (mLastLoadFactor = getApp().getFeeTrack ().getLoadFactor ());
 
-        Json::FastWriter w;
-        std::string sObj = w.write (jvObj);
+        auto const start = std::chrono::steady_clock::now ();
 
+        // VFALCO TODO research the possibility of using thread queues and
+        //             linearizing the deletion of subscribers with the
+        //             sending of JSON data.
+        publish (mSubServer, InfoSub::Payload::make (jvObj));
 
-        for (auto i = mSubServer.begin (); i != mSubServer.end (); )
-        {
-            InfoSub::pointer p = i->second.lock ();
+        m_publishStats.server.notify (
+            std::chrono::steady_clock::now () - start);
+    }
+}
 
-            // VFALCO TODO research the possibility of using thread queues and
-            //             linearizing the deletion of subscribers with the
-            //             sending of JSON data.
-            if (p)
-            {
-                p->send (jvObj, sObj, true);
-                ++i;
-            }
-            else
-            {
-                i = mSubServer.erase (i);
-            }
+void NetworkOPsImp::publish (SubMapType& subscribers,
+    InfoSub::Payload::pointer const& payload)
+{
+    auto it = subscribers.begin ();
+
+    while (it != subscribers.end ())
+    {
+        InfoSub::pointer p = it->second.lock ();
+
+        if (p)
+        {
+            p->send (payload, true);
+            ++it;
+        }
+        else
+        {
+            it = subscribers.erase (it);
         }
     }
 }
@@ -1928,9 +1974,9 @@ NetworkOPsImp::transactionsSQL (
         sql =
             boost::str (boost::format (
                 "SELECT %s FROM AccountTransactions "
-                "WHERE Account = '%s' %s %s LIMIT %u, %u;")
+                "WHERE Account = %s %s %s LIMIT %u, %u;")
             % selection
-            % account.humanAccountID ()
+            % txnDBKey (account.getAccountID ())
             % maxClause
             % minClause
             % beast::lexicalCastThrow <std::string> (offset)
@@ -1942,12 +1988,12 @@ NetworkOPsImp::transactionsSQL (
                 "SELECT %s FROM "
                 "AccountTransactions INNER JOIN Transactions "
                 "ON Transactions.TransID = AccountTransactions.TransID "
-                "WHERE Account = '%s' %s %s "
+                "WHERE Account = %s %s %s "
                 "ORDER BY AccountTransactions.LedgerSeq %s, "
                 "AccountTransactions.TxnSeq %s, AccountTransactions.TransID %s "
                 "LIMIT %u, %u;")
                     % selection
-                    % account.humanAccountID ()
+                    % txnDBKey (account.getAccountID ())
                     % maxClause
                     % minClause
                     % (descending ? "DESC" : "ASC")
@@ -2074,113 +2120,39 @@ NetworkOPsImp::AccountTxs NetworkOPsImp::getTxsAccount (
     AccountTxs ret;
 
     std::uint32_t NONBINARY_PAGE_LENGTH = 200;
-    std::uint32_t EXTRA_LENGTH = 100;
 
-    bool foundResume = token.isNull() || !token.isObject();
-
-    std::uint32_t numberOfResults, queryLimit;
+    std::uint32_t numberOfResults;
     if (limit <= 0)
         numberOfResults = NONBINARY_PAGE_LENGTH;
     else if (!bAdmin && (limit > NONBINARY_PAGE_LENGTH))
         numberOfResults = NONBINARY_PAGE_LENGTH;
     else
         numberOfResults = limit;
-    queryLimit = numberOfResults + 1 + (foundResume ? 0 : EXTRA_LENGTH);
 
-    std::uint32_t findLedger = 0, findSeq = 0;
-    if (!foundResume)
-    {
-        try
-        {
-            if (!token.isMember(jss::ledger) || !token.isMember(jss::seq))
-                return ret;
-            findLedger = token[jss::ledger].asInt();
-            findSeq = token[jss::seq].asInt();
-        }
-        catch (...)
-        {
-            return ret;
-        }
-    }
+    AccountTxPager::Rows rows;
 
-    // ST NOTE We're using the token reference both for passing inputs and
-    //         outputs, so we need to clear it in between.
-    token = Json::nullValue;
+    if (!getTxsAccountPage (account, minLedger, maxLedger, forward, token,
+            numberOfResults, rows))
+        return ret;
 
-    std::string sql = boost::str (boost::format
-        ("SELECT AccountTransactions.LedgerSeq,AccountTransactions.TxnSeq,"
-         "Status,RawTxn,TxnMeta "
-         "FROM AccountTransactions INNER JOIN Transactions "
-         "ON Transactions.TransID = AccountTransactions.TransID "
-         "WHERE AccountTransactions.Account = '%s' "
-         "AND AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u' "
-         "ORDER BY AccountTransactions.LedgerSeq %s, "
-         "AccountTransactions.TxnSeq %s, AccountTransactions.TransID %s "
-         "LIMIT %u;")
-             % account.humanAccountID()
-             % ((forward && (findLedger != 0)) ? findLedger : minLedger)
-             % ((!forward && (findLedger != 0)) ? findLedger: maxLedger)
-             % (forward ? "ASC" : "DESC")
-             % (forward ? "ASC" : "DESC")
-             % (forward ? "ASC" : "DESC")
-             % queryLimit);
+    for (auto const& row : rows)
     {
-        auto db = getApp().getTxnDB ().getDB ();
-        auto sl (getApp().getTxnDB ().lock ());
+        auto txn = Transaction::transactionFromSQL (row->rawTxn, row->status,
+            row->key.ledgerSeq, Validate::NO);
 
-        SQL_FOREACH (db, sql)
+        if (row->rawMeta.empty ())
         {
-            if (!foundResume)
-            {
-                foundResume = (findLedger == db->getInt("LedgerSeq") &&
-                               findSeq == db->getInt("TxnSeq"));
-            }
-            else if (numberOfResults == 0)
-            {
-                token = Json::objectValue;
-                token[jss::ledger] = db->getInt("LedgerSeq");
-                token[jss::seq] = db->getInt("TxnSeq");
-                break;
-            }
-
-            if (foundResume)
-            {
-                auto txn = Transaction::transactionFromSQL (db, Validate::NO);
-
-                Serializer rawMeta;
-                int metaSize = 2048;
-                rawMeta.resize (metaSize);
-                metaSize = db->getBinary (
-                    "TxnMeta", &*rawMeta.begin (), rawMeta.getLength ());
-
-                if (metaSize > rawMeta.getLength ())
-                {
-                    rawMeta.resize (metaSize);
-                    db->getBinary (
-                        "TxnMeta", &*rawMeta.begin (), rawMeta.getLength ());
-                }
-                else
-                    rawMeta.resize (metaSize);
-
-                if (rawMeta.getLength() == 0)
-                {
-                    // Work around a bug that could leave the metadata missing
-                    auto seq = static_cast<std::uint32_t>(
-                        db->getBigInt("LedgerSeq"));
-                    m_journal.warning << "Recovering ledger " << seq
-                                      << ", txn " << txn->getID();
-                    Ledger::pointer ledger = getLedgerBySeq(seq);
-                    if (ledger)
-                        ledger->pendSaveValidated(false, false);
-                }
-
-                --numberOfResults;
-
-                ret.emplace_back (std::move (txn),
-                    std::make_shared<TransactionMetaSet> (
-                        txn->getID (), txn->getLedger (), rawMeta.getData ()));
-            }
+            // Work around a bug that could leave the metadata missing
+            auto seq = row->key.ledgerSeq;
+            m_journal.warning << "Recovering ledger " << seq
+                              << ", txn " << txn->getID();
+            Ledger::pointer ledger = getLedgerBySeq(seq);
+            if (ledger)
+                ledger->pendSaveValidated(false, false);
         }
+
+        ret.emplace_back (txn, std::make_shared<TransactionMetaSet> (
+            txn->getID (), txn->getLedger (), row->rawMeta));
     }
 
     return ret;
@@ -2194,114 +2166,70 @@ NetworkOPsImp::MetaTxsList NetworkOPsImp::getTxsAccountB (
     MetaTxsList ret;
 
     std::uint32_t BINARY_PAGE_LENGTH = 500;
-    std::uint32_t EXTRA_LENGTH = 100;
-
-    bool foundResume = token.isNull() || !token.isObject();
 
-    std::uint32_t numberOfResults, queryLimit;
+    std::uint32_t numberOfResults;
     if (limit <= 0)
         numberOfResults = BINARY_PAGE_LENGTH;
     else if (!bAdmin && (limit > BINARY_PAGE_LENGTH))
         numberOfResults = BINARY_PAGE_LENGTH;
     else
         numberOfResults = limit;
-    queryLimit = numberOfResults + 1 + (foundResume ? 0 : EXTRA_LENGTH);
 
-    std::uint32_t findLedger = 0, findSeq = 0;
+    AccountTxPager::Rows rows;
+
+    if (!getTxsAccountPage (account, minLedger, maxLedger, forward, token,
+            numberOfResults, rows))
+        return ret;
+
+    for (auto const& row : rows)
+    {
+        ret.emplace_back (strHex (row->rawTxn), strHex (row->rawMeta),
+                          row->key.ledgerSeq);
+    }
+
+    return ret;
+}
+
+bool NetworkOPsImp::getTxsAccountPage (
+    RippleAddress const& account, std::int32_t minLedger,
+    std::int32_t maxLedger, bool forward, Json::Value& token,
+    std::uint32_t limit, AccountTxPager::Rows& rows)
+{
+    bool foundResume = token.isNull() || !token.isObject();
+
+    AccountTxPager::Key marker;
     if (!foundResume)
     {
         try
         {
             if (!token.isMember(jss::ledger) || !token.isMember(jss::seq))
-                return ret;
-            findLedger = token[jss::ledger].asInt();
-            findSeq = token[jss::seq].asInt();
+                return false;
+            marker.ledgerSeq = token[jss::ledger].asUInt();
+            marker.txnSeq = token[jss::seq].asUInt();
         }
         catch (...)
         {
-            return ret;
+            return false;
         }
     }
 
+    // ST NOTE We're using the token reference both for passing inputs and
+    //         outputs, so we need to clear it in between.
     token = Json::nullValue;
 
-    std::string sql = boost::str (boost::format
-        ("SELECT AccountTransactions.LedgerSeq,AccountTransactions.TxnSeq,"
-         "Status,RawTxn,TxnMeta "
-         "FROM AccountTransactions INNER JOIN Transactions "
-         "ON Transactions.TransID = AccountTransactions.TransID "
-         "WHERE AccountTransactions.Account = '%s' "
-         "AND AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u' "
-         "ORDER BY AccountTransactions.LedgerSeq %s, "
-         "AccountTransactions.TxnSeq %s, AccountTransactions.TransID %s "
-         "LIMIT %u;")
-             % account.humanAccountID()
-             % ((forward && (findLedger != 0)) ? findLedger : minLedger)
-             % ((!forward && (findLedger != 0)) ? findLedger: maxLedger)
-             % (forward ? "ASC" : "DESC")
-             % (forward ? "ASC" : "DESC")
-             % (forward ? "ASC" : "DESC")
-             % queryLimit);
-    {
-        auto db = getApp().getTxnDB ().getDB ();
-        auto sl (getApp().getTxnDB ().lock ());
-
-        SQL_FOREACH (db, sql)
-        {
-            if (!foundResume)
-            {
-                if (findLedger == db->getInt("LedgerSeq") &&
-                    findSeq == db->getInt("TxnSeq"))
-                {
-                    foundResume = true;
-                }
-            }
-            else if (numberOfResults == 0)
-            {
-                token = Json::objectValue;
-                token[jss::ledger] = db->getInt("LedgerSeq");
-                token[jss::seq] = db->getInt("TxnSeq");
-                break;
-            }
-
-            if (foundResume)
-            {
-                int txnSize = 2048;
-                Blob rawTxn (txnSize);
-                txnSize = db->getBinary ("RawTxn", &rawTxn[0], rawTxn.size ());
-
-                if (txnSize > rawTxn.size ())
-                {
-                    rawTxn.resize (txnSize);
-                    db->getBinary ("RawTxn", &*rawTxn.begin (), rawTxn.size ());
-                }
-                else
-                    rawTxn.resize (txnSize);
+    AccountTxPager::Key next;
+    bool const more = getApp().getAccountTxPager ().getPage (
+        account.getAccountID (), minLedger, maxLedger, forward,
+        foundResume ? nullptr : &marker, limit, rows, next);
 
-                int metaSize = 2048;
-                Blob rawMeta (metaSize);
-                metaSize = db->getBinary (
-                    "TxnMeta", &rawMeta[0], rawMeta.size ());
-
-                if (metaSize > rawMeta.size ())
-                {
-                    rawMeta.resize (metaSize);
-                    db->getBinary (
-                        "TxnMeta", &*rawMeta.begin (), rawMeta.size ());
-                }
-                else
-                {
-                    rawMeta.resize (metaSize);
-                }
-
-                ret.emplace_back (strHex (rawTxn), strHex (rawMeta),
-                                  db->getInt ("LedgerSeq"));
-                --numberOfResults;
-            }
-        }
+    if (more)
+    {
+        token = Json::objectValue;
+        token[jss::ledger] = next.ledgerSeq;
+        token[jss::seq] = next.txnSeq;
     }
 
-    return ret;
+    return true;
 }
 
 
@@ -2319,8 +2247,20 @@ NetworkOPsImp::getLedgerAffectedAccounts (std::uint32_t ledgerSeq)
         auto sl (getApp().getTxnDB ().lock ());
         SQL_FOREACH (db, sql)
         {
-            if (acct.setAccountID (db->getStrBinary ("Account")))
+            if (getConfig ().TXN_DB_BINARY)
+            {
+                Blob const raw (db->getBinary ("Account"));
+
+                if (raw.size () == Account::bytes)
+                {
+                    acct.setAccountID (Account::fromVoid (raw.data ()));
+                    accounts.push_back (acct);
+                }
+            }
+            else if (acct.setAccountID (db->getStrBinary ("Account")))
+            {
                 accounts.push_back (acct);
+            }
         }
     }
     return accounts;
@@ -2563,20 +2503,14 @@ void NetworkOPsImp::pubProposedTransaction (
     {
         ScopedLockType sl (mLock);
 
-        auto it = mSubRTTransactions.begin ();
-        while (it != mSubRTTransactions.end ())
+        if (!mSubRTTransactions.empty ())
         {
-            InfoSub::pointer p = it->second.lock ();
+            auto const start = std::chrono::steady_clock::now ();
 
-            if (p)
-            {
-                p->send (jvObj, true);
-                ++it;
-            }
-            else
-            {
-                it = mSubRTTransactions.erase (it);
-            }
+            publish (mSubRTTransactions, InfoSub::Payload::make (jvObj));
+
+            m_publishStats.proposed.notify (
+                std::chrono::steady_clock::now () - start);
         }
     }
     AcceptedLedgerTx alt (lpCurrent, stTxn, terResult);
@@ -2619,18 +2553,12 @@ void NetworkOPsImp::pubLedger (Ledger::ref accepted)
                         = getApp().getLedgerMaster ().getCompleteLedgers ();
             }
 
-            auto it = mSubLedger.begin ();
-            while (it != mSubLedger.end ())
-            {
-                InfoSub::pointer p = it->second.lock ();
-                if (p)
-                {
-                    p->send (jvObj, true);
-                    ++it;
-                }
-                else
-                    it = mSubLedger.erase (it);
-            }
+            auto const start = std::chrono::steady_clock::now ();
+
+            publish (mSubLedger, InfoSub::Payload::make (jvObj));
+
+            m_publishStats.ledger.notify (
+                std::chrono::steady_clock::now () - start);
         }
     }
 
@@ -2640,6 +2568,9 @@ void NetworkOPsImp::pubLedger (Ledger::ref accepted)
         m_journal.trace << "pubAccepted: " << vt.second->getJson ();
         pubValidatedTransaction (lpAccepted, *vt.second);
     }
+
+    getApp().getBalanceRankIndex ().update (alpAccepted);
+    getApp().getOrderBookDB ().update (alpAccepted);
 }
 
 void NetworkOPsImp::reportFeeChange ()
@@ -2714,39 +2645,19 @@ void NetworkOPsImp::pubValidatedTransaction (
         *alTx.getTxn (), alTx.getResult (), true, alAccepted);
     jvObj[jss::meta] = alTx.getMeta ()->getJson (0);
 
-    Json::FastWriter w;
-    std::string sObj = w.write (jvObj);
-
     {
         ScopedLockType sl (mLock);
 
-        auto it = mSubTransactions.begin ();
-        while (it != mSubTransactions.end ())
+        if (!mSubTransactions.empty () || !mSubRTTransactions.empty ())
         {
-            InfoSub::pointer p = it->second.lock ();
-
-            if (p)
-            {
-                p->send (jvObj, sObj, true);
-                ++it;
-            }
-            else
-                it = mSubTransactions.erase (it);
-        }
+            auto const start = std::chrono::steady_clock::now ();
 
-        it = mSubRTTransactions.begin ();
-
-        while (it != mSubRTTransactions.end ())
-        {
-            InfoSub::pointer p = it->second.lock ();
+            auto const payload = InfoSub::Payload::make (jvObj);
+            publish (mSubTransactions, payload);
+            publish (mSubRTTransactions, payload);
 
-            if (p)
-            {
-                p->send (jvObj, sObj, true);
-                ++it;
-            }
-            else
-                it = mSubRTTransactions.erase (it);
+            m_publishStats.transactions.notify (
+                std::chrono::steady_clock::now () - start);
         }
     }
     getApp().getOrderBookDB ().processTxn (alAccepted, alTx, jvObj);
@@ -2827,13 +2738,17 @@ void NetworkOPsImp::pubAccountTransaction (
         if (alTx.isApplied ())
             jvObj[jss::meta] = alTx.getMeta ()->getJson (0);
 
-        Json::FastWriter w;
-        std::string sObj = w.write (jvObj);
+        auto const start = std::chrono::steady_clock::now ();
+
+        auto const payload = InfoSub::Payload::make (jvObj);
 
         BOOST_FOREACH (InfoSub::ref isrListener, notify)
         {
-            isrListener->send (jvObj, sObj, true);
+            isrListener->send (payload, true);
         }
+
+        m_publishStats.accounts.notify (
+            std::chrono::steady_clock::now () - start);
     }
 }
 
@@ -3088,6 +3003,30 @@ InfoSub::pointer NetworkOPsImp::addRpcSub (
     return rspEntry;
 }
 
+Json::Value NetworkOPsImp::getRpcSubJson ()
+{
+    std::vector <InfoSub::pointer> subs;
+
+    {
+        ScopedLockType sl (mLock);
+
+        subs.reserve (mRpcSubMap.size ());
+
+        for (auto const& it : mRpcSubMap)
+            subs.push_back (it.second);
+    }
+
+    Json::Value ret (Json::arrayValue);
+
+    for (auto const& sub : subs)
+    {
+        if (auto rpcSub = std::dynamic_pointer_cast <RPCSub> (sub))
+            ret.append (rpcSub->getJson ());
+    }
+
+    return ret;
+}
+
 #ifndef USE_NEW_BOOK_PAGE
 
 // NIKB FIXME this should be looked at. There's no reason why this shouldn't
@@ -3681,10 +3620,11 @@ NetworkOPs::~NetworkOPs ()
 std::unique_ptr<NetworkOPs>
 make_NetworkOPs (NetworkOPs::clock_type& clock, bool standalone,
     std::size_t network_quorum, JobQueue& job_queue, LedgerMaster& ledgerMaster,
-    beast::Stoppable& parent, beast::Journal journal)
+    beast::Stoppable& parent, beast::insight::Collector::ptr const& collector,
+    beast::Journal journal)
 {
     return std::make_unique<NetworkOPsImp> (clock, standalone, network_quorum,
-        job_queue, ledgerMaster, parent, journal);
+        job_queue, ledgerMaster, parent, collector, journal);
 }
 
 } // ripple
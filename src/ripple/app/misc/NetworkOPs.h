@@ -266,6 +266,9 @@ public:
     virtual Json::Value getServerInfo (bool human, bool admin) = 0;
     virtual void clearLedgerFetch () = 0;
     virtual Json::Value getLedgerFetchInfo () = 0;
+
+    /** Returns the delivery state of each subscriber added with a url. */
+    virtual Json::Value getRpcSubJson () = 0;
     virtual std::uint32_t acceptLedger () = 0;
 
     typedef hash_map <NodeID, std::list<LedgerProposal::pointer>> Proposals;
@@ -332,7 +335,8 @@ public:
 std::unique_ptr<NetworkOPs>
 make_NetworkOPs (NetworkOPs::clock_type& clock, bool standalone,
     std::size_t network_quorum, JobQueue& job_queue, LedgerMaster& ledgerMaster,
-    beast::Stoppable& parent, beast::Journal journal);
+    beast::Stoppable& parent, beast::insight::Collector::ptr const& collector,
+    beast::Journal journal);
 
 } // ripple
 
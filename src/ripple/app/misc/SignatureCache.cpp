@@ -0,0 +1,217 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/core/WorkerPool.h>
+#include <beast/chrono/manual_clock.h>
+#include <beast/unit_test/suite.h>
+
+namespace ripple {
+
+SignatureCache::SignatureCache (clock_type& clock,
+    beast::insight::Collector::ptr const& collector,
+        std::size_t targetSize, int expirationSeconds)
+    : m_cache ("signature_cache", clock, collector,
+        targetSize, expirationSeconds)
+    , m_verified (collector->make_meter ("signatures", "verified"))
+    , m_cached (collector->make_meter ("signatures", "cached"))
+{
+}
+
+uint256 SignatureCache::makeKey (RippleAddress const& publicKey,
+    uint256 const& signingHash, Blob const& signature, ECDSA fullyCanonical)
+{
+    Serializer s (256);
+    s.add256 (signingHash);
+    s.addVL (publicKey.getAccountPublic ());
+    s.addVL (signature);
+    s.add8 ((fullyCanonical == ECDSA::strict) ? 1 : 0);
+    return s.getSHA512Half ();
+}
+
+bool SignatureCache::verify (RippleAddress const& publicKey,
+    uint256 const& signingHash, Blob const& signature, ECDSA fullyCanonical)
+{
+    uint256 const key (makeKey (
+        publicKey, signingHash, signature, fullyCanonical));
+
+    if (m_cache.touch_if_exists (key))
+    {
+        ++m_cached;
+        return true;
+    }
+
+    ++m_verified;
+
+    if (! publicKey.accountPublicVerify (
+            signingHash, signature, fullyCanonical))
+        return false;
+
+    // Only good signatures are remembered, so a bad one costs the sender
+    // a full check every time.
+    m_cache.insert (key);
+    return true;
+}
+
+bool SignatureCache::checkSign (SerializedTransaction const& txn,
+    RippleAddress const& publicKey)
+{
+    try
+    {
+        ECDSA const fullyCanonical = (txn.getFlags () & tfFullyCanonicalSig)
+            ? ECDSA::strict : ECDSA::not_strict;
+        return verify (publicKey, txn.getSigningHash (),
+            txn.getFieldVL (sfTxnSignature), fullyCanonical);
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+bool SignatureCache::checkSign (SerializedTransaction const& txn)
+{
+    if (txn.isKnownGood ())
+        return true;
+
+    if (txn.isKnownBad ())
+        return false;
+
+    try
+    {
+        RippleAddress publicKey;
+        publicKey.setAccountPublic (txn.getFieldVL (sfSigningPubKey));
+
+        if (checkSign (txn, publicKey))
+        {
+            txn.setGood ();
+            return true;
+        }
+    }
+    catch (...)
+    {
+    }
+
+    txn.setBad ();
+    return false;
+}
+
+void SignatureCache::checkBatch (
+    std::vector <SerializedTransaction::pointer> const& txns)
+{
+    // Below this size handing out the work costs more than it saves
+    std::size_t const minParallel = 16;
+
+    if (txns.size () < minParallel)
+    {
+        for (auto const& txn : txns)
+            checkSign (*txn);
+        return;
+    }
+
+    // Each index is a separate transaction, so the calls are independent
+    WorkerPool::forEach (txns.size (),
+        [&txns, this] (std::size_t i)
+        {
+            checkSign (*txns[i]);
+        });
+}
+
+//------------------------------------------------------------------------------
+
+class SignatureCache_test : public beast::unit_test::suite
+{
+public:
+    SerializedTransaction::pointer makeTransaction (
+        RippleAddress const& publicKey, RippleAddress const& privateKey,
+            std::uint32_t sequence)
+    {
+        auto txn = std::make_shared <SerializedTransaction> (ttACCOUNT_SET);
+        txn->setFieldAccount (sfAccount, publicKey.getAccountID ());
+        txn->setFieldU32 (sfSequence, sequence);
+        txn->setFieldAmount (sfFee, STAmount (10));
+        txn->setSigningPubKey (publicKey);
+        txn->sign (privateKey);
+        return txn;
+    }
+
+    void run ()
+    {
+        beast::manual_clock <std::chrono::seconds> clock;
+        SignatureCache cache (clock,
+            beast::insight::NullCollector::New (), 0, 120);
+
+        RippleAddress seed;
+        seed.setSeedRandom ();
+        RippleAddress generator = RippleAddress::createGeneratorPublic (seed);
+        RippleAddress publicKey = RippleAddress::createAccountPublic (
+            generator, 1);
+        RippleAddress privateKey = RippleAddress::createAccountPrivate (
+            generator, seed, 1);
+
+        auto txn = makeTransaction (publicKey, privateKey, 1);
+        Blob signature = txn->getFieldVL (sfTxnSignature);
+
+        testcase ("verify");
+        expect (cache.verify (publicKey, txn->getSigningHash (),
+            signature, ECDSA::not_strict), "Signature should verify");
+        expect (cache.size () == 1, "Good signature should be cached");
+        expect (cache.verify (publicKey, txn->getSigningHash (),
+            signature, ECDSA::not_strict), "Cached signature should verify");
+        expect (cache.size () == 1, "Cached signature added twice");
+
+        Blob tampered (signature);
+        tampered.back () ^= 0x01;
+        expect (! cache.verify (publicKey, txn->getSigningHash (),
+            tampered, ECDSA::not_strict), "Tampered signature verified");
+        expect (cache.size () == 1, "Bad signature should not be cached");
+
+        txn->setFieldU32 (sfSequence, 2);
+        expect (! cache.verify (publicKey, txn->getSigningHash (),
+            signature, ECDSA::not_strict), "Signature moved to new data");
+
+        expect (cache.checkSign (*txn) == false, "Changed transaction passed");
+        expect (txn->isKnownBad (), "Bad result should be recorded");
+
+        testcase ("batch");
+        std::vector <SerializedTransaction::pointer> txns;
+        for (std::uint32_t i = 0; i < 40; ++i)
+        {
+            txns.push_back (makeTransaction (publicKey, privateKey, i + 1));
+            if (i % 10 == 0)
+                txns.back ()->setFieldU32 (sfSequence, 1000 + i);
+        }
+        cache.checkBatch (txns);
+        for (std::size_t i = 0; i < txns.size (); ++i)
+        {
+            bool const good = (i % 10 != 0);
+            expect (txns[i]->isKnownGood () == good,
+                "Batch result for good transaction");
+            expect (txns[i]->isKnownBad () == ! good,
+                "Batch result for bad transaction");
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SignatureCache,ripple_app,ripple);
+
+} // ripple
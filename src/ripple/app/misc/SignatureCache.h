@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_SIGNATURECACHE_H_INCLUDED
+#define RIPPLE_SIGNATURECACHE_H_INCLUDED
+
+#include <ripple/app/misc/SerializedTransaction.h>
+#include <ripple/common/KeyCache.h>
+#include <beast/Insight.h>
+
+namespace ripple {
+
+/** Remembers which transaction signatures verified.
+
+    A transaction's signature is checked when it arrives from a client or
+    a peer, and again whenever it is applied to a ledger, which can happen
+    several times while building and replaying ledgers. The hash router
+    only remembers good signatures for a short time. This cache remembers
+    them for longer.
+
+    The key covers the signing hash, the public key, the signature and
+    the strictness of the check. A cached result therefore only applies to
+    the same signature by the same key over the same data.
+*/
+class SignatureCache
+{
+public:
+    typedef KeyCache <uint256> cache_type;
+    typedef cache_type::clock_type clock_type;
+
+    SignatureCache (clock_type& clock,
+        beast::insight::Collector::ptr const& collector,
+        std::size_t targetSize, int expirationSeconds);
+
+    /** Verify a signature unless the same one verified before. */
+    bool verify (RippleAddress const& publicKey, uint256 const& signingHash,
+        Blob const& signature, ECDSA fullyCanonical);
+
+    /** Check a transaction's signature against the given public key. */
+    bool checkSign (SerializedTransaction const& txn,
+        RippleAddress const& publicKey);
+
+    /** Check a transaction's signature against its signing public key.
+
+        Like SerializedTransaction::checkSign (), the result is recorded in
+        the transaction and reused on later calls.
+    */
+    bool checkSign (SerializedTransaction const& txn);
+
+    /** Check the signatures of many transactions.
+
+        Large batches are split across the shared WorkerPool. Each result
+        is recorded in the transaction, so later checks return without
+        verifying again.
+    */
+    void checkBatch (std::vector <SerializedTransaction::pointer> const& txns);
+
+    std::size_t size () const
+    {
+        return m_cache.size ();
+    }
+
+    void sweep ()
+    {
+        m_cache.sweep ();
+    }
+
+private:
+    static uint256 makeKey (RippleAddress const& publicKey,
+        uint256 const& signingHash, Blob const& signature,
+        ECDSA fullyCanonical);
+
+    cache_type m_cache;
+
+    // Signatures checked with ECDSA, and checks answered by the cache
+    beast::insight::Meter m_verified;
+    beast::insight::Meter m_cached;
+};
+
+} // ripple
+
+#endif
@@ -129,6 +129,32 @@ void PathRequest::updateComplete ()
     mInProgress = false;
 }
 
+LedgerIndex PathRequest::getLastIndex ()
+{
+    ScopedLockType sl (mIndexLock);
+
+    return mLastIndex;
+}
+
+std::string PathRequest::getKey ()
+{
+    ScopedLockType sl (mLock);
+
+    if (!raSrcAccount.isSet () || !raDstAccount.isSet ())
+        return std::string ();
+
+    std::string key = raSrcAccount.humanAccountID () + " " +
+        raDstAccount.humanAccountID () + " " + saDstAmount.getFullText ();
+
+    for (auto const& currIssuer : sciSourceCurrencies)
+    {
+        key += " " + to_string (currIssuer.first) + "/" +
+            to_string (currIssuer.second);
+    }
+
+    return key;
+}
+
 bool PathRequest::isValid (RippleLineCache::ref crCache)
 {
     ScopedLockType sl (mLock);
@@ -358,6 +384,13 @@ Json::Value PathRequest::doUpdate (RippleLineCache::ref cache, bool fast)
 
     ScopedLockType sl (mLock);
 
+    if (!fast)
+    {
+        // Answered for this ledger, whether or not the request is valid
+        ScopedLockType il (mIndexLock);
+        mLastIndex = cache->getLedger ()->getLedgerSeq ();
+    }
+
     if (!isValid (cache))
         return jvStatus;
     jvStatus = Json::objectValue;
@@ -534,6 +567,57 @@ Json::Value PathRequest::doUpdate (RippleLineCache::ref cache, bool fast)
     return jvStatus;
 }
 
+Json::Value PathRequest::doUpdate (PathRequest& source)
+{
+    m_journal.debug << iIdentifier << " update from " << source.iIdentifier;
+
+    Json::Value status;
+    std::map<CurrencyIssuer, STPathSet> context;
+    bool valid, success;
+    int level;
+    LedgerIndex index;
+
+    {
+        ScopedLockType sl (source.mLock);
+        status = source.jvStatus;
+        context = source.mContext;
+        valid = source.bValid;
+        success = source.bLastSuccess;
+        level = source.iLastLevel;
+    }
+
+    {
+        ScopedLockType sl (source.mIndexLock);
+        index = source.mLastIndex;
+    }
+
+    ScopedLockType sl (mLock);
+
+    jvStatus = status;
+    mContext.swap (context);
+    bValid = valid;
+    bLastSuccess = success;
+    iLastLevel = level;
+
+    if (bValid && !jvId.isNull ())
+        jvStatus["id"] = jvId;
+    else if (jvStatus.isObject ())
+        jvStatus.removeMember ("id");
+
+    if (ptFullReply.is_not_a_date_time())
+    {
+        ptFullReply = boost::posix_time::microsec_clock::universal_time();
+        mOwner.reportFull ((ptFullReply-ptCreated).total_milliseconds());
+    }
+
+    {
+        ScopedLockType il (mIndexLock);
+        mLastIndex = index;
+    }
+
+    return jvStatus;
+}
+
 InfoSub::pointer PathRequest::getSubscriber ()
 {
     return wpSubscriber.lock ();
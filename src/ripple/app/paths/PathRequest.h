@@ -63,6 +63,12 @@ public:
     bool        isNew ();
     bool        needsUpdate (bool newOnly, LedgerIndex index);
     void        updateComplete ();
+    LedgerIndex getLastIndex ();
+
+    /** Requests with equal keys always get the same answer.
+        The key is empty if the request is incomplete.
+    */
+    std::string getKey ();
     Json::Value getStatus ();
 
     Json::Value doCreate (
@@ -75,6 +81,9 @@ public:
 
     // update jvStatus
     Json::Value doUpdate (const std::shared_ptr<RippleLineCache>&, bool fast);
+
+    // take the last answer of a request with the same key
+    Json::Value doUpdate (PathRequest& source);
     InfoSub::pointer getSubscriber ();
 
 private:
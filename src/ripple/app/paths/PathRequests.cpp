@@ -21,7 +21,10 @@
 */
 //==============================================================================
 
-#include <boost/foreach.hpp>
+#include <ripple/core/WorkerPool.h>
+#include <atomic>
+#include <exception>
+#include <mutex>
 
 namespace ripple {
 
@@ -41,7 +44,12 @@ RippleLineCache::pointer PathRequests::getLineCache (Ledger::pointer& ledger, bo
          (lgrSeq > (lineSeq + 8)))                         // we jumped way forward for some reason
     {
         ledger = std::make_shared<Ledger>(*ledger, false); // Take a snapshot of the ledger
-        mLineCache = std::make_shared<RippleLineCache> (ledger);
+
+        // Keep the lines of accounts the new ledger did not touch
+        if (mLineCache)
+            mLineCache = std::make_shared<RippleLineCache> (ledger, *mLineCache);
+        else
+            mLineCache = std::make_shared<RippleLineCache> (ledger);
     }
     else
     {
@@ -66,73 +74,36 @@ void PathRequests::updateAll (Ledger::ref inLedger,
         cache = getLineCache (ledger, true);
     }
 
+    std::vector<PathRequest::wptr> const initial = requests;
+    std::uint32_t const ledgerSeq = ledger->getLedgerSeq ();
+    auto const deadline = std::chrono::steady_clock::now () +
+        std::chrono::milliseconds (updateDeadlineMilliseconds);
+
     bool newRequests = getApp().getLedgerMaster().isNewPathRequest();
     bool mustBreak = false;
 
-    mJournal.trace << "updateAll seq=" << ledger->getLedgerSeq() << ", " <<
+    mJournal.trace << "updateAll seq=" << ledgerSeq << ", " <<
         requests.size() << " requests";
     int processed = 0, removed = 0;
 
     do
     {
-        BOOST_FOREACH (PathRequest::wref wRequest, requests)
-        {
-            if (shouldCancel())
-                break;
+        // Claim the requests that need an answer for this ledger
+        std::vector<PathRequest::pointer> work;
 
-            bool remove = true;
+        for (auto const& wRequest : requests)
+        {
             PathRequest::pointer pRequest = wRequest.lock ();
 
-            if (pRequest)
-            {
-                if (!pRequest->needsUpdate (newRequests, ledger->getLedgerSeq ()))
-                    remove = false;
-                else
-                {
-                    InfoSub::pointer ipSub = pRequest->getSubscriber ();
-                    if (ipSub)
-                    {
-                        ipSub->getConsumer ().charge (Resource::feePathFindUpdate);
-                        if (!ipSub->getConsumer ().warn ())
-                        {
-                            Json::Value update = pRequest->doUpdate (cache, false);
-                            pRequest->updateComplete ();
-                            update["type"] = "path_find";
-                            ipSub->send (update, false);
-                            remove = false;
-                            ++processed;
-                        }
-                    }
-                }
-            }
-
-            if (remove)
-            {
-                PathRequest::pointer pRequest = wRequest.lock ();
-
-                ScopedLockType sl (mLock);
-
-                // Remove any dangling weak pointers or weak pointers that refer to this path request.
-                std::vector<PathRequest::wptr>::iterator it = mRequests.begin();
-                while (it != mRequests.end())
-                {
-                    PathRequest::pointer itRequest = it->lock ();
-                    if (!itRequest || (itRequest == pRequest))
-                    {
-                        ++removed;
-                        it = mRequests.erase (it);
-                    }
-                    else
-                        ++it;
-                }
-            }
-
-            mustBreak = !newRequests && getApp().getLedgerMaster().isNewPathRequest();
-            if (mustBreak) // We weren't handling new requests and then there was a new request
-                break;
-
+            if (!pRequest || !pRequest->getSubscriber ())
+                removed += removeRequest (pRequest);
+            else if (pRequest->needsUpdate (newRequests, ledgerSeq))
+                work.push_back (pRequest);
         }
 
+        processed += updateRequests (work, cache, newRequests, deadline,
+            shouldCancel, mustBreak, removed);
+
         if (mustBreak)
         { // a new request came in while we were working
             newRequests = true;
@@ -145,9 +116,12 @@ void PathRequests::updateAll (Ledger::ref inLedger,
         { // check if there are any new requests, otherwise we are done
             newRequests = getApp().getLedgerMaster().isNewPathRequest();
             if (!newRequests) // We did a full pass and there are no new requests
-                return;
+                break;
         }
 
+        if (std::chrono::steady_clock::now () > deadline)
+            break;
+
         {
             // Get the latest requests, cache, and ledger for next pass
             ScopedLockType sl (mLock);
@@ -162,8 +136,196 @@ void PathRequests::updateAll (Ledger::ref inLedger,
     }
     while (!shouldCancel ());
 
+    // How many of the requests open when the ledger closed were answered
+    int wanted = 0, completed = 0;
+
+    for (auto const& wRequest : initial)
+    {
+        PathRequest::pointer pRequest = wRequest.lock ();
+
+        if (pRequest && pRequest->getSubscriber ())
+        {
+            ++wanted;
+
+            if (pRequest->getLastIndex () >= ledgerSeq)
+                ++completed;
+        }
+    }
+
+    if (wanted != 0)
+        mCompletion = (completed * 100) / wanted;
+
     mJournal.debug << "updateAll complete " << processed << " process and " <<
-        removed << " removed";
+        removed << " removed, " << completed << " of " << wanted <<
+            " answered";
+}
+
+int PathRequests::updateRequests (std::vector<PathRequest::pointer> const& work,
+    RippleLineCache::ref cache, bool newRequests,
+    std::chrono::steady_clock::time_point deadline,
+    Job::CancelCallback const& shouldCancel, bool& mustBreak, int& removed)
+{
+    typedef std::pair<LedgerIndex, int> Priority;
+    typedef std::pair<Priority, PathRequest::pointer> Ordered;
+
+    // The oldest answers go first, then the least loaded clients
+    std::vector<Ordered> ordered;
+    ordered.reserve (work.size ());
+
+    for (auto const& pRequest : work)
+    {
+        InfoSub::pointer ipSub = pRequest->getSubscriber ();
+        int const balance = ipSub ? ipSub->getConsumer ().balance () : 0;
+        ordered.emplace_back (
+            std::make_pair (pRequest->getLastIndex (), balance), pRequest);
+    }
+
+    std::stable_sort (ordered.begin (), ordered.end (),
+        [] (Ordered const& lhs, Ordered const& rhs)
+        {
+            return lhs.first < rhs.first;
+        });
+
+    // Identical requests share one path finding run
+    std::vector<std::vector<PathRequest::pointer>> groups;
+    hash_map<std::string, std::size_t> byKey;
+
+    for (auto& entry : ordered)
+    {
+        std::string const key = entry.second->getKey ();
+
+        if (!key.empty ())
+        {
+            auto const result = byKey.emplace (key, groups.size ());
+
+            if (!result.second)
+            {
+                groups[result.first->second].push_back (entry.second);
+                continue;
+            }
+        }
+
+        groups.emplace_back (1, entry.second);
+    }
+
+    std::atomic<int> processed (0);
+    std::atomic<int> dropped (0);
+    std::atomic<bool> stop (false);
+    std::atomic<bool> newRequest (false);
+    std::exception_ptr error;
+    std::mutex errorLock;
+
+    WorkerPool::forEach (groups.size (), [&] (std::size_t i)
+    {
+        if (!stop)
+        {
+            if (!newRequests &&
+                getApp().getLedgerMaster().isNewPathRequest())
+            {
+                // We weren't handling new requests and then there was
+                // a new request
+                newRequest = true;
+                stop = true;
+            }
+            else if (shouldCancel () ||
+                (std::chrono::steady_clock::now () > deadline))
+            {
+                // Leave the rest for the next ledger
+                stop = true;
+            }
+        }
+
+        if (!stop)
+        {
+            try
+            {
+                int count = 0;
+                dropped += updateGroup (groups[i], cache, count);
+                processed += count;
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> sl (errorLock);
+                if (!error)
+                    error = std::current_exception ();
+                stop = true;
+            }
+        }
+
+        for (auto const& pRequest : groups[i])
+            pRequest->updateComplete ();
+    }, maxUpdateThreads);
+
+    // Every claimed request has been released, pass on a failure such as
+    // a missing node to the caller
+    if (error)
+        std::rethrow_exception (error);
+
+    mustBreak = newRequest;
+    removed += dropped;
+    return processed;
+}
+
+int PathRequests::updateGroup (std::vector<PathRequest::pointer> const& group,
+    RippleLineCache::ref cache, int& processed)
+{
+    int removed = 0;
+    PathRequest::pointer leader;
+    Json::Value update;
+
+    for (auto const& pRequest : group)
+    {
+        InfoSub::pointer ipSub = pRequest->getSubscriber ();
+
+        if (ipSub)
+        {
+            ipSub->getConsumer ().charge (Resource::feePathFindUpdate);
+
+            if (!ipSub->getConsumer ().warn ())
+            {
+                if (leader)
+                    update = pRequest->doUpdate (*leader);
+                else
+                    update = pRequest->doUpdate (cache, false);
+
+                update["type"] = "path_find";
+                ipSub->send (update, false);
+
+                if (!leader)
+                    leader = pRequest;
+
+                ++processed;
+                continue;
+            }
+        }
+
+        removed += removeRequest (pRequest);
+    }
+
+    return removed;
+}
+
+int PathRequests::removeRequest (PathRequest::pointer const& request)
+{
+    ScopedLockType sl (mLock);
+
+    int removed = 0;
+
+    // Remove any dangling weak pointers or weak pointers that refer to this path request.
+    std::vector<PathRequest::wptr>::iterator it = mRequests.begin();
+    while (it != mRequests.end())
+    {
+        PathRequest::pointer itRequest = it->lock ();
+        if (!itRequest || (itRequest == request))
+        {
+            ++removed;
+            it = mRequests.erase (it);
+        }
+        else
+            ++it;
+    }
+
+    return removed;
 }
 
 Json::Value PathRequests::makePathRequest(
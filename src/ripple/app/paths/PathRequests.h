@@ -25,6 +25,7 @@
 #define RIPPLE_PATHREQUESTS_H
 
 #include <atomic>
+#include <chrono>
 
 namespace ripple {
 
@@ -37,6 +38,7 @@ public:
     {
         mFast = collector->make_event ("pathfind_fast");
         mFull = collector->make_event ("pathfind_full");
+        mCompletion = collector->make_gauge ("pathfind_completion");
     }
 
     void updateAll (const std::shared_ptr<Ledger>& ledger,
@@ -61,11 +63,32 @@ public:
     }
 
 private:
+    // Most pool threads updating requests at once
+    static int const maxUpdateThreads = 4;
+
+    // Requests not started this long after a ledger wait for the next one
+    static int const updateDeadlineMilliseconds = 10000;
+
+    int updateRequests (std::vector<PathRequest::pointer> const& work,
+        RippleLineCache::ref cache, bool newRequests,
+        std::chrono::steady_clock::time_point deadline,
+        Job::CancelCallback const& shouldCancel, bool& mustBreak,
+        int& removed);
+
+    int updateGroup (std::vector<PathRequest::pointer> const& group,
+        RippleLineCache::ref cache, int& processed);
+
+    // Remove a request and any requests that no longer exist
+    int removeRequest (PathRequest::pointer const& request);
+
     beast::Journal                   mJournal;
 
     beast::insight::Event            mFast;
     beast::insight::Event            mFull;
 
+    // Percent of requests answered for the last ledger
+    beast::insight::Gauge            mCompletion;
+
     // Track all requests
     std::vector<PathRequest::wptr>   mRequests;
 
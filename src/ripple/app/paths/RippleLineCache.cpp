@@ -23,24 +23,98 @@
 
 namespace ripple {
 
+// Ledgers further apart than this are loaded from scratch
+static int const maxCarryForwardChanges = 16384;
+
 RippleLineCache::RippleLineCache (Ledger::ref l)
     : mLedger (l)
 {
 }
 
+RippleLineCache::RippleLineCache (Ledger::ref l, RippleLineCache& previous)
+    : mLedger (l)
+{
+    carryForward (previous);
+}
+
 RippleLineCache::RippleStateVector const&
 RippleLineCache::getRippleLines (Account const& accountID)
 {
     AccountKey key (accountID);
 
+    {
+        ScopedLockType sl (mLock);
+
+        auto const it = mRLMap.find (key);
+
+        if (it != mRLMap.end ())
+            return *it->second;
+    }
+
+    // Walk the ledger without holding the lock, so other requests are not
+    // stalled. If two requests load the same account, the first one wins.
+    auto lines = std::make_shared <RippleStateVector> (
+        ripple::getRippleStateItems (accountID, mLedger));
+
     ScopedLockType sl (mLock);
 
-    auto it = mRLMap.emplace (key, RippleStateVector ());
+    return *mRLMap.emplace (key, std::move (lines)).first->second;
+}
+
+void RippleLineCache::carryForward (RippleLineCache& previous)
+{
+    SHAMap::Delta delta;
+
+    try
+    {
+        if (!mLedger->peekAccountStateMap ()->compare (
+            previous.mLedger->peekAccountStateMap (), delta,
+                maxCarryForwardChanges))
+        {
+            WriteLog (lsDEBUG, RippleLineCache) << "Ledger " <<
+                mLedger->getLedgerSeq () << " is too far from ledger " <<
+                    previous.mLedger->getLedgerSeq ();
+            return;
+        }
+    }
+    catch (SHAMapMissingNode const& mn)
+    {
+        WriteLog (lsDEBUG, RippleLineCache) <<
+            "Unable to compare with previous ledger: " << mn;
+        return;
+    }
+
+    // Any change to a trust line changes the lines of both its accounts
+    hash_set <Account> changed;
+
+    for (auto const& item : delta)
+    {
+        for (auto const& side : { item.second.first, item.second.second })
+        {
+            if (!side)
+                continue;
+
+            STObjectView const sle (side->peekData ());
+
+            if (sle.getType () == ltRIPPLE_STATE)
+            {
+                changed.insert (sle.getFieldAmount (sfLowLimit).getIssuer ());
+                changed.insert (sle.getFieldAmount (sfHighLimit).getIssuer ());
+            }
+        }
+    }
+
+    ScopedLockType sl (previous.mLock);
 
-    if (it.second)
-        it.first->second = ripple::getRippleStateItems (accountID, mLedger);
+    for (auto const& entry : previous.mRLMap)
+    {
+        if (changed.find (entry.first.account_) == changed.end ())
+            mRLMap.insert (entry);
+    }
 
-    return it.first->second;
+    WriteLog (lsDEBUG, RippleLineCache) << "Ledger " <<
+        mLedger->getLedgerSeq () << " kept lines of " << mRLMap.size () <<
+            " of " << previous.mRLMap.size () << " accounts";
 }
 
 } // ripple
@@ -26,7 +26,15 @@
 
 namespace ripple {
 
-// Used by Pathfinder
+/** The trust lines of accounts in one ledger, used by Pathfinder.
+
+    Lines are loaded on first use and never change afterwards, so one cache
+    can be shared by any number of concurrent path finding requests.
+
+    A cache for a new ledger can start from the cache of an earlier one.
+    Accounts whose trust lines did not change between the two ledgers keep
+    their lines, so only the accounts the ledgers touched are walked again.
+*/
 class RippleLineCache
 {
 public:
@@ -36,6 +44,11 @@ public:
 
     explicit RippleLineCache (Ledger::ref l);
 
+    /** Create a cache for a ledger, carrying forward the unchanged lines
+        of another cache.
+    */
+    RippleLineCache (Ledger::ref l, RippleLineCache& previous);
+
     Ledger::ref getLedger () // VFALCO TODO const?
     {
         return mLedger;
@@ -45,6 +58,8 @@ public:
     getRippleLines (Account const& accountID);
 
 private:
+    void carryForward (RippleLineCache& previous);
+
     typedef RippleMutex LockType;
     typedef std::lock_guard <LockType> ScopedLockType;
     LockType mLock;
@@ -99,7 +114,8 @@ private:
         };
     };
 
-    hash_map <AccountKey, RippleStateVector, AccountKey::Hash> mRLMap;
+    hash_map <AccountKey, std::shared_ptr <RippleStateVector const>,
+        AccountKey::Hash> mRLMap;
 };
 
 } // ripple
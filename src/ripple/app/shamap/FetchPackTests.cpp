@@ -21,9 +21,15 @@
 */
 //==============================================================================
 
+#include <ripple/nodestore/DummyScheduler.h>
+#include <ripple/nodestore/Factory.h>
+#include <ripple/nodestore/Manager.h>
 #include <beast/unit_test/suite.h>
 
+#include <chrono>
 #include <functional>
+#include <limits>
+#include <sstream>
 
 namespace ripple {
 
@@ -131,4 +137,134 @@ public:
 
 BEAST_DEFINE_TESTSUITE(FetchPack,ripple_app,ripple);
 
+//------------------------------------------------------------------------------
+
+/** Measure how quickly a node catches up on a large state map.
+
+    A random state map is turned into a fetch pack, and an empty map with
+    the same root hash is then completed from the pack by repeatedly asking
+    for missing nodes, as InboundLedger does. This is repeated with
+    different numbers of threads searching for the missing nodes.
+*/
+class FetchPack_timing_test : public FetchPack_test
+{
+public:
+    enum
+    {
+        benchmarkItems = 200000,
+        neededPerPass = 256
+    };
+
+    // Complete a copy of the source map from a node store, returning the
+    // elapsed seconds. Every node is read through the batched path.
+    double catchUp (std::shared_ptr <RadixMap::Table> const& source,
+        NodeStore::Database& nodeStore, int threads, beast::Journal journal)
+    {
+        using namespace RadixMap;
+
+        beast::manual_clock <std::chrono::seconds> clock;
+        FullBelowCache fullBelowCache ("test.full_below", clock);
+        TreeNodeCache treeNodeCache ("test.tree_node_cache", 65536, 60,
+            clock, journal);
+
+        Table destination (smtSTATE, source->getHash (),
+            fullBelowCache, treeNodeCache);
+        destination.setNodeStore (nodeStore);
+
+        auto const start = std::chrono::steady_clock::now ();
+
+        expect (destination.fetchRoot (source->getHash (), nullptr),
+            "unable to get root");
+        destination.setSynching ();
+
+        // The node store has every node, so one pass completes the map
+        std::vector <SHAMapNodeID> nodeIDs;
+        std::vector <uint256> hashes;
+        destination.getMissingNodes (nodeIDs, hashes, neededPerPass,
+            nullptr, threads);
+
+        auto const elapsed = std::chrono::steady_clock::now () - start;
+
+        expect (hashes.empty (), "missing hashes");
+        expect (destination.deepCompare (*source), "failed compare");
+
+        return std::chrono::duration_cast <std::chrono::duration <double>> (
+            elapsed).count ();
+    }
+
+    void testBackend (std::string const& type,
+        std::shared_ptr <RadixMap::Table> const& source, Map& map)
+    {
+        std::unique_ptr <NodeStore::Manager> manager (
+            NodeStore::make_Manager ());
+        NodeStore::DummyScheduler scheduler;
+        beast::Journal const j;
+
+        beast::File const path (beast::File::createTempFile ("node_db"));
+        beast::StringPairArray params;
+        params.set ("type", type);
+        params.set ("path", path.getFullPathName ());
+
+        // Write the nodes, then close the store so they are on disk
+        {
+            std::unique_ptr <NodeStore::Database> db (manager->make_Database (
+                "test", scheduler, j, 2, params));
+
+            for (auto const& node : map)
+            {
+                Blob data (node.second);
+                db->store (hotACCOUNT_NODE, 0, std::move (data), node.first);
+            }
+        }
+
+        for (int threads : { 1, 2, 4, 8, 16 })
+        {
+            std::stringstream ss;
+            ss << type << ", " << threads << " threads";
+            testcase (ss.str ());
+
+            // Each pass starts with empty node store caches
+            std::unique_ptr <NodeStore::Database> db (manager->make_Database (
+                "test", scheduler, j, 2, params));
+
+            double const seconds = catchUp (source, *db, threads, j);
+            log << benchmarkItems << " items, " << map.size () <<
+                " nodes in " << seconds << "s";
+        }
+
+        path.deleteRecursively ();
+    }
+
+    void run ()
+    {
+        using namespace RadixMap;
+
+        beast::manual_clock <std::chrono::seconds> clock;
+        beast::Journal const j;
+
+        FullBelowCache fullBelowCache ("test.full_below", clock);
+        TreeNodeCache treeNodeCache ("test.tree_node_cache", 65536, 60,
+            clock, j);
+
+        std::shared_ptr <Table> source (std::make_shared <Table> (
+            smtSTATE, fullBelowCache, treeNodeCache));
+
+        beast::Random r;
+        add_random_items (benchmarkItems, *source, r);
+        source->setImmutable ();
+
+        Map map;
+        source->getFetchPack (nullptr, true, std::numeric_limits <int>::max (),
+            std::bind (&FetchPack_test::on_fetch, this, std::ref (map),
+                std::placeholders::_1, std::placeholders::_2));
+
+        testBackend ("leveldb", source, map);
+#if RIPPLE_ROCKSDB_AVAILABLE
+        testBackend ("rocksdb", source, map);
+#endif
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(FetchPack_timing,ripple_app,ripple);
+
 }
@@ -23,6 +23,7 @@
 
 #include <ripple/nodestore/Database.h>
 #include <beast/unit_test/suite.h>
+#include <ripple/core/WorkerPool.h>
 #include <beast/chrono/manual_clock.h>
 
 namespace ripple {
@@ -47,16 +48,13 @@ SHAMap::SHAMap (
     , mState (smsModifying)
     , mType (t)
     , mTXMap (false)
+    , mNodeStore (nullptr)
     , m_missing_node_handler (missing_node_handler)
 {
     assert (mSeq != 0);
-    if (t == smtSTATE)
-        mTNByID.rehash (STATE_MAP_BUCKETS);
 
-    SHAMapNodeID rootID{};
     root = std::make_shared<SHAMapTreeNode> (mSeq);
     root->makeInner ();
-    mTNByID.replace(rootID, root);
 }
 
 SHAMap::SHAMap (
@@ -72,24 +70,17 @@ SHAMap::SHAMap (
     , mState (smsSynching)
     , mType (t)
     , mTXMap (false)
+    , mNodeStore (nullptr)
     , m_missing_node_handler (missing_node_handler)
 {
-    if (t == smtSTATE)
-        mTNByID.rehash (STATE_MAP_BUCKETS);
-
-    SHAMapNodeID rootID{};
     root = std::make_shared<SHAMapTreeNode> (mSeq);
     root->makeInner ();
-    mTNByID.replace(rootID, root);
 }
 
 SHAMap::~SHAMap ()
 {
     mState = smsInvalid;
 
-    logTimedDestroy <SHAMap> (mTNByID, "mTNByID with " +
-        std::to_string (mTNByID.size ()) + " items");
-
     if (mDirtyNodes)
     {
         logTimedDestroy <SHAMap> (mDirtyNodes, "mDirtyNodes with " +
@@ -107,34 +98,19 @@ SHAMap::pointer SHAMap::snapShot (bool isMutable)
     SHAMap& newMap = *ret;
 
     // Return a new SHAMap that is a snapshot of this one
-    // Initially most nodes are shared and CoW is forced where needed
-    {
-        ScopedReadLockType sl (mLock);
-        newMap.mSeq = mSeq;
-        newMap.mTNByID = mTNByID;
-        newMap.root = root;
+    // All nodes are shared. Neither map modifies a node in place unless
+    // the node's sequence matches the map's, so bumping the sequence of
+    // every map that might change forces CoW where needed.
+    ScopedWriteLockType sl (mLock);
 
-        if (!isMutable)
-            newMap.mState = smsImmutable;
+    if (mState != smsImmutable)
+        ++mSeq;
 
-        // If the existing map has any nodes it might modify, unshare ours now
-        if (mState != smsImmutable)
-        {
-            for (NodeMap::value_type& nodeIt : mTNByID.peekMap())
-            {
-                if (nodeIt.second->getSeq() == mSeq)
-                { // We might modify this node, so duplicate it in the snapShot
-                    SHAMapTreeNode::pointer newNode = std::make_shared<SHAMapTreeNode> (*nodeIt.second, mSeq);
-                    SHAMapNodeID const& newNodeID = nodeIt.first;
-                    newMap.mTNByID.replace (newNodeID, newNode);
-                    if (newNodeID.isRoot ())
-                        newMap.root = newNode;
-                }
-            }
-        }
-        else if (isMutable) // Need to unshare on changes to the snapshot
-            ++newMap.mSeq;
-    }
+    newMap.mSeq = mSeq + 1;
+    newMap.root = root;
+
+    if (!isMutable)
+        newMap.mState = smsImmutable;
 
     return ret;
 }
@@ -147,7 +123,6 @@ SHAMap::getStack (uint256 const& id, bool include_nonmatching_leaf)
     std::stack<std::pair<SHAMapTreeNode::pointer, SHAMapNodeID>> stack;
     SHAMapTreeNode::pointer node = root;
     SHAMapNodeID nodeID;
-    uint256 nodeHash;
 
     while (!node->isLeaf ())
     {
@@ -156,10 +131,11 @@ SHAMap::getStack (uint256 const& id, bool include_nonmatching_leaf)
         int branch = nodeID.selectBranch (id);
         assert (branch >= 0);
 
-        if (!node->descend (branch, nodeID, nodeHash))
+        if (node->isEmptyBranch (branch))
             return stack;
 
-        node = getNode (nodeID, nodeHash, false);
+        nodeID = nodeID.getChildNodeID (branch);
+        node = descend (node, nodeID, branch);
     }
 
     if (include_nonmatching_leaf || (node->peekItem ()->getTag () == id))
@@ -170,10 +146,10 @@ SHAMap::getStack (uint256 const& id, bool include_nonmatching_leaf)
 
 void
 SHAMap::dirtyUp (std::stack<std::pair<SHAMapTreeNode::pointer, SHAMapNodeID>>& stack,
-                 uint256 const& target, uint256 prevHash)
+                 uint256 const& target, SHAMapTreeNode::pointer terminal)
 {
     // walk the tree up from through the inner nodes to the root
-    // update linking hashes and add nodes to dirty list
+    // update linking hashes and child pointers, add nodes to dirty list
 
     assert ((mState != smsSynching) && (mState != smsImmutable));
 
@@ -189,7 +165,7 @@ SHAMap::dirtyUp (std::stack<std::pair<SHAMapTreeNode::pointer, SHAMapNodeID>>& s
 
         returnNode (node, nodeID, true);
 
-        if (!node->setChildHash (branch, prevHash))
+        if (!node->setChild (branch, terminal->getNodeHash (), terminal))
         {
             WriteLog (lsFATAL, SHAMap) << "dirtyUp terminates early";
             assert (false);
@@ -197,149 +173,124 @@ SHAMap::dirtyUp (std::stack<std::pair<SHAMapTreeNode::pointer, SHAMapNodeID>>& s
         }
 
 #ifdef ST_DEBUG
-        WriteLog (lsTRACE, SHAMap) << "dirtyUp sets branch " << branch << " to " << prevHash;
+        WriteLog (lsTRACE, SHAMap) << "dirtyUp sets branch " << branch << " to " << terminal->getNodeHash ();
 #endif
-        prevHash = node->getNodeHash ();
-        assert (prevHash.isNonZero ());
+        terminal = node;
+        assert (terminal->getNodeHash ().isNonZero ());
     }
 }
 
-SHAMapTreeNode::pointer SHAMap::checkCacheNode (const SHAMapNodeID& iNode)
-{
-    SHAMapTreeNode::pointer ret = mTNByID.retrieve(iNode);
-    if (ret && (ret->getSeq()!= 0))
-        ret->touch (mSeq);
-    return ret;
-}
-
-SHAMapTreeNode::pointer SHAMap::walkTo (uint256 const& id, bool modify)
-{
-    // walk down to the terminal node for this ID
-
-    SHAMapTreeNode::pointer inNode = root;
-    SHAMapNodeID nodeID;
-    uint256 nodeHash;
-
-    while (!inNode->isLeaf ())
-    {
-        int branch = nodeID.selectBranch (id);
-
-        if (!inNode->descend (branch, nodeID, nodeHash))
-            return inNode;
-
-        inNode = getNode (nodeID, nodeHash, false);
-    }
-
-    if (inNode->getTag () != id)
-        return SHAMapTreeNode::pointer ();
-
-    if (modify)
-        returnNode (inNode, nodeID, true);
-
-    return inNode;
-}
-
 SHAMapTreeNode* SHAMap::walkToPointer (uint256 const& id)
 {
     SHAMapTreeNode* inNode = root.get ();
     SHAMapNodeID nodeID;
-    uint256 nodeHash;
 
     while (!inNode->isLeaf ())
     {
         int branch = nodeID.selectBranch (id);
 
-        if (!inNode->descend (branch, nodeID, nodeHash))
+        if (inNode->isEmptyBranch (branch))
             return nullptr;
 
-        inNode = getNodePointer (nodeID, nodeHash);
-        assert (inNode);
+        nodeID = nodeID.getChildNodeID (branch);
+        inNode = descendThrow (inNode, nodeID, branch);
     }
 
     return (inNode->getTag () == id) ? inNode : nullptr;
 }
 
-SHAMapTreeNode::pointer SHAMap::getNode (const SHAMapNodeID& id, uint256 const& hash, bool modify)
+SHAMapTreeNode::pointer
+SHAMap::descend (SHAMapTreeNode::ref parent, SHAMapNodeID const& childID,
+                 int branch)
 {
-    // retrieve a node whose node hash is known
-    SHAMapTreeNode::pointer node = checkCacheNode (id);
+    SHAMapTreeNode::pointer node = parent->getChild (branch);
 
-    if (node)
+    if (!node)
     {
-#if BEAST_DEBUG
+        uint256 const& hash = parent->getChildHash (branch);
 
-        if (node->getNodeHash () != hash)
-        {
-            WriteLog (lsFATAL, SHAMap) << "Attempt to get node, hash not in tree";
-            WriteLog (lsFATAL, SHAMap) << "ID: " << id;
-            WriteLog (lsFATAL, SHAMap) << "TgtHash " << hash;
-            WriteLog (lsFATAL, SHAMap) << "NodHash " << node->getNodeHash ();
-            throw std::runtime_error ("invalid node");
-        }
+        node = fetchNodeExternalNT (hash);
 
-#endif
-        returnNode (node, id, modify);
-        return node;
+        if (!node)
+            throw (SHAMapMissingNode (mType, childID, hash));
+
+        parent->canonicalizeChild (branch, node);
     }
 
-    return fetchNodeExternal (id, hash);
+    return node;
 }
 
-SHAMapTreeNode* SHAMap::getNodePointer (const SHAMapNodeID& id, uint256 const& hash)
+SHAMapTreeNode*
+SHAMap::descendThrow (SHAMapTreeNode* parent, SHAMapNodeID const& childID,
+                      int branch)
 {
     // fast, but you do not hold a reference
-    SHAMapTreeNode* ret = getNodePointerNT (id, hash);
+    SHAMapTreeNode* ret = descendNT (parent, childID, branch);
 
     if (!ret)
-        throw (SHAMapMissingNode (mType, id, hash));
+        throw (SHAMapMissingNode (mType, childID,
+                                  parent->getChildHash (branch)));
 
     return ret;
 }
 
-SHAMapTreeNode* SHAMap::getNodePointerNT (const SHAMapNodeID& id, uint256 const& hash)
-{
-    SHAMapTreeNode::pointer ret = mTNByID.retrieve (id);
-    if (!ret)
-        ret = fetchNodeExternalNT (id, hash);
-    return ret ? ret.get() : nullptr;
-}
-
-SHAMapTreeNode* SHAMap::getNodePointer (const SHAMapNodeID& id, uint256 const& hash, SHAMapSyncFilter* filter)
+SHAMapTreeNode*
+SHAMap::descendNT (SHAMapTreeNode* parent, SHAMapNodeID const& childID,
+                   int branch, SHAMapSyncFilter* filter)
 {
-    SHAMapTreeNode* ret = getNodePointerNT (id, hash, filter);
+    SHAMapTreeNode* ret = parent->getChildPointer (branch);
 
-    if (!ret)
-        throw (SHAMapMissingNode (mType, id, hash));
-
-    return ret;
-}
+    if (ret)
+        return ret;
 
-SHAMapTreeNode* SHAMap::getNodePointerNT (const SHAMapNodeID& id, uint256 const& hash, SHAMapSyncFilter* filter)
-{
-    SHAMapTreeNode* node = getNodePointerNT (id, hash);
+    uint256 const& hash = parent->getChildHash (branch);
+    SHAMapTreeNode::pointer node = fetchNodeExternalNT (hash);
 
     if (!node && filter)
     { // Our regular node store didn't have the node. See if the filter does
         Blob nodeData;
 
-        if (filter->haveNode (id, hash, nodeData))
+        if (filter->haveNode (childID, hash, nodeData))
         {
-            SHAMapTreeNode::pointer node = std::make_shared<SHAMapTreeNode> (
+            node = std::make_shared<SHAMapTreeNode> (
                     nodeData, 0, snfPREFIX, hash, true);
             canonicalize (hash, node);
 
-            // Canonicalize the node with mTNByID to make sure all threads gets the same node
-            // If the node is new, tell the filter
-            if (mTNByID.canonicalize (id, &node))
-                filter->gotNode (true, id, hash, nodeData, node->getType ());
+            // Hook the node to its parent to make sure all threads get the
+            // same node. If the node is new, tell the filter
+            if (parent->canonicalizeChild (branch, node))
+                filter->gotNode (true, childID, hash, nodeData,
+                                 node->getType ());
 
             return node.get ();
         }
     }
 
-    return node;
+    if (!node)
+        return nullptr;
+
+    parent->canonicalizeChild (branch, node);
+    return node.get ();
 }
 
+SHAMapTreeNode::pointer
+SHAMap::descendNoStore (SHAMapTreeNode::ref parent,
+                        SHAMapNodeID const& childID, int branch)
+{
+    SHAMapTreeNode::pointer ret = parent->getChild (branch);
+
+    if (!ret)
+    {
+        uint256 const& hash = parent->getChildHash (branch);
+
+        ret = fetchNodeExternalNT (hash);
+
+        if (!ret)
+            throw (SHAMapMissingNode (mType, childID, hash));
+    }
+
+    return ret;
+}
 
 void
 SHAMap::returnNode (SHAMapTreeNode::pointer& node, SHAMapNodeID const& nodeID,
@@ -352,14 +303,13 @@ SHAMap::returnNode (SHAMapTreeNode::pointer& node, SHAMapNodeID const& nodeID,
     if (node && modify && (node->getSeq () != mSeq))
     {
         // have a CoW
+        // The caller links the copy to its parent
         assert (node->getSeq () < mSeq);
         assert (mState != smsImmutable);
 
         node = std::make_shared<SHAMapTreeNode> (*node, mSeq); // here's to the new node, same as the old node
         assert (node->isValid ());
 
-        mTNByID.replace (nodeID, node);
-
         if (nodeID.isRoot ())
             root = node;
 
@@ -389,10 +339,10 @@ SHAMap::firstBelow (SHAMapTreeNode* node, SHAMapNodeID nodeID)
         bool foundNode = false;
         for (int i = 0; i < 16; ++i)
         {
-            uint256 nodeHash;
-            if (node->descend (i, nodeID, nodeHash))
+            if (!node->isEmptyBranch (i))
             {
-                node = getNodePointer (nodeID, nodeHash);
+                nodeID = nodeID.getChildNodeID (i);
+                node = descendThrow (node, nodeID, i);
                 foundNode = true;
                 break;
             }
@@ -414,10 +364,10 @@ SHAMap::lastBelow (SHAMapTreeNode* node, SHAMapNodeID nodeID)
         bool foundNode = false;
         for (int i = 15; i >= 0; --i)
         {
-            uint256 nodeHash;
-            if (node->descend (i, nodeID, nodeHash))
+            if (!node->isEmptyBranch (i))
             {
-                node = getNodePointer (nodeID, nodeHash);
+                nodeID = nodeID.getChildNodeID (i);
+                node = descendThrow (node, nodeID, i);
                 foundNode = true;
                 break;
             }
@@ -438,14 +388,12 @@ SHAMap::onlyBelow (SHAMapTreeNode* node, SHAMapNodeID nodeID)
         SHAMapNodeID nextNodeID;
         for (int i = 0; i < 16; ++i)
         {
-            SHAMapNodeID tempNodeID = nodeID;
-            uint256 nodeHash;
-            if (node->descend (i, tempNodeID, nodeHash))
+            if (!node->isEmptyBranch (i))
             {
                 if (nextNode)
                     return SHAMapItem::pointer (); // two leaves below
-                nextNode = getNodePointer (tempNodeID, nodeHash);
-                nextNodeID = tempNodeID;
+                nextNodeID = nodeID.getChildNodeID (i);
+                nextNode = descendThrow (node, nextNodeID, i);
             }
         }
         if (!nextNode)
@@ -463,45 +411,6 @@ SHAMap::onlyBelow (SHAMapTreeNode* node, SHAMapNodeID nodeID)
     return node->peekItem ();
 }
 
-void
-SHAMap::eraseChildren (SHAMapTreeNode::pointer node, SHAMapNodeID nodeID)
-{
-    // this node has only one item below it, erase its children
-    bool erase = false;
-    while (node->isInner ())
-    {
-        for (int i = 0; i < 16; ++i)
-        {
-            uint256 nodeHash;
-            SHAMapNodeID nextNodeID = nodeID;
-            if (node->descend (i, nextNodeID, nodeHash))
-            {
-                SHAMapTreeNode::pointer nextNode = getNode (nextNodeID,
-                                                               nodeHash, false);
-                if (erase)
-                {
-                    returnNode (node, nodeID, true);
-
-                    if (mTNByID.erase (nodeID))
-                        assert (false);
-                }
-
-                erase = true;
-                node = nextNode;
-                nodeID = nextNodeID;
-                break;
-            }
-        }
-    }
-
-    returnNode (node, nodeID, true);
-
-    if (mTNByID.erase (nodeID) == 0)
-        assert (false);
-
-    return;
-}
-
 static const SHAMapItem::pointer no_item;
 
 SHAMapItem::pointer SHAMap::peekFirstItem ()
@@ -571,15 +480,14 @@ SHAMapItem::pointer SHAMap::peekNextItem (uint256 const& id, SHAMapTreeNode::TNT
         }
         else
         {
-            uint256 nodeHash;
             // breadth-first
             for (int i = nodeID.selectBranch (id) + 1; i < 16; ++i)
             {
-                SHAMapNodeID childNodeID = nodeID;
-                if (node->descend (i, childNodeID, nodeHash))
+                if (!node->isEmptyBranch (i))
                 {
-                    SHAMapTreeNode* firstNode = getNodePointer (
-                        childNodeID, nodeHash);
+                    SHAMapNodeID childNodeID = nodeID.getChildNodeID (i);
+                    SHAMapTreeNode* firstNode = descendThrow (
+                        node.get (), childNodeID, i);
                     assert (firstNode);
                     firstNode = firstBelow (firstNode, childNodeID);
 
@@ -617,13 +525,13 @@ SHAMapItem::pointer SHAMap::peekPrevItem (uint256 const& id)
         }
         else
         {
-            uint256 nodeHash;
             for (int i = nodeID.selectBranch (id) - 1; i >= 0; --i)
             {
-                if (node->descend (i, nodeID, nodeHash))
+                if (!node->isEmptyBranch (i))
                 {
-                    node = getNode (nodeID, nodeHash, false);
-                    SHAMapTreeNode* item = firstBelow (node.get (), nodeID);
+                    nodeID = nodeID.getChildNodeID (i);
+                    SHAMapTreeNode* item = firstBelow (
+                        descendThrow (node.get (), nodeID, i), nodeID);
 
                     if (!item)
                         throw (std::runtime_error ("missing node"));
@@ -698,19 +606,17 @@ bool SHAMap::delItem (uint256 const& id)
         throw (std::runtime_error ("missing node"));
 
     SHAMapTreeNode::pointer leaf = stack.top ().first;
-    SHAMapNodeID leafID = stack.top ().second;
     stack.pop ();
 
     if (!leaf || !leaf->hasItem () || (leaf->peekItem ()->getTag () != id))
         return false;
 
     SHAMapTreeNode::TNType type = leaf->getType ();
-    returnNode (leaf, leafID, true);
-
-    if (mTNByID.erase (leafID) == 0)
-        assert (false);
 
+    // What gets attached to the end of the chain
+    // (For now, nothing, since we deleted the leaf)
     uint256 prevHash;
+    SHAMapTreeNode::pointer prevNode;
 
     while (!stack.empty ())
     {
@@ -719,7 +625,7 @@ bool SHAMap::delItem (uint256 const& id)
         stack.pop ();
         returnNode (node, nodeID, true);
         assert (node->isInner ());
-        if (!node->setChildHash (nodeID.selectBranch (id), prevHash))
+        if (!node->setChild (nodeID.selectBranch (id), prevHash, prevNode))
         {
             assert (false);
             return true;
@@ -733,9 +639,7 @@ bool SHAMap::delItem (uint256 const& id)
             if (bc == 0)
             {
                 prevHash = uint256 ();
-
-                if (!mTNByID.erase (nodeID))
-                    assert (false);
+                prevNode.reset ();
             }
             else if (bc == 1)
             {
@@ -743,18 +647,16 @@ bool SHAMap::delItem (uint256 const& id)
                 SHAMapItem::pointer item = onlyBelow (node.get (), nodeID);
 
                 if (item)
-                {
-                    returnNode (node, nodeID, true);
-                    eraseChildren (node, nodeID);
                     node->setItem (item, type);
-                }
 
                 prevHash = node->getNodeHash ();
+                prevNode = node;
                 assert (prevHash.isNonZero ());
             }
             else
             {
                 prevHash = node->getNodeHash ();
+                prevNode = node;
                 assert (prevHash.isNonZero ());
             }
         }
@@ -786,7 +688,6 @@ bool SHAMap::addGiveItem (SHAMapItem::ref item, bool isTransaction, bool hasMeta
     if (node->isLeaf () && (node->peekItem ()->getTag () == tag))
         return false;
 
-    uint256 prevHash;
     returnNode (node, nodeID, true);
     if (node->isInner ())
     {
@@ -797,17 +698,8 @@ bool SHAMap::addGiveItem (SHAMapItem::ref item, bool isTransaction, bool hasMeta
         SHAMapTreeNode::pointer newNode =
             std::make_shared<SHAMapTreeNode> (item, type, mSeq);
 
-        if (!mTNByID.peekMap().emplace (newNodeID, newNode).second)
-        {
-            WriteLog (lsFATAL, SHAMap) << "Node: " << nodeID;
-            WriteLog (lsFATAL, SHAMap) << "NewNode: " << newNodeID;
-            dump ();
-            assert (false);
-            throw (std::runtime_error ("invalid inner node"));
-        }
-
         trackNewNode (newNode, newNodeID);
-        node->setChildHash (branch, newNode->getNodeHash ());
+        node->setChild (branch, newNode->getNodeHash (), newNode);
     }
     else
     {
@@ -822,18 +714,12 @@ bool SHAMap::addGiveItem (SHAMapItem::ref item, bool isTransaction, bool hasMeta
         while ((b1 = nodeID.selectBranch (tag)) ==
                (b2 = nodeID.selectBranch (otherItem->getTag ())))
         {
-            // we need a new inner node, since both go on same branch at this level
-            SHAMapNodeID newNodeID = nodeID.getChildNodeID (b1);
-            SHAMapTreeNode::pointer newNode =
-                std::make_shared<SHAMapTreeNode> (mSeq);
-            newNode->makeInner ();
-
-            if (!mTNByID.peekMap().emplace (newNodeID, newNode).second)
-                assert (false);
-
             stack.push ({node, nodeID});
-            node = newNode;
-            nodeID = newNodeID;
+
+            // we need a new inner node, since both go on same branch at this level
+            nodeID = nodeID.getChildNodeID (b1);
+            node = std::make_shared<SHAMapTreeNode> (mSeq);
+            node->makeInner ();
             trackNewNode (node, nodeID);
         }
 
@@ -844,23 +730,17 @@ bool SHAMap::addGiveItem (SHAMapItem::ref item, bool isTransaction, bool hasMeta
             std::make_shared<SHAMapTreeNode> (item, type, mSeq);
         assert (newNode->isValid () && newNode->isLeaf ());
 
-        if (!mTNByID.peekMap().emplace (newNodeID, newNode).second)
-            assert (false);
-
-        node->setChildHash (b1, newNode->getNodeHash ()); // OPTIMIZEME hash op not needed
+        node->setChild (b1, newNode->getNodeHash (), newNode); // OPTIMIZEME hash op not needed
         trackNewNode (newNode, newNodeID);
         newNodeID = nodeID.getChildNodeID (b2);
         newNode = std::make_shared<SHAMapTreeNode> (otherItem, type, mSeq);
         assert (newNode->isValid () && newNode->isLeaf ());
 
-        if (!mTNByID.peekMap().emplace (newNodeID, newNode).second)
-            assert (false);
-
-        node->setChildHash (b2, newNode->getNodeHash ());
+        node->setChild (b2, newNode->getNodeHash (), newNode);
         trackNewNode (newNode, newNodeID);
     }
 
-    dirtyUp (stack, tag, node->getNodeHash ());
+    dirtyUp (stack, tag, node);
     return true;
 }
 
@@ -901,41 +781,200 @@ bool SHAMap::updateGiveItem (SHAMapItem::ref item, bool isTransaction, bool hasM
         return true;
     }
 
-    dirtyUp (stack, tag, node->getNodeHash ());
+    dirtyUp (stack, tag, node);
     return true;
 }
 
-void SHAMapItem::dump ()
+// Find the end of the run of items on the same branch as the first
+template <class Iterator>
+static Iterator
+endOfBranch (SHAMapNodeID const& nodeID, int branch,
+    Iterator first, Iterator last)
 {
-    WriteLog (lsINFO, SHAMap) << "SHAMapItem(" << mTag << ") " << mData.size () << "bytes";
+    while ((first != last) && (nodeID.selectBranch ((*first)->getTag ()) == branch))
+        ++first;
+
+    return first;
 }
 
-SHAMapTreeNode::pointer SHAMap::fetchNodeExternal (const SHAMapNodeID& id, uint256 const& hash)
+bool SHAMap::updateGiveItems (std::vector <SHAMapItem::pointer> const& items,
+    bool isTransaction, bool hasMeta)
 {
-    SHAMapTreeNode::pointer ret = fetchNodeExternalNT (id, hash);
+    assert (std::is_sorted (items.begin (), items.end (),
+        [] (SHAMapItem::ref a, SHAMapItem::ref b)
+        {
+            return a->getTag () < b->getTag ();
+        }));
 
-    if (!ret)
-        throw (SHAMapMissingNode (mType, id, hash));
+    SHAMapTreeNode::TNType const type = !isTransaction ?
+        SHAMapTreeNode::tnACCOUNT_STATE : (hasMeta ?
+            SHAMapTreeNode::tnTRANSACTION_MD : SHAMapTreeNode::tnTRANSACTION_NM);
 
-    return ret;
+    ScopedWriteLockType sl (mLock);
+    assert (mState != smsImmutable);
+
+    if (items.empty ())
+        return true;
+
+    SHAMapNodeID const rootID;
+    std::vector <SHAMapNodeID> dirty;
+    std::size_t missing = 0;
+
+    if (root->isLeaf ())
+    {
+        root = updateItemsBelow (root, rootID, items.begin (), items.end (),
+            type, dirty, missing);
+    }
+    else
+    {
+        if (root->getSeq () != mSeq)
+        {
+            root = std::make_shared <SHAMapTreeNode> (*root, mSeq);
+            dirty.push_back (rootID);
+        }
+
+        struct Subtree
+        {
+            int branch;
+            SHAMapNodeID nodeID;
+            SHAMapTreeNode::pointer node;
+            ItemIterator first;
+            ItemIterator last;
+            std::vector <SHAMapNodeID> dirty;
+            std::size_t missing;
+        };
+
+        std::vector <Subtree> subtrees;
+
+        for (auto first = items.begin (); first != items.end ();)
+        {
+            int const branch = rootID.selectBranch ((*first)->getTag ());
+            auto const last = endOfBranch (rootID, branch, first, items.end ());
+
+            if (root->isEmptyBranch (branch))
+            {
+                missing += last - first;
+            }
+            else
+            {
+                SHAMapNodeID const childID = rootID.getChildNodeID (branch);
+                subtrees.push_back ({ branch, childID,
+                    descend (root, childID, branch), first, last, {}, 0 });
+            }
+
+            first = last;
+        }
+
+        // The subtrees below the root share no nodes
+        WorkerPool::forEach (subtrees.size (), [&] (std::size_t i)
+        {
+            Subtree& subtree (subtrees[i]);
+            subtree.node = updateItemsBelow (subtree.node, subtree.nodeID,
+                subtree.first, subtree.last, type, subtree.dirty,
+                subtree.missing);
+        });
+
+        std::array <SHAMapTreeNode::pointer, 16> children;
+        for (auto const& subtree : subtrees)
+        {
+            children[subtree.branch] = subtree.node;
+            dirty.insert (dirty.end (), subtree.dirty.begin (),
+                subtree.dirty.end ());
+            missing += subtree.missing;
+        }
+
+        root->setChildren (children);
+    }
+
+    if (mDirtyNodes)
+        mDirtyNodes->insert (dirty.begin (), dirty.end ());
+
+    if (missing != 0)
+    {
+        WriteLog (lsWARNING, SHAMap) << missing <<
+            " items to update were not in the map";
+        return false;
+    }
+
+    return true;
+}
+
+SHAMapTreeNode::pointer
+SHAMap::updateItemsBelow (SHAMapTreeNode::pointer node,
+    SHAMapNodeID const& nodeID, ItemIterator first, ItemIterator last,
+    SHAMapTreeNode::TNType type, std::vector <SHAMapNodeID>& dirty,
+    std::size_t& missing)
+{
+    // Copy on write, as returnNode does
+    if (node->getSeq () != mSeq)
+    {
+        assert (node->getSeq () < mSeq);
+        node = std::make_shared <SHAMapTreeNode> (*node, mSeq);
+        dirty.push_back (nodeID);
+    }
+
+    if (node->isLeaf ())
+    {
+        for (; first != last; ++first)
+        {
+            if (node->peekItem ()->getTag () == (*first)->getTag ())
+                node->setItem (*first, type);
+            else
+                ++missing;
+        }
+
+        return node;
+    }
+
+    std::array <SHAMapTreeNode::pointer, 16> children;
+
+    while (first != last)
+    {
+        int const branch = nodeID.selectBranch ((*first)->getTag ());
+        auto const end = endOfBranch (nodeID, branch, first, last);
+
+        if (node->isEmptyBranch (branch))
+        {
+            missing += end - first;
+        }
+        else
+        {
+            SHAMapNodeID const childID = nodeID.getChildNodeID (branch);
+            children[branch] = updateItemsBelow (descend (node, childID, branch),
+                childID, first, end, type, dirty, missing);
+        }
+
+        first = end;
+    }
+
+    node->setChildren (children);
+    return node;
+}
+
+void SHAMapItem::dump ()
+{
+    WriteLog (lsINFO, SHAMap) << "SHAMapItem(" << mTag << ") " << mData.size () << "bytes";
 }
 
 // Non-blocking version
-SHAMapTreeNode* SHAMap::getNodeAsync (
-    const SHAMapNodeID& id,
-    uint256 const& hash,
+SHAMapTreeNode* SHAMap::descendAsync (
+    SHAMapTreeNode* parent,
+    SHAMapNodeID const& childID,
+    int branch,
     SHAMapSyncFilter *filter,
     bool& pending)
 {
     pending = false;
 
-    // If the node is in mTNByID, return it
-    SHAMapTreeNode::pointer ptr = mTNByID.retrieve (id);
-    if (ptr)
-        return ptr.get ();
+    // If the node is already hooked up, return it
+    SHAMapTreeNode* ret = parent->getChildPointer (branch);
+    if (ret)
+        return ret;
+
+    uint256 const& hash = parent->getChildHash (branch);
 
     // Try the tree node cache
-    ptr = getCache (hash);
+    SHAMapTreeNode::pointer ptr = getCache (hash);
 
     if (!ptr)
     {
@@ -944,68 +983,76 @@ SHAMapTreeNode* SHAMap::getNodeAsync (
         if (filter)
         {
             Blob nodeData;
-            if (filter->haveNode (id, hash, nodeData))
+            if (filter->haveNode (childID, hash, nodeData))
             {
                 ptr = std::make_shared <SHAMapTreeNode> (
                     nodeData, 0, snfPREFIX, hash, true);
-                filter->gotNode (true, id, hash, nodeData, ptr->getType ());
+                filter->gotNode (true, childID, hash, nodeData, ptr->getType ());
             }
         }
 
-        if (!ptr)
+        if (ptr)
         {
-            if (mTXMap)
-            {
-                // We don't store proposed transaction nodes in the node store
+            // Put it in the tree node cache
+            canonicalize (hash, ptr);
+        }
+        else
+        {
+            // We don't store proposed transaction nodes in the node store
+            NodeStore::Database* const nodeStore = getNodeStore ();
+            if (mTXMap || !nodeStore)
                 return nullptr;
-            }
 
+            // Otherwise the caller reads this node in its next batch,
+            // unless the node store's caches already have the answer.
             NodeObject::pointer obj;
-
-            if (!getApp().getNodeStore().asyncFetch (hash, obj))
-            { // We would have to block
+            if (!nodeStore->fetchCached (hash, obj))
+            {
                 pending = true;
-                assert (!obj);
                 return nullptr;
             }
 
+            // A node known to be missing is reported without waiting
             if (!obj)
                 return nullptr;
 
-            ptr = std::make_shared <SHAMapTreeNode> (obj->getData(), 0,
-                                                     snfPREFIX, hash, true);
+            ptr = nodeFromObject (obj, hash);
+            if (!ptr)
+                return nullptr;
         }
-
-        // Put it in the tree node cache
-        canonicalize (hash, ptr);
-    }
-
-    if (id.isRoot ())
-    {
-        // It is legal to replace the root
-        mTNByID.replace (id, ptr);
-        root = ptr;
     }
-    else
-        mTNByID.canonicalize (id, &ptr);
 
+    parent->canonicalizeChild (branch, ptr);
     return ptr.get ();
 }
 
+/** Return the node store to read missing nodes from. This allows us to
+    use the SHAMap in unit tests: unless one was set with setNodeStore, we
+    don't fetch external nodes if we're not running in the application.
+*/
+NodeStore::Database* SHAMap::getNodeStore () const
+{
+    if (mNodeStore)
+        return mNodeStore;
+
+    if (!getApp().running ())
+        return nullptr;
+
+    return &getApp().getNodeStore ();
+}
+
 /** Look at the cache and back end (things external to this SHAMap) to
-    find a tree node. Only a read lock is required because mTNByID has its
-    own, internal synchronization. Every thread calling this function must
-    get a shared pointer to the same underlying node.
-    This function does not throw.
+    find a tree node. Only a read lock is required because the caller
+    hooks the node with SHAMapTreeNode::canonicalizeChild, which has its
+    own, internal synchronization. This function does not throw.
 */
 SHAMapTreeNode::pointer
-SHAMap::fetchNodeExternalNT (const SHAMapNodeID& id, uint256 const& hash)
+SHAMap::fetchNodeExternalNT (uint256 const& hash)
 {
     SHAMapTreeNode::pointer ret;
 
-    // This if allows us to use the SHAMap in unit tests.  So we don't attempt
-    // to fetch external nodes if we're not running in the application.
-    if (!getApp().running ())
+    NodeStore::Database* const nodeStore = getNodeStore ();
+    if (!nodeStore)
         return ret;
 
     // Check the cache of shared, immutable tree nodes
@@ -1016,7 +1063,7 @@ SHAMap::fetchNodeExternalNT (const SHAMapNodeID& id, uint256 const& hash)
     }
     else
     { // Check the back end
-        NodeObject::pointer obj (getApp ().getNodeStore ().fetch (hash));
+        NodeObject::pointer obj (nodeStore->fetch (hash));
         if (!obj)
         {
             if (mLedgerSeq != 0)
@@ -1028,36 +1075,42 @@ SHAMap::fetchNodeExternalNT (const SHAMapNodeID& id, uint256 const& hash)
             return ret;
         }
 
-        try
-        {
-            // We make this node immutable (seq == 0) so that it can be shared
-            // CoW is needed if it is modified
-            ret = std::make_shared<SHAMapTreeNode> (obj->getData (), 0, snfPREFIX, hash, true);
+        ret = nodeFromObject (obj, hash);
+    }
 
-            if (ret->getNodeHash () != hash)
-            {
-                WriteLog (lsFATAL, SHAMap) << "Hashes don't match";
-                assert (false);
-                return SHAMapTreeNode::pointer ();
-            }
+    return ret;
+}
 
-            // Share this immutable tree node in the TreeNodeCache
-            canonicalize (hash, ret);
-        }
-        catch (...)
+/** Build a shareable tree node from a node store object, and put it in the
+    TreeNodeCache. Returns null if the object does not hold a valid node.
+*/
+SHAMapTreeNode::pointer
+SHAMap::nodeFromObject (NodeObject::ref obj, uint256 const& hash)
+{
+    SHAMapTreeNode::pointer ret;
+
+    try
+    {
+        // We make this node immutable (seq == 0) so that it can be shared
+        // CoW is needed if it is modified
+        ret = std::make_shared<SHAMapTreeNode> (obj->getData (), 0, snfPREFIX, hash, true);
+
+        if (ret->getNodeHash () != hash)
         {
-            WriteLog (lsWARNING, SHAMap) << "fetchNodeExternal gets an invalid node: " << hash;
+            WriteLog (lsFATAL, SHAMap) << "Hashes don't match";
+            assert (false);
             return SHAMapTreeNode::pointer ();
         }
-    }
 
-    if (id.isRoot ()) // it is legal to replace an existing root
+        // Share this immutable tree node in the TreeNodeCache
+        canonicalize (hash, ret);
+    }
+    catch (...)
     {
-        mTNByID.replace(id, ret);
-        root = ret;
+        WriteLog (lsWARNING, SHAMap) << "fetchNodeExternal gets an invalid node: " << hash;
+        return SHAMapTreeNode::pointer ();
     }
-    else // Make sure other threads get pointers to the same underlying object
-       mTNByID.canonicalize (id, &ret);
+
     return ret;
 }
 
@@ -1076,7 +1129,7 @@ bool SHAMap::fetchRoot (uint256 const& hash, SHAMapSyncFilter* filter)
             WriteLog (lsTRACE, SHAMap) << "Fetch root SHAMap node " << hash;
     }
 
-    SHAMapTreeNode::pointer newRoot = fetchNodeExternalNT(SHAMapNodeID(), hash);
+    SHAMapTreeNode::pointer newRoot = fetchNodeExternalNT (hash);
 
     if (newRoot)
     {
@@ -1094,8 +1147,6 @@ bool SHAMap::fetchRoot (uint256 const& hash, SHAMapSyncFilter* filter)
         filter->gotNode (true, SHAMapNodeID (), hash, nodeData, root->getType ());
     }
 
-    mTNByID.replace(SHAMapNodeID (), root);
-
     assert (root->getNodeHash () == hash);
     return true;
 }
@@ -1119,7 +1170,9 @@ SHAMap::flushDirty (DirtySet& set, int maxNodes, NodeObjectType t, std::uint32_t
     for (DirtySet::iterator it = set.begin (); it != set.end (); it = set.erase (it))
     {
         SHAMapNodeID nodeID = *it;
-        SHAMapTreeNode::pointer node = checkCacheNode (nodeID);
+
+        // Modified nodes are always linked from the root
+        SHAMapTreeNode* node = getNodePointerNoFetch (nodeID);
 
         // Check if node was deleted
         if (!node)
@@ -1145,10 +1198,12 @@ SHAMap::flushDirty (DirtySet& set, int maxNodes, NodeObjectType t, std::uint32_t
         if (node->getSeq () != 0)
         {
             // Node is not shareable
-            // Make and share a shareable copy
-            node = std::make_shared <SHAMapTreeNode> (*node, 0);
-            canonicalize (node->getNodeHash(), node);
-            mTNByID.replace (nodeID, node);
+            // Share a copy without child pointers, so the TreeNodeCache
+            // never links to nodes this map may still modify
+            SHAMapTreeNode::pointer copy =
+                std::make_shared <SHAMapTreeNode> (*node, 0);
+            copy->dropChildren ();
+            canonicalize (nodeHash, copy);
         }
 
         getApp().getNodeStore ().store (t, seq, std::move (s.modData ()), nodeHash);
@@ -1170,56 +1225,45 @@ std::shared_ptr<SHAMap::DirtySet> SHAMap::disarmDirty ()
     return ret;
 }
 
-SHAMapTreeNode::pointer SHAMap::getNode (const SHAMapNodeID& nodeID)
+// This function returns NULL if no node with that ID exists in the map
+// It throws if the map is incomplete
+SHAMapTreeNode* SHAMap::getNodePointer (const SHAMapNodeID& nodeID)
 {
-
-    SHAMapTreeNode::pointer node = checkCacheNode (nodeID);
-
-    if (node)
-        return node;
-
-    node = root;
+    SHAMapTreeNode* node = root.get();
     SHAMapNodeID currentID;
     while (nodeID != currentID)
     {
+        if (node->isLeaf ())
+            return nullptr;
+
         int branch = currentID.selectBranch (nodeID.getNodeID ());
         assert (branch >= 0);
-        uint256 currentHash;
-        if (!node->descend (branch, currentID, currentHash))
-            return SHAMapTreeNode::pointer ();
-        node = getNode (currentID, currentHash, false);
-        assert (node);
+
+        if (node->isEmptyBranch (branch))
+            return nullptr;
+
+        currentID = currentID.getChildNodeID (branch);
+        node = descendThrow (node, currentID, branch);
     }
 
     return node;
 }
 
-// This function returns NULL if no node with that ID exists in the map
-// It throws if the map is incomplete
-SHAMapTreeNode* SHAMap::getNodePointer (const SHAMapNodeID& nodeID)
+// Like getNodePointer, but only follows nodes that are already in memory
+SHAMapTreeNode* SHAMap::getNodePointerNoFetch (const SHAMapNodeID& nodeID)
 {
-    SHAMapTreeNode::pointer nodeptr = mTNByID.retrieve (nodeID);
-    if (nodeptr)
-    {
-        SHAMapTreeNode* ret = nodeptr.get ();
-        ret->touch(mSeq);
-        return ret;
-    }
-
     SHAMapTreeNode* node = root.get();
     SHAMapNodeID currentID;
-    while (nodeID != currentID)
+    while (node && (nodeID != currentID))
     {
         if (node->isLeaf ())
             return nullptr;
 
         int branch = currentID.selectBranch (nodeID.getNodeID ());
         assert (branch >= 0);
-        uint256 currentHash;
-        if (!node->descend (branch, currentID, currentHash))
-            return nullptr;
-        node = getNodePointer (currentID, currentHash);
-        assert (node);
+
+        currentID = currentID.getChildNodeID (branch);
+        node = node->getChildPointer (branch);
     }
 
     return node;
@@ -1241,12 +1285,11 @@ bool SHAMap::getPath (uint256 const& index, std::vector< Blob >& nodes, SHANodeF
         nodes.push_back (s.peekData ());
 
         int branch = nodeID.selectBranch (index);
-        uint256 nodeHash;
-        if (!inNode->descend (branch, nodeID, nodeHash)) // paths leads to empty branch
+        if (inNode->isEmptyBranch (branch)) // paths leads to empty branch
             return false;
 
-        inNode = getNodePointer (nodeID, nodeHash);
-        assert (inNode);
+        nodeID = nodeID.getChildNodeID (branch);
+        inNode = descendThrow (inNode, nodeID, branch);
     }
 
     if (inNode->getTag () != index) // path leads to different leaf
@@ -1264,22 +1307,41 @@ void SHAMap::dropCache ()
     ScopedWriteLockType sl (mLock);
     assert (mState == smsImmutable);
 
-    mTNByID.clear ();
-
-    if (root)
-        mTNByID.canonicalize(SHAMapNodeID{}, &root);
+    // Unlink the root from its children so the rest of the tree can be
+    // released. Nodes will be fetched again as they are needed.
+    if (root && root->isInner ())
+    {
+        root = std::make_shared<SHAMapTreeNode> (*root, root->getSeq ());
+        root->dropChildren ();
+    }
 }
 
-void SHAMap::dropBelow (SHAMapTreeNode* d, SHAMapNodeID nodeID)
+std::size_t SHAMap::size () const
 {
-    if (d->isInner ())
+    ScopedReadLockType sl (mLock);
+
+    std::size_t count = 0;
+    std::stack<SHAMapTreeNode*> stack;
+    stack.push (root.get ());
+
+    while (!stack.empty ())
     {
-        for (int i = 0 ; i < 16; ++i)
+        SHAMapTreeNode* node = stack.top ();
+        stack.pop ();
+        ++count;
+
+        if (node->isInner ())
         {
-            if (!d->isEmptyBranch (i))
-                mTNByID.erase (nodeID.getChildNodeID (i));
+            for (int i = 0; i < 16; ++i)
+            {
+                SHAMapTreeNode* child = node->getChildPointer (i);
+                if (child)
+                    stack.push (child);
+            }
         }
     }
+
+    return count;
 }
 
 void SHAMap::dump (bool hash)
@@ -1287,12 +1349,29 @@ void SHAMap::dump (bool hash)
     WriteLog (lsINFO, SHAMap) << " MAP Contains";
     ScopedWriteLockType sl (mLock);
 
-    for (auto const& p : mTNByID.peekMap())
+    std::stack<std::pair<SHAMapTreeNode*, SHAMapNodeID>> stack;
+    stack.push ({root.get (), SHAMapNodeID ()});
+
+    while (!stack.empty ())
     {
-        WriteLog (lsINFO, SHAMap) << p.second->getString (p.first);
-        CondLog (hash, lsINFO, SHAMap) << p.second->getNodeHash ();
-    }
+        SHAMapTreeNode* node;
+        SHAMapNodeID nodeID;
+        std::tie (node, nodeID) = stack.top ();
+        stack.pop ();
+
+        WriteLog (lsINFO, SHAMap) << node->getString (nodeID);
+        CondLog (hash, lsINFO, SHAMap) << node->getNodeHash ();
 
+        if (node->isInner ())
+        {
+            for (int i = 0; i < 16; ++i)
+            {
+                SHAMapTreeNode* child = node->getChildPointer (i);
+                if (child)
+                    stack.push ({child, nodeID.getChildNodeID (i)});
+            }
+        }
+    }
 }
 
 SHAMapTreeNode::pointer SHAMap::getCache (uint256 const& hash)
@@ -1401,6 +1480,91 @@ public:
         unexpected (sMap.getHash () == mapHash, "bad snapshot");
 
         unexpected (map2->getHash () != mapHash, "bad snapshot");
+
+        testcase ("mutable snapshot");
+
+        mapHash = sMap.getHash ();
+        SHAMap::pointer map3 = sMap.snapShot (true);
+
+        unexpected (!map3->addItem (i2, true, false), "no add");
+
+        unexpected (sMap.getHash () != mapHash, "snapshot changed source");
+
+        unexpected (map3->getHash () == mapHash, "bad snapshot");
+
+        unexpected (!sMap.addItem (i5, true, false), "no add");
+
+        unexpected (map3->hasItem (i5.getTag ()), "source changed snapshot");
+
+        unexpected (!sMap.hasItem (i5.getTag ()), "bad mod");
+
+        unexpected (sMap.hasItem (i2.getTag ()), "snapshot changed source");
+
+        testBatchUpdate ();
+    }
+
+    void testBatchUpdate ()
+    {
+        testcase ("batch update");
+
+        beast::manual_clock <std::chrono::seconds> clock;
+        beast::Journal const j;
+
+        FullBelowCache fullBelowCache ("test.full_below", clock);
+        TreeNodeCache treeNodeCache ("test.tree_node_cache", 65536, 60, clock, j);
+
+        SHAMap source (smtFREE, fullBelowCache, treeNodeCache);
+        std::vector <uint256> tags;
+
+        for (int i = 0; i < 2000; ++i)
+        {
+            Serializer s;
+            s.add32 (i);
+            tags.push_back (s.getSHA512Half ());
+            source.addItem (SHAMapItem (tags.back (), IntToVUC (i)), true, false);
+        }
+
+        std::sort (tags.begin (), tags.end ());
+        uint256 const sourceHash = source.getHash ();
+
+        SHAMap::pointer serial = source.snapShot (true);
+        SHAMap::pointer batch = source.snapShot (true);
+        std::vector <SHAMapItem::pointer> items;
+
+        for (std::size_t i = 0; i < tags.size (); i += 3)
+        {
+            items.push_back (std::make_shared <SHAMapItem> (
+                tags[i], IntToVUC (static_cast <int> (i) + 7)));
+            serial->updateGiveItem (std::make_shared <SHAMapItem> (
+                tags[i], IntToVUC (static_cast <int> (i) + 7)), true, false);
+        }
+
+        expect (batch->updateGiveItems (items, true, false), "batch failed");
+
+        unexpected (batch->getHash () != serial->getHash (), "bad batch hash");
+        unexpected (source.getHash () != sourceHash, "batch changed source");
+        unexpected (*batch->peekItem (tags[3]) != *items[1], "bad batch item");
+
+        // Items that are not in the map are skipped, the rest still apply
+        uint256 absent (tags[4]);
+        absent.begin ()[31] ^= 1;
+
+        items.clear ();
+        items.push_back (std::make_shared <SHAMapItem> (uint256 (), IntToVUC (1)));
+        items.push_back (std::make_shared <SHAMapItem> (tags[1], IntToVUC (2)));
+        items.push_back (std::make_shared <SHAMapItem> (absent, IntToVUC (3)));
+        std::sort (items.begin (), items.end (),
+            [] (SHAMapItem::ref a, SHAMapItem::ref b)
+            {
+                return a->getTag () < b->getTag ();
+            });
+        serial->updateGiveItem (std::make_shared <SHAMapItem> (
+            tags[1], IntToVUC (2)), true, false);
+
+        expect (!batch->updateGiveItems (items, true, false),
+            "missing item not detected");
+        unexpected (batch->getHash () != serial->getHash (), "bad partial hash");
+        unexpected (batch->hasItem (absent), "missing item added");
     }
 };
 
@@ -60,6 +60,10 @@ struct hash <ripple::SHAMapNodeID> : std::hash <ripple::SHAMapNodeID>
 
 namespace ripple {
 
+namespace NodeStore {
+class Database;
+}
+
 enum SHAMapState
 {
     smsModifying = 0,       // Objects can be added and removed (like an open ledger)
@@ -104,11 +108,6 @@ private:
     };
 
 public:
-    enum
-    {
-        STATE_MAP_BUCKETS = 1024
-    };
-
     static char const* getCountedObjectName () { return "SHAMap"; }
 
     typedef std::shared_ptr<SHAMap> pointer;
@@ -117,7 +116,6 @@ public:
     typedef std::pair<SHAMapItem::pointer, SHAMapItem::pointer> DeltaItem;
     typedef std::pair<SHAMapItem::ref, SHAMapItem::ref> DeltaRef;
     typedef std::map<uint256, DeltaItem> Delta;
-    typedef hash_map<SHAMapNodeID, SHAMapTreeNode::pointer, SHAMapNode_hash> NodeMap;
     typedef hash_set<SHAMapNodeID, SHAMapNode_hash> DirtySet;
 
     typedef boost::shared_mutex LockType;
@@ -142,12 +140,15 @@ public:
 
     ~SHAMap ();
 
-    std::size_t size () const noexcept
-    {
-        return mTNByID.size ();
-    }
+    /** Returns the number of nodes held in memory.
+        Only the children already hooked into the tree are counted and
+        nothing is fetched. This walks the tree, so it takes time linear
+        in the number of nodes.
+    */
+    std::size_t size () const;
 
-    // Returns a new map that's a snapshot of this one. Force CoW
+    // Returns a new map that's a snapshot of this one. Shares all nodes
+    // and forces CoW in both maps, so this is a constant time operation.
     SHAMap::pointer snapShot (bool isMutable);
 
     // Remove nodes from memory
@@ -172,6 +173,16 @@ public:
 
     // save a copy if you have a temporary anyway
     bool updateGiveItem (SHAMapItem::ref, bool isTransaction, bool hasMeta);
+
+    /** Replace many existing items in one pass.
+        The items must be sorted by tag. Each inner node above them is
+        copied and rehashed only once, and the subtrees below the root
+        are updated in parallel on the shared WorkerPool.
+        @return `false` if some items were not in the map. Those items are
+                skipped and the others are still replaced.
+    */
+    bool updateGiveItems (std::vector <SHAMapItem::pointer> const& items,
+        bool isTransaction, bool hasMeta);
     bool addGiveItem (SHAMapItem::ref, bool isTransaction, bool hasMeta);
 
     // save a copy if you only need a temporary
@@ -190,7 +201,7 @@ public:
 
     // comparison/sync functions
     void getMissingNodes (std::vector<SHAMapNodeID>& nodeIDs, std::vector<uint256>& hashes, int max,
-                          SHAMapSyncFilter * filter);
+                          SHAMapSyncFilter * filter, int threads = 1);
     bool getNodeFat (SHAMapNodeID node, std::vector<SHAMapNodeID>& nodeIDs,
                      std::list<Blob >& rawNode, bool fatRoot, bool fatLeaves);
     bool getRootNode (Serializer & s, SHANodeFormat format);
@@ -247,14 +258,26 @@ public:
         mTXMap = true;
     }
 
+    /** Read nodes from this node store instead of the application's.
+        Missing nodes are then read even outside the application, as in
+        unit tests and benchmarks.
+    */
+    void setNodeStore (NodeStore::Database& nodeStore)
+    {
+        mNodeStore = &nodeStore;
+    }
+
 private:
     // trusted path operations - prove a particular node is in a particular ledger
     std::list<Blob > getTrustedPath (uint256 const& index);
 
-    SHAMapTreeNode::pointer fetchNodeExternal (const SHAMapNodeID & id,
-                                               uint256 const& hash); // throws
-    SHAMapTreeNode::pointer fetchNodeExternalNT (const SHAMapNodeID & id,
-                                                 uint256 const& hash); // no throw
+    // fetch a node from the TreeNodeCache or the node store
+    NodeStore::Database* getNodeStore () const;
+    SHAMapTreeNode::pointer fetchNodeExternalNT (uint256 const& hash);
+    std::vector <NodeObject::pointer> fetchBatchNT (
+        std::vector <uint256> const& hashes);
+    SHAMapTreeNode::pointer nodeFromObject (NodeObject::ref obj,
+        uint256 const& hash);
 
     bool getPath (uint256 const& index, std::vector< Blob >& nodes, SHANodeFormat format);
     void dump (bool withHashes = false);
@@ -263,34 +286,55 @@ private:
     SHAMapTreeNode::pointer getCache (uint256 const& hash);
     void canonicalize (uint256 const& hash, SHAMapTreeNode::pointer&);
 
+    typedef std::vector <SHAMapItem::pointer>::const_iterator ItemIterator;
+
+    SHAMapTreeNode::pointer updateItemsBelow (SHAMapTreeNode::pointer node,
+        SHAMapNodeID const& nodeID, ItemIterator first, ItemIterator last,
+        SHAMapTreeNode::TNType type, std::vector <SHAMapNodeID>& dirty,
+        std::size_t& missing);
+
     void dirtyUp (std::stack<std::pair<SHAMapTreeNode::pointer, SHAMapNodeID>>& stack,
-                  uint256 const& target, uint256 prevHash);
+                  uint256 const& target, SHAMapTreeNode::pointer terminal);
     std::stack<std::pair<SHAMapTreeNode::pointer, SHAMapNodeID>>
         getStack (uint256 const& id, bool include_nonmatching_leaf);
-    SHAMapTreeNode::pointer walkTo (uint256 const& id, bool modify);
     SHAMapTreeNode* walkToPointer (uint256 const& id);
-    SHAMapTreeNode::pointer checkCacheNode (const SHAMapNodeID&);
     void returnNode (SHAMapTreeNode::pointer&, SHAMapNodeID const& nodeID,
                                                                    bool modify);
     void trackNewNode (SHAMapTreeNode::pointer&, SHAMapNodeID const&);
 
-    SHAMapTreeNode::pointer getNode (const SHAMapNodeID & id);
-    SHAMapTreeNode::pointer getNode (const SHAMapNodeID & id, uint256 const& hash, bool modify);
+    // Find the node at a position in the map by walking down from the root
     SHAMapTreeNode* getNodePointer (const SHAMapNodeID & id);
-    SHAMapTreeNode* getNodePointer (const SHAMapNodeID & id, uint256 const& hash);
-    SHAMapTreeNode* getNodePointerNT (const SHAMapNodeID & id, uint256 const& hash);
-    SHAMapTreeNode* getNodePointer (const SHAMapNodeID & id, uint256 const& hash, SHAMapSyncFilter * filter);
-    SHAMapTreeNode* getNodePointerNT (const SHAMapNodeID & id, uint256 const& hash, SHAMapSyncFilter * filter);
+    SHAMapTreeNode* getNodePointerNoFetch (const SHAMapNodeID & id);
+
+    // Follow a child pointer, fetching and hooking the child if needed
+    SHAMapTreeNode::pointer descend (SHAMapTreeNode::ref parent,
+        SHAMapNodeID const& childID, int branch);
+    SHAMapTreeNode* descendThrow (SHAMapTreeNode* parent,
+        SHAMapNodeID const& childID, int branch);
+    SHAMapTreeNode* descendNT (SHAMapTreeNode* parent,
+        SHAMapNodeID const& childID, int branch,
+        SHAMapSyncFilter* filter = nullptr);
+
+    // Fetch the child without hooking it, so it isn't retained in memory
+    SHAMapTreeNode::pointer descendNoStore (SHAMapTreeNode::ref parent,
+        SHAMapNodeID const& childID, int branch);
+
+    struct MissingNodes;
+    void getMissingNodesBelow (SHAMapTreeNode* top, SHAMapNodeID const& topID,
+        MissingNodes& state, SHAMapSyncFilter* filter);
+    void getMissingNodesParallel (MissingNodes& state,
+        SHAMapSyncFilter* filter, int threads);
+
+    // Non-blocking version of descendNT. Sets pending if the node
+    // has to be read from the node store.
+    SHAMapTreeNode* descendAsync (SHAMapTreeNode* parent,
+        SHAMapNodeID const& childID, int branch,
+        SHAMapSyncFilter* filter, bool& pending);
+
     SHAMapTreeNode* firstBelow (SHAMapTreeNode*, SHAMapNodeID);
     SHAMapTreeNode* lastBelow (SHAMapTreeNode*, SHAMapNodeID);
 
-    // Non-blocking version of getNodePointerNT
-    SHAMapTreeNode* getNodeAsync (
-        const SHAMapNodeID & id, uint256 const& hash, SHAMapSyncFilter * filter, bool& pending);
-
     SHAMapItem::pointer onlyBelow (SHAMapTreeNode*, SHAMapNodeID);
-    void eraseChildren (SHAMapTreeNode::pointer, SHAMapNodeID);
-    void dropBelow (SHAMapTreeNode*, SHAMapNodeID);
     bool hasInnerNode (const SHAMapNodeID & nodeID, uint256 const& hash);
     bool hasLeafNode (uint256 const& tag, uint256 const& hash);
 
@@ -304,19 +348,19 @@ private:
 
     // This lock protects key SHAMap structures.
     // One may change anything with a write lock.
-    // With a read lock, one may not invalidate pointers to existing members of mTNByID
+    // With a read lock, one may only hook children onto existing nodes
     mutable LockType mLock;
 
     FullBelowCache& m_fullBelowCache;
     std::uint32_t mSeq;
     std::uint32_t mLedgerSeq; // sequence number of ledger this is part of
-    SyncUnorderedMapType< SHAMapNodeID, SHAMapTreeNode::pointer, SHAMapNode_hash > mTNByID;
     std::shared_ptr<DirtySet> mDirtyNodes;
     TreeNodeCache& mTreeNodeCache;
     SHAMapTreeNode::pointer root;
     SHAMapState mState;
     SHAMapType mType;
     bool mTXMap;       // Map of transactions without metadata
+    NodeStore::Database* mNodeStore;
     MissingNodeHandler m_missing_node_handler;
 };
 
@@ -35,10 +35,11 @@ class SHAMapDeltaNode
 {
 public:
     SHAMapNodeID mNodeID;
-    uint256 mOurHash, mOtherHash;
+    SHAMapTreeNode* mOurNode;
+    SHAMapTreeNode* mOtherNode;
 
-    SHAMapDeltaNode (const SHAMapNodeID& id, uint256 const& ourHash, uint256 const& otherHash) :
-        mNodeID (id), mOurHash (ourHash), mOtherHash (otherHash)
+    SHAMapDeltaNode (const SHAMapNodeID& id, SHAMapTreeNode* ourNode, SHAMapTreeNode* otherNode) :
+        mNodeID (id), mOurNode (ourNode), mOtherNode (otherNode)
     {
         ;
     }
@@ -62,13 +63,14 @@ bool SHAMap::walkBranch (SHAMapTreeNode* node, SHAMapNodeID nodeID,
         if (node->isInner ())
         {
             // This is an inner node, add all non-empty branches
-            uint256 childNodeHash;
             for (int i = 0; i < 16; ++i)
             {
-                SHAMapNodeID childNodeID = nodeID;
-                if (node->descend (i, childNodeID, childNodeHash))
-                    nodeStack.push ({getNodePointer (childNodeID, childNodeHash),
+                if (!node->isEmptyBranch (i))
+                {
+                    SHAMapNodeID childNodeID = nodeID.getChildNodeID (i);
+                    nodeStack.push ({descendThrow (node, childNodeID, i),
                                      childNodeID});
+                }
             }
         }
         else
@@ -147,16 +149,15 @@ bool SHAMap::compare (SHAMap::ref otherMap, Delta& differences, int maxCount)
     if (getHash () == otherMap->getHash ())
         return true;
 
-    nodeStack.push (SHAMapDeltaNode (SHAMapNodeID (), getHash (),
-                    otherMap->getHash ()));
+    nodeStack.push (SHAMapDeltaNode (SHAMapNodeID (), root.get (),
+                    otherMap->root.get ()));
     while (!nodeStack.empty ())
     {
         SHAMapDeltaNode dNode (nodeStack.top ());
         nodeStack.pop ();
 
-        SHAMapTreeNode* ourNode = getNodePointer (dNode.mNodeID, dNode.mOurHash);
-        SHAMapTreeNode* otherNode = otherMap->getNodePointer (dNode.mNodeID,
-                                                              dNode.mOtherHash);
+        SHAMapTreeNode* ourNode = dNode.mOurNode;
+        SHAMapTreeNode* otherNode = dNode.mOtherNode;
         if (!ourNode || !otherNode)
         {
             assert (false);
@@ -213,8 +214,8 @@ bool SHAMap::compare (SHAMap::ref otherMap, Delta& differences, int maxCount)
                     {
                         // We have a branch, the other tree does not
                         SHAMapNodeID childNodeID = dNode.mNodeID.getChildNodeID(i);
-                        SHAMapTreeNode* iNode = getNodePointer (childNodeID,
-                                                     ourNode->getChildHash (i));
+                        SHAMapTreeNode* iNode = descendThrow (ourNode,
+                                                              childNodeID, i);
                         if (!walkBranch (iNode, childNodeID,
                                          SHAMapItem::pointer (), true,
                                          differences, maxCount))
@@ -225,18 +226,19 @@ bool SHAMap::compare (SHAMap::ref otherMap, Delta& differences, int maxCount)
                         // The other tree has a branch, we do not
                         SHAMapNodeID childNodeID = dNode.mNodeID.getChildNodeID(i);
                         SHAMapTreeNode* iNode =
-                            otherMap->getNodePointer(childNodeID,
-                                                     otherNode->getChildHash (i));
+                            otherMap->descendThrow (otherNode, childNodeID, i);
                         if (!otherMap->walkBranch (iNode, childNodeID,
                                                    SHAMapItem::pointer(),
                                                    false, differences, maxCount))
                             return false;
                     }
                     else // The two trees have different non-empty branches
-                        nodeStack.push (SHAMapDeltaNode (
-                                               dNode.mNodeID.getChildNodeID (i),
-                                               ourNode->getChildHash (i),
-                                               otherNode->getChildHash (i)));
+                    {
+                        SHAMapNodeID childNodeID = dNode.mNodeID.getChildNodeID(i);
+                        nodeStack.push (SHAMapDeltaNode (childNodeID,
+                            descendThrow (ourNode, childNodeID, i),
+                            otherMap->descendThrow (otherNode, childNodeID, i)));
+                    }
                 }
         }
         else
@@ -248,41 +250,38 @@ bool SHAMap::compare (SHAMap::ref otherMap, Delta& differences, int maxCount)
 
 void SHAMap::walkMap (std::vector<SHAMapMissingNode>& missingNodes, int maxMissing)
 {
-    std::stack<std::pair<SHAMapTreeNode::pointer, SHAMapNodeID>> nodeStack;
+    std::stack<std::pair<SHAMapTreeNode*, SHAMapNodeID>> nodeStack;
 
     ScopedReadLockType sl (mLock);
 
     if (!root->isInner ())  // root is only node, and we have it
         return;
 
-    nodeStack.push ({root, SHAMapNodeID{}});
+    nodeStack.push ({root.get (), SHAMapNodeID{}});
 
     while (!nodeStack.empty ())
     {
-        SHAMapTreeNode::pointer node;
+        SHAMapTreeNode* node;
         SHAMapNodeID nodeID;
         std::tie(node, nodeID) = nodeStack.top ();
         nodeStack.pop ();
-        uint256 childNodeHash;
         for (int i = 0; i < 16; ++i)
         {
-            SHAMapNodeID childNodeID = nodeID;
-            if (node->descend (i, childNodeID, childNodeHash))
+            if (!node->isEmptyBranch (i))
             {
-                try
-                {
-                    SHAMapTreeNode::pointer d = getNode(childNodeID,
-                                                        childNodeHash, false);
-                    if (d->isInner ())
-                        nodeStack.push ({d, childNodeID});
-                }
-                catch (SHAMapMissingNode& n)
+                SHAMapNodeID childNodeID = nodeID.getChildNodeID (i);
+                SHAMapTreeNode* d = descendNT (node, childNodeID, i);
+
+                if (!d)
                 {
-                    missingNodes.push_back (n);
+                    missingNodes.emplace_back (mType, childNodeID,
+                                               node->getChildHash (i));
 
                     if (--maxMissing <= 0)
                         return;
                 }
+                else if (d->isInner ())
+                    nodeStack.push ({d, childNodeID});
             }
         }
     }
@@ -21,8 +21,11 @@
 */
 //==============================================================================
 
+#include <ripple/core/WorkerPool.h>
 #include <ripple/nodestore/Database.h>
 #include <beast/unit_test/suite.h>
+#include <atomic>
+#include <mutex>
 
 namespace ripple {
 
@@ -50,8 +53,10 @@ void SHAMap::visitLeavesInternal (std::function<void (SHAMapItem::ref item)>& fu
         return;
     }
 
-    std::stack<std::tuple<int, SHAMapTreeNode*, SHAMapNodeID>> stack;
-    SHAMapTreeNode* node = root.get ();
+    // Children that are not already in memory are not hooked up, so
+    // visiting a large map doesn't leave the whole tree in memory
+    std::stack<std::tuple<int, SHAMapTreeNode::pointer, SHAMapNodeID>> stack;
+    SHAMapTreeNode::pointer node = root;
     SHAMapNodeID nodeID;
     int pos = 0;
 
@@ -59,15 +64,14 @@ void SHAMap::visitLeavesInternal (std::function<void (SHAMapItem::ref item)>& fu
     {
         while (pos < 16)
         {
-            SHAMapNodeID childID = nodeID;
-            uint256 childHash;
-            if (node->descend (pos, childID, childHash))
+            if (!node->isEmptyBranch (pos))
             {
-                SHAMapTreeNode* child = getNodePointer (childID, childHash);
+                SHAMapNodeID childID = nodeID.getChildNodeID (pos);
+                SHAMapTreeNode::pointer child = descendNoStore (node,
+                                                                childID, pos);
                 if (child->isLeaf ())
                 {
                     function (child->peekItem ());
-                    mTNByID.erase (childID); // don't need this leaf anymore
                     ++pos;
                 }
                 else
@@ -81,8 +85,6 @@ void SHAMap::visitLeavesInternal (std::function<void (SHAMapItem::ref item)>& fu
                         // save next position to resume at
                         stack.push (std::make_tuple(pos + 1, node, nodeID));
                     }
-                    else
-                        mTNByID.erase (nodeID); // don't need this inner node anymore
 
                     // descend to the child's first position
                     node = child;
@@ -97,7 +99,6 @@ void SHAMap::visitLeavesInternal (std::function<void (SHAMapItem::ref item)>& fu
         }
 
         // We are done with this inner node
-        mTNByID.erase (nodeID);
 
         if (stack.empty ())
             break;
@@ -107,12 +108,76 @@ void SHAMap::visitLeavesInternal (std::function<void (SHAMapItem::ref item)>& fu
     }
 }
 
+/** State shared by the threads looking for missing nodes. */
+struct SHAMap::MissingNodes
+{
+    MissingNodes (std::vector<SHAMapNodeID>& nodeIDs_,
+                  std::vector<uint256>& hashes_, int max_, int maxDefer_)
+        : nodeIDs (nodeIDs_)
+        , hashes (hashes_)
+        , max (max_)
+        , maxDefer (maxDefer_)
+        , finished (false)
+    {
+    }
+
+    /** Record a missing node.
+        @return `false` once we have found as many nodes as were asked for.
+    */
+    bool add (SHAMapNodeID const& nodeID, uint256 const& hash)
+    {
+        std::lock_guard <std::mutex> lock (mutex);
+
+        if (max <= 0)
+        {
+            finished = true;
+            return false;
+        }
+
+        if (missingHashes.insert (hash).second)
+        {
+            nodeIDs.push_back (nodeID);
+            hashes.push_back (hash);
+
+            if (--max <= 0)
+            {
+                finished = true;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /** Returns `true` if a node is already known to be missing. */
+    bool isMissing (uint256 const& hash)
+    {
+        std::lock_guard <std::mutex> lock (mutex);
+        return missingHashes.count (hash) != 0;
+    }
+
+    std::mutex mutex;
+    std::vector<SHAMapNodeID>& nodeIDs;
+    std::vector<uint256>& hashes;
+
+    // Track the missing hashes we have found so far
+    std::set <uint256> missingHashes;
+    int max;
+
+    int const maxDefer;
+    std::atomic <bool> finished;
+};
+
 /** Get a list of node IDs and hashes for nodes that are part of this SHAMap
     but not available locally.  The filter can hold alternate sources of
     nodes that are not permanently stored locally
+
+    If threads is greater than one, the subtrees below the root are walked
+    concurrently. Each walker reads its deferred nodes in batches, so disk
+    reads on one branch overlap with hashing and traversal on the others.
 */
 void SHAMap::getMissingNodes (std::vector<SHAMapNodeID>& nodeIDs, std::vector<uint256>& hashes, int max,
-                              SHAMapSyncFilter* filter)
+                              SHAMapSyncFilter* filter, int threads)
 {
     ScopedReadLockType sl (mLock);
 
@@ -132,23 +197,50 @@ void SHAMap::getMissingNodes (std::vector<SHAMapNodeID>& nodeIDs, std::vector<ui
         return;
     }
 
-    int const maxDefer = getApp().getNodeStore().getDesiredAsyncReadCount ();
+    NodeStore::Database* const nodeStore = getNodeStore ();
+    MissingNodes state (nodeIDs, hashes, max,
+        nodeStore ? nodeStore->getDesiredAsyncReadCount () : max);
 
-    // Track the missing hashes we have found so far
-    std::set <uint256> missingHashes;
+    if (threads > 1)
+        getMissingNodesParallel (state, filter, threads);
+    else
+        getMissingNodesBelow (root.get (), SHAMapNodeID (), state, filter);
 
+    if (nodeIDs.empty ())
+        clearSynching ();
+}
 
-    while (1)
+/** Read a batch of nodes from the node store. Like fetchNodeExternalNT,
+    this finds nothing when there is no node store to read from.
+*/
+std::vector <NodeObject::pointer>
+SHAMap::fetchBatchNT (std::vector <uint256> const& hashes)
+{
+    NodeStore::Database* const nodeStore = getNodeStore ();
+    if (!nodeStore)
+        return std::vector <NodeObject::pointer> (hashes.size ());
+
+    return nodeStore->fetchBatch (hashes);
+}
+
+/** Walk the subtree below a node, looking for missing nodes. Nodes which
+    have to come from the node store are deferred and read in one batch.
+*/
+void SHAMap::getMissingNodesBelow (SHAMapTreeNode* top,
+    SHAMapNodeID const& topID, MissingNodes& state, SHAMapSyncFilter* filter)
+{
+    while (!state.finished)
     {
-        std::vector <std::pair <SHAMapNodeID, uint256>> deferredReads;
-        deferredReads.reserve (maxDefer + 16);
+        std::vector <std::tuple <SHAMapTreeNode*, SHAMapNodeID, int>>
+                                                                  deferredReads;
+        deferredReads.reserve (state.maxDefer + 16);
 
         std::stack <std::tuple<SHAMapTreeNode*, SHAMapNodeID, int, int, bool>>
                                                                           stack;
         // Traverse the map without blocking
 
-        SHAMapTreeNode *node = root.get ();
-        SHAMapNodeID nodeID;
+        SHAMapTreeNode *node = top;
+        SHAMapNodeID nodeID = topID;
 
         // The firstChild value is selected randomly so if multiple threads
         // are traversing the map, each thread will start at a different
@@ -172,25 +264,19 @@ void SHAMap::getMissingNodes (std::vector<SHAMapNodeID>& nodeIDs, std::vector<ui
                     {
                         SHAMapNodeID childID = nodeID.getChildNodeID (branch);
                         bool pending = false;
-                        SHAMapTreeNode* d = getNodeAsync (childID, childHash, filter, pending);
+                        SHAMapTreeNode* d = descendAsync (node, childID, branch, filter, pending);
 
                         if (!d)
                         {
-                            if (!pending)
+                            if (!pending || state.isMissing (childHash))
                             { // node is not in the database
-                                if (missingHashes.insert (childHash).second)
-                                {
-                                    nodeIDs.push_back (childID);
-                                    hashes.push_back (childHash);
-
-                                    if (--max <= 0)
-                                        return;
-                                }
+                                if (!state.add (childID, childHash))
+                                    return;
                             }
                             else
                             {
                                 // read is deferred
-                                deferredReads.emplace_back (childID, childHash);
+                                deferredReads.emplace_back (node, childID, branch);
                             }
 
                             fullBelow = false; // This node is not known full below
@@ -231,34 +317,152 @@ void SHAMap::getMissingNodes (std::vector<SHAMapNodeID>& nodeIDs, std::vector<ui
             }
 
         }
-        while ((node != nullptr) && (deferredReads.size () <= maxDefer));
+        while ((node != nullptr) && (deferredReads.size () <= state.maxDefer));
 
         // If we didn't defer any reads, we're done
         if (deferredReads.empty ())
             break;
 
-        getApp().getNodeStore().waitReads();
+        // Read every deferred node from the node store in one batch
+        std::vector <uint256> deferredHashes;
+        deferredHashes.reserve (deferredReads.size ());
+        for (auto const& node : deferredReads)
+            deferredHashes.push_back (
+                std::get<0>(node)->getChildHash (std::get<2>(node)));
+
+        std::vector <NodeObject::pointer> const objects (
+            fetchBatchNT (deferredHashes));
 
         // Process all deferred reads
-        for (auto const& node : deferredReads)
+        for (std::size_t i = 0; i < deferredReads.size (); ++i)
         {
-            auto const& nodeID = node.first;
-            auto const& nodeHash = node.second;
-            SHAMapTreeNode* nodePtr = getNodePointerNT (nodeID, nodeHash, filter);
-            if (!nodePtr && missingHashes.insert (nodeHash).second)
+            auto parent = std::get<0>(deferredReads[i]);
+            auto const& nodeID = std::get<1>(deferredReads[i]);
+            auto branch = std::get<2>(deferredReads[i]);
+            auto const& nodeHash = deferredHashes[i];
+
+            SHAMapTreeNode::pointer nodePtr;
+            if (objects[i])
+                nodePtr = nodeFromObject (objects[i], nodeHash);
+
+            if (nodePtr)
             {
-                nodeIDs.push_back (nodeID);
-                hashes.push_back (nodeHash);
+                parent->canonicalizeChild (branch, nodePtr);
+            }
+            else if (!state.add (nodeID, nodeHash))
+            {
+                return;
+            }
+        }
+
+    }
+}
+
+/** Find missing nodes on up to `threads` threads of the shared WorkerPool,
+    one root branch at a time.
+*/
+void SHAMap::getMissingNodesParallel (MissingNodes& state,
+    SHAMapSyncFilter* filter, int threads)
+{
+    SHAMapTreeNode* const top = root.get ();
+    SHAMapNodeID const topID;
+
+    // Inner nodes directly below the root which still need to be walked
+    std::vector <std::pair <SHAMapTreeNode*, SHAMapNodeID>> subtrees;
+    std::vector <int> deferred;
+    bool fullBelow = true;
+
+    // Start at a random branch, for the same reason as the serial walk
+    int const firstChild = rand() % 16;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        int const branch = (firstChild + i) % 16;
+
+        if (top->isEmptyBranch (branch))
+            continue;
+
+        uint256 const& childHash = top->getChildHash (branch);
+
+        if (m_fullBelowCache.touch_if_exists (childHash))
+            continue;
+
+        SHAMapNodeID const childID = topID.getChildNodeID (branch);
+        bool pending = false;
+        SHAMapTreeNode* d = descendAsync (top, childID, branch, filter, pending);
+
+        if (d)
+        {
+            if (d->isInner () && !d->isFullBelow ())
+                subtrees.emplace_back (d, childID);
+        }
+        else if (pending && !state.isMissing (childHash))
+        {
+            deferred.push_back (branch);
+        }
+        else
+        {
+            fullBelow = false;
+            if (!state.add (childID, childHash))
+                return;
+        }
+    }
+
+    if (!deferred.empty ())
+    {
+        std::vector <uint256> deferredHashes;
+        deferredHashes.reserve (deferred.size ());
+        for (auto const branch : deferred)
+            deferredHashes.push_back (top->getChildHash (branch));
 
-                if (--max <= 0)
+        std::vector <NodeObject::pointer> const objects (
+            fetchBatchNT (deferredHashes));
+
+        for (std::size_t i = 0; i < deferred.size (); ++i)
+        {
+            SHAMapNodeID const childID = topID.getChildNodeID (deferred[i]);
+
+            SHAMapTreeNode::pointer nodePtr;
+            if (objects[i])
+                nodePtr = nodeFromObject (objects[i], deferredHashes[i]);
+
+            if (nodePtr)
+            {
+                top->canonicalizeChild (deferred[i], nodePtr);
+                if (nodePtr->isInner () && !nodePtr->isFullBelow ())
+                    subtrees.emplace_back (nodePtr.get (), childID);
+            }
+            else
+            {
+                fullBelow = false;
+                if (!state.add (childID, deferredHashes[i]))
                     return;
             }
         }
+    }
+
+    WorkerPool::forEach (subtrees.size (), [&] (std::size_t i)
+    {
+        if (!state.finished)
+            getMissingNodesBelow (subtrees[i].first, subtrees[i].second,
+                                  state, filter);
+    }, threads);
+
+    if (state.finished)
+        return;
 
+    for (auto const& subtree : subtrees)
+    {
+        if (!subtree.first->isFullBelow ())
+            fullBelow = false;
     }
 
-    if (nodeIDs.empty ())
-        clearSynching ();
+    if (fullBelow)
+    { // No partial node encountered below the root
+        top->setFullBelow ();
+        if (mType == smtSTATE)
+            m_fullBelowCache.insert (top->getNodeHash ());
+    }
 }
 
 std::vector<uint256> SHAMap::getNeededHashes (int max, SHAMapSyncFilter* filter)
@@ -317,12 +521,10 @@ bool SHAMap::getNodeFat (SHAMapNodeID wanted, std::vector<SHAMapNodeID>& nodeIDs
         count = 0;
         for (int i = 0; i < 16; ++i)
         {
-            SHAMapNodeID tempNodeID = wanted;
-            uint256 nextNodeHash;
-            if (node->descend (i, tempNodeID, nextNodeHash))
+            if (!node->isEmptyBranch (i))
             {
-                nextNodeID = tempNodeID;
-                nextNode = getNodePointer (nextNodeID, nextNodeHash);
+                nextNodeID = wanted.getChildNodeID (i);
+                nextNode = descendThrow (node, nextNodeID, i);
                 ++count;
                 if (fatLeaves || nextNode->isInner ())
                 {
@@ -375,7 +577,6 @@ SHAMapAddNode SHAMap::addRootNode (Blob const& rootNode, SHANodeFormat format,
 #endif
 
     root = node;
-    mTNByID.replace(SHAMapNodeID{}, root);
 
     if (root->isLeaf())
         clearSynching ();
@@ -413,7 +614,6 @@ SHAMapAddNode SHAMap::addRootNode (uint256 const& hash, Blob const& rootNode, SH
         return SHAMapAddNode::invalid ();
 
     root = node;
-    mTNByID.replace(SHAMapNodeID{}, root);
 
     if (root->isLeaf())
         clearSynching ();
@@ -444,16 +644,8 @@ SHAMap::addKnownNode (const SHAMapNodeID& node, Blob const& rawNode,
         return SHAMapAddNode::duplicate ();
     }
 
-    if (checkCacheNode (node)) // Do we already have this node?
-        return SHAMapAddNode::duplicate ();
-
-    SHAMapNodeID iNodeID = node.getParentNodeID();
-    SHAMapTreeNode* iNode = checkCacheNode(iNodeID).get();
-    if (iNode == nullptr)
-    {
-        iNode = root.get ();
-        iNodeID = SHAMapNodeID{};
-    }
+    SHAMapNodeID iNodeID;
+    SHAMapTreeNode* iNode = root.get ();
 
     while (!iNode->isLeaf () && !iNode->isFullBelow () &&
            (iNodeID.getDepth () < node.getDepth ()))
@@ -472,7 +664,7 @@ SHAMap::addKnownNode (const SHAMapNodeID& node, Blob const& rawNode,
         if (m_fullBelowCache.touch_if_exists (childHash))
             return SHAMapAddNode::duplicate ();
         SHAMapNodeID nextNodeID = iNodeID.getChildNodeID (branch);
-        SHAMapTreeNode* nextNode = getNodePointerNT(nextNodeID, childHash,
+        SHAMapTreeNode* nextNode = descendNT (iNode, nextNodeID, branch,
                                                                         filter);
         if (!nextNode)
         {
@@ -506,7 +698,7 @@ SHAMap::addKnownNode (const SHAMapNodeID& node, Blob const& rawNode,
                 return SHAMapAddNode::useful ();
             }
 
-            if (mTNByID.canonicalize(node, &newNode) && filter)
+            if (iNode->canonicalizeChild (branch, newNode) && filter)
             {
                 Serializer s;
                 newNode->addRaw (s, snfPREFIX);
@@ -527,24 +719,24 @@ SHAMap::addKnownNode (const SHAMapNodeID& node, Blob const& rawNode,
 bool SHAMap::deepCompare (SHAMap& other)
 {
     // Intended for debug/test only
-    std::stack<std::pair<SHAMapTreeNode::pointer, SHAMapNodeID>> stack;
+    std::stack<std::pair<SHAMapTreeNode*, SHAMapNodeID>> stack;
     ScopedReadLockType sl (mLock);
 
-    stack.push ({root, SHAMapNodeID{}});
+    stack.push ({root.get (), SHAMapNodeID{}});
 
     while (!stack.empty ())
     {
-        SHAMapTreeNode::pointer node;
+        SHAMapTreeNode* node;
         SHAMapNodeID nodeID;
         std::tie(node, nodeID) = stack.top ();
         stack.pop ();
 
-        SHAMapTreeNode::pointer otherNode;
+        SHAMapTreeNode* otherNode;
 
         if (nodeID.isRoot ())
-            otherNode = other.root;
+            otherNode = other.root.get ();
         else
-            otherNode = other.getNode (nodeID, node->getNodeHash (), false);
+            otherNode = other.getNodePointer (nodeID);
 
         if (!otherNode)
         {
@@ -587,15 +779,13 @@ bool SHAMap::deepCompare (SHAMap& other)
                 }
                 else
                 {
-                    SHAMapNodeID nextNodeID = nodeID;
-                    uint256 nextNodeHash;
-                    if (!node->descend (i, nextNodeID, nextNodeHash))
+                    SHAMapNodeID nextNodeID = nodeID.getChildNodeID (i);
+                    SHAMapTreeNode* next = descendNT (node, nextNodeID, i);
+                    if (!next)
                     {
                         WriteLog (lsWARNING, SHAMap) << "unable to fetch inner node";
                         return false;
                     }
-                    SHAMapTreeNode::pointer next = getNode (nextNodeID,
-                                                            nextNodeHash, false);
                     stack.push ({next, nextNodeID});
                 }
             }
@@ -612,19 +802,17 @@ bool
 SHAMap::hasInnerNode (SHAMapNodeID const& targetNodeID,
                       uint256 const& targetNodeHash)
 {
-    SHAMapTreeNode::pointer ptr = mTNByID.retrieve (targetNodeID);
-    if (ptr)
-        return ptr->getNodeHash() == targetNodeHash;
-
     SHAMapTreeNode* node = root.get ();
     SHAMapNodeID nodeID;
     uint256 nodeHash;
     while (node->isInner () && (nodeID.getDepth () < targetNodeID.getDepth ()))
     {
         int branch = nodeID.selectBranch (targetNodeID.getNodeID ());
-        if (!node->descend (branch, nodeID, nodeHash))
+        if (node->isEmptyBranch (branch))
             return false;
-        node = getNodePointer (nodeID, nodeHash);
+        nodeHash = node->getChildHash (branch);
+        nodeID = nodeID.getChildNodeID (branch);
+        node = descendThrow (node, nodeID, branch);
     }
 
     return nodeHash == targetNodeHash;
@@ -637,18 +825,18 @@ bool SHAMap::hasLeafNode (uint256 const& tag, uint256 const& targetNodeHash)
 {
     SHAMapTreeNode* node = root.get ();
     SHAMapNodeID nodeID;
-    uint256 nodeHash;
     if (!node->isInner()) // only one leaf node in the tree
         return node->getNodeHash() == targetNodeHash;
 
     do
     {
         int branch = nodeID.selectBranch (tag);
-        if (!node->descend (branch, nodeID, nodeHash))
+        if (node->isEmptyBranch (branch))
             return false;   // Dead end, node must not be here
-        if (nodeHash == targetNodeHash) // Matching leaf, no need to retrieve it
+        if (node->getChildHash (branch) == targetNodeHash) // Matching leaf, no need to retrieve it
             return true;
-        node = getNodePointer (nodeID, nodeHash);
+        nodeID = nodeID.getChildNodeID (branch);
+        node = descendThrow (node, nodeID, branch);
     }
     while (node->isInner());
 
@@ -723,7 +911,7 @@ void SHAMap::getFetchPack (SHAMap* have, bool includeLeaves, int max,
                 uint256 const& childHash = node->getChildHash (i);
                 SHAMapNodeID childID = nodeID.getChildNodeID (i);
 
-                SHAMapTreeNode* next = getNodePointer (childID, childHash);
+                SHAMapTreeNode* next = descendThrow (node, childID, i);
 
                 if (next->isInner ())
                 {
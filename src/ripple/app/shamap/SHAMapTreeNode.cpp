@@ -22,6 +22,7 @@
 //==============================================================================
 
 #include <ripple/basics/StringUtilities.h>
+#include <memory>
 
 namespace ripple {
 
@@ -45,7 +46,13 @@ SHAMapTreeNode::SHAMapTreeNode (const SHAMapTreeNode& node, std::uint32_t seq)
     if (node.mItem)
         mItem = node.mItem;
     else
+    {
         memcpy (mHashes, node.mHashes, sizeof (mHashes));
+
+        // The source may be shared, and readers may be hooking its children
+        for (int i = 0; i < 16; ++i)
+            mChildren[i] = std::atomic_load (&node.mChildren[i]);
+    }
 }
 
 SHAMapTreeNode::SHAMapTreeNode (SHAMapItem::ref item,
@@ -399,6 +406,7 @@ bool SHAMapTreeNode::setItem (SHAMapItem::ref i, TNType type)
     mItem = i;
     assert (isLeaf ());
     assert (mSeq != 0);
+    dropChildren ();
     return updateHash ();
 }
 
@@ -419,11 +427,18 @@ int SHAMapTreeNode::getBranchCount () const
     return count;
 }
 
+void SHAMapTreeNode::dropChildren ()
+{
+    for (auto& child : mChildren)
+        child.reset ();
+}
+
 void SHAMapTreeNode::makeInner ()
 {
     mItem.reset ();
     mIsBranch = 0;
     memset (mHashes, 0, sizeof (mHashes));
+    dropChildren ();
     mType = tnINNER;
     mHash.zero ();
 }
@@ -475,11 +490,19 @@ std::string SHAMapTreeNode::getString (const SHAMapNodeID & id) const
     return ret;
 }
 
-bool SHAMapTreeNode::setChildHash (int m, uint256 const& hash)
+bool SHAMapTreeNode::setChild (int m, uint256 const& hash,
+                               pointer const& child)
 {
     assert ((m >= 0) && (m < 16));
     assert (mType == tnINNER);
     assert (mSeq != 0);
+    assert (!child || (child->getNodeHash () == hash));
+
+    // Only a node with a nonzero sequence, private to the one map that is
+    // modifying it, is changed here. It is not in the TreeNodeCache or any
+    // other map, so no other thread can reach it to hook a child, and the
+    // plain store cannot race with canonicalizeChild.
+    mChildren[m] = child;
 
     if (mHashes[m] == hash)
         return false;
@@ -494,6 +517,24 @@ bool SHAMapTreeNode::setChildHash (int m, uint256 const& hash)
     return updateHash ();
 }
 
+bool SHAMapTreeNode::setChildren (std::array <pointer, 16> const& children)
+{
+    assert (mType == tnINNER);
+    assert (mSeq != 0);
+
+    for (int m = 0; m < 16; ++m)
+    {
+        if (children[m])
+        {
+            assert (!isEmptyBranch (m));
+            mChildren[m] = children[m];
+            mHashes[m] = children[m]->getNodeHash ();
+        }
+    }
+
+    return updateHash ();
+}
+
 // Descends along the specified branch
 // On invocation, nodeID must be the ID of this node
 // Returns false if there is no node down that branch
@@ -514,4 +555,44 @@ SHAMapTreeNode::descend (int branch, SHAMapNodeID& nodeID, uint256& nodeHash)
     return true;
 }
 
+SHAMapTreeNode*
+SHAMapTreeNode::getChildPointer (int branch)
+{
+    assert (branch >= 0 && branch < 16);
+    assert (isInnerNode ());
+
+    // The child of a shared node is only ever set once, from empty, so the
+    // node stays alive while its parent holds it
+    return std::atomic_load (&mChildren[branch]).get ();
+}
+
+SHAMapTreeNode::pointer
+SHAMapTreeNode::getChild (int branch)
+{
+    assert (branch >= 0 && branch < 16);
+    assert (isInnerNode ());
+
+    return std::atomic_load (&mChildren[branch]);
+}
+
+bool
+SHAMapTreeNode::canonicalizeChild (int branch, pointer& node)
+{
+    assert (branch >= 0 && branch < 16);
+    assert (isInnerNode ());
+    assert (node);
+    assert (node->getNodeHash () == mHashes[branch]);
+
+    // Hook this node up if the branch is still empty
+    pointer expected;
+
+    if (std::atomic_compare_exchange_strong (
+            &mChildren[branch], &expected, node))
+        return true;
+
+    // There is already a node hooked up, return it
+    node = expected;
+    return false;
+}
+
 } // ripple
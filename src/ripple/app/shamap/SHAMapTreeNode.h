@@ -26,6 +26,8 @@
 
 #include <ripple/app/shamap/SHAMapNodeID.h>
 #include <ripple/basics/CountedObject.h>
+#include <ripple/common/ShardedTaggedCache.h>
+#include <array>
 
 namespace ripple {
 
@@ -134,7 +136,15 @@ public:
     {
         return !mItem;
     }
-    bool setChildHash (int m, uint256 const& hash);
+    bool setChild (int m, uint256 const& hash, pointer const& child);
+
+    /** Link replacements for several existing children.
+        Null entries leave their branch unchanged. The node is rehashed
+        once, rather than once per child as setChild does.
+        @return `true` if the node's hash changed.
+    */
+    bool setChildren (std::array <pointer, 16> const& children);
+
     bool isEmptyBranch (int m) const
     {
         return (mIsBranch & (1 << m)) == 0;
@@ -148,6 +158,22 @@ public:
         return mHashes[m];
     }
 
+    /** Child pointers
+        Children are hooked lazily as the tree is walked. A node that is
+        shared between maps (or is in the TreeNodeCache) may have children
+        hooked by any reader, so these functions use the atomic shared_ptr
+        operations on the child slot.
+    */
+    SHAMapTreeNode* getChildPointer (int branch);
+    pointer getChild (int branch);
+
+    /** Hook a child node that was fetched from outside the map.
+        If another thread already hooked a child on this branch,
+        `node` is replaced with that child.
+        @return `true` if `node` was hooked.
+    */
+    bool canonicalizeChild (int branch, pointer& node);
+
     // item node function
     bool hasItem () const
     {
@@ -201,6 +227,7 @@ private:
 
     uint256             mHash;
     uint256             mHashes[16];
+    pointer             mChildren[16];
     SHAMapItem::pointer mItem;
     std::uint32_t       mSeq, mAccessSeq;
     TNType              mType;
@@ -208,9 +235,12 @@ private:
     bool                mFullBelow;
 
     bool updateHash ();
+
+    // Only used on nodes that no other thread can be reading
+    void dropChildren ();
 };
 
-using TreeNodeCache = TaggedCache <uint256, SHAMapTreeNode>;
+using TreeNodeCache = ShardedTaggedCache <uint256, SHAMapTreeNode>;
 
 } // ripple
 
@@ -175,14 +175,6 @@ private:
         return tesSUCCESS;
     }
 
-	class pair_less {
-        public:
-            bool operator()(const std::pair<RippleAddress, uint64_t> &x, const std::pair<RippleAddress, uint64_t> &y)
-            {
-                    return x.second < y.second;
-            }
-	};
-
 	TER applyDividend()
 	{
 		SLE::pointer dividendObject = mEngine->entryCache(
@@ -211,63 +203,34 @@ private:
 		m_journal.info <<
 			"Current dividend object: " << dividendObject->getJson(0);
 
-		std::vector<std::pair<RippleAddress, uint64_t> > accounts;
-		mEngine->getLedger()->visitStateItems(std::bind(retrieveAccount,
-            std::ref(accounts), std::placeholders::_1));
-		std::sort(accounts.begin(), accounts.end(), pair_less());
-		hash_map<RippleAddress, uint32_t> rank;
-		int r = 1;
-		rank[accounts[0].first] = r;
-		int sum = r;
-		for (int i=1; i<accounts.size(); ++i) {
-			if (accounts[i].second > accounts[i-1].second)
-				++r;
-			rank[accounts[i].first] = r;
-			sum += r;
+		// Each account is paid in proportion to the dense rank of its balance
+		std::vector<BalanceRankIndex::AccountRank> ranks;
+		uint32_t sum = 0;
+		if (!getApp().getBalanceRankIndex().getRanks(mEngine->getLedger(), ranks, sum)) {
+			m_journal.info << "Ranking accounts by scanning the ledger";
+			sum = BalanceRankIndex::rankLedger(mEngine->getLedger(), ranks);
 		}
-		std::for_each(rank.begin(), rank.end(), dividend_account(mEngine, dividendAmount, sum, m_journal));
 
-		return tesSUCCESS;
-	}
+		m_journal.info << "Paying dividend to " << ranks.size() << " accounts";
 
-	class dividend_account {
-		RippleAddress root;
-		TransactionEngine *engine;
-		uint64_t totalDividend;
-		uint32_t totalPart;
-		beast::Journal m_journal;
-	public:
-		dividend_account(TransactionEngine *e, uint64_t d, uint32_t p, const beast::Journal &j)
-			: engine(e), totalDividend(d), totalPart(p), m_journal(j)
-		{
-            RippleAddress rootSeedMaster = RippleAddress::createSeedGeneric ("masterpassphrase");
-            RippleAddress rootGeneratorMaster = RippleAddress::createGeneratorPublic (rootSeedMaster);
-            root = RippleAddress::createAccountPublic (rootGeneratorMaster, 0);
+		// The root account is paid too. An earlier check meant to skip it
+		// compared account IDs with its public key, so it never matched.
+		std::vector<Ledger::Credit> credits;
+		credits.reserve(ranks.size());
+		for (auto const& v : ranks) {
+			uint64_t div = dividendAmount * v.second / sum;
+			if (div>0)
+				credits.emplace_back(Ledger::getAccountRootIndex(v.first), div);
 		}
 
-		void operator ()(const std::pair<RippleAddress, uint64_t> &v)
-		{
-			uint64_t div = totalDividend * v.second / totalPart;
-			m_journal.info << v.first.humanAccountID() << "\t" << root.humanAccountID();
-			if (div>0 && v.first!=root) {
-				auto const index = Ledger::getAccountRootIndex (v.first);
-				SLE::pointer sleDst (engine->entryCache (ltACCOUNT_ROOT, index));
-				if (sleDst) {
-					engine->entryModify(sleDst);
-					uint64_t prevBalance = sleDst->getFieldAmount(sfBalance).getNValue();
-					sleDst->setFieldAmount(sfBalance, prevBalance+div);
-				}
-			}
-		}
-	};
+		// Credits to accounts missing from the ledger are skipped, as
+		// entryCache would have returned nothing for them
+		std::size_t const credited =
+			mEngine->view().creditBalances(std::move(credits));
 
-	static void retrieveAccount (std::vector<std::pair<RippleAddress, uint64_t> > &accounts, SLE::ref sle)
-	{
-		if (sle->getType() == ltACCOUNT_ROOT) {
-			RippleAddress addr = sle->getFieldAccount(sfAccount);
-			uint64_t bal = sle->getFieldAmount(sfBalance).getNValue();
-			accounts.push_back(std::make_pair(addr, bal));
-		}
+		m_journal.info << "Paid dividend to " << credited << " accounts";
+
+		return tesSUCCESS;
 	}
 
     // VFALCO TODO Can this be removed?
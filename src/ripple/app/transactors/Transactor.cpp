@@ -258,7 +258,7 @@ TER Transactor::preCheck ()
     if (!mTxn.isKnownGood ())
     {
         if (mTxn.isKnownBad () || 
-            (!(mParams & tapNO_CHECK_SIGN) && !mTxn.checkSign (mSigningPubKey)))
+            (!(mParams & tapNO_CHECK_SIGN) && !getApp().getSignatureCache ().checkSign (mTxn, mSigningPubKey)))
         {
             mTxn.setBad ();
             m_journal.warning << "apply: Invalid transaction (bad signature)";
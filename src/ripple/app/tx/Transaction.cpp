@@ -73,7 +73,8 @@ Transaction::pointer Transaction::sharedTransaction (
 bool Transaction::checkSign () const
 {
     if (mFromPubKey.isValid ())
-        return mTransaction->checkSign (mFromPubKey);
+        return getApp().getSignatureCache ().checkSign (
+            *mTransaction, mFromPubKey);
 
     WriteLog (lsWARNING, Ledger) << "Transaction has bad source public key";
     return false;
@@ -108,13 +109,21 @@ Transaction::pointer Transaction::transactionFromSQL (
 
     rawTxn.resize (txSize);
 
-    SerializerIterator it (rawTxn);
+    return transactionFromSQL (rawTxn.peekData (), status[0], inLedger,
+        validate);
+}
+
+Transaction::pointer Transaction::transactionFromSQL (
+    Blob const& rawTxn, char status, std::uint32_t inLedger, Validate validate)
+{
+    Serializer s (rawTxn);
+    SerializerIterator it (s);
     auto txn = std::make_shared<SerializedTransaction> (it);
     auto tr = std::make_shared<Transaction> (txn, validate);
 
     TransStatus st (INVALID);
 
-    switch (status[0])
+    switch (status)
     {
     case TXN_SQL_NEW:
         st = NEW;
@@ -180,53 +189,17 @@ Transaction::pointer Transaction::transactionFromSQL (std::string const& sql)
     }
     rawTxn.resize (txSize);
 
-    SerializerIterator it (rawTxn);
-    auto txn = std::make_shared<SerializedTransaction> (it);
-    auto tr = std::make_shared<Transaction> (txn, Validate::YES);
-
-    TransStatus st (INVALID);
-
-    switch (status[0])
-    {
-    case TXN_SQL_NEW:
-        st = NEW;
-        break;
-
-    case TXN_SQL_CONFLICT:
-        st = CONFLICTED;
-        break;
-
-    case TXN_SQL_HELD:
-        st = HELD;
-        break;
-
-    case TXN_SQL_VALIDATED:
-        st = COMMITTED;
-        break;
-
-    case TXN_SQL_INCLUDED:
-        st = INCLUDED;
-        break;
-
-    case TXN_SQL_UNKNOWN:
-        break;
-
-    default:
-        assert (false);
-    }
-
-    tr->setStatus (st);
-    tr->setLedger (inLedger);
-    return tr;
+    return transactionFromSQL (rawTxn.peekData (), status[0], inLedger,
+        Validate::YES);
 }
 
 
 Transaction::pointer Transaction::load (uint256 const& id)
 {
     std::string sql = "SELECT LedgerSeq,Status,RawTxn "
-            "FROM Transactions WHERE TransID='";
-    sql.append (to_string (id));
-    sql.append ("';");
+            "FROM Transactions WHERE TransID=";
+    sql.append (txnDBKey (id));
+    sql.append (";");
     return transactionFromSQL (sql);
 }
 
@@ -65,6 +65,8 @@ public:
 
     static Transaction::pointer sharedTransaction (Blob const&, Validate);
     static Transaction::pointer transactionFromSQL (Database*, Validate);
+    static Transaction::pointer transactionFromSQL (
+        Blob const& rawTxn, char status, std::uint32_t inLedger, Validate);
 
     bool checkSign () const;
 
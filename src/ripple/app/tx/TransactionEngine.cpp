@@ -30,8 +30,7 @@ namespace ripple {
 void TransactionEngine::txnWrite ()
 {
     // Write back the account states
-    typedef std::map<uint256, LedgerEntrySetEntry>::value_type u256_LES_pair;
-    BOOST_FOREACH (u256_LES_pair & it, mNodes)
+    for (auto const& it : mNodes)
     {
         SLE::ref    sleEntry    = it.second.mEntry;
 
@@ -72,6 +71,16 @@ void TransactionEngine::txnWrite ()
         break;
         }
     }
+
+    if (!mNodes.getCreditedItems ().empty ())
+    {
+        WriteLog (lsINFO, TransactionEngine) << "applyTransaction: crediting " <<
+            mNodes.getCreditedItems ().size () << " accounts";
+
+        if (!mLedger->peekAccountStateMap ()->updateGiveItems (
+                mNodes.getCreditedItems (), false, false))
+            assert (false);
+    }
 }
 
 TER TransactionEngine::applyTransaction (
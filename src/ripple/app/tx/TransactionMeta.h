@@ -84,6 +84,13 @@ public:
     void setAffectedNode (uint256 const& , SField::ref type, std::uint16_t nodeType);
     STObject& getAffectedNode (SLE::ref node, SField::ref type); // create if needed
     STObject& getAffectedNode (uint256 const& );
+
+    // Add a node that is not in the set yet, without searching for it
+    void addAffectedNode (STObject const& node)
+    {
+        mNodes.push_back (node);
+    }
+
     const STObject& peekAffectedNode (uint256 const& ) const;
     std::vector<RippleAddress> getAffectedAccounts ();
 
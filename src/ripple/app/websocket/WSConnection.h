@@ -145,6 +145,14 @@ public:
             m_serverHandler.send (ptr, sObj, broadcast);
     }
 
+    void send (Payload::pointer const& payload, bool broadcast)
+    {
+        connection_ptr ptr = m_connection.lock ();
+
+        if (ptr)
+            m_serverHandler.send (ptr, payload, broadcast);
+    }
+
     void disconnect ()
     {
         connection_ptr ptr = m_connection.lock ();
@@ -83,6 +83,11 @@ protected:
     bool const mPublic;
     bool const mProxy;
 
+private:
+    LockType mFrameLock;
+    std::weak_ptr <InfoSub::Payload const> mFramePayload;
+    message_ptr mFrames[2];
+
 public:
     WSServerHandler (Resource::Manager& resourceManager,
         InfoSub::Source& source, boost::asio::ssl::context& ssl_context, bool bPublic, bool bProxy)
@@ -128,6 +133,20 @@ public:
         }
     }
 
+    static void ssendm (connection_ptr cpClient, message_ptr mpMessage, bool broadcast)
+    {
+        try
+        {
+            WriteLog (broadcast ? lsTRACE : lsDEBUG, WSServerHandlerLog) << "Ws:: Sending '" << mpMessage->get_payload () << "'";
+
+            cpClient->send (mpMessage);
+        }
+        catch (...)
+        {
+            cpClient->close (websocketpp::close::status::value (crTooSlow), std::string ("Client is too slow."));
+        }
+    }
+
     void send (connection_ptr cpClient, message_ptr mpMessage)
     {
         cpClient->get_strand ().post (std::bind (
@@ -140,13 +159,82 @@ public:
                                           &WSServerHandler<endpoint_type>::ssendb, cpClient, strMessage, broadcast));
     }
 
+    // The frame is built once and the same message is queued on every
+    // connection the payload goes to, so its text is not copied for each.
+    void send (connection_ptr cpClient,
+        InfoSub::Payload::pointer const& payload, bool broadcast)
+    {
+        message_ptr mpMessage = getFrame (cpClient, payload);
+
+        if (mpMessage)
+            cpClient->get_strand ().post (std::bind (
+                &WSServerHandler<endpoint_type>::ssendm, cpClient, mpMessage, broadcast));
+    }
+
+    // Writes the JSON straight into an outgoing message sized for it,
+    // instead of into a string that is then copied into the message.
     void send (connection_ptr cpClient, Json::Value const& jvObj, bool broadcast)
     {
-        Json::FastWriter    jfwWriter;
+        message_ptr mpMessage = cpClient->get_control_message2 ();
 
-        // WriteLog (lsDEBUG, WSServerHandlerLog) << "Ws:: Object '" << jfwWriter.write(jvObj) << "'";
+        if (!mpMessage)
+        {
+            cpClient->close (websocketpp::close::status::value (crTooSlow), std::string ("Client is too slow."));
+            return;
+        }
+
+        mpMessage->reset (websocketpp::frame::opcode::TEXT);
+        mpMessage->reserve_payload (Json::ChunkedWriter::measure (jvObj) + 1);
+
+        Json::ChunkedWriter writer (
+            [&mpMessage] (char const* data, std::size_t bytes)
+            {
+                mpMessage->append_payload (data, bytes);
+            });
+        writer.write (jvObj);
+        writer.output ("\n", 1);
+        writer.flush ();
+
+        cpClient->get_strand ().post (std::bind (
+                                          &WSServerHandler<endpoint_type>::ssendm, cpClient, mpMessage, broadcast));
+    }
+
+    // Returns the prepared frame for the payload, building it on first use.
+    // Publishers send one payload to all of its subscribers before the
+    // next, so only the frames of the latest payload are kept. Hixie-76
+    // connections frame text differently from the others.
+    message_ptr getFrame (connection_ptr const& cpClient,
+        InfoSub::Payload::pointer const& payload)
+    {
+        int const framing = (cpClient->get_version () == 0) ? 1 : 0;
+
+        ScopedLockType sl (mFrameLock);
+
+        if (mFramePayload.lock () != payload)
+        {
+            mFramePayload = payload;
+            mFrames[0] = message_ptr ();
+            mFrames[1] = message_ptr ();
+        }
+
+        message_ptr& mpMessage = mFrames[framing];
+
+        if (!mpMessage)
+        {
+            message_ptr mpFrame (new websocketpp::message::data (
+                websocketpp::message::data::pool_ptr (), 0));
+
+            mpFrame->reset (websocketpp::frame::opcode::TEXT);
+            mpFrame->set_payload (payload->getText ());
+
+            // Framed with the lock held, so no connection sees it unprepared
+            if (!cpClient->prepare (mpFrame))
+                return message_ptr ();
+
+            mpMessage = mpFrame;
+        }
 
-        send (cpClient, jfwWriter.write (jvObj), broadcast);
+        return mpMessage;
     }
 
     void pingTimer (connection_ptr cpClient)
@@ -364,8 +452,8 @@ public:
 
     bool do_message (Job& job, const connection_ptr& cpClient, const wsc_ptr& conn, const message_ptr& mpMessage)
     {
-        Json::Value     jvRequest;
-        Json::Reader    jrReader;
+        Json::Value         jvRequest;
+        Json::InSituReader  jrReader;
 
         try
         {
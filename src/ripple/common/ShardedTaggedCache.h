@@ -0,0 +1,294 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_SHARDEDTAGGEDCACHE_H_INCLUDED
+#define RIPPLE_SHARDEDTAGGEDCACHE_H_INCLUDED
+
+#include <ripple/common/TaggedCache.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ripple {
+
+/** A TaggedCache split into independently locked shards.
+
+    Keys are distributed across the shards by hash, so threads working on
+    different keys rarely contend for the same mutex. The interface mirrors
+    TaggedCache; target size and age apply to the cache as a whole and are
+    divided evenly among the shards. Sweeping visits one shard at a time so
+    lookups are never blocked by a sweep of the entire cache.
+
+    There is no peekMutex, since no single mutex guards the whole cache.
+*/
+template <
+    class Key,
+    class T,
+    class Hash = beast::hardened_hash <>,
+    class KeyEqual = std::equal_to <Key>,
+    class Mutex = std::recursive_mutex
+>
+class ShardedTaggedCache
+{
+public:
+    typedef TaggedCache <Key, T, Hash, KeyEqual, Mutex> shard_type;
+    typedef typename shard_type::mutex_type mutex_type;
+    typedef typename shard_type::key_type key_type;
+    typedef typename shard_type::mapped_type mapped_type;
+    typedef typename shard_type::weak_mapped_ptr weak_mapped_ptr;
+    typedef typename shard_type::mapped_ptr mapped_ptr;
+    typedef typename shard_type::clock_type clock_type;
+
+    /** The number of shards used when none is specified. */
+    static std::size_t const defaultShards = 16;
+
+public:
+    ShardedTaggedCache (std::string const& name, int size,
+        typename clock_type::rep expiration_seconds, clock_type& clock,
+            beast::Journal journal,
+                beast::insight::Collector::ptr const& collector =
+                    beast::insight::NullCollector::New (),
+                        std::size_t shards = defaultShards)
+        : m_clock (clock)
+        , m_target_size (size)
+        , m_shards (makeShards (name, size, expiration_seconds,
+            clock, journal, shards))
+        , m_stats (name,
+            std::bind (&ShardedTaggedCache::collect_metrics, this),
+                collector)
+    {
+    }
+
+    ShardedTaggedCache (ShardedTaggedCache const&) = delete;
+    ShardedTaggedCache& operator= (ShardedTaggedCache const&) = delete;
+
+public:
+    /** Return the clock associated with the cache. */
+    clock_type& clock ()
+    {
+        return m_clock;
+    }
+
+    /** Return the number of shards. */
+    std::size_t shards () const
+    {
+        return m_shards.size ();
+    }
+
+    int getTargetSize () const
+    {
+        return m_target_size;
+    }
+
+    void setTargetSize (int s)
+    {
+        m_target_size = s;
+        for (auto& shard : m_shards)
+            shard->setTargetSize (shardTargetSize (s, m_shards.size ()));
+    }
+
+    typename clock_type::rep getTargetAge () const
+    {
+        return m_shards.front ()->getTargetAge ();
+    }
+
+    void setTargetAge (typename clock_type::rep s)
+    {
+        for (auto& shard : m_shards)
+            shard->setTargetAge (s);
+    }
+
+    int getCacheSize ()
+    {
+        int size = 0;
+        for (auto& shard : m_shards)
+            size += shard->getCacheSize ();
+        return size;
+    }
+
+    int getTrackSize ()
+    {
+        int size = 0;
+        for (auto& shard : m_shards)
+            size += shard->getTrackSize ();
+        return size;
+    }
+
+    float getHitRate ()
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        getStats (hits, misses);
+        auto const total = static_cast<float> (hits + misses);
+        return hits * (100.0f / std::max (1.0f, total));
+    }
+
+    void clearStats ()
+    {
+        for (auto& shard : m_shards)
+            shard->clearStats ();
+    }
+
+    void clear ()
+    {
+        for (auto& shard : m_shards)
+            shard->clear ();
+    }
+
+    /** Sweep every shard, one at a time. */
+    void sweep ()
+    {
+        for (auto& shard : m_shards)
+            shard->sweep ();
+    }
+
+    bool del (key_type const& key, bool valid)
+    {
+        return shard (key).del (key, valid);
+    }
+
+    /** Replace aliased objects with originals.
+        @see TaggedCache::canonicalize
+    */
+    bool canonicalize (key_type const& key, std::shared_ptr<T>& data,
+        bool replace = false)
+    {
+        return shard (key).canonicalize (key, data, replace);
+    }
+
+    std::shared_ptr<T> fetch (key_type const& key)
+    {
+        return shard (key).fetch (key);
+    }
+
+    /** Insert the element into the container.
+        If the key already exists, nothing happens.
+        @return `true` If the element was inserted
+    */
+    bool insert (key_type const& key, T const& value)
+    {
+        return shard (key).insert (key, value);
+    }
+
+    bool retrieve (key_type const& key, T& data)
+    {
+        return shard (key).retrieve (key, data);
+    }
+
+    /** Refresh the expiration time on a key.
+
+        @param key The key to refresh.
+        @return `true` if the key was found and the object is cached.
+    */
+    bool refreshIfPresent (key_type const& key)
+    {
+        return shard (key).refreshIfPresent (key);
+    }
+
+private:
+    static std::vector <std::unique_ptr <shard_type>> makeShards (
+        std::string const& name, int size,
+            typename clock_type::rep expiration_seconds, clock_type& clock,
+                beast::Journal journal, std::size_t shards)
+    {
+        assert (shards > 0);
+        std::vector <std::unique_ptr <shard_type>> result;
+        result.reserve (shards);
+        for (std::size_t i = 0; i < shards; ++i)
+            result.emplace_back (new shard_type (name,
+                shardTargetSize (size, shards), expiration_seconds,
+                    clock, journal));
+        return result;
+    }
+
+    static int shardTargetSize (int size, std::size_t shards)
+    {
+        // Zero means "no target", so never round a real target down to it
+        if (size <= 0)
+            return size;
+        return std::max (1, static_cast<int> (
+            (size + shards - 1) / shards));
+    }
+
+    shard_type& shard (key_type const& key)
+    {
+        return *m_shards [m_hash (key) % m_shards.size ()];
+    }
+
+    void getStats (std::uint64_t& hits, std::uint64_t& misses)
+    {
+        for (auto& shard : m_shards)
+        {
+            std::uint64_t h;
+            std::uint64_t m;
+            shard->getStats (h, m);
+            hits += h;
+            misses += m;
+        }
+    }
+
+    void collect_metrics ()
+    {
+        m_stats.size.set (getCacheSize ());
+
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        getStats (hits, misses);
+
+        beast::insight::Gauge::value_type hit_rate (0);
+        if (hits + misses != 0)
+            hit_rate = (hits * 100) / (hits + misses);
+        m_stats.hit_rate.set (hit_rate);
+    }
+
+private:
+    struct Stats
+    {
+        template <class Handler>
+        Stats (std::string const& prefix, Handler const& handler,
+            beast::insight::Collector::ptr const& collector)
+            : hook (collector->make_hook (handler))
+            , size (collector->make_gauge (prefix, "size"))
+            , hit_rate (collector->make_gauge (prefix, "hit_rate"))
+            { }
+
+        beast::insight::Hook hook;
+        beast::insight::Gauge size;
+        beast::insight::Gauge hit_rate;
+    };
+
+    clock_type& m_clock;
+    Hash m_hash;
+    std::atomic <int> m_target_size;
+    std::vector <std::unique_ptr <shard_type>> m_shards;
+
+    // Declared last so the hook never sees partially constructed shards
+    Stats m_stats;
+};
+
+}
+
+#endif
@@ -150,6 +150,14 @@ public:
         return m_hits * (100.0f / std::max (1.0f, total));
     }
 
+    /** Retrieve the raw hit and miss counters. */
+    void getStats (std::uint64_t& hits, std::uint64_t& misses)
+    {
+        lock_guard lock (m_mutex);
+        hits = m_hits;
+        misses = m_misses;
+    }
+
     void clearStats ()
     {
         lock_guard lock (m_mutex);
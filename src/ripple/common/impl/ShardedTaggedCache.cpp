@@ -0,0 +1,238 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/common/ShardedTaggedCache.h>
+
+#include <beast/unit_test/suite.h>
+#include <beast/chrono/manual_clock.h>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace ripple {
+
+class ShardedTaggedCache_test : public beast::unit_test::suite
+{
+public:
+    typedef int Key;
+    typedef std::string Value;
+    typedef ShardedTaggedCache <Key, Value> Cache;
+
+    void testAging ()
+    {
+        testcase ("aging");
+
+        beast::Journal const j;
+        beast::manual_clock <std::chrono::seconds> clock;
+        clock.set (0);
+
+        Cache c ("test", 4, 1, clock, j,
+            beast::insight::NullCollector::New (), 4);
+
+        // Insert an item, retrieve it, and age it so it gets purged.
+        expect (! c.insert (1, "one"));
+        expect (c.getCacheSize() == 1);
+        expect (c.getTrackSize() == 1);
+        {
+            std::string s;
+            expect (c.retrieve (1, s));
+            expect (s == "one");
+        }
+        ++clock;
+        c.sweep ();
+        expect (c.getCacheSize () == 0);
+        expect (c.getTrackSize () == 0);
+
+        // Keep a strong pointer, age it, and make sure it stays tracked
+        // until the last reference goes away.
+        expect (! c.insert (2, "two"));
+        {
+            Cache::mapped_ptr p (c.fetch (2));
+            expect (p != nullptr);
+            ++clock;
+            c.sweep ();
+            expect (c.getCacheSize() == 0);
+            expect (c.getTrackSize() == 1);
+
+            // Canonicalizing a new object yields the original
+            Cache::mapped_ptr p2 (std::make_shared <Value> ("two"));
+            expect (c.canonicalize (2, p2));
+            expect (p.get () == p2.get ());
+            expect (c.getCacheSize() == 1);
+        }
+        ++clock;
+        c.sweep ();
+        ++clock;
+        c.sweep ();
+        expect (c.getCacheSize() == 0);
+        expect (c.getTrackSize() == 0);
+    }
+
+    void testShards ()
+    {
+        testcase ("shards");
+
+        beast::Journal const j;
+        beast::manual_clock <std::chrono::seconds> clock;
+        clock.set (0);
+
+        Cache c ("test", 64, 1, clock, j,
+            beast::insight::NullCollector::New (), 8);
+        expect (c.shards () == 8);
+        expect (c.getTargetSize () == 64);
+
+        for (Key k = 0; k < 100; ++k)
+            expect (! c.insert (k, std::to_string (k)));
+        expect (c.getCacheSize () == 100);
+        expect (c.getTrackSize () == 100);
+
+        bool allFound = true;
+        for (Key k = 0; k < 100; ++k)
+        {
+            Cache::mapped_ptr const p (c.fetch (k));
+            if (! p || *p != std::to_string (k))
+                allFound = false;
+        }
+        expect (allFound, "every key is found in its shard");
+        expect (! c.fetch (1000));
+        expect (c.getHitRate () > 99.0f && c.getHitRate () < 100.0f);
+
+        expect (c.del (5, false));
+        expect (! c.fetch (5));
+        expect (c.getCacheSize () == 99);
+
+        Cache::mapped_ptr p (std::make_shared <Value> ("replaced"));
+        expect (c.canonicalize (7, p, true));
+        expect (*c.fetch (7) == "replaced");
+
+        c.clearStats ();
+        expect (c.getHitRate () == 0);
+
+        c.clear ();
+        expect (c.getCacheSize () == 0);
+        expect (c.getTrackSize () == 0);
+    }
+
+    void run ()
+    {
+        testAging ();
+        testShards ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ShardedTaggedCache,common,ripple);
+
+//------------------------------------------------------------------------------
+
+/** Compare TaggedCache and ShardedTaggedCache under contention.
+
+    Several threads fetch and canonicalize keys drawn from a shared key
+    space while another thread sweeps continuously, which approximates how
+    the node store and tree node caches are used while acquiring ledgers.
+*/
+class TaggedCache_timing_test : public beast::unit_test::suite
+{
+public:
+    typedef std::uint64_t Key;
+    typedef std::string Value;
+
+    static int const keySpace = 100000;
+    static int const opsPerThread = 500000;
+
+    template <class Cache>
+    static void worker (Cache& cache, std::uint32_t seed)
+    {
+        std::mt19937 gen (seed);
+        std::uniform_int_distribution <Key> dist (0, keySpace - 1);
+        for (int i = 0; i < opsPerThread; ++i)
+        {
+            Key const key (dist (gen));
+            if (! cache.fetch (key))
+            {
+                std::shared_ptr <Value> p (
+                    std::make_shared <Value> ("value"));
+                cache.canonicalize (key, p);
+            }
+        }
+    }
+
+    template <class Cache>
+    double time (Cache& cache, int threads)
+    {
+        std::atomic <bool> stop (false);
+        std::thread sweeper ([&cache, &stop]
+        {
+            while (! stop.load ())
+            {
+                cache.sweep ();
+                std::this_thread::yield ();
+            }
+        });
+
+        auto const start = std::chrono::steady_clock::now ();
+        std::vector <std::thread> workers;
+        for (int i = 0; i < threads; ++i)
+            workers.emplace_back (&worker <Cache>, std::ref (cache), i + 1);
+        for (auto& t : workers)
+            t.join ();
+        auto const elapsed = std::chrono::steady_clock::now () - start;
+
+        stop = true;
+        sweeper.join ();
+
+        return std::chrono::duration_cast <std::chrono::duration <double>> (
+            elapsed).count ();
+    }
+
+    void run ()
+    {
+        beast::Journal const j;
+        beast::manual_clock <std::chrono::seconds> clock;
+        clock.set (0);
+
+        for (int threads : { 1, 2, 4, 8, 16 })
+        {
+            std::stringstream ss;
+            ss << threads << " threads";
+            testcase (ss.str ());
+
+            TaggedCache <Key, Value> single ("single", keySpace / 2, 1,
+                clock, j);
+            ShardedTaggedCache <Key, Value> sharded ("sharded", keySpace / 2,
+                1, clock, j);
+
+            double const t1 = time (single, threads);
+            double const t2 = time (sharded, threads);
+
+            log << "TaggedCache:        " << t1 << "s";
+            log << "ShardedTaggedCache: " << t2 << "s (" <<
+                sharded.shards () << " shards)";
+            pass ();
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(TaggedCache_timing,common,ripple);
+
+}
@@ -336,6 +336,9 @@ public:
     std::string                 PEER_SSL_CIPHER_LIST;
     bool                        PEER_PRIVATE;           // True to ask peers not to relay current IP.
     unsigned int                PEERS_MAX;
+    unsigned int                PEER_SEND_BYTES;        // Largest coalesced write to a peer, 0 for the default.
+    bool                        PEER_SEND_RATE;         // True to meter each peer's outbound byte rate.
+    bool                        PEER_COMPRESSION;       // True to offer peers compressed messages.
 
     // Websocket networking parameters
     std::string                 WEBSOCKET_PUBLIC_IP;        // XXX Going away. Merge with the inbound peer connction.
@@ -398,6 +401,8 @@ public:
     std::uint32_t                      LEDGER_HISTORY;
     std::uint32_t                      FETCH_DEPTH;
     int                         NODE_SIZE;
+    int                         SYNC_THREADS;           // Threads used to find missing state nodes.
+    bool                        TXN_DB_BINARY;          // True to key the transaction database with raw bytes.
 
     // Client behavior
     int                         ACCOUNT_PROBE_MAX;      // How far to scan for accounts.
@@ -412,6 +417,10 @@ public:
     std::string                 SMS_TO;
     std::string                 SMS_URL;
 
+    // Diagnostics
+    int                         JOB_TRACE;              // Trace jobs running at least this many milliseconds, 0 for none.
+    int                         RPC_SUB_QUEUE;          // Events held for each url subscriber while it catches up.
+
 public:
     Config ();
 
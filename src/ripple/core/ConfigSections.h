@@ -55,6 +55,7 @@ struct ConfigSection
 #define SECTION_INSIGHT                 "insight"
 #define SECTION_IPS                     "ips"
 #define SECTION_IPS_FIXED               "ips_fixed"
+#define SECTION_JOB_TRACE               "job_trace"
 #define SECTION_NETWORK_QUORUM          "network_quorum"
 #define SECTION_NODE_SEED               "node_seed"
 #define SECTION_NODE_SIZE               "node_size"
@@ -68,6 +69,9 @@ struct ConfigSection
 #define SECTION_PEER_PRIVATE            "peer_private"
 #define SECTION_PEERS_MAX               "peers_max"
 #define SECTION_PEER_SSL_CIPHER_LIST    "peer_ssl_cipher_list"
+#define SECTION_PEER_SEND_BYTES         "peer_send_bytes"
+#define SECTION_PEER_SEND_RATE          "peer_send_rate"
+#define SECTION_PEER_COMPRESSION        "peer_compression"
 #define SECTION_RPC_ALLOW_REMOTE        "rpc_allow_remote"
 #define SECTION_RPC_ADMIN_ALLOW         "rpc_admin_allow"
 #define SECTION_RPC_ADMIN_USER          "rpc_admin_user"
@@ -77,6 +81,7 @@ struct ConfigSection
 #define SECTION_RPC_USER                "rpc_user"
 #define SECTION_RPC_PASSWORD            "rpc_password"
 #define SECTION_RPC_STARTUP             "rpc_startup"
+#define SECTION_RPC_SUB_QUEUE           "rpc_sub_queue"
 #define SECTION_RPC_SECURE              "rpc_secure"
 #define SECTION_RPC_SSL_CERT            "rpc_ssl_cert"
 #define SECTION_RPC_SSL_CHAIN           "rpc_ssl_chain"
@@ -87,6 +92,8 @@ struct ConfigSection
 #define SECTION_SMS_TO                  "sms_to"
 #define SECTION_SMS_URL                 "sms_url"
 #define SECTION_SNTP                    "sntp_servers"
+#define SECTION_SYNC_THREADS            "sync_threads"
+#define SECTION_TXN_DB_BINARY           "transaction_db_binary"
 #define SECTION_SSL_VERIFY              "ssl_verify"
 #define SECTION_SSL_VERIFY_FILE         "ssl_verify_file"
 #define SECTION_SSL_VERIFY_DIR          "ssl_verify_dir"
@@ -132,6 +132,9 @@ public:
 
     void rename (std::string const& n);
 
+    /** Returns the name given when the job was added or last renamed. */
+    std::string const& getName () const;
+
     // These comparison operators make the jobs sort in priority order
     // in the job set
     bool operator< (const Job& j) const;
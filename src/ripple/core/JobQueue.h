@@ -77,6 +77,18 @@ public:
     virtual bool isOverloaded () = 0;
 
     virtual Json::Value getJson (int c = 0) = 0;
+
+    /** Trace jobs which run for at least this long.
+
+        The most recent slow jobs are kept with their names and reported
+        by getLatencyJson. A threshold of zero turns tracing off.
+    */
+    virtual void setSlowJobThreshold (std::chrono::milliseconds threshold) = 0;
+
+    /** Returns latency percentiles for each job type and the slow jobs.
+        The percentiles cover roughly the last five to ten minutes of jobs.
+    */
+    virtual Json::Value getLatencyJson () = 0;
 };
 
 std::unique_ptr <JobQueue>
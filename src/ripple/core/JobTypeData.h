@@ -24,7 +24,12 @@
 #ifndef RIPPLE_CORE_JOBTYPEDATA_H_INCLUDED
 #define RIPPLE_CORE_JOBTYPEDATA_H_INCLUDED
 
+#include <ripple/core/Job.h>
 #include <ripple/core/JobTypeInfo.h>
+#include <ripple/core/LatencyHistogram.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
 
 namespace ripple
 {
@@ -41,26 +46,44 @@ public:
     /* The job category which we represent */
     JobTypeInfo const& info;
 
+    /* Guards the queue and changes to the counts below */
+    std::mutex mutex;
+
+    /* The jobs waiting to run, oldest first */
+    std::deque <Job> jobs;
+
     /* The number of jobs waiting */
-    int waiting;
+    std::atomic <int> waiting;
 
     /* The number presently running */
-    int running;
+    std::atomic <int> running;
 
-    /* And the number we deferred executing because of job limits */
-    int deferred;
+    /* The number of waiting jobs a worker has been signaled to run */
+    std::atomic <int> ready;
 
     /* Notification callbacks */
     beast::insight::Event dequeue;
     beast::insight::Event execute;
 
+    /* Time spent waiting in the queue and running, for recent jobs */
+    LatencyHistogram dequeueLatency;
+    LatencyHistogram executeLatency;
+
+    /* Percentiles of the histograms, updated when insight collects */
+    beast::insight::Gauge dequeueP50;
+    beast::insight::Gauge dequeueP99;
+    beast::insight::Gauge dequeueP999;
+    beast::insight::Gauge executeP50;
+    beast::insight::Gauge executeP99;
+    beast::insight::Gauge executeP999;
+
     explicit JobTypeData (JobTypeInfo const& info_, 
             beast::insight::Collector::ptr const& collector) noexcept
         : m_collector (collector)
         , info (info_)
         , waiting (0)
         , running (0)
-        , deferred (0)
+        , ready (0)
     {
         m_load.setTargetLatency (
             info.getAverageLatency (),
@@ -70,6 +93,13 @@ public:
         {
             dequeue = m_collector->make_event (info.name () + "_q");
             execute = m_collector->make_event (info.name ());
+
+            dequeueP50 = m_collector->make_gauge (info.name () + "_q_p50");
+            dequeueP99 = m_collector->make_gauge (info.name () + "_q_p99");
+            dequeueP999 = m_collector->make_gauge (info.name () + "_q_p999");
+            executeP50 = m_collector->make_gauge (info.name () + "_p50");
+            executeP99 = m_collector->make_gauge (info.name () + "_p99");
+            executeP999 = m_collector->make_gauge (info.name () + "_p999");
         }
     }
 
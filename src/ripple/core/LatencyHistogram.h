@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_CORE_LATENCYHISTOGRAM_H_INCLUDED
+#define RIPPLE_CORE_LATENCYHISTOGRAM_H_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ripple {
+
+/** A histogram of latencies with bounded relative error.
+
+    Latencies are counted in microseconds. Values below 16 have a bucket
+    each; above that every power of two is split into 16 buckets, so a
+    reported value is within 1/16 of what was recorded. Recording is a
+    single atomic increment and may be done from any thread.
+
+    Samples are kept for the current and the previous period only, so the
+    percentiles follow recent behavior. The owner starts each new period
+    by calling rotate.
+*/
+class LatencyHistogram
+{
+public:
+    typedef std::chrono::microseconds duration;
+
+    LatencyHistogram ();
+
+    LatencyHistogram (LatencyHistogram const&) = delete;
+    LatencyHistogram& operator= (LatencyHistogram const&) = delete;
+
+    /** Record one latency. */
+    void insert (duration value);
+
+    /** Returns the number of latencies recorded. */
+    std::uint64_t count () const;
+
+    /** Start a new period, discarding the samples of the one before last.
+        A sample recorded while this runs may be lost.
+    */
+    void rotate ();
+
+    /** Returns the latency at or below which a fraction of samples fall.
+
+        @param fraction A value from 0 to 1, for example 0.99.
+        @return The highest latency in the bucket holding that sample, or
+                zero if nothing was recorded.
+    */
+    duration percentile (double fraction) const;
+
+private:
+    enum
+    {
+        subBucketBits = 4,
+        subBuckets = 1 << subBucketBits,
+
+        // Latencies beyond 2^36 microseconds (about 19 hours) are clamped
+        maxExponent = 35,
+
+        bucketCount = subBuckets + (maxExponent - subBucketBits + 1) * subBuckets
+    };
+
+    static int bucketFor (std::uint64_t value);
+
+    static std::uint64_t highestValueIn (int bucket);
+
+    typedef std::array <std::atomic <std::uint64_t>, bucketCount> Buckets;
+
+    // Copies the counts of both periods, returning their total
+    std::uint64_t snapshot (std::array <std::uint64_t, bucketCount>& counts) const;
+
+    // The buckets of the current and previous periods
+    std::array <Buckets, 2> m_periods;
+    std::atomic <int> m_current;
+};
+
+} // ripple
+
+#endif
@@ -0,0 +1,63 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_CORE_WORKERPOOL_H_INCLUDED
+#define RIPPLE_CORE_WORKERPOOL_H_INCLUDED
+
+#include <cstddef>
+#include <functional>
+
+namespace ripple {
+
+/** A shared set of threads for splitting up CPU bound work.
+
+    There is one pool per process, with a thread for each processor,
+    created on first use. Code that divides a computation into independent
+    parts uses the pool rather than starting threads of its own, so the
+    number of threads busy at once stays bounded however many callers
+    there are.
+*/
+class WorkerPool
+{
+public:
+    /** Call `work` once for each index in [0, count).
+
+        The calling thread takes part, and the call returns when every
+        index has been processed. The caller only waits for indexes that
+        another thread has already started, so this may be called from a
+        job or from inside other work on the pool. If `work` throws, the
+        first exception is rethrown here once the other indexes are done.
+
+        @param maxThreads The most threads to use, counting the caller,
+                          or zero to use the whole pool.
+    */
+    static void forEach (std::size_t count,
+        std::function <void (std::size_t)> const& work, int maxThreads = 0);
+
+    /** Return the number of threads in the pool. */
+    static int size ();
+};
+
+} // ripple
+
+#endif
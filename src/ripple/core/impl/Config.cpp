@@ -265,6 +265,9 @@ Config::Config ()
 
     PEER_PRIVATE            = false;
     PEERS_MAX               = 0;    // indicates "use default"
+    PEER_SEND_BYTES         = 0;    // indicates "use default"
+    PEER_SEND_RATE          = false;
+    PEER_COMPRESSION        = true;
 
     TRANSACTION_FEE_BASE    = DEFAULT_TRANSACTION_FEE_BASE;
 
@@ -279,6 +282,10 @@ Config::Config ()
 
     LEDGER_HISTORY          = 256;
     FETCH_DEPTH             = 1000000000;
+    SYNC_THREADS            = 1;
+    TXN_DB_BINARY           = false;
+    JOB_TRACE               = 0;
+    RPC_SUB_QUEUE           = 1024;
 
     // An explanation of these magical values would be nice.
     PATH_SEARCH_OLD         = 7;
@@ -504,6 +511,15 @@ void Config::load ()
             if (getSingleSection (secConfig, SECTION_PEERS_MAX, strTemp))
                 PEERS_MAX           = beast::lexicalCastThrow <int> (strTemp);
 
+            if (getSingleSection (secConfig, SECTION_PEER_SEND_BYTES, strTemp))
+                PEER_SEND_BYTES     = beast::lexicalCastThrow <unsigned int> (strTemp);
+
+            if (getSingleSection (secConfig, SECTION_PEER_SEND_RATE, strTemp))
+                PEER_SEND_RATE      = beast::lexicalCastThrow <bool> (strTemp);
+
+            if (getSingleSection (secConfig, SECTION_PEER_COMPRESSION, strTemp))
+                PEER_COMPRESSION    = beast::lexicalCastThrow <bool> (strTemp);
+
             smtTmp = getIniFileSection (secConfig, SECTION_RPC_ADMIN_ALLOW);
 
             if (smtTmp)
@@ -705,6 +721,35 @@ void Config::load ()
                     FETCH_DEPTH = 10;
             }
 
+            if (getSingleSection (secConfig, SECTION_SYNC_THREADS, strTemp))
+            {
+                SYNC_THREADS = beast::lexicalCastThrow <int> (strTemp);
+
+                if (SYNC_THREADS < 1)
+                    SYNC_THREADS = 1;
+                else if (SYNC_THREADS > 16)
+                    SYNC_THREADS = 16;
+            }
+
+            if (getSingleSection (secConfig, SECTION_TXN_DB_BINARY, strTemp))
+                TXN_DB_BINARY       = beast::lexicalCastThrow <bool> (strTemp);
+
+            if (getSingleSection (secConfig, SECTION_JOB_TRACE, strTemp))
+            {
+                JOB_TRACE = beast::lexicalCastThrow <int> (strTemp);
+
+                if (JOB_TRACE < 0)
+                    JOB_TRACE = 0;
+            }
+
+            if (getSingleSection (secConfig, SECTION_RPC_SUB_QUEUE, strTemp))
+            {
+                RPC_SUB_QUEUE = beast::lexicalCastThrow <int> (strTemp);
+
+                if (RPC_SUB_QUEUE < 1)
+                    RPC_SUB_QUEUE = 1;
+            }
+
             if (getSingleSection (secConfig, SECTION_PATH_SEARCH_OLD, strTemp))
                 PATH_SEARCH_OLD     = beast::lexicalCastThrow <int> (strTemp);
             if (getSingleSection (secConfig, SECTION_PATH_SEARCH, strTemp))
@@ -89,6 +89,11 @@ void Job::rename (std::string const& newName)
     mName = newName;
 }
 
+std::string const& Job::getName () const
+{
+    return mName;
+}
+
 bool Job::operator> (const Job& j) const
 {
     if (mType < j.mType)
@@ -25,40 +25,90 @@
 #include <ripple/core/JobTypes.h>
 #include <ripple/core/JobTypeInfo.h>
 #include <ripple/core/JobTypeData.h>
+#include <ripple/core/LatencyHistogram.h>
 
 #include <beast/cxx14/memory.h>
 #include <beast/chrono/chrono_util.h>
+#include <beast/insight/NullCollector.h>
 #include <beast/module/core/thread/Workers.h>
 #include <beast/module/core/system/SystemStats.h>
+#include <beast/unit_test/suite.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <mutex>
-#include <set>
+#include <random>
+#include <thread>
+#include <vector>
 
 namespace ripple {
 
+/** Dispatches jobs to a pool of worker threads by priority.
+
+    Each job type has its own queue and counts, guarded by a lock for that
+    type alone. Adding a job signals a worker only while the type is below
+    its limit of running jobs; otherwise the job waits until one of that
+    type finishes. A signaled worker takes the oldest job of the highest
+    priority type that has one ready, so types at their limit are never
+    walked past and unrelated types never contend for a lock.
+*/
 class JobQueueImp
     : public JobQueue
     , private beast::Workers::Callback
 {
 public:
-    typedef std::set <Job> JobSet;
     typedef std::map <JobType, JobTypeData> JobDataMap;
     typedef std::lock_guard <std::mutex> ScopedLock;
 
     beast::Journal m_journal;
-    std::mutex m_mutex;
-    std::uint64_t m_lastJob;
-    JobSet m_jobSet;
+    std::atomic <std::uint64_t> m_lastJob;
     JobDataMap m_jobData;
     JobTypeData m_invalidJobData;
 
+    // The job types from highest to lowest priority
+    std::vector <JobTypeData*> m_priority;
+
+    // The number of jobs waiting in all queues
+    std::atomic <int> m_jobCount;
+
     // The number of jobs currently in processTask()
-    int m_processCount;
+    std::atomic <int> m_processCount;
 
     beast::Workers m_workers;
     Job::CancelCallback m_cancelCallback;
 
+    // A job which ran for at least the slow job threshold
+    struct SlowJob
+    {
+        std::string name;
+        JobType type;
+        std::chrono::microseconds wait;
+        std::chrono::microseconds run;
+        Job::clock_type::time_point finished;
+    };
+
+    enum
+    {
+        // The number of recent slow jobs kept
+        slowJobTraceSize = 64,
+
+        // Latency percentiles cover between one and two of these periods
+        latencyPeriodSeconds = 300
+    };
+
+    // Runs of at least this many microseconds are traced, zero for none
+    std::atomic <std::int64_t> m_slowJobThreshold;
+
+    // The most recent slow jobs, oldest overwritten first
+    std::mutex m_slowJobMutex;
+    std::vector <SlowJob> m_slowJobs;
+    std::size_t m_slowJobNext;
+
+    // When the latency histograms next start a new period, in clock ticks
+    std::atomic <Job::clock_type::rep> m_nextLatencyPeriod;
+
     // statistics tracking
     beast::insight::Collector::ptr m_collector;
     beast::insight::Gauge job_count;
@@ -79,30 +129,34 @@ public:
         , m_journal (journal)
         , m_lastJob (0)
         , m_invalidJobData (getJobTypes ().getInvalid (), collector)
+        , m_jobCount (0)
         , m_processCount (0)
         , m_workers (*this, "JobQueue", 0)
         , m_cancelCallback (std::bind (&Stoppable::isStopping, this))
+        , m_slowJobThreshold (0)
+        , m_slowJobNext (0)
+        , m_nextLatencyPeriod (0)
         , m_collector (collector)
     {
         hook = m_collector->make_hook (std::bind (
             &JobQueueImp::collect, this));
         job_count = m_collector->make_gauge ("job_count");
 
+        for (auto const& x : getJobTypes ())
         {
-            ScopedLock lock (m_mutex);
-
-            for (auto const& x : getJobTypes ())
-            {
-                JobTypeInfo const& jt = x.second;
-
-                // And create dynamic information for all jobs
-                auto const result (m_jobData.emplace (std::piecewise_construct,
-                    std::forward_as_tuple (jt.type ()),
-                    std::forward_as_tuple (jt, m_collector)));
-                assert (result.second == true);
-                (void) result.second;
-            }
+            JobTypeInfo const& jt = x.second;
+
+            // And create dynamic information for all jobs
+            auto const result (m_jobData.emplace (std::piecewise_construct,
+                std::forward_as_tuple (jt.type ()),
+                std::forward_as_tuple (jt, m_collector)));
+            assert (result.second == true);
+            (void) result.second;
         }
+
+        // Later job types have higher priority
+        for (auto iter (m_jobData.rbegin ()); iter != m_jobData.rend (); ++iter)
+            m_priority.push_back (&iter->second);
     }
 
     ~JobQueueImp ()
@@ -113,8 +167,23 @@ public:
 
     void collect ()
     {
-        ScopedLock lock (m_mutex);
-        job_count = m_jobSet.size ();
+        job_count = m_jobCount.load ();
+        rotateLatencies (Job::clock_type::now ());
+
+        for (auto& x : m_jobData)
+        {
+            JobTypeData& data (x.second);
+
+            if (data.info.special ())
+                continue;
+
+            data.dequeueP50 = data.dequeueLatency.percentile (0.5).count ();
+            data.dequeueP99 = data.dequeueLatency.percentile (0.99).count ();
+            data.dequeueP999 = data.dequeueLatency.percentile (0.999).count ();
+            data.executeP50 = data.executeLatency.percentile (0.5).count ();
+            data.executeP99 = data.executeLatency.percentile (0.99).count ();
+            data.executeP999 = data.executeLatency.percentile (0.999).count ();
+        }
     }
 
     void addJob (JobType type, std::string const& name,
@@ -146,10 +215,9 @@ public:
             //          OR
             //      * Not all children are stopped
             //
-            ScopedLock lock (m_mutex);
             assert (! isStopped() && (
                 m_processCount>0 ||
-                ! m_jobSet.empty () ||
+                m_jobCount>0 ||
                 ! areChildrenStopped()));
         }
 
@@ -163,31 +231,21 @@ public:
             return;
         }
 
-        {
-            ScopedLock lock (m_mutex);
-
-            std::pair <std::set <Job>::iterator, bool> result (
-                m_jobSet.insert (Job (type, name, ++m_lastJob,
-                    data.load (), jobFunc, m_cancelCallback)));
-            queueJob (*result.first, lock);
-        }
+        queueJob (Job (type, name, ++m_lastJob,
+            data.load (), jobFunc, m_cancelCallback), data);
     }
 
     int getJobCount (JobType t)
     {
-        ScopedLock lock (m_mutex);
-
         JobDataMap::const_iterator c = m_jobData.find (t);
 
         return (c == m_jobData.end ())
             ? 0
-            : c->second.waiting;
+            : c->second.waiting.load ();
     }
 
     int getJobCountTotal (JobType t)
     {
-        ScopedLock lock (m_mutex);
-
         JobDataMap::const_iterator c = m_jobData.find (t);
 
         return (c == m_jobData.end ())
@@ -200,8 +258,6 @@ public:
         // return the number of jobs at this priority level or greater
         int ret = 0;
 
-        ScopedLock lock (m_mutex);
-
         for (auto const& x : m_jobData)
         {
             if (x.first >= t)
@@ -303,8 +359,6 @@ public:
 
         Json::Value priorities = Json::arrayValue;
 
-        ScopedLock lock (m_mutex);
-
         for (auto& x : m_jobData)
         {
             assert (x.first != jtINVALID);
@@ -343,6 +397,12 @@ public:
 
                 if (running != 0)
                     pri["in_progress"] = running;
+
+                if (data.executeLatency.count () != 0)
+                {
+                    pri["queue_us"] = getPercentilesJson (data.dequeueLatency);
+                    pri["run_us"] = getPercentilesJson (data.executeLatency);
+                }
             }
         }
 
@@ -351,6 +411,44 @@ public:
         return ret;
     }
 
+    void setSlowJobThreshold (std::chrono::milliseconds threshold)
+    {
+        m_slowJobThreshold = std::chrono::duration_cast <
+            std::chrono::microseconds> (threshold).count ();
+    }
+
+    Json::Value getLatencyJson ()
+    {
+        rotateLatencies (Job::clock_type::now ());
+
+        Json::Value ret (Json::objectValue);
+
+        Json::Value& types (ret["job_types"] = Json::objectValue);
+
+        for (auto& x : m_jobData)
+        {
+            if (x.first == jtGENERIC)
+                continue;
+
+            JobTypeData& data (x.second);
+
+            std::uint64_t const count (data.executeLatency.count ());
+
+            if (count == 0)
+                continue;
+
+            Json::Value& type (types[data.name ()] = Json::objectValue);
+            type["count"] = static_cast <Json::UInt> (count);
+            type["queue_us"] = getPercentilesJson (data.dequeueLatency);
+            type["run_us"] = getPercentilesJson (data.executeLatency);
+        }
+
+        if (m_slowJobThreshold != 0)
+            ret["slow_jobs"] = getSlowJobsJson ();
+
+        return ret;
+    }
+
 private:
     //--------------------------------------------------------------------------
     JobTypeData& getJobTypeData (JobType type)
@@ -370,19 +468,21 @@ private:
 
     // Signals the service stopped if the stopped condition is met.
     //
-    void checkStopped (ScopedLock const& lock)
+    void checkStopped ()
     {
         // We are stopped when all of the following are true:
         //
         //  1. A stop notification was received
         //  2. All Stoppable children have stopped
         //  3. There are no executing calls to processTask
-        //  4. There are no remaining Jobs in the job set
+        //  4. There are no remaining Jobs in the queues
+        //
+        // Signaling stopped more than once is harmless.
         //
         if (isStopping() &&
             areChildrenStopped() &&
             (m_processCount == 0) &&
-            m_jobSet.empty())
+            (m_jobCount == 0))
         {
             stopped();
         }
@@ -390,39 +490,45 @@ private:
 
     //--------------------------------------------------------------------------
     //
-    // Signals an added Job for processing.
+    // Adds a Job to the queue for its type, signaling a worker if the
+    // type is below its limit.
     //
     // Pre-conditions:
     //  The JobType must be valid.
-    //  The Job must exist in mJobSet.
-    //  The Job must not have previously been queued.
     //
     // Post-conditions:
     //  Count of waiting jobs of that type will be incremented.
     //  If JobQueue exists, and has at least one thread, Job will eventually run.
     //
     // Invariants:
-    //  The calling thread owns the JobLock
+    //  For each type, ready <= waiting and ready + running <= limit
     //
-    void queueJob (Job const& job, ScopedLock const& lock)
+    void queueJob (Job const& job, JobTypeData& data)
     {
         JobType const type (job.getType ());
         assert (type != jtINVALID);
-        assert (m_jobSet.find (job) != m_jobSet.end ());
 
-        JobTypeData& data (getJobTypeData (type));
+        // Count the job before it can be seen so we can't appear stopped
+        ++m_jobCount;
+
+        bool signal (false);
 
-        if (data.waiting + data.running < getJobLimit (type))
-        {
-            m_workers.addTask ();
-        }
-        else
         {
-            // defer the task until we go below the limit
-            //
-            ++data.deferred;
+            ScopedLock lock (data.mutex);
+
+            data.jobs.push_back (job);
+            ++data.waiting;
+
+            if (data.running + data.ready < getJobLimit (type))
+            {
+                ++data.ready;
+                signal = true;
+            }
         }
-        ++data.waiting;
+
+        // Otherwise the job waits until a running job of its type finishes
+        if (signal)
+            m_workers.addTask ();
     }
 
     //------------------------------------------------------------------------------
@@ -430,52 +536,49 @@ private:
     // Returns the next Job we should run now.
     //
     // RunnableJob:
-    //  A Job in the JobSet whose slots count for its type is greater than zero.
+    //  The oldest Job of a type whose ready count is greater than zero.
     //
     // Pre-conditions:
-    //  mJobSet must not be empty.
-    //  mJobSet holds at least one RunnableJob
+    //  The caller was signaled by the Workers, so a RunnableJob exists.
     //
     // Post-conditions:
     //  job is a valid Job object.
-    //  job is removed from mJobQueue.
-    //  Waiting job count of it's type is decremented
+    //  job is removed from the queue for its type.
+    //  Waiting and ready job counts of it's type are decremented
     //  Running job count of it's type is incremented
     //
-    // Invariants:
-    //  The calling thread owns the JobLock
-    //
-    void getNextJob (Job& job, ScopedLock const& lock)
+    void getNextJob (Job& job)
     {
-        assert (! m_jobSet.empty ());
-
-        JobSet::const_iterator iter;
-        for (iter = m_jobSet.begin (); iter != m_jobSet.end (); ++iter)
+        for (;;)
         {
-            JobTypeData& data (getJobTypeData (iter->getType ()));
-
-            assert (data.running <= getJobLimit (data.type ()));
-
-            // Run this job if we're running below the limit.
-            if (data.running < getJobLimit (data.type ()))
+            for (JobTypeData* data : m_priority)
             {
-                assert (data.waiting > 0);
-                break;
-            }
-        }
+                // Cheap check first, types at their limit are never ready
+                if (data->ready.load () == 0)
+                    continue;
 
-        assert (iter != m_jobSet.end ());
+                ScopedLock lock (data->mutex);
 
-        JobType const type = iter->getType ();
-        JobTypeData& data (getJobTypeData (type));
+                if (data->ready == 0)
+                    continue;
 
-        assert (type != jtINVALID);
+                assert (! data->jobs.empty ());
+                assert (data->type () != jtINVALID);
+
+                job = std::move (data->jobs.front ());
+                data->jobs.pop_front ();
 
-        job = *iter;
-        m_jobSet.erase (iter);
+                --data->ready;
+                --data->waiting;
+                ++data->running;
+                --m_jobCount;
+                return;
+            }
 
-        --data.waiting;
-        ++data.running;
+            // Every signal has a ready job, but another worker that started
+            // scanning later may have taken the one we were heading for.
+            std::this_thread::yield ();
+        }
     }
 
     //------------------------------------------------------------------------------
@@ -483,35 +586,38 @@ private:
     // Indicates that a running Job has completed its task.
     //
     // Pre-conditions:
-    //  Job must not exist in mJobSet.
     //  The JobType must not be invalid.
     //
     // Post-conditions:
     //  The running count of that JobType is decremented
-    //  A new task is signaled if there are more waiting Jobs than the limit, if any.
-    //
-    // Invariants:
-    //  <none>
+    //  A new task is signaled if that type has a waiting Job without one.
     //
-    void finishJob (Job const& job, ScopedLock const& lock)
+    void finishJob (Job const& job)
     {
         JobType const type = job.getType ();
 
-        assert (m_jobSet.find (job) == m_jobSet.end ());
         assert (type != jtINVALID);
 
         JobTypeData& data (getJobTypeData (type));
 
-        // Queue a deferred task if possible
-        if (data.deferred > 0)
+        bool signal (false);
+
         {
-            assert (data.running + data.waiting >= getJobLimit (type));
+            ScopedLock lock (data.mutex);
 
-            --data.deferred;
-            m_workers.addTask ();
+            --data.running;
+
+            // Queue a deferred task if possible
+            if (data.waiting > data.ready &&
+                data.running + data.ready < getJobLimit (type))
+            {
+                ++data.ready;
+                signal = true;
+            }
         }
 
-        --data.running;
+        if (signal)
+            m_workers.addTask ();
     }
 
     //--------------------------------------------------------------------------
@@ -519,20 +625,135 @@ private:
     void on_dequeue (JobType type,
         std::chrono::duration <Rep, Period> const& value)
     {
+        JobTypeData& data (getJobTypeData (type));
         auto const ms (ceil <std::chrono::milliseconds> (value));
 
+        data.dequeueLatency.insert (std::chrono::duration_cast <
+            LatencyHistogram::duration> (value));
+
         if (ms.count() >= 10)
-            getJobTypeData (type).dequeue.notify (ms);
+            data.dequeue.notify (ms);
     }
 
     template <class Rep, class Period>
     void on_execute (JobType type,
         std::chrono::duration <Rep, Period> const& value)
     {
+        JobTypeData& data (getJobTypeData (type));
         auto const ms (ceil <std::chrono::milliseconds> (value));
 
+        data.executeLatency.insert (std::chrono::duration_cast <
+            LatencyHistogram::duration> (value));
+
         if (ms.count() >= 10)
-            getJobTypeData (type).execute.notify (ms);
+            data.execute.notify (ms);
+    }
+
+    // Starts a new period in every latency histogram once the current
+    // period is old enough, so the percentiles reflect recent jobs
+    void rotateLatencies (Job::clock_type::time_point now)
+    {
+        Job::clock_type::rep const ticks (now.time_since_epoch ().count ());
+        Job::clock_type::rep due (m_nextLatencyPeriod.load ());
+
+        if (ticks < due)
+            return;
+
+        Job::clock_type::rep const next (ticks + std::chrono::duration_cast <
+            Job::clock_type::duration> (std::chrono::seconds (
+                latencyPeriodSeconds)).count ());
+
+        // Only one caller rotates
+        if (! m_nextLatencyPeriod.compare_exchange_strong (due, next))
+            return;
+
+        for (auto& x : m_jobData)
+        {
+            x.second.dequeueLatency.rotate ();
+            x.second.executeLatency.rotate ();
+        }
+    }
+
+    // Records the job in the slow job trace if it ran long enough
+    void traceSlowJob (Job const& job, Job::clock_type::time_point start,
+        Job::clock_type::time_point finish)
+    {
+        std::int64_t const threshold (m_slowJobThreshold.load ());
+
+        if (threshold == 0)
+            return;
+
+        auto const run (std::chrono::duration_cast <
+            std::chrono::microseconds> (finish - start));
+
+        if (run.count () < threshold)
+            return;
+
+        SlowJob slow;
+        slow.name = job.getName ();
+        slow.type = job.getType ();
+        slow.wait = std::chrono::duration_cast <std::chrono::microseconds> (
+            start - job.queue_time ());
+        slow.run = run;
+        slow.finished = finish;
+
+        std::lock_guard <std::mutex> lock (m_slowJobMutex);
+
+        if (m_slowJobs.size () < slowJobTraceSize)
+        {
+            m_slowJobs.push_back (std::move (slow));
+        }
+        else
+        {
+            m_slowJobs [m_slowJobNext] = std::move (slow);
+            m_slowJobNext = (m_slowJobNext + 1) % slowJobTraceSize;
+        }
+    }
+
+    // Returns the traced jobs, slowest first
+    Json::Value getSlowJobsJson ()
+    {
+        std::vector <SlowJob> jobs;
+
+        {
+            std::lock_guard <std::mutex> lock (m_slowJobMutex);
+            jobs = m_slowJobs;
+        }
+
+        std::sort (jobs.begin (), jobs.end (),
+            [](SlowJob const& lhs, SlowJob const& rhs)
+            {
+                return lhs.run > rhs.run;
+            });
+
+        Job::clock_type::time_point const now (Job::clock_type::now ());
+        Json::Value ret (Json::arrayValue);
+
+        for (auto const& slow : jobs)
+        {
+            Json::Value& entry (ret.append (Json::objectValue));
+            entry["name"] = slow.name;
+            entry["job_type"] = getJobTypes ().get (slow.type).name ();
+            entry["queue_us"] = static_cast <Json::UInt> (slow.wait.count ());
+            entry["run_us"] = static_cast <Json::UInt> (slow.run.count ());
+            entry["age_seconds"] = static_cast <Json::UInt> (
+                std::chrono::duration_cast <std::chrono::seconds> (
+                    now - slow.finished).count ());
+        }
+
+        return ret;
+    }
+
+    static Json::Value getPercentilesJson (LatencyHistogram const& histogram)
+    {
+        Json::Value ret (Json::objectValue);
+        ret["p50"] = static_cast <Json::UInt> (
+            histogram.percentile (0.5).count ());
+        ret["p99"] = static_cast <Json::UInt> (
+            histogram.percentile (0.99).count ());
+        ret["p999"] = static_cast <Json::UInt> (
+            histogram.percentile (0.999).count ());
+        return ret;
     }
 
     //--------------------------------------------------------------------------
@@ -540,7 +761,7 @@ private:
     // Runs the next appropriate waiting Job.
     //
     // Pre-conditions:
-    //  A RunnableJob must exist in the JobSet
+    //  A RunnableJob must exist in one of the queues
     //
     // Post-conditions:
     //  The chosen RunnableJob will have Job::doJob() called.
@@ -552,11 +773,8 @@ private:
     {
         Job job;
 
-        {
-            ScopedLock lock (m_mutex);
-            getNextJob (job, lock);
-            ++m_processCount;
-        }
+        ++m_processCount;
+        getNextJob (job);
 
         JobTypeData& data (getJobTypeData (job.getType ()));
 
@@ -573,19 +791,22 @@ private:
 
             on_dequeue (job.getType (), start_time - job.queue_time ());
             job.doJob ();
-            on_execute (job.getType (), Job::clock_type::now() - start_time);
+
+            Job::clock_type::time_point const finish_time (
+                Job::clock_type::now());
+
+            on_execute (job.getType (), finish_time - start_time);
+            traceSlowJob (job, start_time, finish_time);
+            rotateLatencies (finish_time);
         }
         else
         {
             m_journal.trace << "Skipping processTask ('" << data.name () << "')";
         }
 
-        {
-            ScopedLock lock (m_mutex);
-            finishJob (job, lock);
-            --m_processCount;
-            checkStopped (lock);
-        }
+        finishJob (job);
+        --m_processCount;
+        checkStopped ();
 
         // Note that when Job::~Job is called, the last reference
         // to the associated LoadEvent object (in the Job) may be destroyed.
@@ -673,9 +894,7 @@ private:
 
     void onChildrenStopped ()
     {
-        ScopedLock lock (m_mutex);
-
-        checkStopped (lock);
+        checkStopped ();
     }
 };
 
@@ -695,4 +914,326 @@ std::unique_ptr <JobQueue> make_JobQueue (
     return std::make_unique <JobQueueImp> (collector, parent, journal);
 }
 
+//------------------------------------------------------------------------------
+
+class JobQueue_test : public beast::unit_test::suite
+{
+public:
+    // Long enough for a worker to pick up a job it should not
+    static std::chrono::milliseconds settle ()
+    {
+        return std::chrono::milliseconds (50);
+    }
+
+    // Records what the jobs did, and lets the test hold a job while it runs
+    struct Recorder
+    {
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::vector <int> order;
+        int running = 0;
+        int maxRunning = 0;
+        bool held = false;
+        bool release = false;
+
+        // Waits up to ten seconds for the predicate, returning its value
+        template <class Predicate>
+        bool wait (Predicate pred)
+        {
+            std::unique_lock <std::mutex> lock (mutex);
+            return cond.wait_for (lock, std::chrono::seconds (10), pred);
+        }
+
+        bool done (std::size_t count)
+        {
+            return wait ([this, count] { return order.size () >= count; });
+        }
+
+        // A job that records its id
+        void record (int id, Job&)
+        {
+            std::lock_guard <std::mutex> lock (mutex);
+            order.push_back (id);
+            cond.notify_all ();
+        }
+
+        // A job that counts how many of its kind run at once
+        void overlap (int id, Job&)
+        {
+            {
+                std::lock_guard <std::mutex> lock (mutex);
+                maxRunning = std::max (maxRunning, ++running);
+            }
+
+            std::this_thread::sleep_for (std::chrono::milliseconds (2));
+
+            std::lock_guard <std::mutex> lock (mutex);
+            --running;
+            order.push_back (id);
+            cond.notify_all ();
+        }
+
+        // A job that runs until the test releases it
+        void hold (int id, Job&)
+        {
+            std::unique_lock <std::mutex> lock (mutex);
+            held = true;
+            cond.notify_all ();
+            cond.wait (lock, [this] { return release; });
+            order.push_back (id);
+            cond.notify_all ();
+        }
+
+        void unhold ()
+        {
+            std::lock_guard <std::mutex> lock (mutex);
+            release = true;
+            cond.notify_all ();
+        }
+    };
+
+    static boost::function <void (Job&)> job (Recorder& r,
+        void (Recorder::*f) (int, Job&), int id)
+    {
+        return std::bind (f, &r, id, std::placeholders::_1);
+    }
+
+    std::unique_ptr <JobQueue> makeQueue (beast::Stoppable& parent,
+        int threads)
+    {
+        std::unique_ptr <JobQueue> jq (make_JobQueue (
+            beast::insight::NullCollector::New (), parent, beast::Journal ()));
+        jq->setThreadCount (threads, false);
+        return jq;
+    }
+
+    void testLimit ()
+    {
+        testcase ("limit");
+
+        beast::RootStoppable root ("root");
+        auto jq (makeQueue (root, 6));
+        Recorder r;
+
+        // Ledger data jobs are limited to two at once
+        int const count = 20;
+        for (int i = 0; i < count; ++i)
+            jq->addJob (jtLEDGER_DATA, "test",
+                job (r, &Recorder::overlap, i));
+
+        expect (r.done (count), "jobs did not finish");
+        expect (r.maxRunning <= 2, "limit exceeded");
+    }
+
+    void testHeld ()
+    {
+        testcase ("held");
+
+        beast::RootStoppable root ("root");
+        auto jq (makeQueue (root, 2));
+        Recorder r;
+
+        // Fetch packs run one at a time
+        jq->addJob (jtPACK, "test", job (r, &Recorder::hold, 0));
+        expect (r.wait ([&r] { return r.held; }), "first job did not start");
+
+        jq->addJob (jtPACK, "test", job (r, &Recorder::record, 1));
+        std::this_thread::sleep_for (settle ());
+        expect (jq->getJobCount (jtPACK) == 1, "second job not waiting");
+        {
+            std::lock_guard <std::mutex> lock (r.mutex);
+            expect (r.order.empty (), "second job ran past the limit");
+        }
+
+        r.unhold ();
+        expect (r.done (2), "held job did not run");
+        expect (r.order == std::vector <int> ({ 0, 1 }), "wrong order");
+    }
+
+    void testPriority ()
+    {
+        testcase ("priority");
+
+        beast::RootStoppable root ("root");
+        auto jq (makeQueue (root, 1));
+        Recorder r;
+
+        jq->addJob (jtCLIENT, "test", job (r, &Recorder::hold, 0));
+        expect (r.wait ([&r] { return r.held; }), "first job did not start");
+
+        // Queued lowest priority first
+        jq->addJob (jtPACK, "test", job (r, &Recorder::record, 1));
+        jq->addJob (jtTRANSACTION, "test", job (r, &Recorder::record, 2));
+        jq->addJob (jtADMIN, "test", job (r, &Recorder::record, 3));
+
+        r.unhold ();
+        expect (r.done (4), "jobs did not finish");
+        expect (r.order == std::vector <int> ({ 0, 3, 2, 1 }),
+            "jobs did not run in priority order");
+    }
+
+    void testOrder ()
+    {
+        testcase ("order");
+
+        beast::RootStoppable root ("root");
+        auto jq (makeQueue (root, 1));
+        Recorder r;
+
+        jq->addJob (jtCLIENT, "test", job (r, &Recorder::hold, 0));
+        expect (r.wait ([&r] { return r.held; }), "first job did not start");
+
+        std::vector <int> expected (1, 0);
+        for (int i = 1; i <= 10; ++i)
+        {
+            jq->addJob (jtCLIENT, "test", job (r, &Recorder::record, i));
+            expected.push_back (i);
+        }
+
+        r.unhold ();
+        expect (r.done (expected.size ()), "jobs did not finish");
+        expect (r.order == expected, "jobs of one type out of order");
+    }
+
+    void testStop ()
+    {
+        testcase ("stop");
+
+        beast::RootStoppable root ("root");
+        auto jq (makeQueue (root, 1));
+        Recorder r;
+        root.start ();
+
+        // Accepting a ledger is not skipped when stopping
+        jq->addJob (jtACCEPT, "test", job (r, &Recorder::hold, 0));
+        expect (r.wait ([&r] { return r.held; }), "first job did not start");
+        jq->addJob (jtACCEPT, "test", job (r, &Recorder::record, 1));
+
+        std::atomic <bool> stopped (false);
+        std::thread stopper ([&root, &stopped]
+        {
+            root.stop ();
+            stopped = true;
+        });
+
+        std::this_thread::sleep_for (settle ());
+        expect (! stopped.load (), "stopped with jobs pending");
+
+        r.unhold ();
+        stopper.join ();
+        expect (stopped.load (), "did not stop");
+        expect (r.order == std::vector <int> ({ 0, 1 }),
+            "pending jobs were not run before stopping");
+    }
+
+    void run ()
+    {
+        testLimit ();
+        testHeld ();
+        testPriority ();
+        testOrder ();
+        testStop ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(JobQueue,ripple_core,ripple);
+
+//------------------------------------------------------------------------------
+
+/** Measures JobQueue throughput with a mixed priority workload.
+
+    Producer threads add jobs of several types while the workers drain them.
+    A large share of the jobs carry ledger data, a type limited to two
+    running at once, so a backlog of blocked jobs builds up ahead of the
+    lower priority proposals and validations, as it does while a server is
+    acquiring ledgers.
+*/
+class JobQueue_timing_test : public beast::unit_test::suite
+{
+public:
+    static int const producers = 2;
+    static int const jobsPerProducer = 100000;
+
+    struct Workload
+    {
+        std::atomic <int> remaining;
+        std::mutex mutex;
+        std::condition_variable cond;
+    };
+
+    static void work (Workload& w, Job&)
+    {
+        // Enough work that the job is not free
+        std::uint64_t volatile x (0);
+        for (int i = 0; i < 200; ++i)
+            x = x + i;
+
+        if (--w.remaining == 0)
+        {
+            std::lock_guard <std::mutex> lock (w.mutex);
+            w.cond.notify_all ();
+        }
+    }
+
+    static void produce (JobQueue& jq, Workload& w, std::uint32_t seed)
+    {
+        static JobType const types [] = {
+            jtLEDGER_DATA, jtLEDGER_DATA, jtLEDGER_DATA,
+            jtPROPOSAL_ut, jtPROPOSAL_ut, jtPROPOSAL_ut,
+            jtVALIDATION_ut, jtVALIDATION_ut,
+            jtTRANSACTION, jtTRANSACTION };
+
+        std::mt19937 gen (seed);
+        std::uniform_int_distribution <int> dist (0, 9);
+        for (int i = 0; i < jobsPerProducer; ++i)
+            jq.addJob (types [dist (gen)], "timing", std::bind (
+                &work, std::ref (w), std::placeholders::_1));
+    }
+
+    double time (int threads)
+    {
+        beast::RootStoppable root ("root");
+        std::unique_ptr <JobQueue> jq (make_JobQueue (
+            beast::insight::NullCollector::New (), root, beast::Journal ()));
+        jq->setThreadCount (threads, false);
+
+        Workload w;
+        w.remaining = producers * jobsPerProducer;
+
+        auto const start = std::chrono::steady_clock::now ();
+        std::vector <std::thread> v;
+        for (int i = 0; i < producers; ++i)
+            v.emplace_back (&produce, std::ref (*jq), std::ref (w), i + 1);
+        for (auto& t : v)
+            t.join ();
+        {
+            std::unique_lock <std::mutex> lock (w.mutex);
+            w.cond.wait (lock, [&w] { return w.remaining == 0; });
+        }
+        auto const elapsed = std::chrono::steady_clock::now () - start;
+
+        return std::chrono::duration_cast <std::chrono::duration <double>> (
+            elapsed).count ();
+    }
+
+    void run ()
+    {
+        for (int threads : { 1, 2, 4, 8 })
+        {
+            std::stringstream ss;
+            ss << threads << " threads";
+            testcase (ss.str ());
+
+            double const t = time (threads);
+            int const count (producers * jobsPerProducer);
+
+            log << count << " jobs in " << t << "s, " <<
+                (count / t) << " per second";
+            pass ();
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(JobQueue_timing,ripple_core,ripple);
+
 }
@@ -0,0 +1,249 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/core/LatencyHistogram.h>
+#include <beast/unit_test/suite.h>
+#include <cmath>
+
+namespace ripple {
+
+LatencyHistogram::LatencyHistogram ()
+    : m_current (0)
+{
+    for (auto& period : m_periods)
+        for (auto& bucket : period)
+            bucket.store (0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::insert (duration value)
+{
+    std::uint64_t const us (
+        value.count () > 0 ? static_cast <std::uint64_t> (value.count ()) : 0);
+
+    m_periods [m_current.load (std::memory_order_relaxed)] [bucketFor (us)]
+        .fetch_add (1, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::count () const
+{
+    std::uint64_t result (0);
+
+    for (auto const& period : m_periods)
+        for (auto const& bucket : period)
+            result += bucket.load (std::memory_order_relaxed);
+
+    return result;
+}
+
+void LatencyHistogram::rotate ()
+{
+    // Clear the older period, then record into it
+    int const next (1 - m_current.load ());
+
+    for (auto& bucket : m_periods [next])
+        bucket.store (0, std::memory_order_relaxed);
+
+    m_current.store (next);
+}
+
+std::uint64_t LatencyHistogram::snapshot (
+    std::array <std::uint64_t, bucketCount>& counts) const
+{
+    std::uint64_t total (0);
+
+    for (int i = 0; i < bucketCount; ++i)
+    {
+        counts [i] = m_periods [0] [i].load (std::memory_order_relaxed) +
+            m_periods [1] [i].load (std::memory_order_relaxed);
+        total += counts [i];
+    }
+
+    return total;
+}
+
+LatencyHistogram::duration LatencyHistogram::percentile (double fraction) const
+{
+    // Take a snapshot so the total matches the buckets we walk
+    std::array <std::uint64_t, bucketCount> counts;
+    std::uint64_t const total (snapshot (counts));
+
+    if (total == 0)
+        return duration (0);
+
+    std::uint64_t rank (static_cast <std::uint64_t> (
+        std::ceil (fraction * total)));
+
+    if (rank < 1)
+        rank = 1;
+
+    std::uint64_t seen (0);
+
+    for (int i = 0; i < bucketCount; ++i)
+    {
+        seen += counts [i];
+
+        if (seen >= rank)
+            return duration (highestValueIn (i));
+    }
+
+    return duration (highestValueIn (bucketCount - 1));
+}
+
+int LatencyHistogram::bucketFor (std::uint64_t value)
+{
+    if (value < subBuckets)
+        return static_cast <int> (value);
+
+    int exponent (subBucketBits);
+
+    while (exponent < maxExponent && (value >> (exponent + 1)) != 0)
+        ++exponent;
+
+    if ((value >> (exponent + 1)) != 0)
+        return bucketCount - 1;
+
+    // The bits below the leading one select the bucket within the power
+    int const shift (exponent - subBucketBits);
+    int const sub (static_cast <int> (value >> shift) & (subBuckets - 1));
+
+    return subBuckets + (exponent - subBucketBits) * subBuckets + sub;
+}
+
+std::uint64_t LatencyHistogram::highestValueIn (int bucket)
+{
+    if (bucket < subBuckets)
+        return bucket;
+
+    int const shift ((bucket - subBuckets) / subBuckets);
+    int const sub ((bucket - subBuckets) % subBuckets);
+
+    std::uint64_t const lowest (
+        std::uint64_t (subBuckets + sub) << shift);
+
+    return lowest + (std::uint64_t (1) << shift) - 1;
+}
+
+//------------------------------------------------------------------------------
+
+class LatencyHistogram_test : public beast::unit_test::suite
+{
+public:
+    typedef LatencyHistogram::duration duration;
+
+    void testExact ()
+    {
+        testcase ("small values");
+
+        LatencyHistogram h;
+        expect (h.percentile (0.5) == duration (0), "empty not zero");
+
+        for (int i = 1; i <= 10; ++i)
+            h.insert (duration (i));
+
+        expect (h.count () == 10, "wrong count");
+        expect (h.percentile (0.5) == duration (5), "wrong median");
+        expect (h.percentile (0.99) == duration (10), "wrong p99");
+        expect (h.percentile (0) == duration (1), "wrong minimum");
+    }
+
+    void testError ()
+    {
+        testcase ("relative error");
+
+        for (std::uint64_t value : { 16ULL, 17ULL, 1000ULL, 12345ULL,
+            999999ULL, 3600000000ULL })
+        {
+            LatencyHistogram h;
+            h.insert (duration (value));
+
+            std::uint64_t const reported (h.percentile (0.5).count ());
+            expect (reported >= value, "reported below recorded");
+            expect (reported - value <= value / 16, "error above 1/16");
+        }
+
+        LatencyHistogram h;
+        h.insert (duration (-5));
+        h.insert (duration (std::chrono::hours (100000)));
+        expect (h.count () == 2, "out of range values dropped");
+    }
+
+    void testPercentiles ()
+    {
+        testcase ("percentiles");
+
+        LatencyHistogram h;
+
+        // 990 fast samples and 10 slow ones
+        for (int i = 0; i < 990; ++i)
+            h.insert (duration (100));
+        for (int i = 0; i < 9; ++i)
+            h.insert (duration (50000));
+        h.insert (duration (2000000));
+
+        expect (h.percentile (0.5).count () < 107, "wrong p50");
+        expect (h.percentile (0.99).count () < 107, "wrong p99");
+        expect (h.percentile (0.995).count () >= 50000, "wrong p995");
+        expect (h.percentile (0.999).count () >= 50000 &&
+            h.percentile (0.999).count () < 53125, "wrong p999");
+        expect (h.percentile (1).count () >= 2000000, "wrong maximum");
+    }
+
+    void testRotate ()
+    {
+        testcase ("rotate");
+
+        LatencyHistogram h;
+
+        for (int i = 0; i < 100; ++i)
+            h.insert (duration (5000));
+
+        h.rotate ();
+
+        for (int i = 0; i < 100; ++i)
+            h.insert (duration (10));
+
+        expect (h.count () == 200, "previous period dropped early");
+        expect (h.percentile (0.25) == duration (10), "wrong p25");
+        expect (h.percentile (0.99).count () >= 5000, "wrong p99");
+
+        h.rotate ();
+        expect (h.count () == 100, "old period kept");
+        expect (h.percentile (0.99) == duration (10), "old samples reported");
+
+        h.rotate ();
+        expect (h.count () == 0, "samples kept past two periods");
+        expect (h.percentile (0.5) == duration (0), "empty not zero");
+    }
+
+    void run ()
+    {
+        testExact ();
+        testError ();
+        testPercentiles ();
+        testRotate ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(LatencyHistogram,ripple_core,ripple);
+
+} // ripple
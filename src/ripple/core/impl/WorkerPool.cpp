@@ -0,0 +1,336 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/core/WorkerPool.h>
+#include <beast/module/core/thread/Workers.h>
+#include <beast/unit_test/suite.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ripple {
+
+namespace {
+
+class Pool : private beast::Workers::Callback
+{
+public:
+    Pool ()
+        : m_size (std::max (1, beast::SystemStats::getNumCpus ()))
+        , m_workers (*this, "WorkerPool", m_size)
+    {
+    }
+
+    int size () const
+    {
+        return m_size;
+    }
+
+    void post (std::function <void ()> task)
+    {
+        {
+            std::lock_guard <std::mutex> lock (m_mutex);
+            m_tasks.push_back (std::move (task));
+        }
+
+        m_workers.addTask ();
+    }
+
+private:
+    void processTask () override
+    {
+        std::function <void ()> task;
+
+        {
+            std::lock_guard <std::mutex> lock (m_mutex);
+            assert (!m_tasks.empty ());
+            task = std::move (m_tasks.front ());
+            m_tasks.pop_front ();
+        }
+
+        task ();
+    }
+
+    int const m_size;
+    std::mutex m_mutex;
+    std::deque <std::function <void ()>> m_tasks;
+
+    // Last, so the threads are stopped before the tasks go away
+    beast::Workers m_workers;
+};
+
+Pool& getPool ()
+{
+    static Pool pool;
+    return pool;
+}
+
+// The indexes of one forEach call, shared with the threads helping out
+struct ForEachState
+{
+    ForEachState (std::size_t count_,
+            std::function <void (std::size_t)> const& work_)
+        : work (work_)
+        , count (count_)
+        , next (0)
+        , done (0)
+    {
+    }
+
+    // Process indexes until none are left unclaimed. A helper that
+    // starts after the last index was claimed never touches `work`,
+    // which may be gone by then.
+    void run ()
+    {
+        std::size_t finished = 0;
+        std::exception_ptr firstError;
+
+        for (std::size_t i; (i = next++) < count; ++finished)
+        {
+            try
+            {
+                work (i);
+            }
+            catch (...)
+            {
+                if (!firstError)
+                    firstError = std::current_exception ();
+            }
+        }
+
+        if (finished == 0)
+            return;
+
+        std::lock_guard <std::mutex> lock (mutex);
+
+        if (firstError && !error)
+            error = firstError;
+
+        done += finished;
+
+        if (done == count)
+            cond.notify_all ();
+    }
+
+    std::function <void (std::size_t)> const& work;
+    std::size_t const count;
+    std::atomic <std::size_t> next;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::size_t done;
+    std::exception_ptr error;
+};
+
+}
+
+void WorkerPool::forEach (std::size_t count,
+    std::function <void (std::size_t)> const& work, int maxThreads)
+{
+    if (count == 0)
+        return;
+
+    Pool& pool (getPool ());
+
+    std::size_t helpers = std::min <std::size_t> (pool.size (), count - 1);
+
+    if (maxThreads > 0)
+        helpers = std::min <std::size_t> (helpers, maxThreads - 1);
+
+    if (helpers == 0)
+    {
+        std::exception_ptr error;
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            try
+            {
+                work (i);
+            }
+            catch (...)
+            {
+                if (!error)
+                    error = std::current_exception ();
+            }
+        }
+
+        if (error)
+            std::rethrow_exception (error);
+        return;
+    }
+
+    auto const state (std::make_shared <ForEachState> (count, work));
+
+    for (std::size_t i = 0; i < helpers; ++i)
+        pool.post ([state] { state->run (); });
+
+    state->run ();
+
+    std::unique_lock <std::mutex> lock (state->mutex);
+    state->cond.wait (lock, [&] { return state->done == count; });
+
+    if (state->error)
+        std::rethrow_exception (state->error);
+}
+
+int WorkerPool::size ()
+{
+    return getPool ().size ();
+}
+
+//------------------------------------------------------------------------------
+
+class WorkerPool_test : public beast::unit_test::suite
+{
+public:
+    void testEvery ()
+    {
+        testcase ("every index");
+
+        for (std::size_t count : { 0, 1, 2, 100, 10000 })
+        {
+            std::vector <std::atomic <int>> calls (count);
+            for (auto& c : calls)
+                c = 0;
+
+            WorkerPool::forEach (count, [&] (std::size_t i)
+            {
+                ++calls[i];
+            });
+
+            bool once = true;
+            for (auto const& c : calls)
+                once = once && (c == 1);
+            expect (once, "each index once");
+        }
+    }
+
+    void testLimit ()
+    {
+        testcase ("thread limit");
+
+        std::mutex lock;
+        std::set <std::thread::id> threads;
+
+        WorkerPool::forEach (1000, [&] (std::size_t)
+        {
+            std::lock_guard <std::mutex> sl (lock);
+            threads.insert (std::this_thread::get_id ());
+        }, 1);
+
+        expect (threads.size () == 1, "one thread");
+        expect (threads.count (std::this_thread::get_id ()) == 1,
+            "caller does the work");
+    }
+
+    void testNested ()
+    {
+        testcase ("nested");
+
+        // Work on the pool can itself split up work without waiting
+        // for threads that are all busy
+        std::atomic <int> total (0);
+
+        WorkerPool::forEach (4 * WorkerPool::size (), [&] (std::size_t)
+        {
+            WorkerPool::forEach (50, [&] (std::size_t)
+            {
+                ++total;
+            });
+        });
+
+        expect (total == 200 * WorkerPool::size (), "nested total");
+    }
+
+    void testException ()
+    {
+        testcase ("exception");
+
+        std::atomic <int> calls (0);
+        bool threw = false;
+
+        try
+        {
+            WorkerPool::forEach (100, [&] (std::size_t i)
+            {
+                ++calls;
+                if (i == 42)
+                    throw std::runtime_error ("42");
+            });
+        }
+        catch (std::runtime_error const& e)
+        {
+            threw = std::string (e.what ()) == "42";
+        }
+
+        expect (threw, "exception rethrown");
+        expect (calls == 100, "other indexes still run");
+    }
+
+    void testExceptionOneThread ()
+    {
+        testcase ("exception on one thread");
+
+        std::atomic <int> calls (0);
+        bool threw = false;
+
+        try
+        {
+            WorkerPool::forEach (100, [&] (std::size_t i)
+            {
+                ++calls;
+                if (i == 42 || i == 50)
+                    throw std::runtime_error (std::to_string (i));
+            }, 1);
+        }
+        catch (std::runtime_error const& e)
+        {
+            threw = std::string (e.what ()) == "42";
+        }
+
+        expect (threw, "first exception rethrown");
+        expect (calls == 100, "other indexes still run");
+    }
+
+    void run ()
+    {
+        testEvery ();
+        testLimit ();
+        testNested ();
+        testException ();
+        testExceptionOneThread ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(WorkerPool,core,ripple);
+
+} // ripple
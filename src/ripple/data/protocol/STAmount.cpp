@@ -132,31 +132,58 @@ STAmount::STAmount (Issue const& issue,
 std::unique_ptr<STAmount>
 STAmount::construct (SerializerIterator& sit, SField::ref name)
 {
-    std::uint64_t value = sit.get64 ();
+    int const left = sit.getBytesLeft ();
+
+    if (left < 0)
+        throw std::runtime_error ("invalid serializer get64");
+
+    unsigned char const* data = static_cast<unsigned char const*> (
+        (*sit).getDataPtr ()) + sit.getPos ();
+
+    auto amount = std::make_unique<STAmount> (construct (data, left, name));
+    sit.setPos (sit.getPos () + (amount->isNative () ? 8 : 48));
+    return amount;
+}
+
+STAmount
+STAmount::construct (unsigned char const* data, std::size_t size,
+    SField::ref name)
+{
+    if (size < 8)
+        throw std::runtime_error ("invalid amount size");
+
+    std::uint64_t value = 0;
+
+    // Big endian
+    for (int i = 0; i < 8; ++i)
+        value = (value << 8) | data[i];
 
     // native
     if ((value & cNotNative) == 0)
     {
         // positive
         if ((value & cPosNative) != 0)
-            return std::make_unique<STAmount> (name, value & ~cPosNative, false);
+            return STAmount (name, value & ~cPosNative, false);
 
         // negative
         if (value == 0)
             throw std::runtime_error ("negative zero is not canonical");
 
-        return std::make_unique<STAmount> (name, value, true);
+        return STAmount (name, value, true);
     }
 
+    if (size < 48)
+        throw std::runtime_error ("invalid amount size");
+
     Issue issue;
-    issue.currency.copyFrom (sit.get160 ());
+    std::memcpy (issue.currency.begin (), data + 8, 20);
 
     if (isXRP (issue.currency))
         throw std::runtime_error ("invalid native currency");
 	if (isVBC (issue.currency))
 		throw std::runtime_error ("invalid native currency");
 
-    issue.account.copyFrom (sit.get160 ());
+    std::memcpy (issue.account.begin (), data + 28, 20);
 
     if (isXRP (issue.account))
         throw std::runtime_error ("invalid native account");
@@ -181,13 +208,13 @@ STAmount::construct (SerializerIterator& sit, SField::ref name)
             throw std::runtime_error ("invalid currency value");
         }
 
-        return std::make_unique<STAmount> (name, issue, value, offset, isNegative);
+        return STAmount (name, issue, value, offset, isNegative);
     }
 
     if (offset != 512)
         throw std::runtime_error ("invalid currency value");
 
-    return std::make_unique<STAmount> (name, issue);
+    return STAmount (name, issue);
 }
 
 STAmount
@@ -1139,6 +1166,82 @@ operator- (STAmount const& value)
 //
 //------------------------------------------------------------------------------
 
+namespace detail {
+
+std::uint64_t
+mulAddDivPortable (std::uint64_t a, std::uint64_t b,
+    std::uint64_t c, std::uint64_t d)
+{
+    // Multiply in 32-bit halves to get the 128-bit product
+    std::uint64_t const a0 = a & 0xffffffff, a1 = a >> 32;
+    std::uint64_t const b0 = b & 0xffffffff, b1 = b >> 32;
+
+    std::uint64_t const p00 = a0 * b0;
+    std::uint64_t const p01 = a0 * b1;
+    std::uint64_t const p10 = a1 * b0;
+    std::uint64_t const p11 = a1 * b1;
+
+    std::uint64_t const mid =
+        (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+
+    std::uint64_t lo = (mid << 32) | (p00 & 0xffffffff);
+    std::uint64_t hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+
+    lo += c;
+    if (lo < c)
+        ++hi;
+
+    if (d == 0)
+        throw std::runtime_error ("division by zero");
+
+    // The quotient fits in 64 bits only if the high half is less than
+    // the divisor
+    if (hi >= d)
+        return std::numeric_limits <std::uint64_t>::max ();
+
+    // Long division one bit at a time, the remainder is always below d
+    std::uint64_t rem = hi;
+    std::uint64_t quotient = 0;
+
+    for (int i = 63; i >= 0; --i)
+    {
+        bool const carry = (rem >> 63) != 0;
+        rem = (rem << 1) | ((lo >> i) & 1);
+        quotient <<= 1;
+
+        if (carry || rem >= d)
+        {
+            rem -= d;
+            quotient |= 1;
+        }
+    }
+
+    return quotient;
+}
+
+std::uint64_t
+mulAddDiv (std::uint64_t a, std::uint64_t b, std::uint64_t c, std::uint64_t d)
+{
+#ifdef __SIZEOF_INT128__
+    if (d == 0)
+        throw std::runtime_error ("division by zero");
+
+    unsigned __int128 const v =
+        static_cast <unsigned __int128> (a) * b + c;
+
+    if ((v >> 64) >= d)
+        return std::numeric_limits <std::uint64_t>::max ();
+
+    return static_cast <std::uint64_t> (v / d);
+#else
+    return mulAddDivPortable (a, b, c, d);
+#endif
+}
+
+} // detail
+
+//------------------------------------------------------------------------------
+
 // NIKB TODO Make Amount::divide skip math if den == QUALITY_ONE
 STAmount
 divide (STAmount const& num, STAmount const& den, Issue const& issue)
@@ -1174,20 +1277,11 @@ divide (STAmount const& num, STAmount const& den, Issue const& issue)
     }
 
     // Compute (numerator * 10^17) / denominator
-    CBigNum v;
-
-    if ((BN_add_word64 (&v, numVal) != 1) ||
-            (BN_mul_word64 (&v, tenTo17) != 1) ||
-            (BN_div_word64 (&v, denVal) == ((std::uint64_t) - 1)))
-    {
-        throw std::runtime_error ("internal bn error");
-    }
-
     // 10^16 <= quotient <= 10^18
-    assert (BN_num_bytes (&v) <= 64);
+    std::uint64_t const v = detail::mulAddDiv (numVal, tenTo17, 0, denVal);
 
     // TODO(tom): where do 5 and 17 come from?
-    return STAmount (issue, v.getuint64 () + 5,
+    return STAmount (issue, v + 5,
                      numOffset - denOffset - 17,
                      num.negative() != den.negative());
 }
@@ -1239,20 +1333,10 @@ multiply (STAmount const& v1, STAmount const& v2, Issue const& issue)
 
     // Compute (numerator * denominator) / 10^14 with rounding
     // 10^16 <= result <= 10^18
-    CBigNum v;
-
-    if ((BN_add_word64 (&v, value1) != 1) ||
-            (BN_mul_word64 (&v, value2) != 1) ||
-            (BN_div_word64 (&v, tenTo14) == ((std::uint64_t) - 1)))
-    {
-        throw std::runtime_error ("internal bn error");
-    }
-
-    // 10^16 <= product <= 10^18
-    assert (BN_num_bytes (&v) <= 64);
+    std::uint64_t const v = detail::mulAddDiv (value1, value2, 0, tenTo14);
 
     // TODO(tom): where do 7 and 14 come from?
-    return STAmount (issue, v.getuint64 () + 7,
+    return STAmount (issue, v + 7,
         offset1 + offset2 + 14, v1.negative() != v2.negative());
 }
 
@@ -1495,21 +1579,9 @@ mulRound (STAmount const& v1, STAmount const& v2,
     bool resultNegative = v1.negative() != v2.negative();
     // Compute (numerator * denominator) / 10^14 with rounding
     // 10^16 <= result <= 10^18
-    CBigNum v;
-
-    if ((BN_add_word64 (&v, value1) != 1) || (BN_mul_word64 (&v, value2) != 1))
-        throw std::runtime_error ("internal bn error");
-
-    if (resultNegative != roundUp) // rounding down is automatic when we divide
-        BN_add_word64 (&v, tenTo14m1);
-
-    if  (BN_div_word64 (&v, tenTo14) == ((std::uint64_t) - 1))
-        throw std::runtime_error ("internal bn error");
-
-    // 10^16 <= product <= 10^18
-    assert (BN_num_bytes (&v) <= 64);
-
-    std::uint64_t amount = v.getuint64 ();
+    // Rounding down is automatic when we divide
+    std::uint64_t amount = detail::mulAddDiv (value1, value2,
+        (resultNegative != roundUp) ? tenTo14m1 : 0, tenTo14);
     int offset = offset1 + offset2 + 14;
     canonicalizeRound (
 		(isXRP(issue) || isVBC(issue)), amount, offset, resultNegative != roundUp);
@@ -1546,21 +1618,10 @@ divRound (STAmount const& num, STAmount const& den,
 
     bool resultNegative = num.negative() != den.negative();
     // Compute (numerator * 10^17) / denominator
-    CBigNum v;
-
-    if ((BN_add_word64 (&v, numVal) != 1) || (BN_mul_word64 (&v, tenTo17) != 1))
-        throw std::runtime_error ("internal bn error");
-
-    if (resultNegative != roundUp) // Rounding down is automatic when we divide
-        BN_add_word64 (&v, denVal - 1);
-
-    if (BN_div_word64 (&v, denVal) == ((std::uint64_t) - 1))
-        throw std::runtime_error ("internal bn error");
-
+    // Rounding down is automatic when we divide
     // 10^16 <= quotient <= 10^18
-    assert (BN_num_bytes (&v) <= 64);
-
-    std::uint64_t amount = v.getuint64 ();
+    std::uint64_t amount = detail::mulAddDiv (numVal, tenTo17,
+        (resultNegative != roundUp) ? denVal - 1 : 0, denVal);
     int offset = numOffset - denOffset - 17;
     canonicalizeRound (
         (isXRP (issue) || isVBC (issue)), amount, offset, resultNegative != roundUp);
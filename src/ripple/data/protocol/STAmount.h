@@ -114,6 +114,15 @@ private:
     construct (SerializerIterator&, SField::ref name);
 
 public:
+    /** Decode a serialized amount.
+        The data holds 8 bytes for a native amount, or 48 bytes for an
+        amount with an issue. Throws if the amount is not valid.
+    */
+    static
+    STAmount
+    construct (unsigned char const* data, std::size_t size,
+        SField::ref name);
+
     static
     STAmount
     createFromInt64 (SField::ref n, std::int64_t v);
@@ -402,6 +411,24 @@ void
 canonicalizeRound (bool native, std::uint64_t& mantissa,
     int& exponent, bool roundUp);
 
+namespace detail {
+
+/** Compute (a * b + c) / d, rounded down.
+    The intermediate value has 128 bits. A quotient that does not fit in
+    64 bits gives all bits set, which is what the BIGNUM arithmetic this
+    replaces produced. Results must not change, since they are part of
+    the ledger.
+*/
+std::uint64_t
+mulAddDiv (std::uint64_t a, std::uint64_t b, std::uint64_t c, std::uint64_t d);
+
+/** mulAddDiv for compilers without a 128-bit integer type. */
+std::uint64_t
+mulAddDivPortable (std::uint64_t a, std::uint64_t b,
+    std::uint64_t c, std::uint64_t d);
+
+} // detail
+
 /* addRound, subRound can end up rounding if the amount subtracted is too small
     to make a change. Consder (X-d) where d is very small relative to X.
     If you ask to round down, then (X-d) should not be X unless d is zero.
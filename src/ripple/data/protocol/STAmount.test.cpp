@@ -23,6 +23,9 @@
 
 #include <ripple/data/protocol/STAmount.h>
 #include <beast/unit_test/suite.h>
+#include <beast/module/core/maths/Random.h>
+
+#include <chrono>
 
 namespace ripple {
 
@@ -561,6 +564,102 @@ public:
 
     //--------------------------------------------------------------------------
 
+    // The BIGNUM arithmetic that amounts used before mulAddDiv
+    static std::uint64_t bnMulAddDiv (std::uint64_t a, std::uint64_t b,
+        std::uint64_t c, std::uint64_t d)
+    {
+        CBigNum v;
+
+        if ((BN_add_word64 (&v, a) != 1) ||
+                (BN_mul_word64 (&v, b) != 1) ||
+                (BN_add_word64 (&v, c) != 1) ||
+                (BN_div_word64 (&v, d) == ((std::uint64_t) - 1)))
+        {
+            throw std::runtime_error ("internal bn error");
+        }
+
+        return v.getuint64 ();
+    }
+
+    static std::uint64_t randomValue (beast::Random& r,
+        std::uint64_t low, std::uint64_t high)
+    {
+        return low + static_cast <std::uint64_t> (r.nextInt64 ()) %
+            (high - low + 1);
+    }
+
+    bool checkMulAddDiv (std::uint64_t a, std::uint64_t b,
+        std::uint64_t c, std::uint64_t d)
+    {
+        std::uint64_t const expected = bnMulAddDiv (a, b, c, d);
+
+        if (detail::mulAddDiv (a, b, c, d) != expected ||
+            detail::mulAddDivPortable (a, b, c, d) != expected)
+        {
+            std::stringstream ss;
+            ss << "(" << a << " * " << b << " + " << c << ") / " << d;
+            fail (ss.str ());
+            return false;
+        }
+
+        return true;
+    }
+
+    void testMulAddDiv ()
+    {
+        testcase ("mulAddDiv");
+
+        std::uint64_t const tenTo14 = 100000000000000ull;
+        std::uint64_t const tenTo17 = tenTo14 * 1000;
+        std::uint64_t const maxNative = STAmount::cMaxNativeN;
+
+        beast::Random r (42);
+        bool ok = true;
+
+        // The operands multiply and divide see, including native
+        // mantissas, which are not normalized
+        for (int i = 0; ok && i < 100000; ++i)
+        {
+            std::uint64_t const v1 = randomValue (r,
+                STAmount::cMinValue, (i & 1) ? maxNative : STAmount::cMaxValue);
+            std::uint64_t const v2 = randomValue (r,
+                STAmount::cMinValue, (i & 2) ? maxNative : STAmount::cMaxValue);
+
+            // multiply and mulRound
+            ok = checkMulAddDiv (v1, v2, 0, tenTo14) &&
+                checkMulAddDiv (v1, v2, tenTo14 - 1, tenTo14);
+
+            // divide and divRound
+            ok = ok && checkMulAddDiv (v1, tenTo17, 0, v2) &&
+                checkMulAddDiv (v1, tenTo17, v2 - 1, v2);
+        }
+
+        // Arbitrary operands, including quotients that do not fit
+        for (int i = 0; ok && i < 100000; ++i)
+        {
+            std::uint64_t const a = r.nextInt64 ();
+            std::uint64_t const b = r.nextInt64 () >> r.nextInt (64);
+            std::uint64_t const c = r.nextInt64 ();
+            std::uint64_t const d = 1 + (r.nextInt64 () >> r.nextInt (64));
+
+            ok = checkMulAddDiv (a, b, c, d);
+        }
+
+        std::uint64_t const max = std::numeric_limits <std::uint64_t>::max ();
+
+        ok = ok && checkMulAddDiv (0, 0, 0, 1) &&
+            checkMulAddDiv (max, max, max, max) &&
+            checkMulAddDiv (max, max, 0, max) &&
+            checkMulAddDiv (max, 1, 0, 1) &&
+            checkMulAddDiv (max, 2, 0, 1) &&
+            checkMulAddDiv (maxNative, maxNative, tenTo14 - 1, tenTo14);
+
+        if (ok)
+            pass ();
+    }
+
+    //--------------------------------------------------------------------------
+
     void run ()
     {
         testSetValue ();
@@ -569,9 +668,98 @@ public:
         testArithmetic ();
         testUnderflow ();
         testRounding ();
+        testMulAddDiv ();
     }
 };
 
 BEAST_DEFINE_TESTSUITE(STAmount,ripple_data,ripple);
 
+//------------------------------------------------------------------------------
+
+/** Compare multiplying and dividing amounts with BIGNUM and mulAddDiv. */
+class STAmount_timing_test : public STAmount_test
+{
+public:
+    enum
+    {
+        count = 1000000
+    };
+
+    template <class Function>
+    static double elapsed (Function f)
+    {
+        auto const start = std::chrono::steady_clock::now ();
+        f ();
+        return std::chrono::duration_cast <std::chrono::duration <double>> (
+            std::chrono::steady_clock::now () - start).count ();
+    }
+
+    void run ()
+    {
+        beast::Random r (7);
+        Issue const usd (to_currency ("USD"), Account (1));
+
+        std::vector <STAmount> amounts;
+        std::vector <std::uint64_t> values;
+        amounts.reserve (count);
+        values.reserve (count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            std::uint64_t const value = randomValue (r,
+                STAmount::cMinValue, STAmount::cMaxValue);
+            values.push_back (value);
+            amounts.emplace_back (usd, value, r.nextInt (20) - 10);
+        }
+
+        std::uint64_t const tenTo14 = 100000000000000ull;
+        std::uint64_t const tenTo17 = tenTo14 * 1000;
+        std::uint64_t sum1 = 0;
+        std::uint64_t sum2 = 0;
+
+        testcase ("words");
+
+        double const bn = elapsed ([&]
+        {
+            for (int i = 1; i < count; ++i)
+            {
+                sum1 += bnMulAddDiv (values[i - 1], values[i], 0, tenTo14);
+                sum1 += bnMulAddDiv (values[i - 1], tenTo17, 0, values[i]);
+            }
+        });
+
+        double const native = elapsed ([&]
+        {
+            for (int i = 1; i < count; ++i)
+            {
+                sum2 += detail::mulAddDiv (values[i - 1], values[i], 0, tenTo14);
+                sum2 += detail::mulAddDiv (values[i - 1], tenTo17, 0, values[i]);
+            }
+        });
+
+        expect (sum1 == sum2, "results differ");
+        log << "BIGNUM:     " << bn << "s";
+        log << "mulAddDiv:  " << native << "s";
+
+        testcase ("amounts");
+
+        STAmount total (usd);
+        double const amountTime = elapsed ([&]
+        {
+            for (int i = 1; i < count; ++i)
+            {
+                STAmount const product (
+                    multiply (amounts[i - 1], amounts[i], usd));
+                total += divide (product, amounts[i], usd);
+            }
+        });
+
+        log << "multiply and divide: " << amountTime << "s for " <<
+            count - 1 << " pairs";
+        pass ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(STAmount_timing,ripple_data,ripple);
+
 } // ripple
@@ -167,32 +167,40 @@ bool STObject::setType (const SOTemplate& type)
     SerializedType** array = mData.c_array();
     std::size_t count = mData.size ();
 
-    for (auto const& elem : type.peek ())
+    // Place each field in its template slot through the template's index
+    // instead of searching the object once for every template element
+    std::vector<SerializedType*> slots (type.peek ().size (), nullptr);
+
+    for (std::size_t i = 0; i < count; ++i)
     {
-        // Loop through all the fields in the template
-        bool match = false;
+        int const index = type.getIndex (array[i]->getFName ());
 
-        for (std::size_t i = 0; i < count; ++i)
-            if ((array[i] != nullptr) &&
-                (array[i]->getFName () == elem->e_field))
-            {
-                // matching entry in the object, move to new vector
-                match = true;
+        // The first of any duplicates is the one that is kept
+        if ((index != -1) && (slots[index] == nullptr))
+        {
+            slots[index] = array[i];
+            array[i] = nullptr;
+        }
+    }
 
-                if ((elem->flags == SOE_DEFAULT) && array[i]->isDefault ())
-                {
-                    WriteLog (lsWARNING, STObject) <<
-                        "setType( " << getFName ().getName () <<
-                        ") invalid default " << elem->e_field.fieldName;
-                    valid = false;
-                }
+    for (std::size_t index = 0; index < slots.size (); ++index)
+    {
+        auto const& elem = type.peek ()[index];
+        SerializedType* field = slots[index];
 
-                newData.push_back (array[i]);
-                array[i] = nullptr;
-                break;
+        if (field != nullptr)
+        {
+            if ((elem->flags == SOE_DEFAULT) && field->isDefault ())
+            {
+                WriteLog (lsWARNING, STObject) <<
+                    "setType( " << getFName ().getName () <<
+                    ") invalid default " << elem->e_field.fieldName;
+                valid = false;
             }
 
-        if (!match)
+            newData.push_back (field);
+        }
+        else
         {
             // no match found in the object for an entry in the template
             if (elem->flags == SOE_REQUIRED)
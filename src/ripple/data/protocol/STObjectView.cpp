@@ -0,0 +1,394 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+namespace ripple {
+
+namespace detail {
+
+// Walks serialized fields without building them
+class FieldReader
+{
+public:
+    FieldReader (unsigned char const* data, std::size_t size)
+        : mPos (data)
+        , mEnd (data + size)
+    {
+    }
+
+    bool empty () const
+    {
+        return mPos == mEnd;
+    }
+
+    void getFieldID (int& type, int& name)
+    {
+        type = get8 ();
+        name = type & 15;
+        type >>= 4;
+
+        // Uncommon types and names take a byte of their own
+        if (type == 0)
+        {
+            type = get8 ();
+
+            if (type < 16)
+                throw std::runtime_error ("invalid serializer getFieldID");
+        }
+
+        if (name == 0)
+        {
+            name = get8 ();
+
+            if (name < 16)
+                throw std::runtime_error ("invalid serializer getFieldID");
+        }
+    }
+
+    // Step over the value of a field.
+    // @return The start of the value, without any length prefix.
+    unsigned char const* getValue (int type, std::size_t& size,
+        int depth = 0)
+    {
+        switch (type)
+        {
+        case STI_UINT8:
+            size = 1;
+            break;
+
+        case STI_UINT16:
+            size = 2;
+            break;
+
+        case STI_UINT32:
+            size = 4;
+            break;
+
+        case STI_UINT64:
+            size = 8;
+            break;
+
+        case STI_HASH128:
+            size = 16;
+            break;
+
+        case STI_HASH160:
+            size = 20;
+            break;
+
+        case STI_HASH256:
+            size = 32;
+            break;
+
+        case STI_AMOUNT:
+            // Native amounts have no currency or issuer
+            size = (peek8 () & 0x80) ? 48 : 8;
+            break;
+
+        case STI_VL:
+        case STI_ACCOUNT:
+        case STI_VECTOR256:
+            size = getVLLength ();
+            break;
+
+        case STI_PATHSET:
+        case STI_OBJECT:
+        case STI_ARRAY:
+        {
+            unsigned char const* const begin = mPos;
+
+            if (type == STI_PATHSET)
+                skipPathSet ();
+            else
+                skipFields (type, depth + 1);
+
+            size = mPos - begin;
+            return begin;
+        }
+
+        default:
+            throw std::runtime_error ("Unknown object type");
+        }
+
+        return get (size);
+    }
+
+private:
+    unsigned char const* get (std::size_t bytes)
+    {
+        if (bytes > static_cast <std::size_t> (mEnd - mPos))
+            throw std::runtime_error ("invalid serialized object");
+
+        unsigned char const* const pos = mPos;
+        mPos += bytes;
+        return pos;
+    }
+
+    unsigned char peek8 () const
+    {
+        if (mPos == mEnd)
+            throw std::runtime_error ("invalid serialized object");
+
+        return *mPos;
+    }
+
+    int get8 ()
+    {
+        return *get (1);
+    }
+
+    std::size_t getVLLength ()
+    {
+        int const b1 = get8 ();
+
+        switch (Serializer::decodeLengthLength (b1))
+        {
+        case 1:
+            return Serializer::decodeVLLength (b1);
+
+        case 2:
+        {
+            int const b2 = get8 ();
+            return Serializer::decodeVLLength (b1, b2);
+        }
+
+        default:
+        {
+            int const b2 = get8 ();
+            int const b3 = get8 ();
+            return Serializer::decodeVLLength (b1, b2, b3);
+        }
+        }
+    }
+
+    void skipPathSet ()
+    {
+        for (;;)
+        {
+            int const type = get8 ();
+
+            if (type == STPathElement::typeNone)
+                return;
+
+            if (type == STPathElement::typeBoundary)
+                continue;
+
+            if (type & ~STPathElement::typeAll)
+                throw std::runtime_error ("bad path element");
+
+            if (type & STPathElement::typeAccount)
+                get (20);
+
+            if (type & STPathElement::typeCurrency)
+                get (20);
+
+            if (type & STPathElement::typeIssuer)
+                get (20);
+        }
+    }
+
+    // Skip the fields of an object or the objects of an array, up to and
+    // including the end marker
+    void skipFields (int type, int depth)
+    {
+        if (depth > 64)
+            throw std::runtime_error ("Maximum nesting depth exceeded");
+
+        for (;;)
+        {
+            int fieldType;
+            int fieldName;
+            getFieldID (fieldType, fieldName);
+
+            if (fieldName == 1 &&
+                (fieldType == STI_OBJECT || fieldType == STI_ARRAY))
+            {
+                if (fieldType != type)
+                    throw std::runtime_error ("Illegal terminator in object");
+
+                return;
+            }
+
+            if (type == STI_ARRAY && fieldType != STI_OBJECT)
+                throw std::runtime_error ("Non-object in array");
+
+            std::size_t size;
+            getValue (fieldType, size, depth);
+        }
+    }
+
+    unsigned char const* mPos;
+    unsigned char const* const mEnd;
+};
+
+} // detail
+
+//------------------------------------------------------------------------------
+
+STObjectView::STObjectView (void const* data, std::size_t size)
+    : mData (static_cast <unsigned char const*> (data))
+    , mSize (size)
+{
+}
+
+STObjectView::STObjectView (Blob const& data)
+    : mData (data.empty () ? nullptr : &data.front ())
+    , mSize (data.size ())
+{
+}
+
+unsigned char const* STObjectView::find (SField::ref field,
+    SerializedTypeID type, std::size_t& size) const
+{
+    if (field.fieldType != type)
+        throw std::runtime_error ("Wrong field type");
+
+    detail::FieldReader reader (mData, mSize);
+
+    while (!reader.empty ())
+    {
+        int fieldType;
+        int fieldName;
+        reader.getFieldID (fieldType, fieldName);
+
+        unsigned char const* const value =
+            reader.getValue (fieldType, size);
+
+        if (fieldType == type && fieldName == field.fieldValue)
+            return value;
+    }
+
+    return nullptr;
+}
+
+template <class Integer>
+Integer STObjectView::getInteger (
+    SField::ref field, SerializedTypeID type) const
+{
+    std::size_t size;
+    unsigned char const* value = find (field, type, size);
+
+    Integer result = 0;
+
+    if (value)
+    {
+        // Big endian
+        for (std::size_t i = 0; i < size; ++i)
+            result = static_cast <Integer> ((result << 8) | value[i]);
+    }
+
+    return result;
+}
+
+template <std::size_t Bits, class Tag>
+base_uint <Bits, Tag> STObjectView::getBitString (
+    SField::ref field, SerializedTypeID type) const
+{
+    std::size_t size;
+    unsigned char const* value = find (field, type, size);
+
+    base_uint <Bits, Tag> result;
+
+    if (value)
+        std::memcpy (result.begin (), value, size);
+
+    return result;
+}
+
+bool STObjectView::isFieldPresent (SField::ref field) const
+{
+    std::size_t size;
+    return find (field, field.fieldType, size) != nullptr;
+}
+
+unsigned char STObjectView::getFieldU8 (SField::ref field) const
+{
+    return getInteger <unsigned char> (field, STI_UINT8);
+}
+
+std::uint16_t STObjectView::getFieldU16 (SField::ref field) const
+{
+    return getInteger <std::uint16_t> (field, STI_UINT16);
+}
+
+std::uint32_t STObjectView::getFieldU32 (SField::ref field) const
+{
+    return getInteger <std::uint32_t> (field, STI_UINT32);
+}
+
+std::uint64_t STObjectView::getFieldU64 (SField::ref field) const
+{
+    return getInteger <std::uint64_t> (field, STI_UINT64);
+}
+
+uint128 STObjectView::getFieldH128 (SField::ref field) const
+{
+    return getBitString <128> (field, STI_HASH128);
+}
+
+uint160 STObjectView::getFieldH160 (SField::ref field) const
+{
+    return getBitString <160> (field, STI_HASH160);
+}
+
+uint256 STObjectView::getFieldH256 (SField::ref field) const
+{
+    return getBitString <256> (field, STI_HASH256);
+}
+
+Account STObjectView::getFieldAccount160 (SField::ref field) const
+{
+    std::size_t size;
+    unsigned char const* value = find (field, STI_ACCOUNT, size);
+
+    Account account;
+
+    // Like STAccount, anything but a full account is zero
+    if (value && size == Account::bytes)
+        std::memcpy (account.begin (), value, size);
+
+    return account;
+}
+
+Blob STObjectView::getFieldVL (SField::ref field) const
+{
+    std::size_t size;
+    unsigned char const* value = find (field, STI_VL, size);
+
+    if (!value)
+        return Blob ();
+
+    return Blob (value, value + size);
+}
+
+STAmount STObjectView::getFieldAmount (SField::ref field) const
+{
+    std::size_t size;
+    unsigned char const* data = find (field, STI_AMOUNT, size);
+
+    if (!data)
+        return STAmount (field);
+
+    return STAmount::construct (data, size, field);
+}
+
+} // ripple
@@ -0,0 +1,86 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_STOBJECTVIEW_H_INCLUDED
+#define RIPPLE_STOBJECTVIEW_H_INCLUDED
+
+namespace ripple {
+
+/** Reads the fields of a serialized object without deserializing it.
+
+    Building an STObject allocates every field, which is wasted when only
+    a few fields of each ledger entry are needed, as when visiting a whole
+    state map. The view reads fields straight from the serialized bytes.
+    Each lookup walks the top level fields, skipping the ones it does not
+    want, and nothing is allocated except for variable length values.
+
+    The view does not copy the bytes, which must outlive it. Malformed
+    data throws std::runtime_error, as deserializing it would.
+*/
+class STObjectView
+{
+public:
+    STObjectView (void const* data, std::size_t size);
+
+    explicit STObjectView (Blob const& data);
+
+    bool isFieldPresent (SField::ref field) const;
+
+    // These throw if the field type doesn't match, or return default values
+    // if the field is not present
+    unsigned char getFieldU8 (SField::ref field) const;
+    std::uint16_t getFieldU16 (SField::ref field) const;
+    std::uint32_t getFieldU32 (SField::ref field) const;
+    std::uint64_t getFieldU64 (SField::ref field) const;
+    uint128 getFieldH128 (SField::ref field) const;
+    uint160 getFieldH160 (SField::ref field) const;
+    uint256 getFieldH256 (SField::ref field) const;
+    Account getFieldAccount160 (SField::ref field) const;
+    Blob getFieldVL (SField::ref field) const;
+    STAmount getFieldAmount (SField::ref field) const;
+
+    LedgerEntryType getType () const
+    {
+        return static_cast <LedgerEntryType> (
+            getFieldU16 (sfLedgerEntryType));
+    }
+
+private:
+    // The value of a field, or nullptr if it is not present
+    unsigned char const* find (SField::ref field, SerializedTypeID type,
+        std::size_t& size) const;
+
+    template <class Integer>
+    Integer getInteger (SField::ref field, SerializedTypeID type) const;
+
+    template <std::size_t Bits, class Tag = void>
+    base_uint <Bits, Tag> getBitString (
+        SField::ref field, SerializedTypeID type) const;
+
+    unsigned char const* mData;
+    std::size_t mSize;
+};
+
+} // ripple
+
+#endif
@@ -0,0 +1,158 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/data/protocol/STObjectView.h>
+#include <beast/unit_test/suite.h>
+
+namespace ripple {
+
+class STObjectView_test : public beast::unit_test::suite
+{
+public:
+    static STObject makeObject ()
+    {
+        Account const account (5);
+        Issue const usd (to_currency ("USD"), account);
+
+        STObject object (sfGeneric);
+        object.setFieldU16 (sfLedgerEntryType, ltOFFER);
+        object.setFieldU32 (sfFlags, 0x80000001);
+        object.setFieldU64 (sfBookNode, 0x0102030405060708ull);
+        object.setFieldU8 (sfTransactionResult, 7);
+        object.setFieldH128 (sfEmailHash, uint128 (3));
+        object.setFieldH160 (sfTakerPaysCurrency, usd.currency);
+        object.setFieldH256 (sfBookDirectory, uint256 (9));
+        object.setFieldAccount (sfAccount, account);
+        object.setFieldAmount (sfTakerPays, STAmount (usd, std::uint64_t (12345), -2, true));
+        object.setFieldAmount (sfTakerGets, STAmount (std::uint64_t (250000)));
+        object.setFieldVL (sfMemoData, Blob (300, 0x5a));
+
+        STVector256 indexes;
+        indexes.push_back (uint256 (1));
+        indexes.push_back (uint256 (2));
+        object.setFieldV256 (sfIndexes, indexes);
+
+        // Variable length values that have to be skipped over
+        STPath path;
+        path.emplace_back (account, usd.currency, account);
+        path.emplace_back (Account (), usd.currency, account);
+        STPathSet paths;
+        paths.push_back (path);
+        paths.push_back (path);
+        object.setFieldPathSet (sfPaths, paths);
+
+        STObject memo (sfMemo);
+        memo.setFieldVL (sfMemoData, Blob (3, 1));
+        STArray memos (sfMemos);
+        memos.push_back (memo);
+        memos.push_back (memo);
+        object.setFieldArray (sfMemos, memos);
+
+        return object;
+    }
+
+    void testFields ()
+    {
+        testcase ("fields");
+
+        STObject const object (makeObject ());
+        Serializer s;
+        object.add (s);
+        STObjectView const view (s.peekData ());
+
+        expect (view.getType () == ltOFFER, "wrong type");
+        expect (view.getFieldU32 (sfFlags) == object.getFieldU32 (sfFlags),
+            "wrong U32");
+        expect (view.getFieldU64 (sfBookNode) ==
+            object.getFieldU64 (sfBookNode), "wrong U64");
+        expect (view.getFieldU8 (sfTransactionResult) == 7, "wrong U8");
+        expect (view.getFieldH128 (sfEmailHash) ==
+            object.getFieldH128 (sfEmailHash), "wrong H128");
+        expect (view.getFieldH160 (sfTakerPaysCurrency) ==
+            object.getFieldH160 (sfTakerPaysCurrency), "wrong H160");
+        expect (view.getFieldH256 (sfBookDirectory) ==
+            object.getFieldH256 (sfBookDirectory), "wrong H256");
+        expect (view.getFieldAccount160 (sfAccount) ==
+            object.getFieldAccount160 (sfAccount), "wrong account");
+        expect (view.getFieldAmount (sfTakerPays) ==
+            object.getFieldAmount (sfTakerPays), "wrong amount");
+        expect (view.getFieldAmount (sfTakerGets) ==
+            object.getFieldAmount (sfTakerGets), "wrong native amount");
+        expect (view.getFieldVL (sfMemoData) ==
+            object.getFieldVL (sfMemoData), "wrong VL");
+
+        // Absent fields read as defaults
+        expect (!view.isFieldPresent (sfOwner), "absent field present");
+        expect (view.isFieldPresent (sfMemos), "array missing");
+        expect (view.getFieldU32 (sfSequence) == 0, "absent U32");
+        expect (view.getFieldH256 (sfRootIndex).isZero (), "absent H256");
+        expect (view.getFieldAmount (sfBalance).signum () == 0, "absent amount");
+    }
+
+    void testErrors ()
+    {
+        testcase ("errors");
+
+        Serializer s;
+        makeObject ().add (s);
+        Blob data (s.peekData ());
+
+        STObjectView const view (data);
+
+        try
+        {
+            view.getFieldU16 (sfFlags);
+            fail ("wrong type accepted");
+        }
+        catch (std::runtime_error const&)
+        {
+            pass ();
+        }
+
+        // The last field, a vector of two hashes, is cut short
+        for (std::size_t size = data.size () - 60; size < data.size (); ++size)
+        {
+            STObjectView const truncated (&data.front (), size);
+
+            try
+            {
+                truncated.isFieldPresent (sfOwner);
+                fail ("truncated data accepted");
+            }
+            catch (std::exception const&)
+            {
+                pass ();
+            }
+        }
+    }
+
+    void run ()
+    {
+        testFields ();
+        testErrors ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(STObjectView,ripple_data,ripple);
+
+} // ripple
@@ -107,7 +107,11 @@ public:
     beast::http::message&
     message() = 0;
 
-    /** Send a copy of data asynchronously. */
+    /** Send a copy of data asynchronously.
+        Called from outside the session's own handlers, such as from a job
+        after detach, this waits while a large amount of earlier data is
+        still queued, so a long reply is sent as it is written.
+    */
     /** @{ */
     void
     write (std::string const& s)
@@ -41,6 +41,7 @@
 #include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <list>
 #include <memory>
@@ -78,8 +79,11 @@ protected:
         bufferSize = 4 * 1024,
 
         // Max seconds without completing a message
-        timeoutSeconds = 30
+        timeoutSeconds = 30,
 
+        // Bytes queued before a writer off the strand waits for the
+        // socket to drain
+        writeQueueLimit = 256 * 1024
     };
 
     struct buffer
@@ -110,6 +114,9 @@ protected:
     beast::http::message message_;
     std::list <buffer> write_queue_;
     std::mutex mutex_;
+    std::condition_variable drained_;
+    std::size_t queued_bytes_ = 0;
+    bool write_failed_ = false;
     bool graceful_ = false;
     bool complete_ = false;
     std::shared_ptr <Peer> detach_ref_;
@@ -560,6 +567,9 @@ Peer<Impl>::do_write (boost::asio::yield_context yield)
         void const* data;
         {
             std::lock_guard <std::mutex> lock (mutex_);
+            queued_bytes_ -= bytes;
+            if (queued_bytes_ <= writeQueueLimit)
+                drained_.notify_all();
             buffer& b = write_queue_.front();
             b.used += bytes;
             if (b.used < b.bytes)
@@ -583,7 +593,17 @@ Peer<Impl>::do_write (boost::asio::yield_context yield)
         cancel_timer();
 
         if (ec)
+        {
+            // Nothing more will be sent, so release any waiting writer
+            {
+                std::lock_guard <std::mutex> lock (mutex_);
+                write_failed_ = true;
+                write_queue_.clear();
+                queued_bytes_ = 0;
+            }
+            drained_.notify_all();
             return fail (ec, "write");
+        }
     }
 
     if (! complete_)
@@ -599,6 +619,8 @@ Peer<Impl>::do_write (boost::asio::yield_context yield)
 //------------------------------------------------------------------------------
 
 // Send a copy of the data.
+// A caller off the strand, such as a detached handler writing a large
+// reply, waits while too much is queued so the reply is not buffered whole.
 template <class Impl>
 void
 Peer<Impl>::write (void const* buffer, std::size_t bytes)
@@ -608,9 +630,17 @@ Peer<Impl>::write (void const* buffer, std::size_t bytes)
 
     bool empty;
     {
-        std::lock_guard <std::mutex> lock (mutex_);
+        std::unique_lock <std::mutex> lock (mutex_);
+        if (! strand_.running_in_this_thread())
+            drained_.wait (lock, [this]
+            {
+                return write_failed_ || queued_bytes_ <= writeQueueLimit;
+            });
+        if (write_failed_)
+            return;
         empty = write_queue_.empty();
         write_queue_.emplace_back (buffer, bytes);
+        queued_bytes_ += bytes;
     }
 
     if (empty)
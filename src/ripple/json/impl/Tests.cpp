@@ -23,6 +23,7 @@
 
 #include <beast/unit_test/suite.h>
 #include <beast/utility/type_name.h>
+#include <chrono>
 
 namespace ripple {
 
@@ -140,15 +141,208 @@ public:
         pass ();
     }
 
+    void
+    test_chunked ()
+    {
+        Json::Value v (Json::objectValue);
+        v["null"] = Json::Value ();
+        v["int"] = -17;
+        v["uint"] = Json::UInt (4000000000u);
+        v["real"] = 0.25;
+        v["bool"] = true;
+        v["escaped"] = "tab\tquote\"";
+        v["empty"] = Json::Value (Json::arrayValue);
+        v["object"]["nested"] = "value";
+
+        Json::Value& array = v["array"] = Json::Value (Json::arrayValue);
+        for (int i = 0; i < 100; ++i)
+            array.append (std::string (i, 'x'));
+
+        std::string const expected = Json::FastWriter ().write (v);
+
+        for (std::size_t chunkBytes : {1, 7, 64, 16384})
+        {
+            std::string result;
+            std::size_t largest = 0;
+
+            Json::ChunkedWriter writer (
+                [&] (char const* data, std::size_t bytes)
+                {
+                    result.append (data, bytes);
+                    largest = std::max (largest, bytes);
+                }, chunkBytes);
+            writer.write (v);
+            writer.output ("\n", 1);
+            writer.flush ();
+
+            expect (result == expected, "chunked matches fast writer");
+
+            // Pieces longer than a chunk are passed straight through
+            if (chunkBytes == 64)
+                expect (largest <= 101, "chunks are bounded");
+        }
+
+        expect (Json::ChunkedWriter::measure (v) + 1 == expected.size (),
+            "measure matches output size");
+    }
+
+    void
+    test_insitu ()
+    {
+        // Both readers must agree on what parses and on the result
+        char const* const documents[] = {
+            "{\"method\":\"account_info\",\"params\":[{\"account\":"
+                "\"rHb9CJAWyB4rj91VRWn96DkukG4bwdtyTh\",\"strict\":true}]}",
+            "  [ 1, -2, 2147483648, 4294967295, 0.5, -1e3, 1E+2, "
+                "true, false, null, \"\", [], {} ]  ",
+            "{\"escaped\":\"tab\\tquote\\\"slash\\/\\\\\\u00e9\\ud83d\\ude00\","
+                "\"na\\u006de\":{\"nested\":[[[\"deep\"]]]}}",
+            "/* comment */ { // line comment\n \"a\" : 1 /* */ }",
+            "{\"trailing\":1} garbage",
+            "\"just a string\"",
+            "42",
+            "{\"a\":1,\"a\":2}",
+            "{\"a\":1,}",
+            "[1,]",
+            "{\"a\" 1}",
+            "[1 2]",
+            "{\"bad\":\"\\q\"}",
+            "{\"bad\":\"\\u12G4\"}",
+            "{\"unterminated\":\"abc",
+            "[4294967296]",
+            "[-2147483649]",
+            "[tru]",
+            "",
+            "   ",
+            "/* unterminated",
+            "{"
+        };
+
+        for (auto const document : documents)
+        {
+            Json::Value expected;
+            bool const expectedOk = Json::Reader ().parse (document, expected);
+
+            Json::Value actual;
+            bool const actualOk = Json::InSituReader ().parse (document, actual);
+
+            expect (actualOk == expectedOk, document);
+
+            if (expectedOk && actualOk)
+                expect (actual == expected, document);
+        }
+
+        // One reader for many documents, as the RPC doors use it
+        Json::InSituReader reader;
+        Json::Value v;
+
+        expect (reader.parse ("{\"a\\n\":\"x\\ty\"}", v));
+        expect (v["a\n"] == "x\ty");
+        expect (reader.parse ("{\"b\":\"plain\"}", v));
+        expect (v.size () == 1 && v["b"] == "plain");
+
+        std::string deep (10000, '[');
+        expect (! reader.parse (deep, v), "deep nesting rejected");
+    }
+
     void run ()
     {
         test_bad_json ();
         test_edge_cases ();
         test_copy ();
         test_move ();
+        test_chunked ();
+        test_insitu ();
     }
 };
 
 BEAST_DEFINE_TESTSUITE(JsonCpp,json,ripple);
 
+//------------------------------------------------------------------------------
+
+// Parse cost of typical RPC requests, with the copy the doors used to make
+class JsonParse_timing_test : public beast::unit_test::suite
+{
+public:
+    static int const iterations = 200000;
+
+    template <class Parse>
+    double time (std::string const& request, Parse parse)
+    {
+        auto const start = std::chrono::steady_clock::now ();
+
+        for (int i = 0; i < iterations; ++i)
+        {
+            Json::Value v;
+
+            if (! parse (request, v) || ! v.isObject ())
+            {
+                fail ("request did not parse");
+                break;
+            }
+        }
+
+        auto const elapsed = std::chrono::steady_clock::now () - start;
+
+        return std::chrono::duration_cast <std::chrono::duration <double>> (
+            elapsed).count ();
+    }
+
+    void measure (char const* name, std::string const& request)
+    {
+        testcase (name);
+
+        double const reader = time (request,
+            [](std::string const& request, Json::Value& v)
+            {
+                std::string const copy (request);
+                return Json::Reader ().parse (copy, v);
+            });
+
+        Json::InSituReader insitu;
+        double const fast = time (request,
+            [&insitu](std::string const& request, Json::Value& v)
+            {
+                return insitu.parse (
+                    request.data (), request.data () + request.size (), v);
+            });
+
+        log << request.size () << " bytes, Reader " <<
+            (reader * 1e9 / iterations) << "ns, InSituReader " <<
+            (fast * 1e9 / iterations) << "ns (" << (reader / fast) << "x)";
+        pass ();
+    }
+
+    void run ()
+    {
+        measure ("submit",
+            "{\"method\":\"submit\",\"params\":[{\"tx_blob\":\"" +
+            std::string (
+                "12000022800000002400000001201B0000001E614000000000"
+                "0F424068400000000000000A732103AB40A0490F9B7ED8DF29"
+                "D246BF2D6269820A0EE7742ACDD457BEA7C7D0931EDB744730"
+                "4502210095D23D8AF107DF50651F266259CC7139D0CD0C64AB"
+                "BA3A958156352A0D95A21E02207FCF9B77D7510380E49FF250"
+                "C21B57169E14E9B4ACFD314CEDC79DDD0A38B8A8114B5F7620"
+                "83E8BEB8C94D09A2F39F9A2A2BBA6D4E983143E9D4A2B8AA08"
+                "70C0AB5AB9D3FC2C1A22B2D0E4A") +
+            "\"}]}");
+
+        measure ("account_info",
+            "{\"method\":\"account_info\",\"params\":[{"
+            "\"account\":\"rHb9CJAWyB4rj91VRWn96DkukG4bwdtyTh\","
+            "\"ledger_index\":\"validated\",\"strict\":true}]}");
+
+        measure ("book_offers",
+            "{\"method\":\"book_offers\",\"params\":[{"
+            "\"taker\":\"rHb9CJAWyB4rj91VRWn96DkukG4bwdtyTh\","
+            "\"taker_gets\":{\"currency\":\"XRP\"},"
+            "\"taker_pays\":{\"currency\":\"USD\","
+            "\"issuer\":\"rvYAfWj5gh67oV6fW32ZzP3Aw4Eubs59B\"},"
+            "\"ledger_index\":\"current\",\"limit\":10}]}");
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(JsonParse_timing,json,ripple);
+
 } // ripple
@@ -1060,6 +1060,511 @@ Reader::getFormatedErrorMessages () const
 }
 
 
+// Class InSituReader
+// //////////////////////////////////////////////////////////////////
+
+static bool
+decodeHexDigits ( Reader::Location& current,
+                  Reader::Location end,
+                  unsigned int& unicode )
+{
+    if ( end - current < 4 )
+        return false;
+
+    unicode = 0;
+
+    for ( int index = 0; index < 4; ++index )
+    {
+        Reader::Char c = *current++;
+        unicode *= 16;
+
+        if ( c >= '0'  &&  c <= '9' )
+            unicode += c - '0';
+        else if ( c >= 'a'  &&  c <= 'f' )
+            unicode += c - 'a' + 10;
+        else if ( c >= 'A'  &&  c <= 'F' )
+            unicode += c - 'A' + 10;
+        else
+            return false;
+    }
+
+    return true;
+}
+
+
+InSituReader::InSituReader ()
+    : current_ ( 0 )
+    , end_ ( 0 )
+{
+}
+
+
+bool
+InSituReader::parse ( std::string const& document, Value& root )
+{
+    const char* begin = document.data ();
+    return parse ( begin, begin + document.size (), root );
+}
+
+
+bool
+InSituReader::parse ( const char* beginDoc, const char* endDoc, Value& root )
+{
+    current_ = beginDoc;
+    end_ = endDoc;
+
+    // Like Reader, anything after the root value is ignored.
+    return readValue ( root, 0 );
+}
+
+
+bool
+InSituReader::readValue ( Value& value, int depth )
+{
+    if ( !skipSpaces ()  ||  current_ == end_ )
+        return false;
+
+    switch ( *current_++ )
+    {
+    case '{':
+        return readObject ( value, depth + 1 );
+
+    case '[':
+        return readArray ( value, depth + 1 );
+
+    case '"':
+    {
+        Location begin, end;
+        bool escaped = false;
+
+        if ( !readString ( begin, end, escaped ) )
+            return false;
+
+        if ( !escaped )
+        {
+            value = Value ( begin, end );
+            return true;
+        }
+
+        if ( !decodeString ( begin, end, decoded_ ) )
+            return false;
+
+        value = decoded_;
+        return true;
+    }
+
+    case 't':
+        if ( !match ( "rue", 3 ) )
+            return false;
+
+        value = true;
+        return true;
+
+    case 'f':
+        if ( !match ( "alse", 4 ) )
+            return false;
+
+        value = false;
+        return true;
+
+    case 'n':
+        if ( !match ( "ull", 3 ) )
+            return false;
+
+        value = Value ();
+        return true;
+
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+    case '-':
+        --current_;
+        return readNumber ( value );
+
+    default:
+        return false;
+    }
+}
+
+
+bool
+InSituReader::readObject ( Value& value, int depth )
+{
+    if ( depth > maxDepth )
+        return false;
+
+    value = Value ( objectValue );
+
+    if ( !skipSpaces ()  ||  current_ == end_ )
+        return false;
+
+    if ( *current_ == '}' ) // empty object
+    {
+        ++current_;
+        return true;
+    }
+
+    while ( true )
+    {
+        if ( !skipSpaces ()  ||  current_ == end_  ||  *current_++ != '"' )
+            return false;
+
+        Location begin, end;
+        bool escaped = false;
+
+        if ( !readString ( begin, end, escaped ) )
+            return false;
+
+        if ( !escaped )
+            name_.assign ( begin, end );
+        else if ( !decodeString ( begin, end, name_ ) )
+            return false;
+
+        if ( !skipSpaces ()  ||  current_ == end_  ||  *current_++ != ':' )
+            return false;
+
+        // Reject duplicate names, without a second lookup
+        Value::UInt const size = value.size ();
+        Value& member = value[ name_ ];
+
+        if ( value.size () == size )
+            return false;
+
+        if ( !readValue ( member, depth ) )
+            return false;
+
+        if ( !skipSpaces ()  ||  current_ == end_ )
+            return false;
+
+        Char const c = *current_++;
+
+        if ( c == '}' )
+            return true;
+
+        if ( c != ',' )
+            return false;
+    }
+}
+
+
+bool
+InSituReader::readArray ( Value& value, int depth )
+{
+    if ( depth > maxDepth )
+        return false;
+
+    value = Value ( arrayValue );
+
+    if ( !skipSpaces ()  ||  current_ == end_ )
+        return false;
+
+    if ( *current_ == ']' ) // empty array
+    {
+        ++current_;
+        return true;
+    }
+
+    for ( Value::UInt index = 0; ; ++index )
+    {
+        if ( !readValue ( value[ index ], depth ) )
+            return false;
+
+        if ( !skipSpaces ()  ||  current_ == end_ )
+            return false;
+
+        Char const c = *current_++;
+
+        if ( c == ']' )
+            return true;
+
+        if ( c != ',' )
+            return false;
+    }
+}
+
+
+bool
+InSituReader::readNumber ( Value& value )
+{
+    // Same rules as Reader::readNumber and Reader::decodeNumber
+    Location const begin = current_;
+    bool isDouble = false;
+
+    for ( ; current_ != end_; ++current_ )
+    {
+        Char const c = *current_;
+
+        if ( c >= '0'  &&  c <= '9' )
+            continue;
+
+        if ( c == '-'  &&  current_ == begin )
+            continue;
+
+        if ( !in ( c, '.', 'e', 'E', '+', '-' ) )
+            break;
+
+        isDouble = true;
+    }
+
+    if ( isDouble )
+    {
+        const int bufferSize = 32;
+        int const length = int ( current_ - begin );
+        Char buffer[bufferSize + 1];
+        std::string longBuffer;
+        const char* text = buffer;
+
+        if ( length <= bufferSize )
+        {
+            memcpy ( buffer, begin, length );
+            buffer[length] = 0;
+        }
+        else
+        {
+            longBuffer.assign ( begin, current_ );
+            text = longBuffer.c_str ();
+        }
+
+        char* parsed;
+        double const d = strtod ( text, &parsed );
+
+        if ( parsed == text )
+            return false;
+
+        value = d;
+        return true;
+    }
+
+    Location current = begin;
+    bool const isNegative = *current == '-';
+
+    if ( isNegative )
+        ++current;
+
+    std::int64_t v = 0;
+
+    while ( current < current_ && ( v <= Value::maxUInt ) )
+        v = ( v * 10 ) + ( *current++ - '0' );
+
+    if ( current != current_ )
+        return false;
+
+    if ( isNegative )
+    {
+        v = -v;
+
+        if ( v < Value::minInt || v > Value::maxInt )
+            return false;
+
+        value = static_cast<Value::Int> ( v );
+    }
+    else
+    {
+        if ( v > Value::maxUInt )
+            return false;
+
+        if ( v <= Value::maxInt )
+            value = static_cast<Value::Int> ( v );
+        else
+            value = static_cast<Value::UInt> ( v );
+    }
+
+    return true;
+}
+
+
+bool
+InSituReader::readString ( Location& begin, Location& end, bool& escaped )
+{
+    begin = current_;
+
+    while ( current_ != end_ )
+    {
+        Char const c = *current_++;
+
+        if ( c == '"' )
+        {
+            end = current_ - 1;
+            return true;
+        }
+
+        if ( c == '\\' )
+        {
+            if ( current_ == end_ )
+                return false;
+
+            escaped = true;
+            ++current_;
+        }
+    }
+
+    return false;
+}
+
+
+bool
+InSituReader::decodeString ( Location current, Location end,
+                             std::string& decoded )
+{
+    decoded.clear ();
+
+    while ( current != end )
+    {
+        Char c = *current++;
+
+        if ( c != '\\' )
+        {
+            decoded += c;
+            continue;
+        }
+
+        switch ( *current++ )
+        {
+        case '"':
+            decoded += '"';
+            break;
+
+        case '/':
+            decoded += '/';
+            break;
+
+        case '\\':
+            decoded += '\\';
+            break;
+
+        case 'b':
+            decoded += '\b';
+            break;
+
+        case 'f':
+            decoded += '\f';
+            break;
+
+        case 'n':
+            decoded += '\n';
+            break;
+
+        case 'r':
+            decoded += '\r';
+            break;
+
+        case 't':
+            decoded += '\t';
+            break;
+
+        case 'u':
+        {
+            unsigned int unicode;
+
+            if ( !decodeHexDigits ( current, end, unicode ) )
+                return false;
+
+            if ( unicode >= 0xD800  &&  unicode <= 0xDBFF )
+            {
+                // surrogate pairs
+                unsigned int surrogatePair;
+
+                if ( end - current < 6  ||
+                        * ( current++ ) != '\\'  ||  * ( current++ ) != 'u'  ||
+                        !decodeHexDigits ( current, end, surrogatePair ) )
+                    return false;
+
+                unicode = 0x10000 + ( ( unicode & 0x3FF ) << 10 ) +
+                    ( surrogatePair & 0x3FF );
+            }
+
+            decoded += codePointToUTF8 ( unicode );
+        }
+        break;
+
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool
+InSituReader::skipSpaces ()
+{
+    while ( current_ != end_ )
+    {
+        Char const c = *current_;
+
+        if ( c == ' '  ||  c == '\t'  ||  c == '\r'  ||  c == '\n' )
+            ++current_;
+        else if ( c == '/' )
+        {
+            if ( !skipComment () )
+                return false;
+        }
+        else
+            break;
+    }
+
+    return true;
+}
+
+
+bool
+InSituReader::skipComment ()
+{
+    ++current_;
+
+    if ( current_ == end_ )
+        return false;
+
+    Char const c = *current_++;
+
+    if ( c == '*' )
+    {
+        while ( current_ != end_ )
+        {
+            if ( *current_++ == '*'  &&  current_ != end_  &&  *current_ == '/' )
+            {
+                ++current_;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    if ( c == '/' )
+    {
+        while ( current_ != end_  &&  *current_ != '\r'  &&  *current_ != '\n' )
+            ++current_;
+
+        return true;
+    }
+
+    return false;
+}
+
+
+bool
+InSituReader::match ( Location pattern, int patternLength )
+{
+    if ( end_ - current_ < patternLength )
+        return false;
+
+    if ( memcmp ( current_, pattern, patternLength ) != 0 )
+        return false;
+
+    current_ += patternLength;
+    return true;
+}
+
+
 std::istream& operator>> ( std::istream& sin, Value& root )
 {
     Json::Reader reader;
@@ -281,6 +281,148 @@ FastWriter::writeValue ( const Value& value )
 }
 
 
+// Class ChunkedWriter
+// //////////////////////////////////////////////////////////////////
+
+ChunkedWriter::ChunkedWriter ( Sink sink, std::size_t chunkBytes )
+    : sink_ ( std::move (sink) )
+    , chunkBytes_ ( chunkBytes )
+{
+    buffer_.reserve ( chunkBytes_ );
+}
+
+
+void
+ChunkedWriter::write ( const Value& value )
+{
+    writeValue ( value );
+}
+
+
+void
+ChunkedWriter::output ( char const* data, std::size_t bytes )
+{
+    if ( buffer_.size () + bytes > chunkBytes_ )
+    {
+        flush ();
+
+        // Too big to be worth buffering
+        if ( bytes >= chunkBytes_ )
+        {
+            sink_ ( data, bytes );
+            return;
+        }
+    }
+
+    buffer_.append ( data, bytes );
+}
+
+
+void
+ChunkedWriter::output ( std::string const& text )
+{
+    output ( text.data (), text.size () );
+}
+
+
+void
+ChunkedWriter::flush ()
+{
+    if ( !buffer_.empty () )
+    {
+        sink_ ( buffer_.data (), buffer_.size () );
+        buffer_.clear ();
+    }
+}
+
+
+std::size_t
+ChunkedWriter::measure ( const Value& value )
+{
+    std::size_t bytes = 0;
+    ChunkedWriter writer ( [&bytes] (char const*, std::size_t n)
+    {
+        bytes += n;
+    });
+    writer.write ( value );
+    writer.flush ();
+    return bytes;
+}
+
+
+void
+ChunkedWriter::writeValue ( const Value& value )
+{
+    switch ( value.type () )
+    {
+    case nullValue:
+        output ( "null", 4 );
+        break;
+
+    case intValue:
+        output ( valueToString ( value.asInt () ) );
+        break;
+
+    case uintValue:
+        output ( valueToString ( value.asUInt () ) );
+        break;
+
+    case realValue:
+        output ( valueToString ( value.asDouble () ) );
+        break;
+
+    case stringValue:
+        output ( valueToQuotedString ( value.asCString () ) );
+        break;
+
+    case booleanValue:
+        output ( valueToString ( value.asBool () ) );
+        break;
+
+    case arrayValue:
+    {
+        output ( "[", 1 );
+        int size = value.size ();
+
+        for ( int index = 0; index < size; ++index )
+        {
+            if ( index > 0 )
+                output ( ",", 1 );
+
+            writeValue ( value[index] );
+        }
+
+        output ( "]", 1 );
+    }
+    break;
+
+    case objectValue:
+    {
+        // Walks the members in place, in the order getMemberNames returns
+        output ( "{", 1 );
+        bool first = true;
+
+        for ( Value::const_iterator it = value.begin ();
+                it != value.end ();
+                ++it )
+        {
+            if ( !first )
+                output ( ",", 1 );
+
+            first = false;
+
+            output ( valueToQuotedString ( it.memberName () ) );
+            output ( ":", 1 );
+            writeValue ( *it );
+        }
+
+        output ( "}", 1 );
+    }
+    break;
+    }
+}
+
+
 // Class StyledWriter
 // //////////////////////////////////////////////////////////////////
 
@@ -189,6 +189,54 @@ private:
     bool collectComments_;
 };
 
+/** \brief Unserialize a JSON document in one pass over the caller's buffer.
+ *
+ * Accepts the same documents as Reader, but parses straight out of the
+ * buffer without copying it or splitting it into tokens first. Strings
+ * and member names without escapes become values directly from their
+ * span of the buffer; only escaped strings are decoded, into scratch
+ * space the reader keeps between documents. Comments are skipped rather
+ * than collected, and no error text is built. Used for RPC requests,
+ * where a document is parsed once and only a few of its fields are read.
+ */
+class JSON_API InSituReader
+{
+public:
+    InSituReader ();
+
+    /** \brief Read a Value from a JSON document.
+     * \return \c true if the document was successfully parsed.
+     */
+    bool parse ( std::string const& document, Value& root );
+
+    /** \brief Read a Value from the JSON document in [beginDoc, endDoc).
+     * \return \c true if the document was successfully parsed.
+     */
+    bool parse ( const char* beginDoc, const char* endDoc, Value& root );
+
+private:
+    typedef char Char;
+    typedef const Char* Location;
+
+    // Deeper documents are rejected rather than overflowing the stack.
+    enum { maxDepth = 256 };
+
+    bool readValue ( Value& value, int depth );
+    bool readObject ( Value& value, int depth );
+    bool readArray ( Value& value, int depth );
+    bool readNumber ( Value& value );
+    bool readString ( Location& begin, Location& end, bool& escaped );
+    bool decodeString ( Location begin, Location end, std::string& decoded );
+    bool skipSpaces ();
+    bool skipComment ();
+    bool match ( Location pattern, int patternLength );
+
+    Location current_;
+    Location end_;
+    std::string name_;
+    std::string decoded_;
+};
+
 /** \brief Read from 'sin' into 'root'.
 
  Always keep comments from the input JSON.
@@ -24,6 +24,8 @@
 #ifndef JSON_WRITER_H_INCLUDED
 #define JSON_WRITER_H_INCLUDED
 
+#include <functional>
+
 namespace Json
 {
 
@@ -63,6 +65,42 @@ private:
     bool yamlCompatiblityEnabled_;
 };
 
+/** \brief Outputs a Value in the same format as FastWriter, a piece at a time.
+ *
+ * Instead of building the whole document in a string, the output is handed
+ * to a sink in chunks as the value is walked, so a large document never has
+ * to be held in memory and the first chunk can be sent before the last one
+ * is written. Unlike FastWriter::write, no newline is appended.
+ */
+class JSON_API ChunkedWriter
+{
+public:
+    /** Receives each chunk of output. */
+    typedef std::function <void (char const* data, std::size_t bytes)> Sink;
+
+    explicit ChunkedWriter ( Sink sink, std::size_t chunkBytes = 16384 );
+
+    /** Write a value. */
+    void write ( const Value& value );
+
+    /** Write text as is, such as an envelope around a value. */
+    void output ( char const* data, std::size_t bytes );
+
+    /** Hand anything still buffered to the sink. */
+    void flush ();
+
+    /** Returns the number of bytes write() produces for a value. */
+    static std::size_t measure ( const Value& value );
+
+private:
+    void output ( std::string const& text );
+    void writeValue ( const Value& value );
+
+    Sink sink_;
+    std::size_t chunkBytes_;
+    std::string buffer_;
+};
+
 /** \brief Writes a Value in <a HREF="http://www.json.org">JSON</a> format in a human friendly way.
  *
  * The rules for line break and indent are as follow:
@@ -28,6 +28,14 @@
 #include <boost/asio/streambuf.hpp>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 
+namespace boost {
+namespace asio {
+namespace ssl {
+class context;
+}
+}
+}
+
 namespace ripple {
 
 /** Provides an asynchronous HTTP client implementation with optional SSL.
@@ -42,6 +50,9 @@ public:
 
     static void initializeSSLContext ();
 
+    /** Returns the context used to verify the servers we connect to. */
+    static boost::asio::ssl::context& getSSLContext ();
+
     static void get (
         bool bSSL,
         boost::asio::io_service& io_service,
@@ -54,6 +54,39 @@ public:
 
     typedef Resource::Consumer Consumer;
 
+public:
+    /** A published event, rendered to text once for all of its subscribers.
+        The publisher makes one Payload per event and passes the same
+        instance to every subscriber, so a stream with thousands of
+        listeners serializes the JSON once instead of once per connection.
+    */
+    class Payload
+    {
+    public:
+        typedef std::shared_ptr <Payload const> pointer;
+
+        explicit Payload (Json::Value const& jvObj);
+
+        static pointer make (Json::Value const& jvObj)
+        {
+            return std::make_shared <Payload const> (jvObj);
+        }
+
+        Json::Value const& getJson () const
+        {
+            return mJson;
+        }
+
+        std::string const& getText () const
+        {
+            return mText;
+        }
+
+    private:
+        Json::Value mJson;
+        std::string mText;
+    };
+
 public:
     /** Abstracts the source of subscription data.
     */
@@ -110,6 +143,11 @@ public:
     virtual void send (
         Json::Value const& jvObj, std::string const& sObj, bool broadcast);
 
+    /** Send an event shared with other subscribers.
+        The default sends the JSON, for subscribers that do not write text.
+    */
+    virtual void send (Payload::pointer const& payload, bool broadcast);
+
     std::uint64_t getSeq ();
 
     void onSendEmpty ();
@@ -37,13 +37,15 @@ public:
     typedef pointer const& ref;
 
     static pointer New (InfoSub::Source& source,
-        boost::asio::io_service& io_service, JobQueue& jobQueue,
-            std::string const& strUrl, std::string const& strUsername,
-            std::string const& strPassword);
+        boost::asio::io_service& io_service, std::string const& strUrl,
+            std::string const& strUsername, std::string const& strPassword);
 
     virtual void setUsername (std::string const& strUsername) = 0;
     virtual void setPassword (std::string const& strPassword) = 0;
 
+    /** Returns the queue depth, lag and delivery counts. */
+    virtual Json::Value getJson () = 0;
+
 protected:
     explicit RPCSub (InfoSub::Source& source);
 };
@@ -42,6 +42,11 @@ extern std::string createHTTPPost (std::string const& strHost, std::string const
 
 extern std::string HTTPReply (int nStatus, std::string const& strMsg);
 
+// Writes the same bytes as HTTPReply (nStatus, JSONRPCReply (result, ...))
+// to the sink in chunks, without building the reply in memory.
+extern void HTTPReply (int nStatus, Json::Value const& result,
+                       Json::ChunkedWriter::Sink const& sink);
+
 // VFALCO TODO Create a HTTPHeaders class with a nice interface instead of the std::map
 //
 extern bool HTTPAuthorized (std::map <std::string, std::string> const& mapHeaders);
@@ -89,6 +89,11 @@ void HTTPClient::initializeSSLContext ()
     beast::SharedSingleton <HTTPClientSSLContext>::get();
 }
 
+boost::asio::ssl::context& HTTPClient::getSSLContext ()
+{
+    return beast::SharedSingleton <HTTPClientSSLContext>::get()->context();
+}
+
 //------------------------------------------------------------------------------
 
 class HTTPClientImp
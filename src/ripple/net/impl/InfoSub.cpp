@@ -46,6 +46,14 @@ InfoSub::Source::Source (char const* name, Stoppable& parent)
 
 //------------------------------------------------------------------------------
 
+InfoSub::Payload::Payload (Json::Value const& jvObj)
+    : mJson (jvObj)
+    , mText (Json::FastWriter ().write (jvObj))
+{
+}
+
+//------------------------------------------------------------------------------
+
 InfoSub::InfoSub (Source& source, Consumer consumer)
     : m_consumer (consumer)
     , m_source (source)
@@ -75,6 +83,11 @@ void InfoSub::send (
     send (jvObj, broadcast);
 }
 
+void InfoSub::send (Payload::pointer const& payload, bool broadcast)
+{
+    send (payload->getJson (), payload->getText (), broadcast);
+}
+
 std::uint64_t InfoSub::getSeq ()
 {
     return mSeq;
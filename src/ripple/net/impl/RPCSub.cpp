@@ -22,27 +22,62 @@
 //==============================================================================
 
 #include <ripple/basics/StringUtilities.h>
+#include <ripple/common/jsonrpc_fields.h>
 #include <ripple/net/RPCSub.h>
+#include <beast/asio/placeholders.h>
+#include <beast/cxx14/memory.h> // <memory>
+#include <beast/unit_test/suite.h>
+#include <boost/regex.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
 
 namespace ripple {
 
 // Subscription object for JSON-RPC
+//
+// Events are POSTed to the url over one connection which is kept alive
+// between requests. Each request carries every event queued while the
+// previous one was outstanding, so a busy subscriber gets fewer, larger
+// requests instead of a connection per event. All network work runs on
+// the strand; send() only touches the queue.
+//
+// A reply's body is read by its Content-Length or its chunks, so the
+// connection can be used again. A reply with neither is finished as soon
+// as its header arrives, and the connection is closed.
+//
 class RPCSubImp
     : public RPCSub
+    , public std::enable_shared_from_this <RPCSubImp>
     , public beast::LeakChecked <RPCSub>
 {
 public:
     RPCSubImp (InfoSub::Source& source, boost::asio::io_service& io_service,
-        JobQueue& jobQueue, std::string const& strUrl, std::string const& strUsername,
+        std::string const& strUrl, std::string const& strUsername,
             std::string const& strPassword)
         : RPCSub (source)
         , m_io_service (io_service)
-        , m_jobQueue (jobQueue)
+        , m_strand (io_service)
+        , m_resolver (io_service)
+        , m_deadline (io_service)
+        , m_retry (io_service)
         , mUrl (strUrl)
         , mSSL (false)
         , mUsername (strUsername)
         , mPassword (strPassword)
         , mSending (false)
+        , mDropping (false)
+        , mQueueMax (getConfig ().RPC_SUB_QUEUE)
+        , mBodySize (0)
+        , mRetrySeconds (retryMinSeconds)
+        , mKeepAlive (false)
+        , mReused (false)
+        , mSent (0)
+        , mBatches (0)
+        , mDropped (0)
+        , mFailures (0)
+        , mConnects (0)
+        , mLatency (0)
     {
         std::string strScheme;
 
@@ -79,27 +114,34 @@ public:
     {
         ScopedLockType sl (mLock);
 
-        if (mDeque.size () >= eventQueueMax)
+        if (mDeque.size () >= mQueueMax)
         {
-            // Drop the previous event.
-            WriteLog (lsWARNING, RPCSub) << "RPCCall::fromNetwork drop";
-            mDeque.pop_back ();
+            // Drop the oldest event, and say so once each time we fall behind.
+            if (!mDropping)
+            {
+                WriteLog (lsWARNING, RPCSub) <<
+                    "RPCCall::fromNetwork drop: " << mUrl << " is " <<
+                    mDeque.size () << " events behind";
+                mDropping = true;
+            }
+
+            mDeque.pop_front ();
+            ++mDropped;
         }
 
         WriteLog (broadcast ? lsDEBUG : lsINFO, RPCSub) <<
             "RPCCall::fromNetwork push: " << jvObj;
 
-        mDeque.push_back (std::make_pair (mSeq++, jvObj));
+        mDeque.emplace_back (mSeq++, jvObj);
 
         if (!mSending)
         {
-            // Start a sending thread.
             mSending    = true;
 
             WriteLog (lsINFO, RPCSub) << "RPCCall::fromNetwork start";
 
-            m_jobQueue.addJob (
-                jtCLIENT, "RPCSub::sendThread", std::bind (&RPCSubImp::sendThread, this));
+            m_strand.post (std::bind (
+                &RPCSubImp::sendBatch, shared_from_this ()));
         }
     }
 
@@ -117,71 +159,517 @@ public:
         mPassword = strPassword;
     }
 
+    Json::Value getJson ()
+    {
+        Json::Value ret (Json::objectValue);
+        auto const now (clock_type::now ());
+
+        ScopedLockType sl (mLock);
+
+        ret["url"]          = mUrl;
+        ret["connected"]    = mSocket != nullptr;
+        ret["queued"]       = static_cast <Json::UInt> (mDeque.size ());
+        ret["queue_max"]    = static_cast <Json::UInt> (mQueueMax);
+        ret["in_flight"]    = static_cast <Json::UInt> (mBatch.size ());
+        ret["sent"]         = std::to_string (mSent);
+        ret["requests"]     = std::to_string (mBatches);
+        ret["dropped"]      = std::to_string (mDropped);
+        ret["failures"]     = static_cast <Json::UInt> (mFailures);
+        ret["connects"]     = static_cast <Json::UInt> (mConnects);
+        ret["latency_ms"]   = static_cast <Json::UInt> (mLatency);
+
+        // How long the oldest undelivered event has waited
+        std::chrono::milliseconds lag (0);
+
+        if (!mBatch.empty ())
+            lag = std::chrono::duration_cast <std::chrono::milliseconds> (
+                now - mBatch.front ().queued);
+        else if (!mDeque.empty ())
+            lag = std::chrono::duration_cast <std::chrono::milliseconds> (
+                now - mDeque.front ().queued);
+
+        ret["lag_ms"]       = static_cast <Json::UInt> (lag.count ());
+
+        return ret;
+    }
+
 private:
-    // XXX Could probably create a bunch of send jobs in a single get of the lock.
-    void sendThread ()
+    typedef std::chrono::steady_clock clock_type;
+
+    struct Event
+    {
+        Event (int seq_, Json::Value const& json_)
+            : seq (seq_)
+            , json (json_)
+            , queued (clock_type::now ())
+        {
+        }
+
+        int seq;
+        Json::Value json;
+        clock_type::time_point queued;
+    };
+
+    // Takes the queued events and POSTs them as one request.
+    void sendBatch ()
     {
-        Json::Value jvEvent;
-        bool bSend;
+        std::map <std::string, std::string> mapRequestHeaders;
 
-        do
         {
+            ScopedLockType sl (mLock);
+
+            if (mDeque.empty ())
             {
-                // Obtain the lock to manipulate the queue and change sending.
-                ScopedLockType sl (mLock);
+                mSending    = false;
+                return;
+            }
 
-                if (mDeque.empty ())
-                {
-                    mSending    = false;
-                    bSend       = false;
-                }
-                else
-                {
-                    std::pair<int, Json::Value> pEvent  = mDeque.front ();
+            while (!mDeque.empty () && (mBatch.size () < batchMax))
+            {
+                mBatch.push_back (std::move (mDeque.front ()));
+                mDeque.pop_front ();
+            }
 
-                    mDeque.pop_front ();
+            mapRequestHeaders["Authorization"] = std::string ("Basic ") +
+                RPCParser::EncodeBase64 (mUsername + ":" + mPassword);
+        }
 
-                    jvEvent     = pEvent.second;
-                    jvEvent["seq"]  = pEvent.first;
+        // Build the request outside of the lock.
+        Json::Value jvRequest (Json::arrayValue);
 
-                    bSend       = true;
-                }
+        for (auto& event : mBatch)
+        {
+            Json::Value& jvCall (jvRequest.append (Json::objectValue));
+
+            event.json["seq"]       = event.seq;
+            jvCall[jss::method]     = "event";
+            jvCall[jss::params]     = event.json;
+            jvCall[jss::id]         = event.seq;
+        }
+
+        mapRequestHeaders["Connection"] = "keep-alive";
+
+        std::ostream osRequest (&mRequest);
+        osRequest << createHTTPPost (mIp, mPath,
+            Json::FastWriter ().write (jvRequest), mapRequestHeaders);
+
+        WriteLog (lsINFO, RPCSub) << "RPCCall::fromNetwork: " << mIp <<
+            " events: " << mBatch.size ();
+
+        mStart = clock_type::now ();
+
+        m_deadline.expires_from_now (
+            boost::posix_time::seconds (int (requestTimeoutSeconds)));
+        m_deadline.async_wait (m_strand.wrap (std::bind (
+            &RPCSubImp::handleDeadline, shared_from_this (),
+                beast::asio::placeholders::error)));
+
+        mReused = mSocket != nullptr;
+
+        if (mReused)
+        {
+            write ();
+            return;
+        }
+
+        // Connect, the previous connection was closed or there was none.
+        {
+            ScopedLockType sl (mLock);
+
+            mSocket = std::make_unique <AutoSocket> (
+                m_io_service, HTTPClient::getSSLContext ());
+            ++mConnects;
+        }
+
+        if (!getConfig ().SSL_VERIFY)
+            mSocket->SSLSocket ().set_verify_mode (boost::asio::ssl::verify_none);
+
+        boost::asio::ip::tcp::resolver::query query (mIp,
+            std::to_string (mPort),
+                boost::asio::ip::resolver_query_base::numeric_service);
+
+        m_resolver.async_resolve (query, m_strand.wrap (std::bind (
+            &RPCSubImp::handleResolve, shared_from_this (),
+                beast::asio::placeholders::error,
+                    beast::asio::placeholders::iterator)));
+    }
+
+    void handleResolve (boost::system::error_code const& ec,
+        boost::asio::ip::tcp::resolver::iterator itrEndpoint)
+    {
+        if (ec)
+            return fail ("resolve", ec);
+
+        boost::asio::async_connect (mSocket->lowest_layer (), itrEndpoint,
+            m_strand.wrap (std::bind (&RPCSubImp::handleConnect,
+                shared_from_this (), beast::asio::placeholders::error)));
+    }
+
+    void handleConnect (boost::system::error_code const& ec)
+    {
+        if (ec)
+            return fail ("connect", ec);
+
+        if (!mSSL)
+            return write ();
+
+        if (getConfig ().SSL_VERIFY)
+        {
+            boost::system::error_code const ecVerify (mSocket->verify (mIp));
+
+            if (ecVerify)
+                return fail ("verify", ecVerify);
+        }
+
+        mSocket->async_handshake (AutoSocket::ssl_socket::client,
+            m_strand.wrap (std::bind (&RPCSubImp::handleHandshake,
+                shared_from_this (), beast::asio::placeholders::error)));
+    }
+
+    void handleHandshake (boost::system::error_code const& ec)
+    {
+        if (ec)
+            return fail ("handshake", ec);
+
+        write ();
+    }
+
+    void write ()
+    {
+        mSocket->async_write (mRequest, m_strand.wrap (std::bind (
+            &RPCSubImp::handleWrite, shared_from_this (),
+                beast::asio::placeholders::error)));
+    }
+
+    void handleWrite (boost::system::error_code const& ec)
+    {
+        if (ec)
+            return fail ("write", ec);
+
+        mSocket->async_read_until (mResponse, "\r\n\r\n",
+            m_strand.wrap (std::bind (&RPCSubImp::handleHeader,
+                shared_from_this (), beast::asio::placeholders::error,
+                    beast::asio::placeholders::bytes_transferred)));
+    }
+
+    void handleHeader (boost::system::error_code const& ec,
+        std::size_t bytes_transferred)
+    {
+        if (ec)
+            return fail ("read", ec);
+
+        std::string const strHeader (boost::asio::buffer_cast <char const*> (
+            mResponse.data ()), bytes_transferred);
+        mResponse.consume (bytes_transferred);
+
+        WriteLog (lsTRACE, RPCSub) << "Header: \"" << strHeader << "\"";
+
+        static boost::regex reStatus ("\\`HTTP/1\\.(\\d) (\\d{3}) .*\\'");     // HTTP/1.1 200 OK
+        static boost::regex reSize ("\\`.*\\r\\nContent-Length:\\s+([0-9]+).*\\'",
+            boost::regex::icase);
+        static boost::regex reClose ("\\`.*\\r\\nConnection:\\s+close.*\\'",
+            boost::regex::icase);
+        static boost::regex reKeepAlive ("\\`.*\\r\\nConnection:\\s+keep-alive.*\\'",
+            boost::regex::icase);
+        static boost::regex reChunked ("\\`.*\\r\\nTransfer-Encoding:\\s+chunked.*\\'",
+            boost::regex::icase);
+
+        boost::smatch smMatch;
+
+        if (!boost::regex_match (strHeader, smMatch, reStatus))
+            return fail ("read", boost::system::error_code (
+                boost::system::errc::bad_message,
+                    boost::system::system_category ()));
+
+        mStatus = beast::lexicalCastThrow <int> (std::string (smMatch[2]));
+
+        // HTTP/1.1 servers keep the connection unless they say otherwise,
+        // HTTP/1.0 servers only if they say so.
+        if (smMatch[1] == "0")
+            mKeepAlive = boost::regex_match (strHeader, reKeepAlive);
+        else
+            mKeepAlive = !boost::regex_match (strHeader, reClose);
+
+        if (boost::regex_match (strHeader, reChunked))
+        {
+            mBodySize = 0;
+            return readChunkSize ();
+        }
+
+        if (boost::regex_match (strHeader, smMatch, reSize))
+        {
+            std::size_t const size (
+                beast::lexicalCastThrow <std::size_t> (std::string (smMatch[1])));
+
+            if (size > responseMax)
+                return fail ("read", boost::system::error_code (
+                    boost::system::errc::message_size,
+                        boost::system::system_category ()));
+
+            if (size > mResponse.size ())
+            {
+                mSocket->async_read (mResponse,
+                    boost::asio::transfer_exactly (size - mResponse.size ()),
+                    m_strand.wrap (std::bind (&RPCSubImp::handleBody,
+                        shared_from_this (), beast::asio::placeholders::error)));
+                return;
             }
 
-            // Send outside of the lock.
-            if (bSend)
+            mResponse.consume (size);
+            return handleBody (boost::system::error_code ());
+        }
+
+        // Without a length the body, if any, runs to the end of the
+        // connection. The status already tells us whether the events were
+        // taken, so finish now and close instead of waiting for the server
+        // to close, which a server keeping the connection never does.
+        mKeepAlive = false;
+        handleBody (boost::system::error_code ());
+    }
+
+    // A chunked body is read and discarded one chunk at a time.
+    void readChunkSize ()
+    {
+        mSocket->async_read_until (mResponse, "\r\n",
+            m_strand.wrap (std::bind (&RPCSubImp::handleChunkSize,
+                shared_from_this (), beast::asio::placeholders::error,
+                    beast::asio::placeholders::bytes_transferred)));
+    }
+
+    void handleChunkSize (boost::system::error_code const& ec,
+        std::size_t bytes_transferred)
+    {
+        if (ec)
+            return fail ("read", ec);
+
+        std::string const line (boost::asio::buffer_cast <char const*> (
+            mResponse.data ()), bytes_transferred);
+        mResponse.consume (bytes_transferred);
+
+        // The size is in hex and may be followed by extensions
+        char* end;
+        unsigned long const size (std::strtoul (line.c_str (), &end, 16));
+
+        if (end == line.c_str ())
+            return fail ("read", boost::system::error_code (
+                boost::system::errc::bad_message,
+                    boost::system::system_category ()));
+
+        if (size > responseMax - mBodySize)
+            return fail ("read", boost::system::error_code (
+                boost::system::errc::message_size,
+                    boost::system::system_category ()));
+
+        if (size == 0)
+            return readTrailer ();
+
+        mBodySize += size;
+
+        // Each chunk ends with a CRLF
+        std::size_t const chunk (size + 2);
+
+        if (chunk > mResponse.size ())
+        {
+            mSocket->async_read (mResponse,
+                boost::asio::transfer_exactly (chunk - mResponse.size ()),
+                m_strand.wrap (std::bind (&RPCSubImp::handleChunk,
+                    shared_from_this (), beast::asio::placeholders::error,
+                        chunk)));
+            return;
+        }
+
+        handleChunk (boost::system::error_code (), chunk);
+    }
+
+    void handleChunk (boost::system::error_code const& ec, std::size_t chunk)
+    {
+        if (ec)
+            return fail ("read", ec);
+
+        mResponse.consume (chunk);
+        readChunkSize ();
+    }
+
+    // The trailer ends with an empty line.
+    void readTrailer ()
+    {
+        mSocket->async_read_until (mResponse, "\r\n",
+            m_strand.wrap (std::bind (&RPCSubImp::handleTrailer,
+                shared_from_this (), beast::asio::placeholders::error,
+                    beast::asio::placeholders::bytes_transferred)));
+    }
+
+    void handleTrailer (boost::system::error_code const& ec,
+        std::size_t bytes_transferred)
+    {
+        if (ec)
+            return fail ("read", ec);
+
+        mResponse.consume (bytes_transferred);
+
+        if (bytes_transferred == 2)
+            return handleBody (boost::system::error_code ());
+
+        readTrailer ();
+    }
+
+    void handleBody (boost::system::error_code const& ec)
+    {
+        if (ec)
+            return fail ("read", ec);
+
+        // We don't use the reply.
+        mResponse.consume (mResponse.size ());
+        m_deadline.cancel ();
+
+        auto const latency (std::chrono::duration_cast <
+            std::chrono::milliseconds> (clock_type::now () - mStart));
+
+        if ((mStatus < 200) || (mStatus >= 300))
+        {
+            // The server saw the events and refused them, sending them
+            // again won't help.
+            WriteLog (lsWARNING, RPCSub) << "RPCCall::fromNetwork: " << mUrl <<
+                " returned HTTP " << mStatus << ", dropped " <<
+                mBatch.size () << " events";
+        }
+
+        {
+            ScopedLockType sl (mLock);
+
+            if ((mStatus < 200) || (mStatus >= 300))
             {
-                // XXX Might not need this in a try.
-                try
-                {
-                    WriteLog (lsINFO, RPCSub) << "RPCCall::fromNetwork: " << mIp;
-
-                    RPCCall::fromNetwork (
-                        m_io_service,
-                        mIp, mPort,
-                        mUsername, mPassword,
-                        mPath, "event",
-                        jvEvent,
-                        mSSL);
-                }
-                catch (const std::exception& e)
-                {
-                    WriteLog (lsINFO, RPCSub) << "RPCCall::fromNetwork exception: " << e.what ();
-                }
+                mDropped += mBatch.size ();
+                ++mFailures;
+            }
+            else
+            {
+                mSent += mBatch.size ();
+                ++mBatches;
+            }
+
+            mLatency = latency.count ();
+            mDropping = false;
+            mBatch.clear ();
+
+            if (!mKeepAlive)
+                close ();
+        }
+
+        mRetrySeconds = retryMinSeconds;
+
+        sendBatch ();
+    }
+
+    void handleDeadline (boost::system::error_code const& ec)
+    {
+        // Ignore the timer of a request which already finished.
+        if ((ec == boost::asio::error::operation_aborted) ||
+            mBatch.empty () ||
+            (m_deadline.expires_at () >
+                boost::asio::deadline_timer::traits_type::now ()))
+        {
+            return;
+        }
+
+        WriteLog (lsINFO, RPCSub) << "RPCCall::fromNetwork timeout: " << mUrl;
+
+        // Aborting the pending operation makes it fail.
+        boost::system::error_code ecClose;
+
+        m_resolver.cancel ();
+
+        if (mSocket)
+            mSocket->lowest_layer ().close (ecClose);
+    }
+
+    // The events in flight go back on the queue and we try again later.
+    void fail (char const* what, boost::system::error_code const& ec)
+    {
+        WriteLog (lsINFO, RPCSub) << "RPCCall::fromNetwork " << what <<
+            " error: " << mUrl << ": " << ec.message ();
+
+        m_deadline.cancel ();
+        mRequest.consume (mRequest.size ());
+        mResponse.consume (mResponse.size ());
+
+        {
+            ScopedLockType sl (mLock);
+
+            close ();
+
+            if (!mReused)
+                ++mFailures;
+
+            while (!mBatch.empty ())
+            {
+                mDeque.push_front (std::move (mBatch.back ()));
+                mBatch.pop_back ();
             }
+
+            while (mDeque.size () > mQueueMax)
+            {
+                mDeque.pop_front ();
+                ++mDropped;
+            }
+        }
+
+        if (mReused)
+        {
+            // The server may have closed the connection while it was idle,
+            // so try once more on a new one before backing off.
+            mReused = false;
+            m_strand.post (std::bind (
+                &RPCSubImp::sendBatch, shared_from_this ()));
+            return;
+        }
+
+        m_retry.expires_from_now (boost::posix_time::seconds (mRetrySeconds));
+        m_retry.async_wait (m_strand.wrap (std::bind (
+            &RPCSubImp::handleRetry, shared_from_this (),
+                beast::asio::placeholders::error)));
+
+        mRetrySeconds = std::min (mRetrySeconds * 2, int (retryMaxSeconds));
+    }
+
+    void handleRetry (boost::system::error_code const& ec)
+    {
+        if (ec != boost::asio::error::operation_aborted)
+            sendBatch ();
+    }
+
+    // Requires the lock.
+    void close ()
+    {
+        if (mSocket)
+        {
+            boost::system::error_code ec;
+            mSocket->lowest_layer ().close (ec);
+            mSocket.reset ();
         }
-        while (bSend);
     }
 
 private:
-// VFALCO TODO replace this macro with a language constant
     enum
     {
-        eventQueueMax = 32
+        // The most events sent in one request
+        batchMax = 256,
+
+        // The largest reply we will read and discard
+        responseMax = 1024 * 1024,
+
+        requestTimeoutSeconds = 60,
+
+        // Delay before retrying a failed request, doubled on each failure
+        retryMinSeconds = 1,
+        retryMaxSeconds = 60
     };
 
     boost::asio::io_service& m_io_service;
-    JobQueue& m_jobQueue;
+    boost::asio::io_service::strand m_strand;
+    boost::asio::ip::tcp::resolver m_resolver;
+    boost::asio::deadline_timer m_deadline;
+    boost::asio::deadline_timer m_retry;
 
     std::string             mUrl;
     std::string             mIp;
@@ -193,9 +681,31 @@ private:
 
     int                     mSeq;                       // Next id to allocate.
 
-    bool                    mSending;                   // Sending threead is active.
-
-    std::deque<std::pair<int, Json::Value> >    mDeque;
+    bool                    mSending;                   // A batch is being sent or retried.
+    bool                    mDropping;                  // Dropped events since the last send.
+
+    std::size_t             mQueueMax;
+    std::deque <Event>      mDeque;
+
+    // Used on the strand only
+    std::vector <Event>     mBatch;                     // Events in the request being sent.
+    std::unique_ptr <AutoSocket> mSocket;
+    boost::asio::streambuf  mRequest;
+    boost::asio::streambuf  mResponse;
+    clock_type::time_point  mStart;
+    int                     mStatus;
+    std::size_t             mBodySize;                  // Bytes of chunked body read so far.
+    int                     mRetrySeconds;
+    bool                    mKeepAlive;                 // The server will keep the connection.
+    bool                    mReused;                    // The request went on a kept connection.
+
+    // Statistics, under the lock
+    std::uint64_t           mSent;
+    std::uint64_t           mBatches;
+    std::uint64_t           mDropped;
+    int                     mFailures;
+    int                     mConnects;
+    int                     mLatency;                   // Milliseconds taken by the last request.
 };
 
 //------------------------------------------------------------------------------
@@ -206,13 +716,260 @@ RPCSub::RPCSub (InfoSub::Source& source)
 }
 
 RPCSub::pointer RPCSub::New (InfoSub::Source& source,
-    boost::asio::io_service& io_service, JobQueue& jobQueue,
-        std::string const& strUrl, std::string const& strUsername,
-        std::string const& strPassword)
+    boost::asio::io_service& io_service, std::string const& strUrl,
+        std::string const& strUsername, std::string const& strPassword)
 {
     return std::make_shared <RPCSubImp> (std::ref (source),
-        std::ref (io_service), std::ref (jobQueue),
-            strUrl, strUsername, strPassword);
+        std::ref (io_service), strUrl, strUsername, strPassword);
 }
 
+//------------------------------------------------------------------------------
+
+class RPCSub_test : public beast::unit_test::suite
+{
+public:
+    typedef boost::asio::ip::tcp::acceptor acceptor_type;
+    typedef boost::asio::ip::tcp::socket socket_type;
+
+    // A source with no subscriptions, all the subscriber needs
+    struct TestSource : InfoSub::Source
+    {
+        explicit TestSource (beast::Stoppable& parent)
+            : InfoSub::Source ("TestSource", parent)
+        {
+        }
+
+        void subAccount (InfoSub::ref, const hash_set<RippleAddress>&,
+            std::uint32_t, bool) override { }
+        void unsubAccount (std::uint64_t, const hash_set<RippleAddress>&,
+            bool) override { }
+        bool subLedger (InfoSub::ref, Json::Value&) override { return true; }
+        bool unsubLedger (std::uint64_t) override { return true; }
+        bool subServer (InfoSub::ref, Json::Value&, bool) override { return true; }
+        bool unsubServer (std::uint64_t) override { return true; }
+        bool subBook (InfoSub::ref, Book const&) override { return true; }
+        bool unsubBook (std::uint64_t, Book const&) override { return true; }
+        bool subTransactions (InfoSub::ref) override { return true; }
+        bool unsubTransactions (std::uint64_t) override { return true; }
+        bool subRTTransactions (InfoSub::ref) override { return true; }
+        bool unsubRTTransactions (std::uint64_t) override { return true; }
+        InfoSub::pointer findRpcSub (std::string const&) override
+        {
+            return InfoSub::pointer ();
+        }
+        InfoSub::pointer addRpcSub (std::string const&, InfoSub::ref) override
+        {
+            return InfoSub::pointer ();
+        }
+    };
+
+    // One connection accepted from the subscriber
+    struct Connection
+    {
+        explicit Connection (boost::asio::io_service& io_service)
+            : socket (io_service)
+        {
+        }
+
+        socket_type socket;
+        std::string data;
+    };
+
+    typedef std::chrono::steady_clock clock_type;
+
+    // Longest wait for the subscriber, well short of its request timeout
+    static clock_type::time_point deadline ()
+    {
+        return clock_type::now () + std::chrono::seconds (10);
+    }
+
+    static void pause ()
+    {
+        std::this_thread::sleep_for (std::chrono::milliseconds (5));
+    }
+
+    bool accept (acceptor_type& acceptor, Connection& c)
+    {
+        auto const until (deadline ());
+
+        for (;;)
+        {
+            boost::system::error_code ec;
+            acceptor.accept (c.socket, ec);
+
+            if (!ec)
+            {
+                c.socket.non_blocking (true);
+                return true;
+            }
+
+            if ((ec != boost::asio::error::would_block) ||
+                (clock_type::now () > until))
+            {
+                return false;
+            }
+
+            pause ();
+        }
+    }
+
+    // Reads one whole request from the subscriber
+    bool readRequest (Connection& c)
+    {
+        auto const until (deadline ());
+
+        for (;;)
+        {
+            std::size_t const header (c.data.find ("\r\n\r\n"));
+
+            if (header != std::string::npos)
+            {
+                std::size_t const field (c.data.find ("Content-Length: "));
+
+                if (field == std::string::npos || field > header)
+                    return false;
+
+                std::size_t const size (std::strtoul (
+                    c.data.c_str () + field + 16, nullptr, 10));
+
+                if (c.data.size () >= header + 4 + size)
+                {
+                    c.data.erase (0, header + 4 + size);
+                    return true;
+                }
+            }
+
+            char buffer [4096];
+            boost::system::error_code ec;
+            std::size_t const bytes (c.socket.read_some (
+                boost::asio::buffer (buffer), ec));
+
+            if (ec == boost::asio::error::would_block)
+            {
+                if (clock_type::now () > until)
+                    return false;
+
+                pause ();
+                continue;
+            }
+
+            if (ec)
+                return false;
+
+            c.data.append (buffer, bytes);
+        }
+    }
+
+    static void reply (Connection& c, std::string const& text)
+    {
+        boost::asio::write (c.socket, boost::asio::buffer (text));
+    }
+
+    // Waits for the subscriber to count the events as delivered
+    bool delivered (RPCSub::ref sub, std::uint64_t count)
+    {
+        auto const until (deadline ());
+
+        while (sub->getJson ()["sent"].asString () != std::to_string (count))
+        {
+            if (clock_type::now () > until)
+                return false;
+
+            pause ();
+        }
+
+        return true;
+    }
+
+    // Sends an event and reads its request on the connection
+    bool request (RPCSub::ref sub, acceptor_type& acceptor, Connection& c,
+        bool connect)
+    {
+        Json::Value event (Json::objectValue);
+        event["type"] = "test";
+        sub->send (event, false);
+
+        if (connect && !accept (acceptor, c))
+            return false;
+
+        return readRequest (c);
+    }
+
+    void run ()
+    {
+        beast::RootStoppable root ("root");
+        TestSource source (root);
+        boost::asio::io_service io_service;
+
+        acceptor_type acceptor (io_service, acceptor_type::endpoint_type (
+            boost::asio::ip::address::from_string ("127.0.0.1"), 0));
+        acceptor.non_blocking (true);
+
+        std::unique_ptr <boost::asio::io_service::work> work (
+            new boost::asio::io_service::work (io_service));
+        std::thread thread ([&io_service] { io_service.run (); });
+
+        RPCSub::pointer sub (RPCSub::New (source, io_service,
+            "http://127.0.0.1:" + std::to_string (
+                acceptor.local_endpoint ().port ()) + "/", "", ""));
+
+        {
+            testcase ("content length");
+            Connection c (io_service);
+            expect (request (sub, acceptor, c, true), "no request");
+            reply (c, "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok");
+            expect (delivered (sub, 1), "not delivered");
+
+            // The connection is kept for the next request
+            testcase ("chunked");
+            expect (request (sub, acceptor, c, false), "connection not kept");
+            reply (c, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                "2\r\nok\r\n0\r\n\r\n");
+            expect (delivered (sub, 2), "not delivered");
+
+            // No length and the server keeps the connection open
+            testcase ("no length");
+            expect (request (sub, acceptor, c, false), "connection not kept");
+            reply (c, "HTTP/1.1 200 OK\r\n\r\n");
+            expect (delivered (sub, 3), "not delivered");
+        }
+
+        {
+            testcase ("connection close");
+            Connection c (io_service);
+            expect (request (sub, acceptor, c, true), "no new connection");
+            reply (c, "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\nok");
+            c.socket.close ();
+            expect (delivered (sub, 4), "not delivered");
+        }
+
+        {
+            testcase ("stale connection");
+            Connection c (io_service);
+            expect (request (sub, acceptor, c, true), "no new connection");
+            reply (c, "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok");
+            expect (delivered (sub, 5), "not delivered");
+
+            // The server closes the kept connection while it is idle, the
+            // event is sent again on a new one
+            c.socket.close ();
+            Connection next (io_service);
+            expect (request (sub, acceptor, next, true), "not resent");
+            reply (next, "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok");
+            expect (delivered (sub, 6), "not delivered");
+
+            Json::Value const stats (sub->getJson ());
+            expect (stats["failures"].asUInt () == 0, "failures counted");
+            expect (stats["connects"].asUInt () == 4, "wrong connection count");
+        }
+
+        // Let the subscriber finish before the io_service goes away
+        sub.reset ();
+        work.reset ();
+        thread.join ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(RPCSub,ripple_net,ripple);
+
 } // ripple
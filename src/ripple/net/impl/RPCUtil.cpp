@@ -102,6 +102,43 @@ std::string getHTTPHeaderTimestamp ()
     return std::string (buffer);
 }
 
+// The status line and headers of a reply whose body is contentLength bytes
+static std::string HTTPReplyHeader (int nStatus, std::size_t contentLength)
+{
+    std::string ret;
+    ret.reserve (256);
+
+    switch (nStatus)
+    {
+    case 200: ret.append ("HTTP/1.1 200 OK\r\n"); break;
+    case 400: ret.append ("HTTP/1.1 400 Bad Request\r\n"); break;
+    case 403: ret.append ("HTTP/1.1 403 Forbidden\r\n"); break;
+    case 404: ret.append ("HTTP/1.1 404 Not Found\r\n"); break;
+    case 500: ret.append ("HTTP/1.1 500 Internal Server Error\r\n"); break;
+    }
+
+    ret.append (getHTTPHeaderTimestamp ());
+
+    ret.append ("Connection: Keep-Alive\r\n");
+
+    if (getConfig ().RPC_ALLOW_REMOTE)
+        ret.append ("Access-Control-Allow-Origin: *\r\n");
+
+    ret.append ("Content-Length: ");
+    ret.append (std::to_string(contentLength));
+    ret.append ("\r\n");
+
+    ret.append ("Content-Type: application/json; charset=UTF-8\r\n");
+
+    ret.append ("Server: " SYSTEM_NAME "-json-rpc/");
+    ret.append (BuildInfo::getFullVersionString ());
+    ret.append ("\r\n");
+
+    ret.append ("\r\n");
+
+    return ret;
+}
+
 std::string HTTPReply (int nStatus, std::string const& strMsg)
 {
     if (ShouldLog (lsTRACE, RPC))
@@ -144,41 +181,42 @@ std::string HTTPReply (int nStatus, std::string const& strMsg)
         return ret;
     }
 
-    ret.reserve(256 + strMsg.length());
-
-    switch (nStatus)
-    {
-    case 200: ret.append ("HTTP/1.1 200 OK\r\n"); break;
-    case 400: ret.append ("HTTP/1.1 400 Bad Request\r\n"); break;
-    case 403: ret.append ("HTTP/1.1 403 Forbidden\r\n"); break;
-    case 404: ret.append ("HTTP/1.1 404 Not Found\r\n"); break;
-    case 500: ret.append ("HTTP/1.1 500 Internal Server Error\r\n"); break;
-    }
-
-    ret.append (getHTTPHeaderTimestamp ());
-
-    ret.append ("Connection: Keep-Alive\r\n");
-
-    if (getConfig ().RPC_ALLOW_REMOTE)
-        ret.append ("Access-Control-Allow-Origin: *\r\n");
-
-    ret.append ("Content-Length: ");
-    ret.append (std::to_string(strMsg.size () + 2));
-    ret.append ("\r\n");
-
-    ret.append ("Content-Type: application/json; charset=UTF-8\r\n");
-
-    ret.append ("Server: " SYSTEM_NAME "-json-rpc/");
-    ret.append (BuildInfo::getFullVersionString ());
-    ret.append ("\r\n");
-
-    ret.append ("\r\n");
+    ret = HTTPReplyHeader (nStatus, strMsg.size () + 2);
+    ret.reserve (ret.size () + strMsg.size () + 2);
     ret.append (strMsg);
     ret.append ("\r\n");
 
     return ret;
 }
 
+void HTTPReply (int nStatus, Json::Value const& result,
+                Json::ChunkedWriter::Sink const& sink)
+{
+    // The body is {"result":...} with two newlines from JSONRPCReply,
+    // and a CRLF from HTTPReply
+    static char const prefix[] = "{\"result\":";
+    static char const suffix[] = "}\n\n\r\n";
+
+    // The result is measured first so the header can carry Content-Length,
+    // then written to the sink in chunks. Measuring is a full extra pass
+    // over the result. Chunked transfer encoding is not used because
+    // existing clients read the body up to Content-Length.
+    std::size_t const contentLength = (sizeof (prefix) - 1) +
+        Json::ChunkedWriter::measure (result) + (sizeof (suffix) - 1);
+
+    WriteLog (lsTRACE, RPC) << "HTTP Reply " << nStatus << " " <<
+        contentLength << " bytes";
+
+    std::string const header = HTTPReplyHeader (nStatus, contentLength);
+    sink (header.data (), header.size ());
+
+    Json::ChunkedWriter writer (sink);
+    writer.output (prefix, sizeof (prefix) - 1);
+    writer.write (result);
+    writer.output (suffix, sizeof (suffix) - 1);
+    writer.flush ();
+}
+
 int ReadHTTPStatus (std::basic_istream<char>& stream)
 {
     std::string str;
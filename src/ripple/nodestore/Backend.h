@@ -64,6 +64,20 @@ public:
     */
     virtual Status fetch (void const* key, NodeObject::Ptr* pObject) = 0;
 
+    /** Fetch a group of objects.
+        The default implementation calls fetch for each key. Backends which
+        can read several keys more efficiently than one at a time should
+        override it.
+        @note This will be called concurrently.
+        @param keys The keys of the objects to fetch.
+        @param objects [out] The created objects, in the same order as the
+                             keys. Objects which could not be fetched are
+                             left as `nullptr`.
+        @return The result of the operation for each key.
+    */
+    virtual std::vector <Status> fetchBatch (std::vector <uint256> const& keys,
+        std::vector <NodeObject::Ptr>& objects);
+
     /** Store a single object.
         Depending on the implementation this may happen immediately
         or deferred using a scheduled task.
@@ -68,6 +68,31 @@ public:
     */
     virtual NodeObject::pointer fetch (uint256 const& hash) = 0;
 
+    /** Fetch a group of objects.
+        Objects found in the cache are returned directly; the remainder
+        are read from the backend in a single batch, which is considerably
+        cheaper than fetching them one at a time.
+
+        @note This can be called concurrently.
+        @param hashes The keys of the objects to retrieve.
+        @return The objects, in the same order as the keys. An entry is
+                `nullptr` if that object couldn't be retrieved.
+    */
+    virtual std::vector <NodeObject::pointer> fetchBatch (
+        std::vector <uint256> const& hashes) = 0;
+
+    /** Look up an object in the caches only.
+        Unlike asyncFetch, no read is scheduled when the caches do not know
+        the answer, so a caller can read the unknown objects in one batch.
+
+        @note This can be called concurrently.
+        @param hash The key of the object to retrieve
+        @param object Set to the object, or `nullptr` if it is known to be
+                      missing.
+        @return `true` if the caches knew whether the object is present.
+    */
+    virtual bool fetchCached (uint256 const& hash, NodeObject::pointer& object) = 0;
+
     /** Fetch an object without waiting.
         If I/O is required to determine whether or not the object is present,
         `false` is returned. Otherwise, `true` is returned and `object` is set
@@ -33,6 +33,7 @@ namespace NodeStore {
 struct FetchReport
 {
     std::chrono::milliseconds elapsed;
+    int fetchCount;
     bool isAsync;
     bool wentToDisk;
     bool wasFound;
@@ -150,6 +150,71 @@ public:
         return status;
     }
 
+    /** Fetch a group of objects with a single iterator.
+        The keys are visited in sorted order, so each seek moves forward
+        through the table files and reuses the blocks the previous seek
+        brought into the cache.
+    */
+    std::vector <Status>
+    fetchBatch (std::vector <uint256> const& keys,
+        std::vector <NodeObject::Ptr>& objects)
+    {
+        std::vector <Status> results (keys.size (), notFound);
+        objects.clear ();
+        objects.resize (keys.size ());
+
+        std::vector <std::size_t> order (keys.size ());
+        for (std::size_t i = 0; i < order.size (); ++i)
+            order[i] = i;
+        std::sort (order.begin (), order.end (),
+            [&keys](std::size_t lhs, std::size_t rhs)
+            {
+                return keys[lhs] < keys[rhs];
+            });
+
+        hyperleveldb::ReadOptions const options;
+        std::unique_ptr <hyperleveldb::Iterator> it (m_db->NewIterator (options));
+
+        for (std::size_t const i : order)
+        {
+            hyperleveldb::Slice const slice (
+                reinterpret_cast <char const*> (keys[i].cbegin ()), m_keyBytes);
+
+            it->Seek (slice);
+
+            if (it->Valid ())
+            {
+                if (it->key ().compare (slice) != 0)
+                    continue;
+
+                DecodedBlob decoded (keys[i].cbegin (),
+                    it->value ().data (), it->value ().size ());
+
+                if (decoded.wasOk ())
+                {
+                    objects[i] = decoded.createObject ();
+                    results[i] = ok;
+                }
+                else
+                {
+                    // Decoding failed, probably corrupted!
+                    //
+                    results[i] = dataCorrupt;
+                }
+            }
+            else if (it->status ().IsCorruption ())
+            {
+                results[i] = dataCorrupt;
+            }
+            else if (! it->status ().ok ())
+            {
+                results[i] = unknown;
+            }
+        }
+
+        return results;
+    }
+
     void
     store (NodeObject::ref object)
     {
@@ -256,6 +256,65 @@ public:
         return status;
     }
 
+    std::vector <Status>
+    fetchBatch (std::vector <uint256> const& keys,
+        std::vector <NodeObject::Ptr>& objects)
+    {
+        std::vector <Status> results;
+        results.reserve (keys.size ());
+        objects.clear ();
+        objects.resize (keys.size ());
+
+        std::vector <rocksdb::Slice> slices;
+        slices.reserve (keys.size ());
+        for (auto const& key : keys)
+            slices.emplace_back (
+                reinterpret_cast <char const*> (key.cbegin ()), m_keyBytes);
+
+        rocksdb::ReadOptions const options;
+        std::vector <std::string> values;
+
+        std::vector <rocksdb::Status> const getStatus (
+            m_db->MultiGet (options, slices, &values));
+
+        for (std::size_t i = 0; i < keys.size (); ++i)
+        {
+            if (getStatus[i].ok ())
+            {
+                DecodedBlob decoded (keys[i].cbegin (),
+                    values[i].data (), values[i].size ());
+
+                if (decoded.wasOk ())
+                {
+                    objects[i] = decoded.createObject ();
+                    results.push_back (ok);
+                }
+                else
+                {
+                    // Decoding failed, probably corrupted!
+                    //
+                    results.push_back (dataCorrupt);
+                }
+            }
+            else if (getStatus[i].IsCorruption ())
+            {
+                results.push_back (dataCorrupt);
+            }
+            else if (getStatus[i].IsNotFound ())
+            {
+                results.push_back (notFound);
+            }
+            else
+            {
+                results.push_back (Status (customCode + getStatus[i].code()));
+
+                m_journal.error << getStatus[i].ToString ();
+            }
+        }
+
+        return results;
+    }
+
     void
     store (NodeObject::ref object)
     {
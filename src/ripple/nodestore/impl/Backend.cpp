@@ -28,5 +28,20 @@ Backend::~Backend ()
 {
 }
 
+std::vector <Status>
+Backend::fetchBatch (std::vector <uint256> const& keys,
+    std::vector <NodeObject::Ptr>& objects)
+{
+    std::vector <Status> results;
+    results.reserve (keys.size ());
+    objects.clear ();
+    objects.resize (keys.size ());
+
+    for (std::size_t i = 0; i < keys.size (); ++i)
+        results.push_back (fetch (keys[i].cbegin (), &objects[i]));
+
+    return results;
+}
+
 }
 }
@@ -26,6 +26,7 @@
 
 #include <beast/threads/Thread.h>
 #include <ripple/basics/Log.h>
+#include <ripple/common/ShardedTaggedCache.h>
 #include <ripple/nodestore/Database.h>
 #include <chrono>
 #include <condition_variable>
@@ -48,7 +49,7 @@ public:
     std::unique_ptr <Backend> m_fastBackend;
 
     // Positive cache
-    TaggedCache <uint256, NodeObject> m_cache;
+    ShardedTaggedCache <uint256, NodeObject> m_cache;
 
     // Negative cache
     KeyCache <uint256> m_negCache;
@@ -109,6 +110,12 @@ public:
 
     //------------------------------------------------------------------------------
 
+    bool fetchCached (uint256 const& hash, NodeObject::pointer& object) override
+    {
+        object = m_cache.fetch (hash);
+        return object || m_negCache.touch_if_exists (hash);
+    }
+
     bool asyncFetch (uint256 const& hash, NodeObject::pointer& object)
     {
         // See if the object is in cache
@@ -153,10 +160,17 @@ public:
         return doTimedFetch (hash, false);
     }
 
+    std::vector <NodeObject::Ptr> fetchBatch (
+        std::vector <uint256> const& hashes) override
+    {
+        return doTimedFetchBatch (hashes, false);
+    }
+
     /** Perform a fetch and report the time it took */
     NodeObject::Ptr doTimedFetch (uint256 const& hash, bool isAsync)
     {
         FetchReport report;
+        report.fetchCount = 1;
         report.isAsync = isAsync;
         report.wentToDisk = false;
 
@@ -171,6 +185,56 @@ public:
         return ret;
     }
 
+    /** Perform a batched fetch and report the time it took */
+    std::vector <NodeObject::Ptr> doTimedFetchBatch (
+        std::vector <uint256> const& hashes, bool isAsync)
+    {
+        std::vector <NodeObject::Ptr> objects (hashes.size ());
+
+        // Satisfy as much as we can from the caches, and
+        // remember where the rest of the results belong.
+        //
+        std::vector <uint256> missing;
+        std::vector <std::size_t> slots;
+
+        for (std::size_t i = 0; i < hashes.size (); ++i)
+        {
+            objects[i] = m_cache.fetch (hashes[i]);
+
+            if (objects[i] == nullptr &&
+                ! m_negCache.touch_if_exists (hashes[i]))
+            {
+                missing.push_back (hashes[i]);
+                slots.push_back (i);
+            }
+        }
+
+        if (missing.empty ())
+            return objects;
+
+        FetchReport report;
+        report.fetchCount = static_cast <int> (missing.size ());
+        report.isAsync = isAsync;
+        report.wentToDisk = true;
+        report.wasFound = false;
+
+        auto const before = std::chrono::steady_clock::now();
+        std::vector <NodeObject::Ptr> found (doFetchBatch (missing));
+        report.elapsed = std::chrono::duration_cast <std::chrono::milliseconds>
+            (std::chrono::steady_clock::now() - before);
+
+        for (std::size_t i = 0; i < found.size (); ++i)
+        {
+            if (found[i] != nullptr)
+                report.wasFound = true;
+            objects[slots[i]] = std::move (found[i]);
+        }
+
+        m_scheduler.onFetch (report);
+
+        return objects;
+    }
+
     NodeObject::Ptr doFetch (uint256 const& hash, FetchReport &report)
     {
         // See if the object already exists in the cache
@@ -208,6 +272,66 @@ public:
             obj = fetchInternal (*m_backend, hash);
         }
 
+        finishFetch (hash, obj, foundInFastBackend);
+
+        return obj;
+    }
+
+    /** Fetch objects which are not in the cache from the backends.
+        Each backend is asked for everything still missing in one batch.
+    */
+    std::vector <NodeObject::Ptr> doFetchBatch (
+        std::vector <uint256> const& hashes)
+    {
+        std::vector <NodeObject::Ptr> objects (hashes.size ());
+        std::vector <bool> foundInFastBackend (hashes.size (), false);
+
+        // Indexes of the objects we still have to look for
+        std::vector <std::size_t> remaining;
+        remaining.reserve (hashes.size ());
+
+        if (m_fastBackend != nullptr)
+        {
+            objects = fetchBatchInternal (*m_fastBackend, hashes);
+
+            for (std::size_t i = 0; i < objects.size (); ++i)
+            {
+                if (objects[i] != nullptr)
+                    foundInFastBackend[i] = true;
+                else
+                    remaining.push_back (i);
+            }
+        }
+        else
+        {
+            for (std::size_t i = 0; i < hashes.size (); ++i)
+                remaining.push_back (i);
+        }
+
+        if (! remaining.empty ())
+        {
+            std::vector <uint256> keys;
+            keys.reserve (remaining.size ());
+            for (auto const i : remaining)
+                keys.push_back (hashes[i]);
+
+            std::vector <NodeObject::Ptr> found (
+                fetchBatchInternal (*m_backend, keys));
+
+            for (std::size_t i = 0; i < remaining.size (); ++i)
+                objects[remaining[i]] = std::move (found[i]);
+        }
+
+        for (std::size_t i = 0; i < hashes.size (); ++i)
+            finishFetch (hashes[i], objects[i], foundInFastBackend[i]);
+
+        return objects;
+    }
+
+    /** Update the caches after going to the backends for an object. */
+    void finishFetch (uint256 const& hash, NodeObject::Ptr& obj,
+        bool foundInFastBackend)
+    {
         if (obj == nullptr)
         {
 
@@ -244,8 +368,6 @@ public:
                     "HOS: " << hash << " fetch: in db";
             }
         }
-
-        return obj;
     }
 
     NodeObject::Ptr fetchInternal (Backend& backend,
@@ -254,6 +376,28 @@ public:
         NodeObject::Ptr object;
 
         Status const status = backend.fetch (hash.begin (), &object);
+        onFetchStatus (status, hash, object);
+
+        return object;
+    }
+
+    std::vector <NodeObject::Ptr> fetchBatchInternal (Backend& backend,
+        std::vector <uint256> const& hashes)
+    {
+        std::vector <NodeObject::Ptr> objects;
+
+        std::vector <Status> const status (
+            backend.fetchBatch (hashes, objects));
+
+        for (std::size_t i = 0; i < hashes.size (); ++i)
+            onFetchStatus (status[i], hashes[i], objects[i]);
+
+        return objects;
+    }
+
+    void onFetchStatus (Status status, uint256 const& hash,
+        NodeObject::Ptr const& object)
+    {
         ++m_fetchTotalCount;
 
         switch (status)
@@ -277,8 +421,6 @@ public:
                 "Unknown status=" << status;
             break;
         }
-
-        return object;
     }
 
     //------------------------------------------------------------------------------
@@ -346,7 +488,8 @@ public:
         beast::Thread::setCurrentThreadName ("prefetch");
         while (1)
         {
-            uint256 hash;
+            std::vector <uint256> hashes;
+            hashes.reserve (asyncReadBatchSize);
 
             {
                 std::unique_lock <std::mutex> lock (m_readLock);
@@ -372,13 +515,20 @@ public:
                     m_readGenCondVar.notify_all ();
                 }
 
-                hash = *it;
-                m_readSet.erase (it);
-                m_readLast = hash;
+                // Take a run of consecutive keys, stopping at the end
+                // of the set so generations are still counted correctly
+                while (it != m_readSet.end () &&
+                    hashes.size () < asyncReadBatchSize)
+                {
+                    hashes.push_back (*it);
+                    it = m_readSet.erase (it);
+                }
+
+                m_readLast = hashes.back ();
             }
 
-            // Perform the read
-            doTimedFetch (hash, true);
+            // Perform the reads
+            doTimedFetchBatch (hashes, true);
          }
      }
 
@@ -37,6 +37,9 @@ enum
 
     // Fraction of the cache one query source can take
     ,asyncDivider = 8
+
+    // Maximum number of keys a prefetch thread reads at once
+    ,asyncReadBatchSize = 64
 };
 
 }
@@ -145,6 +145,17 @@ public:
             }
         }
 
+        if (testPersistence)
+        {
+            // Re-open the database so the batched fetch goes to the backend
+            std::unique_ptr <Database> db (manager->make_Database (
+                "test", scheduler, j, 2, nodeParams, tempParams));
+
+            Batch copy;
+            fetchBatchCopyOfBatch (*db, &copy, batch);
+            expect (areBatchesEqual (batch, copy), "Should be equal");
+        }
+
         if (testPersistence)
         {
             {
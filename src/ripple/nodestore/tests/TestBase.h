@@ -156,6 +156,45 @@ public:
         }
     }
 
+    // Get a copy of a batch in a backend using a single batched fetch
+    void fetchBatchCopyOfBatch (Backend& backend, Batch* pCopy, Batch const& batch)
+    {
+        pCopy->clear ();
+        pCopy->reserve (batch.size ());
+
+        std::vector <uint256> keys;
+        keys.reserve (batch.size () + 1);
+        for (int i = 0; i < batch.size (); ++i)
+            keys.push_back (batch [i]->getHash ());
+
+        // Also ask for an object which was never stored
+        keys.push_back (uint256 ());
+
+        std::vector <NodeObject::Ptr> objects;
+        std::vector <Status> const status (backend.fetchBatch (keys, objects));
+
+        expect (status.size () == keys.size (), "Should have every status");
+        expect (objects.size () == keys.size (), "Should have every object");
+
+        if (status.size () != keys.size () || objects.size () != keys.size ())
+            return;
+
+        for (int i = 0; i < batch.size (); ++i)
+        {
+            expect (status [i] == ok, "Should be ok");
+
+            if (status [i] == ok)
+            {
+                expect (objects [i] != nullptr, "Should not be null");
+
+                pCopy->push_back (objects [i]);
+            }
+        }
+
+        expect (status.back () == notFound, "Should not be found");
+        expect (objects.back () == nullptr, "Should be null");
+    }
+
     // Store all objects in a batch
     static void storeBatch (Database& db, Batch const& batch)
     {
@@ -188,6 +227,26 @@ public:
                 pCopy->push_back (object);
         }
     }
+
+    // Fetch all the hashes in one batch with a single batched fetch.
+    static void fetchBatchCopyOfBatch (Database& db,
+                                       Batch* pCopy,
+                                       Batch const& batch)
+    {
+        pCopy->clear ();
+        pCopy->reserve (batch.size ());
+
+        std::vector <uint256> hashes;
+        hashes.reserve (batch.size ());
+        for (int i = 0; i < batch.size (); ++i)
+            hashes.push_back (batch [i]->getHash ());
+
+        for (auto const& object : db.fetchBatch (hashes))
+        {
+            if (object != nullptr)
+                pCopy->push_back (object);
+        }
+    }
 };
 
 }
@@ -26,7 +26,10 @@
 
 #include "ripple.pb.h"
     
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace ripple {
 
@@ -53,6 +56,28 @@ public:
     */
     static size_t const kHeaderBytes = 6;
 
+    /** Set in the type field of the header when the body is compressed. */
+    static std::uint16_t const kCompressedType = 0x8000;
+
+    /** Compression algorithms a peer can advertise in TMHello. */
+    enum
+    {
+        compressionSnappy = 1
+    };
+
+    /** Running totals of message compression, for all peers. */
+    struct CompressionStats
+    {
+        std::uint64_t compressed = 0;           // Messages compressed
+        std::uint64_t compressedIn = 0;         // Their bytes before
+        std::uint64_t compressedOut = 0;        // Their bytes after
+        std::uint64_t compressMicroseconds = 0;
+        std::uint64_t expanded = 0;             // Messages decompressed
+        std::uint64_t expandedIn = 0;
+        std::uint64_t expandedOut = 0;
+        std::uint64_t expandMicroseconds = 0;
+    };
+
     Message (::google::protobuf::Message const& message, int type);
 
     /** Retrieve the packed message data. */
@@ -62,6 +87,15 @@ public:
         return mBuffer;
     }
 
+    /** Retrieve the packed message data, compressed if it pays off.
+        The compressed form is built the first time it is asked for and
+        shared by every peer the message goes to. Messages of other types,
+        small messages, and messages that do not shrink are returned as is.
+        @param compressed `true` if the peer accepts compressed messages.
+    */
+    std::vector <uint8_t> const&
+    getBuffer (bool compressed) const;
+
     /** Determine bytewise equality. */
     bool operator == (Message const& other) const;
 
@@ -71,12 +105,29 @@ public:
     /** Determine the type of a packed message. */
     static int getType (std::vector <uint8_t> const& buf);
 
+    /** Decompress a message body received with kCompressedType set.
+        @return `false` if the body is corrupt or expands past the limit.
+    */
+    static bool expand (std::vector <uint8_t> const& body,
+        std::vector <uint8_t>& result);
+
+    static CompressionStats getCompressionStats ();
+
 private:
     // Encodes the size and type into a header at the beginning of buf
     //
+    static void encodeHeader (std::vector <uint8_t>& buf,
+        unsigned size, int type);
+
     void encodeHeader (unsigned size, int type);
 
+    void compress () const;
+
     std::vector <uint8_t> mBuffer;
+
+    // Empty if compression does not apply
+    mutable std::vector <uint8_t> mCompressed;
+    mutable std::once_flag mCompressOnce;
 };
 
 }
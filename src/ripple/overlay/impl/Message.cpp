@@ -22,11 +22,54 @@
 //==============================================================================
 
 #include <ripple/overlay/Message.h>
+#include <ripple/overlay/impl/Tuning.h>
 
+#include <snappy.h>
+
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 
 namespace ripple {
 
+namespace {
+
+struct AtomicCompressionStats
+{
+    std::atomic <std::uint64_t> compressed {0};
+    std::atomic <std::uint64_t> compressedIn {0};
+    std::atomic <std::uint64_t> compressedOut {0};
+    std::atomic <std::uint64_t> compressMicroseconds {0};
+    std::atomic <std::uint64_t> expanded {0};
+    std::atomic <std::uint64_t> expandedIn {0};
+    std::atomic <std::uint64_t> expandedOut {0};
+    std::atomic <std::uint64_t> expandMicroseconds {0};
+};
+
+AtomicCompressionStats&
+compressionStats ()
+{
+    static AtomicCompressionStats stats;
+    return stats;
+}
+
+std::uint64_t
+microsecondsSince (std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast <std::chrono::microseconds> (
+        std::chrono::steady_clock::now () - start).count ();
+}
+
+// Only replies that routinely run large are worth the CPU
+bool
+isCompressible (int type)
+{
+    return (type == protocol::mtLEDGER_DATA) ||
+        (type == protocol::mtGET_OBJECTS);
+}
+
+}
+
 Message::Message (::google::protobuf::Message const& message, int type)
 {
     unsigned const messageBytes = message.ByteSize ();
@@ -43,6 +86,93 @@ Message::Message (::google::protobuf::Message const& message, int type)
     }
 }
 
+std::vector <uint8_t> const&
+Message::getBuffer (bool compressed) const
+{
+    if (! compressed)
+        return mBuffer;
+
+    std::call_once (mCompressOnce, &Message::compress, this);
+
+    return mCompressed.empty () ? mBuffer : mCompressed;
+}
+
+void Message::compress () const
+{
+    std::size_t const bodyBytes = mBuffer.size () - kHeaderBytes;
+    int const type = getType (mBuffer);
+
+    if ((bodyBytes < Tuning::compressMinBytes) || ! isCompressible (type))
+        return;
+
+    auto const start = std::chrono::steady_clock::now ();
+
+    std::vector <uint8_t> result (
+        kHeaderBytes + snappy::MaxCompressedLength (bodyBytes));
+    std::size_t resultBytes;
+    snappy::RawCompress (
+        reinterpret_cast <char const*> (&mBuffer [kHeaderBytes]), bodyBytes,
+        reinterpret_cast <char*> (&result [kHeaderBytes]), &resultBytes);
+
+    auto& stats = compressionStats ();
+    stats.compressMicroseconds += microsecondsSince (start);
+
+    // Not worth making the receiver expand it
+    if (resultBytes + (bodyBytes / 16) >= bodyBytes)
+        return;
+
+    result.resize (kHeaderBytes + resultBytes);
+    encodeHeader (result, resultBytes, type | kCompressedType);
+    mCompressed.swap (result);
+
+    ++stats.compressed;
+    stats.compressedIn += bodyBytes;
+    stats.compressedOut += resultBytes;
+}
+
+bool Message::expand (std::vector <uint8_t> const& body,
+    std::vector <uint8_t>& result)
+{
+    auto const start = std::chrono::steady_clock::now ();
+
+    char const* const data = reinterpret_cast <char const*> (body.data ());
+    std::size_t bytes;
+
+    if (! snappy::GetUncompressedLength (data, body.size (), &bytes) ||
+        (bytes > Tuning::expandMaxBytes))
+        return false;
+
+    result.resize (bytes);
+
+    if (! snappy::RawUncompress (data, body.size (),
+            reinterpret_cast <char*> (result.data ())))
+        return false;
+
+    auto& stats = compressionStats ();
+    ++stats.expanded;
+    stats.expandedIn += body.size ();
+    stats.expandedOut += bytes;
+    stats.expandMicroseconds += microsecondsSince (start);
+
+    return true;
+}
+
+Message::CompressionStats Message::getCompressionStats ()
+{
+    auto const& stats = compressionStats ();
+
+    CompressionStats result;
+    result.compressed = stats.compressed;
+    result.compressedIn = stats.compressedIn;
+    result.compressedOut = stats.compressedOut;
+    result.compressMicroseconds = stats.compressMicroseconds;
+    result.expanded = stats.expanded;
+    result.expandedIn = stats.expandedIn;
+    result.expandedOut = stats.expandedOut;
+    result.expandMicroseconds = stats.expandMicroseconds;
+    return result;
+}
+
 bool Message::operator== (Message const& other) const
 {
     return mBuffer == other.mBuffer;
@@ -81,15 +211,21 @@ int Message::getType (std::vector<uint8_t> const& buf)
     return ret;
 }
 
+void Message::encodeHeader (std::vector <uint8_t>& buf,
+    unsigned size, int type)
+{
+    assert (buf.size () >= Message::kHeaderBytes);
+    buf[0] = static_cast<std::uint8_t> ((size >> 24) & 0xFF);
+    buf[1] = static_cast<std::uint8_t> ((size >> 16) & 0xFF);
+    buf[2] = static_cast<std::uint8_t> ((size >> 8) & 0xFF);
+    buf[3] = static_cast<std::uint8_t> (size & 0xFF);
+    buf[4] = static_cast<std::uint8_t> ((type >> 8) & 0xFF);
+    buf[5] = static_cast<std::uint8_t> (type & 0xFF);
+}
+
 void Message::encodeHeader (unsigned size, int type)
 {
-    assert (mBuffer.size () >= Message::kHeaderBytes);
-    mBuffer[0] = static_cast<std::uint8_t> ((size >> 24) & 0xFF);
-    mBuffer[1] = static_cast<std::uint8_t> ((size >> 16) & 0xFF);
-    mBuffer[2] = static_cast<std::uint8_t> ((size >> 8) & 0xFF);
-    mBuffer[3] = static_cast<std::uint8_t> (size & 0xFF);
-    mBuffer[4] = static_cast<std::uint8_t> ((type >> 8) & 0xFF);
-    mBuffer[5] = static_cast<std::uint8_t> (type & 0xFF);
+    encodeHeader (mBuffer, size, type);
 }
 
 }
@@ -29,6 +29,16 @@
 
 namespace ripple {
 
+static
+std::size_t
+configSendBytes ()
+{
+    if (getConfig ().PEER_SEND_BYTES != 0)
+        return getConfig ().PEER_SEND_BYTES;
+
+    return Tuning::sendBytesMax;
+}
+
 PeerImp::PeerImp (NativeSocketType&& socket, beast::IP::Endpoint remoteAddress,
     OverlayImpl& overlay, Resource::Manager& resourceManager,
         PeerFinder::Manager& peerFinder, PeerFinder::Slot::ptr const& slot,
@@ -49,7 +59,11 @@ PeerImp::PeerImp (NativeSocketType&& socket, beast::IP::Endpoint remoteAddress,
     , timer_ (m_owned_socket.get_io_service())
     , slot_ (slot)
     , message_stream_(*this)
+    , send_bytes_max_ (configSendBytes ())
 {
+    if (getConfig ().PEER_SEND_RATE)
+        send_rate_ = std::make_unique <send_rate_type> (
+            get_seconds_clock ().now ());
 }
 
 PeerImp::PeerImp (beast::IP::Endpoint remoteAddress,
@@ -73,7 +87,11 @@ PeerImp::PeerImp (beast::IP::Endpoint remoteAddress,
     , timer_ (io_service)
     , slot_ (slot)
     , message_stream_(*this)
+    , send_bytes_max_ (configSendBytes ())
 {
+    if (getConfig ().PEER_SEND_RATE)
+        send_rate_ = std::make_unique <send_rate_type> (
+            get_seconds_clock ().now ());
 }
 
 PeerImp::~PeerImp ()
@@ -117,10 +135,10 @@ PeerImp::send (Message::pointer const& m)
         return;
     }
 
-    if (send_packet_)
-        send_queue_.push_back (m);
-    else
-        sendForce (m);
+    send_queue_.push_back (m);
+
+    if (send_batch_.empty ())
+        sendQueued ();
 }
 
 beast::IP::Endpoint
@@ -190,6 +208,16 @@ PeerImp::json()
     if (closedLedgerHash_ != zero)
         ret["ledger"] = to_string (closedLedgerHash_);
 
+    if (compression_)
+        ret["compression"] = true;
+
+    if (send_rate_)
+    {
+        std::lock_guard <std::mutex> lock (send_rate_lock_);
+        ret["send_rate"] = static_cast <Json::UInt> (
+            send_rate_->value (get_seconds_clock ().now ()));
+    }
+
     if (last_status_.has_newstatus ())
     {
         switch (last_status_.newstatus ())
@@ -783,7 +811,7 @@ PeerImp::handleWrite (boost::system::error_code const& ec, size_t bytes)
 
     // Call on IO strand
 
-    send_packet_.reset ();
+    send_batch_.clear ();
 
     if (ec == boost::asio::error::operation_aborted)
         return;
@@ -798,16 +826,13 @@ PeerImp::handleWrite (boost::system::error_code const& ec, size_t bytes)
         return;
     }
 
-    if (!send_queue_.empty ())
+    if (send_rate_)
     {
-        Message::pointer packet = send_queue_.front ();
-
-        if (packet)
-        {
-            sendForce (packet);
-            send_queue_.pop_front ();
-        }
+        std::lock_guard <std::mutex> lock (send_rate_lock_);
+        send_rate_->add (bytes, get_seconds_clock ().now ());
     }
+
+    sendQueued ();
 }
 
 void
@@ -961,6 +986,10 @@ PeerImp::on_message (std::shared_ptr <protocol::TMHello> const& m)
 
         hello_ = *m;
 
+        compression_ = getConfig ().PEER_COMPRESSION &&
+            (hello_.compression () & Message::compressionSnappy);
+        message_stream_.set_compression (compression_);
+
         // Determine if this peer belongs to our cluster and get it's name
         clusterNode_ = getApp().getUNL().nodeInCluster (
             publicKey_, name_);
@@ -1668,32 +1697,43 @@ PeerImp::on_message (std::shared_ptr <protocol::TMGetObjectByHash> const& m)
             reply.set_ledgerhash (packet.ledgerhash ());
 
         // This is a very minimal implementation
+        std::vector <uint256> hashes;
+        std::vector <int> requests;
         for (int i = 0; i < packet.objects_size (); ++i)
         {
-            uint256 hash;
             const protocol::TMIndexedObject& obj = packet.objects (i);
 
             if (obj.has_hash () && (obj.hash ().size () == (256 / 8)))
             {
+                uint256 hash;
                 memcpy (hash.begin (), obj.hash ().data (), 256 / 8);
-                // VFALCO TODO Move this someplace more sensible so we dont
-                //             need to inject the NodeStore interfaces.
-                NodeObject::pointer hObj =
-                    getApp().getNodeStore ().fetch (hash);
+                hashes.push_back (hash);
+                requests.push_back (i);
+            }
+        }
 
-                if (hObj)
-                {
-                    protocol::TMIndexedObject& newObj = *reply.add_objects ();
-                    newObj.set_hash (hash.begin (), hash.size ());
-                    newObj.set_data (&hObj->getData ().front (),
-                        hObj->getData ().size ());
+        // VFALCO TODO Move this someplace more sensible so we dont
+        //             need to inject the NodeStore interfaces.
+        std::vector <NodeObject::pointer> const objects (
+            getApp().getNodeStore ().fetchBatch (hashes));
 
-                    if (obj.has_nodeid ())
-                        newObj.set_index (obj.nodeid ());
+        for (std::size_t i = 0; i < objects.size (); ++i)
+        {
+            NodeObject::pointer const& hObj = objects[i];
+            const protocol::TMIndexedObject& obj = packet.objects (requests[i]);
 
-                    if (!reply.has_seq () && (hObj->getLedgerIndex () != 0))
-                        reply.set_seq (hObj->getLedgerIndex ());
-                }
+            if (hObj)
+            {
+                protocol::TMIndexedObject& newObj = *reply.add_objects ();
+                newObj.set_hash (hashes[i].begin (), hashes[i].size ());
+                newObj.set_data (&hObj->getData ().front (),
+                    hObj->getData ().size ());
+
+                if (obj.has_nodeid ())
+                    newObj.set_index (obj.nodeid ());
+
+                if (!reply.has_seq () && (hObj->getLedgerIndex () != 0))
+                    reply.set_seq (hObj->getLedgerIndex ());
             }
         }
 
@@ -2185,21 +2225,57 @@ PeerImp::charge (std::weak_ptr <Peer>& peer, Resource::Charge const& fee)
 }
 
 void
-PeerImp::sendForce (const Message::pointer& packet)
+PeerImp::sendQueued ()
 {
     // must be on IO strand
-    if (!detaching_)
+    if (detaching_ || send_queue_.empty ())
+        return;
+
+    std::size_t bytes = 0;
+
+    do
     {
-        send_packet_ = packet;
+        std::size_t const size =
+            send_queue_.front ()->getBuffer (compression_).size ();
+
+        if (!send_batch_.empty () && (bytes + size > send_bytes_max_))
+            break;
+
+        bytes += size;
+        send_batch_.push_back (std::move (send_queue_.front ()));
+        send_queue_.pop_front ();
+    }
+    while (!send_queue_.empty ());
 
+    auto handler = strand_.wrap (std::bind (
+        &PeerImp::handleWrite,
+        std::static_pointer_cast <PeerImp> (shared_from_this ()),
+        beast::asio::placeholders::error,
+        beast::asio::placeholders::bytes_transferred));
+
+    // A lone message is written from its own buffer. The SSL stream only
+    // writes the first buffer of a sequence per call, so several messages
+    // are copied into one buffer rather than gathered.
+    if (send_batch_.size () == 1)
+    {
         boost::asio::async_write (*socket_,
-            boost::asio::buffer (packet->getBuffer ()),
-            strand_.wrap (std::bind (
-                &PeerImp::handleWrite,
-                std::static_pointer_cast <PeerImp> (shared_from_this ()),
-                beast::asio::placeholders::error,
-                beast::asio::placeholders::bytes_transferred)));
+            boost::asio::buffer (send_batch_.front ()->getBuffer (compression_)),
+            handler);
+        return;
+    }
+
+    send_buffer_.clear ();
+    send_buffer_.reserve (bytes);
+
+    for (auto const& packet : send_batch_)
+    {
+        auto const& buffer = packet->getBuffer (compression_);
+        send_buffer_.insert (send_buffer_.end (),
+            buffer.begin (), buffer.end ());
     }
+
+    boost::asio::async_write (*socket_,
+        boost::asio::buffer (send_buffer_), handler);
 }
 
 bool
@@ -2287,6 +2363,9 @@ PeerImp::sendHello ()
     h.set_ipv4port (getConfig ().peerListeningPort);
     h.set_testnet (false);
 
+    if (getConfig ().PEER_COMPRESSION)
+        h.set_compression (Message::compressionSnappy);
+
     // We always advertise ourselves as private in the HELLO message. This
     // suppresses the old peer advertising code and allows PeerFinder to
     // take over the functionality.
@@ -24,13 +24,16 @@
 #ifndef RIPPLE_OVERLAY_PEERIMP_H_INCLUDED
 #define RIPPLE_OVERLAY_PEERIMP_H_INCLUDED
 
+#include <ripple/common/DecayingSample.h>
 #include <ripple/common/MultiSocket.h>
+#include <ripple/common/seconds_clock.h>
 #include <ripple/nodestore/Database.h>
 #include <ripple/overlay/predicates.h>
 #include <ripple/overlay/impl/message_name.h>
 #include <ripple/overlay/impl/message_stream.h>
 #include <ripple/overlay/impl/OverlayImpl.h>
 #include <ripple/overlay/impl/peer_protocol_detector.h>
+#include <ripple/overlay/impl/Tuning.h>
 #include <ripple/app/misc/ProofOfWork.h>
 #include <ripple/app/misc/ProofOfWorkFactory.h>
 #include <ripple/core/Config.h>
@@ -50,6 +53,7 @@
 #include <boost/foreach.hpp>
 
 #include <cstdint>
+#include <mutex>
 
 namespace ripple {
 
@@ -139,6 +143,9 @@ private:
     // True if peer is a node in our cluster
     bool clusterNode_ = false;
 
+    // True if we and the peer both accept compressed messages
+    bool compression_ = false;
+
     // Node public key of peer.
     RippleAddress publicKey_;
 
@@ -164,7 +171,6 @@ private:
     boost::asio::deadline_timer timer_;
 
     std::list <Message::pointer> send_queue_;
-    Message::pointer send_packet_;
     protocol::TMStatusChange last_status_;
     protocol::TMHello hello_;
 
@@ -182,6 +188,18 @@ private:
     
     std::unique_ptr <LoadEvent> load_event_;
 
+    // Messages in the write that is in progress, and the buffer they are
+    // copied into when more than one is sent at once.
+    std::vector <Message::pointer> send_batch_;
+    std::vector <std::uint8_t> send_buffer_;
+    std::size_t send_bytes_max_;
+
+    // Decaying average of the bytes written per second, when enabled
+    typedef DecayingSample <Tuning::sendRateSeconds,
+        beast::abstract_clock <std::chrono::seconds>> send_rate_type;
+    std::unique_ptr <send_rate_type> send_rate_;
+    mutable std::mutex send_rate_lock_;
+
     //--------------------------------------------------------------------------
 
 public:
@@ -425,8 +443,13 @@ private:
     void
     charge (std::weak_ptr <Peer>& peer, Resource::Charge const& fee);
 
+    /** Write as many queued messages as fit in one write.
+        The messages are coalesced into a single buffer so the socket sees
+        one large write instead of a TLS record and a system call for each
+        message. At least one message is always taken, however large.
+    */
     void
-    sendForce (const Message::pointer& packet);
+    sendQueued ();
 
     /** Hashes the latest finished message from an SSL stream
         @param sslSession the session to get the message from.
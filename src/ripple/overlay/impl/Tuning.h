@@ -33,6 +33,18 @@ enum
 {
     /** Size of buffer used to read from the socket. */
     readBufferBytes     = 4096
+
+    /** Default cap on the bytes coalesced into one socket write. */
+    ,sendBytesMax       = 64 * 1024
+
+    /** Window, in seconds, of the outbound byte rate meter. */
+    ,sendRateSeconds    = 8
+
+    /** Smallest message body worth compressing. */
+    ,compressMinBytes   = 4096
+
+    /** Largest body a compressed message may expand to. */
+    ,expandMaxBytes     = 64 * 1024 * 1024
 };
 
 } // Tuning
@@ -46,6 +46,8 @@ private:
     std::uint16_t type_;
     std::vector <std::uint8_t> header_; // VFALCO TODO Use std::array
     std::vector <std::uint8_t> body_;
+    std::vector <std::uint8_t> expanded_;
+    bool compression_;
 
     static
     boost::system::error_code
@@ -78,10 +80,21 @@ public:
         : handler_(handler)
         , header_bytes_(0)
         , body_bytes_(0)
+        , compression_(false)
     {
         header_.resize (Message::kHeaderBytes);
     }
 
+    /** Accept compressed messages.
+        Until the peer has negotiated compression, a compressed message is
+        a parse error and is never expanded.
+    */
+    void
+    set_compression (bool enabled)
+    {
+        compression_ = enabled;
+    }
+
     /** Push a single buffer through.
         The handler is called for each complete protocol message contained
         in the buffer.
@@ -122,6 +135,16 @@ public:
                 if (body_bytes_ >= length_)
                 {
                     assert (body_bytes_ == length_);
+                    if (type_ & Message::kCompressedType)
+                    {
+                        if (! compression_)
+                            return parse_error();
+                        type_ &= ~Message::kCompressedType;
+                        if (! Message::expand (body_, expanded_))
+                            return parse_error();
+                        body_.swap (expanded_);
+                        length_ = body_.size();
+                    }
                     switch (type_)
                     {
                     case protocol::mtHELLO:           ec = invoke <protocol::TMHello> (); break;
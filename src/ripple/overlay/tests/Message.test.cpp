@@ -0,0 +1,177 @@
+//------------------------------------------------------------------------------
+/*
+    Portions of this file are from Vpallab: https://github.com/vpallabs
+    Copyright (c) 2013 - 2014 - Vpallab.com.
+    Please visit http://www.vpallab.com/
+    
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/overlay/Message.h>
+#include <ripple/overlay/impl/message_stream.h>
+#include <beast/unit_test/suite.h>
+#include <boost/asio/buffer.hpp>
+
+namespace ripple {
+
+class Message_test : public beast::unit_test::suite
+{
+public:
+    // Remembers the last TMGetObjectByHash pushed through a stream
+    class Handler : public abstract_protocol_handler
+    {
+    public:
+        std::shared_ptr <protocol::TMGetObjectByHash> objects;
+
+        error_code on_message_unknown (std::uint16_t) override
+        {
+            return boost::system::errc::make_error_code (
+                boost::system::errc::invalid_argument);
+        }
+
+        error_code on_message_begin (std::uint16_t,
+            std::shared_ptr <::google::protobuf::Message> const&) override
+        {
+            return error_code();
+        }
+
+        void on_message_end (std::uint16_t,
+            std::shared_ptr <::google::protobuf::Message> const&) override
+        {
+        }
+
+        error_code on_message (
+            std::shared_ptr <protocol::TMGetObjectByHash> const& m) override
+        {
+            objects = m;
+            return error_code();
+        }
+    };
+
+    static
+    protocol::TMGetObjectByHash
+    makeObjects (int count)
+    {
+        protocol::TMGetObjectByHash reply;
+        reply.set_type (protocol::TMGetObjectByHash::otFETCH_PACK);
+        reply.set_query (false);
+
+        for (int i = 0; i < count; ++i)
+        {
+            protocol::TMIndexedObject& object = *reply.add_objects ();
+            object.set_hash (std::string (32, static_cast <char> (i)));
+            object.set_data (std::string (200, 'x') + std::to_string (i));
+        }
+
+        return reply;
+    }
+
+    void testRoundTrip ()
+    {
+        auto const reply = makeObjects (100);
+        Message m (reply, protocol::mtGET_OBJECTS);
+
+        auto const& plain = m.getBuffer (false);
+        auto const& compressed = m.getBuffer (true);
+
+        expect (&plain == &m.getBuffer ());
+        expect (compressed.size () < plain.size (), "Should shrink");
+        expect (Message::getType (compressed) ==
+            (protocol::mtGET_OBJECTS | Message::kCompressedType));
+        expect (&compressed == &m.getBuffer (true), "Should compress once");
+
+        Handler handler;
+        message_stream stream (handler);
+        stream.set_compression (true);
+
+        // Feed it in pieces to cross the header and body boundaries
+        std::size_t const step = 37;
+        for (std::size_t i = 0; i < compressed.size (); i += step)
+        {
+            auto const ec = stream.write_one (boost::asio::buffer (
+                &compressed [i], std::min (step, compressed.size () - i)));
+            expect (! ec, ec.message ());
+        }
+
+        expect (handler.objects != nullptr, "Should be delivered");
+        if (handler.objects)
+            expect (handler.objects->SerializeAsString () ==
+                reply.SerializeAsString (), "Should match");
+
+        // The plain form still parses on the same stream
+        handler.objects.reset ();
+        auto const ec = stream.write_one (boost::asio::buffer (plain));
+        expect (! ec, ec.message ());
+        expect (handler.objects != nullptr);
+    }
+
+    void testNotCompressed ()
+    {
+        // Too small
+        Message small (makeObjects (2), protocol::mtGET_OBJECTS);
+        expect (&small.getBuffer (true) == &small.getBuffer ());
+
+        // Wrong type
+        protocol::TMPing ping;
+        ping.set_type (protocol::TMPing::ptPING);
+        ping.set_seq (1);
+        Message other (ping, protocol::mtPING);
+        expect (&other.getBuffer (true) == &other.getBuffer ());
+    }
+
+    void testCorrupt ()
+    {
+        Message m (makeObjects (100), protocol::mtGET_OBJECTS);
+        std::vector <uint8_t> buffer = m.getBuffer (true);
+
+        // Claim an expanded size far past the limit
+        for (std::size_t i = Message::kHeaderBytes;
+                i < Message::kHeaderBytes + 5; ++i)
+            buffer [i] = 0xFF;
+
+        Handler handler;
+        message_stream stream (handler);
+        stream.set_compression (true);
+        auto const ec = stream.write_one (boost::asio::buffer (buffer));
+        expect (ec.value () != 0, "Should be rejected");
+        expect (handler.objects == nullptr);
+    }
+
+    void testNotNegotiated ()
+    {
+        Message m (makeObjects (100), protocol::mtGET_OBJECTS);
+
+        Handler handler;
+        message_stream stream (handler);
+        auto const ec = stream.write_one (boost::asio::buffer (
+            m.getBuffer (true)));
+        expect (ec.value () != 0, "Should be rejected");
+        expect (handler.objects == nullptr);
+    }
+
+    void run ()
+    {
+        testRoundTrip ();
+        testNotCompressed ();
+        testCorrupt ();
+        testNotNegotiated ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(Message,overlay,ripple);
+
+} // ripple
@@ -90,12 +90,33 @@ Json::Value doGetCounts (RPC::Context& context)
     textTime (uptime, s, "second", 1);
     ret["uptime"] = uptime;
     
+    ret["job_latency"] = app.getJobQueue ().getLatencyJson ();
+
+    Json::Value rpcSubs (app.getOPs ().getRpcSubJson ());
+
+    if (rpcSubs.size () != 0)
+        ret["rpc_subscriptions"] = rpcSubs;
+
     ret["node_writes"] = app.getNodeStore().getStoreCount();
     ret["node_reads_total"] = app.getNodeStore().getFetchTotalCount();
     ret["node_reads_hit"] = app.getNodeStore().getFetchHitCount();
     ret["node_written_bytes"] = app.getNodeStore().getStoreSize();
     ret["node_read_bytes"] = app.getNodeStore().getFetchSize();
 
+    auto const compression = Message::getCompressionStats ();
+    if (compression.compressed != 0 || compression.expanded != 0)
+    {
+        Json::Value& peer = ret["peer_compression"] = Json::objectValue;
+        peer["compressed"] = static_cast<Json::UInt> (compression.compressed);
+        peer["compressed_in"] = std::to_string (compression.compressedIn);
+        peer["compressed_out"] = std::to_string (compression.compressedOut);
+        peer["compress_us"] = std::to_string (compression.compressMicroseconds);
+        peer["expanded"] = static_cast<Json::UInt> (compression.expanded);
+        peer["expanded_in"] = std::to_string (compression.expandedIn);
+        peer["expanded_out"] = std::to_string (compression.expandedOut);
+        peer["expand_us"] = std::to_string (compression.expandMicroseconds);
+    }
+
     return ret;
 }
 
@@ -74,8 +74,7 @@ Json::Value doSubscribe (RPC::Context& context)
                 << "doSubscribe: building: " << strUrl;
 
             RPCSub::pointer rspSub = RPCSub::New (getApp ().getOPs (),
-                getApp ().getIOService (), getApp ().getJobQueue (),
-                    strUrl, strUsername, strPassword);
+                getApp ().getIOService (), strUrl, strUsername, strPassword);
             ispSub  = context.netOps_.addRpcSub (
                 strUrl, std::dynamic_pointer_cast<InfoSub> (rspSub));
         }
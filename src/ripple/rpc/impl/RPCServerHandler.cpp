@@ -57,7 +57,7 @@ std::string RPCServerHandler::processRequest (
 {
     Json::Value jsonRequest;
     {
-        Json::Reader reader;
+        Json::InSituReader reader;
 
         if ((request.size() > ripple::RPC::Tuning::maxRequestSize) ||
             ! reader.parse (request, jsonRequest) ||
@@ -74,6 +74,7 @@
 #include <ripple/app/shamap/SHAMapAddNode.h>
 #include <ripple/app/shamap/SHAMap.h>
 #include <ripple/app/misc/SerializedTransaction.h>
+#include <ripple/app/misc/SignatureCache.h>
 #include <ripple/app/misc/SerializedLedger.h>
 #include <ripple/app/tx/TransactionMeta.h>
 #include <ripple/app/tx/Transaction.h>
@@ -95,6 +96,9 @@
 #include <ripple/app/ledger/InboundLedgers.h>
 #include <ripple/app/ledger/AcceptedLedgerTx.h>
 #include <ripple/app/ledger/AcceptedLedger.h>
+#include <ripple/app/ledger/AccountTxPager.h>
+#include <ripple/app/ledger/TxnDBWriter.h>
+#include <ripple/app/ledger/LedgerHashIndex.h>
 #include <ripple/app/ledger/LedgerEntrySet.h>
 #include <ripple/app/ledger/DirectoryEntryIterator.h>
 #include <ripple/app/ledger/OrderBookIterator.h>
@@ -110,6 +114,7 @@
 #include <ripple/app/main/LocalCredentials.h>
 #include <ripple/app/main/Application.h>
 #include <ripple/app/ledger/OrderBookDB.h>
+#include <ripple/app/ledger/BalanceRankIndex.h>
 #include <ripple/app/tx/TransactionAcquire.h>
 #include <ripple/app/tx/LocalTxs.h>
 #include <ripple/app/consensus/DisputedTx.h>
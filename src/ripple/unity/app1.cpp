@@ -37,6 +37,7 @@
 #include <ripple/app/misc/ProofOfWorkFactory.cpp>
 #include <ripple/app/misc/ProofOfWork.cpp>
 #include <ripple/app/misc/SerializedTransaction.cpp>
+#include <ripple/app/misc/SignatureCache.cpp>
 
 // requires Application
 #include <ripple/app/shamap/SHAMapSyncFilters.cpp>
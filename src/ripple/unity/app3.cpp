@@ -26,6 +26,9 @@
 #include <ripple/unity/app.h>
 
 #include <ripple/app/ledger/Ledger.cpp>
+#include <ripple/app/ledger/AccountTxPager.cpp>
+#include <ripple/app/ledger/TxnDBWriter.cpp>
+#include <ripple/app/ledger/LedgerHashIndex.cpp>
 #include <ripple/app/shamap/SHAMapDelta.cpp>
 #include <ripple/app/shamap/SHAMapNodeID.cpp>
 #include <ripple/app/shamap/SHAMapTreeNode.cpp>
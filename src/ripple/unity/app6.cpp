@@ -29,6 +29,7 @@
 
 #include <ripple/app/ledger/LedgerEntrySet.cpp>
 #include <ripple/app/ledger/AcceptedLedger.cpp>
+#include <ripple/app/ledger/BalanceRankIndex.cpp>
 #include <ripple/app/ledger/DirectoryEntryIterator.cpp>
 #include <ripple/app/ledger/OrderBookIterator.cpp>
 #include <ripple/app/consensus/DisputedTx.cpp>
@@ -27,6 +27,7 @@
 #include <ripple/common/impl/MultiSocket.cpp>
 #include <ripple/common/impl/ResolverAsio.cpp>
 #include <ripple/common/impl/RippleSSLContext.cpp>
+#include <ripple/common/impl/ShardedTaggedCache.cpp>
 #include <ripple/common/impl/TaggedCache.cpp>
 
 #include <ripple/common/tests/cross_offer.test.cpp>
@@ -27,5 +27,7 @@
 #include <ripple/core/impl/LoadFeeTrackImp.cpp>
 #include <ripple/core/impl/LoadEvent.cpp>
 #include <ripple/core/impl/LoadMonitor.cpp>
+#include <ripple/core/impl/LatencyHistogram.cpp>
 #include <ripple/core/impl/Job.cpp>
 #include <ripple/core/impl/JobQueue.cpp>
+#include <ripple/core/impl/WorkerPool.cpp>
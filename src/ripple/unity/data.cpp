@@ -85,6 +85,8 @@
 #include <ripple/data/protocol/TxFormats.cpp>
 #include <ripple/data/protocol/STAmount.cpp>
 #include <ripple/data/protocol/STAmount.test.cpp>
+#include <ripple/data/protocol/STObjectView.cpp>
+#include <ripple/data/protocol/STObjectView.test.cpp>
 
 #if BEAST_MSVC
 #pragma warning (pop)
@@ -47,6 +47,7 @@ typedef struct bignum_st BIGNUM;
 #include <ripple/data/protocol/TxFormats.h>
 #include <ripple/data/protocol/STObject.h>
 #include <ripple/data/protocol/STArray.h>
+#include <ripple/data/protocol/STObjectView.h>
 #include <ripple/data/protocol/TxFlags.h>
 
 #include <ripple/data/utility/UptimeTimerAdapter.h>
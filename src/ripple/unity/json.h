@@ -30,6 +30,7 @@
 #include <beast/utility/PropertyStream.h>
 
 #include <deque>
+#include <functional>
 #include <stack>
 #include <vector>
 
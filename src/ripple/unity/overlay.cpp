@@ -29,5 +29,6 @@
 #include <ripple/overlay/impl/PeerImp.cpp>
 #include <ripple/overlay/impl/PeerDoor.cpp>
 
+#include <ripple/overlay/tests/Message.test.cpp>
 #include <ripple/overlay/tests/peer_info.test.cpp>
 
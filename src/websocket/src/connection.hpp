@@ -201,6 +201,7 @@ public:
     
     void send(const std::string& payload, frame::opcode::value op = frame::opcode::TEXT);
     void send(message::data_ptr msg);
+    bool prepare(message::data_ptr msg);
     
     /// Close connection
     /**
@@ -1601,6 +1602,30 @@ void connection<endpoint,role,socket>::send(message::data_ptr msg) {
 	));
 }
 
+/// Frame a message without sending it
+/**
+ * Lets one message be framed once and then sent on every connection that
+ * frames messages the same way, instead of being copied for each of them.
+ * The message must not be changed once it is prepared.
+ *
+ * Returns false if the connection is not open and the message was not
+ * prepared.
+ *
+ * Visibility: public
+ * State: Valid from OPEN, ignored otherwise
+ * Concurrency: callable from any thread
+ *
+ * @param msg A pointer to a data message buffer to prepare.
+ */
+template <typename endpoint,template <class> class role,template <class> class socket>
+bool connection<endpoint,role,socket>::prepare(message::data_ptr msg) {
+    boost::lock_guard<boost::recursive_mutex> lock(m_lock);
+    if (m_state != session::state::OPEN) {return false;}
+    
+    m_processor->prepare_frame(msg);
+    return true;
+}
+
 } // namespace websocketpp
 
 #endif // WEBSOCKETPP_CONNECTION_HPP
@@ -159,6 +159,15 @@ void data::append_payload(const std::string& payload) {
     m_payload.reserve(m_payload.size()+payload.size());
     m_payload.append(payload);
 }
+void data::append_payload(const char* payload, size_t size) {
+    // Appends without an exact fit reserve, so a payload built from many
+    // pieces grows geometrically. Call reserve_payload first if the final
+    // size is known.
+    m_payload.append(payload, size);
+}
+void data::reserve_payload(size_t size) {
+    m_payload.reserve(size);
+}
 void data::mask() {
     if (m_masked && m_payload.size() > 0) {
         // By default WebSocket++ performs block masking/unmasking in a mannor that makes
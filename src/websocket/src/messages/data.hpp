@@ -194,6 +194,8 @@ public:
     // immediately and throws processor::exception if it fails
     void set_payload(const std::string& payload);
     void append_payload(const std::string& payload);
+    void append_payload(const char* payload, size_t size);
+    void reserve_payload(size_t size);
     
     void set_header(const std::string& header);
     